@@ -0,0 +1,89 @@
+// GC-pressure benchmark for pooled receive buffers.
+//
+// Streams small messages over PUSH/PULL and compares event-driven receive
+// with and without a buffer pool, reporting throughput and the number and
+// total duration of garbage collections observed during each run.
+//
+// Usage: node bench/recvPool.js [messages] [size]
+
+const { PerformanceObserver } = require('perf_hooks');
+const nng = require('../lib/index');
+
+const MESSAGES = parseInt(process.argv[2], 10) || 500000;
+const SIZE = parseInt(process.argv[3], 10) || 100;
+const BATCH = 1000;
+
+function delay(ms) {
+    return new Promise(resolve => setTimeout(resolve, ms));
+}
+
+async function run(name, port, options, release) {
+    const push = nng.push();
+    const pull = nng.pull();
+
+    pull.listen(`tcp://127.0.0.1:${port}`);
+    push.dial(`tcp://127.0.0.1:${port}`);
+    await delay(200);
+
+    let gcCount = 0;
+    let gcTime = 0;
+    const obs = new PerformanceObserver(list => {
+        for (const entry of list.getEntries()) {
+            gcCount++;
+            gcTime += entry.duration;
+        }
+    });
+    obs.observe({ entryTypes: ['gc'] });
+
+    let received = 0;
+    let bytes = 0;
+    let doneResolve;
+    const done = new Promise(resolve => { doneResolve = resolve; });
+
+    pull.startRecv((err, data) => {
+        if (err) return;
+        bytes += data.length;
+        if (release) pull.release(data);
+        if (++received === MESSAGES) doneResolve();
+    }, options);
+
+    const payload = [];
+    for (let i = 0; i < BATCH; i++) {
+        payload.push(Buffer.alloc(SIZE, i & 0xff));
+    }
+
+    const start = process.hrtime.bigint();
+    for (let sent = 0; sent < MESSAGES; sent += BATCH) {
+        await push.sendMany(payload.slice(0, Math.min(BATCH, MESSAGES - sent)));
+    }
+    await done;
+    const elapsed = Number(process.hrtime.bigint() - start) / 1e6;
+
+    // Let pending GC entries be reported
+    await delay(50);
+    obs.disconnect();
+
+    const stats = pull.recvStats();
+    pull.stopRecv();
+    push.close();
+    pull.close();
+
+    const rate = Math.round(MESSAGES / elapsed * 1000);
+    console.log(`${name.padEnd(22)} ${String(rate).padStart(9)} msg/s  ` +
+        `${String(gcCount).padStart(5)} GCs  ${gcTime.toFixed(1).padStart(8)} ms in GC` +
+        (options.pool ? `  (pool hits ${stats.poolHits}, misses ${stats.poolMisses})` : ''));
+}
+
+async function main() {
+    console.log(`Receiving ${MESSAGES} messages of ${SIZE} bytes`);
+    console.log('==========================================');
+
+    await run('unpooled', 5590, {}, false);
+    await run('pooled (GC release)', 5591, { pool: { slabSize: 256 * 1024, maxSlabs: 64 } }, false);
+    await run('pooled (release())', 5592, { pool: { slabSize: 256 * 1024, maxSlabs: 64 } }, true);
+}
+
+main().catch(err => {
+    console.error('Benchmark failed:', err);
+    process.exit(1);
+});
@@ -6,7 +6,12 @@
         "src/nng_bindings.c",
         "src/socket.c",
         "src/dialer.c",
-        "src/listener.c"
+        "src/listener.c",
+        "src/poller.c",
+        "src/recv_pool.c",
+        "src/context.c",
+        "src/http.c",
+        "src/batch.c"
       ],
       "include_dirs": [
         "deps/nng/include"
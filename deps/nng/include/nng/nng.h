@@ -657,11 +657,28 @@ NNG_DECL void nng_sleep_aio(nng_duration, nng_aio *);
 // Message API.
 NNG_DECL int      nng_msg_alloc(nng_msg **, size_t);
 NNG_DECL void     nng_msg_free(nng_msg *);
+
+// nng_msg_alloc_external creates a message whose body is the caller's
+// buffer, without copying it.  The callback (which may be NULL) is called
+// with the buffer, its size, and the argument once NNG no longer uses the
+// buffer: when the last reference to the message is freed, or when the
+// body is copied because it had to be modified (e.g. by nng_msg_append or
+// nng_msg_insert).  The buffer must stay valid and unchanged until then,
+// and must not be written through nng_msg_body, including on messages
+// received from an inproc peer.  The callback may run on any thread.
+typedef void (*nng_msg_free_cb)(void *, size_t, void *);
+NNG_DECL int nng_msg_alloc_external(
+    nng_msg **, void *, size_t, nng_msg_free_cb, void *);
+
 NNG_DECL int      nng_msg_realloc(nng_msg *, size_t);
 NNG_DECL int      nng_msg_reserve(nng_msg *, size_t);
 NNG_DECL size_t   nng_msg_capacity(nng_msg *);
 NNG_DECL void    *nng_msg_header(nng_msg *);
 NNG_DECL size_t   nng_msg_header_len(const nng_msg *);
+
+// nng_msg_body returns the message body as one contiguous buffer.  Data
+// inserted in front of a large body may be kept apart from it until this
+// is called, so this can need to copy the body (but it never fails).
 NNG_DECL void    *nng_msg_body(nng_msg *);
 NNG_DECL size_t   nng_msg_len(const nng_msg *);
 NNG_DECL int      nng_msg_append(nng_msg *, const void *, size_t);
@@ -836,6 +853,41 @@ NNG_DECL nng_listener nng_pipe_listener(nng_pipe);
 // which makes it more convenient than using the NNG_OPT_LOCADDR option.
 #define NNG_OPT_TCP_BOUND_PORT "tcp-bound-port"
 
+// TCP reuseport sets SO_REUSEPORT on a listener before it binds, so that
+// several processes (each with its own listener) can listen on the same
+// address and port, with the kernel distributing incoming connections
+// between them.  This is a boolean, only valid on listeners, and must be
+// set before the listener is started.  Platforms without SO_REUSEPORT
+// return NNG_ENOTSUP.
+#define NNG_OPT_TCP_REUSEPORT "tcp-reuseport"
+
+// TCP send delay lets the TCP transport hold a message for up to this
+// long (an nng_duration), waiting for more messages to write to the
+// connection with it, much as Nagle does for small segments.  Messages
+// that are already queued are always written together; this only
+// matters when there are fewer than a full write's worth.  It is set on
+// a dialer or listener, and applies to the pipes created after that.
+// The default is zero, which writes without waiting.
+#define NNG_OPT_TCP_SEND_DELAY "tcp-send-delay"
+
+// TCP zerocopy sends writes of at least this many bytes (a size_t) with
+// MSG_ZEROCOPY, so that the kernel sends straight from the message
+// rather than copying it first.  Such a write completes only once the
+// peer has acknowledged the data, so this is for large messages, where
+// the copying costs more than that wait.  It is set on a dialer or
+// listener, for the connections made after that, or on a connection.
+// Zero, the default, disables it.  Platforms that cannot do this (all
+// but Linux) return NNG_ENOTSUP for anything else.
+#define NNG_OPT_TCP_ZEROCOPY "tcp-zerocopy"
+
+// Inproc buffer gives each direction of an inproc connection room for
+// up to this many messages (an int), so that a sender can finish without
+// waiting for the peer to receive.  It is set on a dialer or listener,
+// and applies to the connections made after that; if the two ends
+// differ, the larger wins.  The default is zero, which hands each message
+// straight from the sender to a waiting receiver.
+#define NNG_OPT_INPROC_BUFFER "inproc-buffer"
+
 // IPC options.  These will largely vary depending on the platform,
 // as POSIX systems have very different options than Windows.
 
@@ -1509,7 +1561,9 @@ enum {
 	NNG_INIT_NUM_EXPIRE_THREADS,
 
 	// Fix the number of poller threads (used for I/O).  Support varies
-	// by platform (many platforms only support a single poller thread.)
+	// by platform (Windows and Linux epoll use this many threads, other
+	// platforms only support a single poller thread.)  Default is one
+	// thread per core, capped to NNG_INIT_MAX_POLLER_THREADS.
 	NNG_INIT_NUM_POLLER_THREADS,
 
 	// Fix the number of threads used for DNS resolution.  At least one
@@ -1532,6 +1586,22 @@ enum {
 	// Default is determined by NNG_MAX_POLLER_THREADS compile time
 	// variable.
 	NNG_INIT_MAX_POLLER_THREADS,
+
+	// Limit the memory the message pool keeps for reuse, in bytes.
+	// Zero disables pooling.  Default is determined by the
+	// NNG_MSGPOOL_MAX_BYTES compile time variable.
+	NNG_INIT_MSGPOOL_MAX_BYTES,
+
+	// Register descriptors with epoll edge-triggered, rather than
+	// oneshot, if non-zero.  Only Linux epoll uses this.  Default is
+	// determined by the NNG_POLLER_EDGE compile time variable.
+	NNG_INIT_POLLER_EDGE,
+
+	// Do TCP and IPC transfers and accepts with io_uring, rather than
+	// the poller, if non-zero.  Only Linux uses this, and falls back to
+	// epoll if the kernel lacks what it needs.  Default is determined by
+	// the NNG_IO_URING compile time variable.
+	NNG_INIT_IO_URING,
 };
 
 // Logging support.
@@ -12,12 +12,14 @@
 #include <string.h>
 
 struct nni_aio_expire_q {
-	nni_mtx  eq_mtx;
-	nni_cv   eq_cv;
-	nni_list eq_list;
-	nni_thr  eq_thr;
-	nni_time eq_next; // next expiration
-	bool     eq_exit;
+	nni_mtx   eq_mtx;
+	nni_cv    eq_cv;
+	nni_aio **eq_heap; // min-heap, ordered by a_expire
+	unsigned  eq_len;
+	unsigned  eq_cap;
+	nni_thr   eq_thr;
+	nni_time  eq_next; // next expiration
+	bool      eq_exit;
 };
 
 static nni_aio_expire_q **nni_aio_expire_q_list;
@@ -43,12 +45,29 @@ static int                nni_aio_expire_q_cnt;
 // caused by a single lock.  The number of queues (and threads) can
 // be tuned using the NNG_NUM_EXPIRE_THREADS tunable.
 //
+// Each queue keeps its pending expirations in a binary min-heap, ordered
+// by expiration time, and every aio records its position in the heap.
+// So adding or removing an expiration is O(log n), and the expiration
+// thread only looks at the aios that are actually due, instead of
+// scanning everything outstanding each time it wakes up.
+//
+// The cancellation state of each aio (the cancel function, and the
+// stop and sleep flags) is protected by a lock in the aio itself, rather
+// than by the expire queue lock.  Most operations have no deadline, and
+// so never need to touch the expire queue, which is shared by many aios.
+// The expire queue lock is only needed to add or remove an aio from
+// the heap.  When both locks are held, the expire queue lock is always
+// taken first.  a_expire_idx and a_expiring are only changed with both
+// held, so they can be checked under either lock.
+//
 // We will not permit an AIO
 // to be marked done if an expiration is outstanding.
 //
 // In order to synchronize with the expiration, we record the aio as
 // expiring, and wait for that record to be cleared (or at least not
-// equal to the aio) before destroying it.
+// equal to the aio) before destroying it.  While it is expiring, the
+// expiration thread owns the cancel function, and so the completion;
+// nobody else may abort the task out from under it.
 //
 // The aio framework is tightly bound up with the task framework. We
 // "prepare" the task for an aio when a caller marks an aio as starting
@@ -75,13 +94,44 @@ static nni_reap_list aio_reap_list = {
 	.rl_func   = nni_aio_free_cb,
 };
 
+static int  nni_aio_expire_reserve(nni_aio_expire_q *);
 static void nni_aio_expire_add(nni_aio *);
 static void nni_aio_expire_rm(nni_aio *);
 
+// nni_aio_lock locks the aio.  If the aio is on the expire heap, then
+// the expire queue is locked as well, and returned, so that the caller
+// can remove it.  Otherwise NULL is returned.
+static nni_aio_expire_q *
+nni_aio_lock(nni_aio *aio)
+{
+	nni_aio_expire_q *eq = aio->a_expire_q;
+
+	nni_mtx_lock(&aio->a_mtx);
+	if (aio->a_expire_idx == 0) {
+		return (NULL);
+	}
+	// Wrong lock order, so start over.  It might be off the
+	// heap by the time we get back, but that is harmless.
+	nni_mtx_unlock(&aio->a_mtx);
+	nni_mtx_lock(&eq->eq_mtx);
+	nni_mtx_lock(&aio->a_mtx);
+	return (eq);
+}
+
+static void
+nni_aio_unlock(nni_aio *aio, nni_aio_expire_q *eq)
+{
+	nni_mtx_unlock(&aio->a_mtx);
+	if (eq != NULL) {
+		nni_mtx_unlock(&eq->eq_mtx);
+	}
+}
+
 void
 nni_aio_init(nni_aio *aio, nni_cb cb, void *arg)
 {
 	memset(aio, 0, sizeof(*aio));
+	nni_mtx_init(&aio->a_mtx);
 	nni_task_init(&aio->a_task, NULL, cb, arg);
 	aio->a_expire  = NNI_TIME_NEVER;
 	aio->a_timeout = NNG_DURATION_INFINITE;
@@ -101,16 +151,19 @@ nni_aio_fini(nni_aio *aio)
 	// for the task.  (Because we implicitly do task_fini.)
 	// We also wait if the aio is being expired.
 	nni_mtx_lock(&eq->eq_mtx);
+	nni_mtx_lock(&aio->a_mtx);
 	aio->a_stop = true;
+	nni_mtx_unlock(&aio->a_mtx);
 	while (aio->a_expiring) {
 		nni_cv_wait(&eq->eq_cv);
 	}
+	nni_mtx_lock(&aio->a_mtx);
 	nni_aio_expire_rm(aio);
 	fn                = aio->a_cancel_fn;
 	arg               = aio->a_cancel_arg;
 	aio->a_cancel_fn  = NULL;
 	aio->a_cancel_arg = NULL;
-	nni_mtx_unlock(&eq->eq_mtx);
+	nni_aio_unlock(aio, eq);
 
 	if (fn != NULL) {
 		fn(aio, arg, NNG_ECLOSED);
@@ -119,6 +172,7 @@ nni_aio_fini(nni_aio *aio)
 	}
 
 	nni_task_fini(&aio->a_task);
+	nni_mtx_fini(&aio->a_mtx);
 }
 
 int
@@ -188,20 +242,22 @@ nni_aio_stop(nni_aio *aio)
 	if (aio != NULL) {
 		nni_aio_cancel_fn fn;
 		void             *arg;
-		nni_aio_expire_q *eq = aio->a_expire_q;
+		bool              expiring;
+		nni_aio_expire_q *eq;
 
-		nni_mtx_lock(&eq->eq_mtx);
+		eq = nni_aio_lock(aio);
 		nni_aio_expire_rm(aio);
 		fn                = aio->a_cancel_fn;
 		arg               = aio->a_cancel_arg;
+		expiring          = aio->a_expiring;
 		aio->a_cancel_fn  = NULL;
 		aio->a_cancel_arg = NULL;
 		aio->a_stop       = true;
-		nni_mtx_unlock(&eq->eq_mtx);
+		nni_aio_unlock(aio, eq);
 
 		if (fn != NULL) {
 			fn(aio, arg, NNG_ECANCELED);
-		} else {
+		} else if (!expiring) {
 			nni_task_abort(&aio->a_task);
 		}
 
@@ -215,20 +271,22 @@ nni_aio_close(nni_aio *aio)
 	if (aio != NULL) {
 		nni_aio_cancel_fn fn;
 		void             *arg;
-		nni_aio_expire_q *eq = aio->a_expire_q;
+		bool              expiring;
+		nni_aio_expire_q *eq;
 
-		nni_mtx_lock(&eq->eq_mtx);
+		eq = nni_aio_lock(aio);
 		nni_aio_expire_rm(aio);
 		fn                = aio->a_cancel_fn;
 		arg               = aio->a_cancel_arg;
+		expiring          = aio->a_expiring;
 		aio->a_cancel_fn  = NULL;
 		aio->a_cancel_arg = NULL;
 		aio->a_stop       = true;
-		nni_mtx_unlock(&eq->eq_mtx);
+		nni_aio_unlock(aio, eq);
 
 		if (fn != NULL) {
 			fn(aio, arg, NNG_ECLOSED);
-		} else {
+		} else if (!expiring) {
 			nni_task_abort(&aio->a_task);
 		}
 	}
@@ -332,21 +390,20 @@ nni_aio_begin(nni_aio *aio)
 	// a bug in the caller.  These checks are not technically thread
 	// safe in the event that they are false.  Users of race detectors
 	// checks may wish ignore or suppress these checks.
-	nni_aio_expire_q *eq = aio->a_expire_q;
-
-	nni_mtx_lock(&eq->eq_mtx);
+	nni_mtx_lock(&aio->a_mtx);
 	NNI_ASSERT(!nni_aio_list_active(aio));
 	NNI_ASSERT(aio->a_cancel_fn == NULL);
-	NNI_ASSERT(!nni_list_node_active(&aio->a_expire_node));
+	NNI_ASSERT(aio->a_expire_idx == 0);
 
 	// Some initialization can be done outside the lock, because
 	// we must have exclusive access to the aio.
 	for (unsigned i = 0; i < NNI_NUM_ELEMENTS(aio->a_outputs); i++) {
 		aio->a_outputs[i] = NULL;
 	}
-	aio->a_result    = 0;
-	aio->a_count     = 0;
-	aio->a_cancel_fn = NULL;
+	aio->a_result     = 0;
+	aio->a_count      = 0;
+	aio->a_cancel_fn  = NULL;
+	aio->a_inline_now = false;
 
 	// We should not reschedule anything at this point.
 	if (aio->a_stop) {
@@ -355,19 +412,19 @@ nni_aio_begin(nni_aio *aio)
 		aio->a_expire    = NNI_TIME_NEVER;
 		aio->a_sleep     = false;
 		aio->a_expire_ok = false;
-		nni_mtx_unlock(&eq->eq_mtx);
+		nni_mtx_unlock(&aio->a_mtx);
 
 		return (NNG_ECANCELED);
 	}
 	nni_task_prep(&aio->a_task);
-	nni_mtx_unlock(&eq->eq_mtx);
+	nni_mtx_unlock(&aio->a_mtx);
 	return (0);
 }
 
 int
 nni_aio_schedule(nni_aio *aio, nni_aio_cancel_fn cancel, void *data)
 {
-	nni_aio_expire_q *eq = aio->a_expire_q;
+	nni_aio_expire_q *eq = NULL;
 
 	if ((!aio->a_sleep) && (!aio->a_use_expire)) {
 		// Convert the relative timeout to an absolute timeout.
@@ -385,23 +442,33 @@ nni_aio_schedule(nni_aio *aio, nni_aio_cancel_fn cancel, void *data)
 		}
 	}
 
-	nni_mtx_lock(&eq->eq_mtx);
+	// We only schedule expiration if we have a way for the expiration
+	// handler to actively cancel it.  Without a deadline, the expire
+	// queue is left alone entirely.
+	if ((aio->a_expire != NNI_TIME_NEVER) && (cancel != NULL)) {
+		eq = aio->a_expire_q;
+		nni_mtx_lock(&eq->eq_mtx);
+	}
+	nni_mtx_lock(&aio->a_mtx);
 	if (aio->a_stop) {
 		nni_task_abort(&aio->a_task);
-		nni_mtx_unlock(&eq->eq_mtx);
+		nni_aio_unlock(aio, eq);
 		return (NNG_ECLOSED);
 	}
 
 	NNI_ASSERT(aio->a_cancel_fn == NULL);
-	aio->a_cancel_fn  = cancel;
-	aio->a_cancel_arg = data;
 
-	// We only schedule expiration if we have a way for the expiration
-	// handler to actively cancel it.
-	if ((aio->a_expire != NNI_TIME_NEVER) && (cancel != NULL)) {
+	if (eq != NULL) {
+		if (nni_aio_expire_reserve(eq) != 0) {
+			nni_task_abort(&aio->a_task);
+			nni_aio_unlock(aio, eq);
+			return (NNG_ENOMEM);
+		}
 		nni_aio_expire_add(aio);
 	}
-	nni_mtx_unlock(&eq->eq_mtx);
+	aio->a_cancel_fn  = cancel;
+	aio->a_cancel_arg = data;
+	nni_aio_unlock(aio, eq);
 	return (0);
 }
 
@@ -412,20 +479,23 @@ nni_aio_abort(nni_aio *aio, int rv)
 {
 	nni_aio_cancel_fn fn;
 	void             *arg;
-	nni_aio_expire_q *eq = aio->a_expire_q;
+	bool              expiring;
+	nni_aio_expire_q *eq;
 
-	nni_mtx_lock(&eq->eq_mtx);
+	eq = nni_aio_lock(aio);
 	nni_aio_expire_rm(aio);
 	fn                = aio->a_cancel_fn;
 	arg               = aio->a_cancel_arg;
+	expiring          = aio->a_expiring;
 	aio->a_cancel_fn  = NULL;
 	aio->a_cancel_arg = NULL;
-	nni_mtx_unlock(&eq->eq_mtx);
+	nni_aio_unlock(aio, eq);
 
-	// Stop any I/O at the provider level.
+	// Stop any I/O at the provider level.  If the expiration thread
+	// has the cancel function, it will see to the completion.
 	if (fn != NULL) {
 		fn(aio, arg, rv);
-	} else {
+	} else if (!expiring) {
 		nni_task_abort(&aio->a_task);
 	}
 }
@@ -436,9 +506,9 @@ static void
 nni_aio_finish_impl(
     nni_aio *aio, int rv, size_t count, nni_msg *msg, bool sync)
 {
-	nni_aio_expire_q *eq = aio->a_expire_q;
+	nni_aio_expire_q *eq;
 
-	nni_mtx_lock(&eq->eq_mtx);
+	eq = nni_aio_lock(aio);
 
 	nni_aio_expire_rm(aio);
 	aio->a_result     = rv;
@@ -452,7 +522,7 @@ nni_aio_finish_impl(
 	aio->a_expire     = NNI_TIME_NEVER;
 	aio->a_sleep      = false;
 	aio->a_use_expire = false;
-	nni_mtx_unlock(&eq->eq_mtx);
+	nni_aio_unlock(aio, eq);
 
 	if (sync) {
 		nni_task_exec(&aio->a_task);
@@ -545,12 +615,116 @@ nni_aio_completions_run(nni_aio_completions *clp)
 	}
 }
 
+void
+nni_aio_set_inline(nni_aio *aio, bool inl)
+{
+	aio->a_inline = inl;
+}
+
+void
+nni_aio_completions_defer(
+    nni_aio_completions *clp, nni_aio *aio, int result, size_t count)
+{
+	if ((clp != NULL) && aio->a_inline) {
+		aio->a_inline_now = true;
+		nni_aio_completions_add(clp, aio, result, count);
+	} else {
+		nni_aio_finish(aio, result, count);
+	}
+}
+
+bool
+nni_aio_completing_inline(nni_aio *aio)
+{
+	return (aio->a_inline_now);
+}
+
+// The heap is stored in an array, with the children of slot i in slots
+// 2i+1 and 2i+2.  Each aio keeps its slot plus one in a_expire_idx, so
+// that zero means it is not in the heap.
+
+static void
+nni_aio_expire_set(nni_aio_expire_q *eq, unsigned i, nni_aio *aio)
+{
+	eq->eq_heap[i]    = aio;
+	aio->a_expire_idx = i + 1;
+}
+
+static void
+nni_aio_expire_up(nni_aio_expire_q *eq, unsigned i)
+{
+	nni_aio *aio = eq->eq_heap[i];
+
+	while (i > 0) {
+		unsigned parent = (i - 1) / 2;
+		if (eq->eq_heap[parent]->a_expire <= aio->a_expire) {
+			break;
+		}
+		nni_aio_expire_set(eq, i, eq->eq_heap[parent]);
+		i = parent;
+	}
+	nni_aio_expire_set(eq, i, aio);
+}
+
+static void
+nni_aio_expire_down(nni_aio_expire_q *eq, unsigned i)
+{
+	nni_aio *aio = eq->eq_heap[i];
+
+	for (;;) {
+		unsigned child = (2 * i) + 1;
+		if (child >= eq->eq_len) {
+			break;
+		}
+		if ((child + 1 < eq->eq_len) &&
+		    (eq->eq_heap[child + 1]->a_expire <
+		        eq->eq_heap[child]->a_expire)) {
+			child++;
+		}
+		if (aio->a_expire <= eq->eq_heap[child]->a_expire) {
+			break;
+		}
+		nni_aio_expire_set(eq, i, eq->eq_heap[child]);
+		i = child;
+	}
+	nni_aio_expire_set(eq, i, aio);
+}
+
+// nni_aio_expire_reserve makes sure there is room to add one more aio
+// to the heap, so that nni_aio_expire_add cannot fail.
+static int
+nni_aio_expire_reserve(nni_aio_expire_q *eq)
+{
+	nni_aio **heap;
+	unsigned  cap;
+
+	if (eq->eq_len < eq->eq_cap) {
+		return (0);
+	}
+	cap = eq->eq_cap == 0 ? 64 : eq->eq_cap * 2;
+	if ((heap = nni_alloc(sizeof(nni_aio *) * cap)) == NULL) {
+		return (NNG_ENOMEM);
+	}
+	if (eq->eq_len > 0) {
+		memcpy(heap, eq->eq_heap, sizeof(nni_aio *) * eq->eq_len);
+	}
+	if (eq->eq_heap != NULL) {
+		nni_free(eq->eq_heap, sizeof(nni_aio *) * eq->eq_cap);
+	}
+	eq->eq_heap = heap;
+	eq->eq_cap  = cap;
+	return (0);
+}
+
 static void
 nni_aio_expire_add(nni_aio *aio)
 {
 	nni_aio_expire_q *eq = aio->a_expire_q;
 
-	nni_list_append(&eq->eq_list, aio);
+	NNI_ASSERT(eq->eq_len < eq->eq_cap);
+	NNI_ASSERT(aio->a_expire_idx == 0);
+	eq->eq_heap[eq->eq_len] = aio;
+	nni_aio_expire_up(eq, eq->eq_len++);
 
 	if (eq->eq_next > aio->a_expire) {
 		eq->eq_next = aio->a_expire;
@@ -561,7 +735,26 @@ nni_aio_expire_add(nni_aio *aio)
 static void
 nni_aio_expire_rm(nni_aio *aio)
 {
-	nni_list_node_remove(&aio->a_expire_node);
+	nni_aio_expire_q *eq = aio->a_expire_q;
+	unsigned          i;
+	nni_aio          *last;
+
+	if (aio->a_expire_idx == 0) {
+		return;
+	}
+	i                 = aio->a_expire_idx - 1;
+	aio->a_expire_idx = 0;
+	last              = eq->eq_heap[--eq->eq_len];
+	if (last != aio) {
+		// Move the last entry into the hole, and restore order.
+		nni_aio_expire_set(eq, i, last);
+		if ((i > 0) &&
+		    (last->a_expire < eq->eq_heap[(i - 1) / 2]->a_expire)) {
+			nni_aio_expire_up(eq, i);
+		} else {
+			nni_aio_expire_down(eq, i);
+		}
+	}
 
 	// If this item is the one that is going to wake the loop,
 	// don't worry about it.  It will wake up normally, or when we
@@ -578,6 +771,8 @@ nni_aio_expire_loop(void *arg)
 	nni_time          now;
 	uint32_t          exp_idx;
 	nni_aio          *expires[NNI_EXPIRE_BATCH];
+	nni_aio_cancel_fn cancel_fns[NNI_EXPIRE_BATCH];
+	void             *cancel_args[NNI_EXPIRE_BATCH];
 
 	nni_thr_set_name(NULL, "nng:aio:expire");
 
@@ -586,75 +781,61 @@ nni_aio_expire_loop(void *arg)
 	for (;;) {
 		nni_aio *aio;
 		int      rv;
-		nni_time next;
-
-		next = q->eq_next;
-		now  = nni_clock();
-
-		// Each time we wake up, we scan the entire list of elements.
-		// We scan forward, moving up to NNI_EXPIRE_Q_SIZE elements
-		// (a batch) to a saved array of things we are going to cancel.
-		// This mostly runs in O(n), provided you don't have many
-		// elements (> NNI_EXPIRE_Q_SIZE) all expiring simultaneously.
-		aio = nni_list_first(&q->eq_list);
-		if ((aio == NULL) && (q->eq_exit)) {
+
+		if ((q->eq_len == 0) && (q->eq_exit)) {
 			nni_mtx_unlock(mtx);
 			return;
 		}
-		if (now < next) {
-			// Early wake up (just to reschedule), no need to
-			// rescan the list.  This is an optimization.
-			nni_cv_until(cv, next);
+		now = nni_clock();
+		if (now < q->eq_next) {
+			// Early wake up (just to reschedule).
+			nni_cv_until(cv, q->eq_next);
 			continue;
 		}
-		q->eq_next = NNI_TIME_NEVER;
-		exp_idx    = 0;
-		while (aio != NULL) {
-			if ((aio->a_expire < now) &&
-			    (exp_idx < NNI_EXPIRE_BATCH)) {
-				nni_aio *nxt;
-
-				// This one is expiring.
-				expires[exp_idx++] = aio;
-				// save the next node
-				nxt = nni_list_next(&q->eq_list, aio);
-				nni_list_remove(&q->eq_list, aio);
-				// Place a temporary hold on the aio.
-				// This prevents it from being destroyed.
-				aio->a_expiring = true;
-				aio             = nxt;
-				continue;
-			}
-			if (aio->a_expire < q->eq_next) {
-				q->eq_next = aio->a_expire;
+
+		// Take up to a batch of the aios that are due off the
+		// top of the heap.  Anything left stays for the next pass.
+		exp_idx = 0;
+		while ((q->eq_len > 0) && (exp_idx < NNI_EXPIRE_BATCH)) {
+			aio = q->eq_heap[0];
+			if (aio->a_expire >= now) {
+				break;
 			}
-			aio = nni_list_next(&q->eq_list, aio);
+			nni_mtx_lock(&aio->a_mtx);
+			nni_aio_expire_rm(aio);
+			cancel_fns[exp_idx]  = aio->a_cancel_fn;
+			cancel_args[exp_idx] = aio->a_cancel_arg;
+			aio->a_cancel_fn     = NULL;
+			aio->a_cancel_arg    = NULL;
+			// Place a temporary hold on the aio.
+			// This prevents it from being destroyed.
+			aio->a_expiring = true;
+			nni_mtx_unlock(&aio->a_mtx);
+			expires[exp_idx++] = aio;
 		}
 
 		for (uint32_t i = 0; i < exp_idx; i++) {
 			aio = expires[i];
 			rv  = aio->a_expire_ok ? 0 : NNG_ETIMEDOUT;
 
-			nni_aio_cancel_fn cancel_fn  = aio->a_cancel_fn;
-			void             *cancel_arg = aio->a_cancel_arg;
-
-			aio->a_cancel_fn  = NULL;
-			aio->a_cancel_arg = NULL;
-
 			// We let the cancel function handle the completion.
 			// If there is no cancellation function, then we cannot
 			// terminate the aio - we've tried, but it has to run
 			// to its natural conclusion.
-			if (cancel_fn != NULL) {
+			if (cancel_fns[i] != NULL) {
 				nni_mtx_unlock(mtx);
-				cancel_fn(aio, cancel_arg, rv);
+				cancel_fns[i](aio, cancel_args[i], rv);
 				nni_mtx_lock(mtx);
 			}
+			nni_mtx_lock(&aio->a_mtx);
 			aio->a_expiring = false;
+			nni_mtx_unlock(&aio->a_mtx);
 		}
 		nni_cv_wake(cv);
 
-		if (now < q->eq_next) {
+		q->eq_next =
+		    q->eq_len > 0 ? q->eq_heap[0]->a_expire : NNI_TIME_NEVER;
+		if ((exp_idx < NNI_EXPIRE_BATCH) && (now < q->eq_next)) {
 			nni_cv_until(cv, q->eq_next);
 		}
 	}
@@ -729,17 +910,17 @@ static void
 nni_sleep_cancel(nng_aio *aio, void *arg, int rv)
 {
 	NNI_ARG_UNUSED(arg);
-	nni_aio_expire_q *eq = aio->a_expire_q;
+	nni_aio_expire_q *eq;
 
-	nni_mtx_lock(&eq->eq_mtx);
+	eq = nni_aio_lock(aio);
 	if (!aio->a_sleep) {
-		nni_mtx_unlock(&eq->eq_mtx);
+		nni_aio_unlock(aio, eq);
 		return;
 	}
 
 	aio->a_sleep = false;
 	nni_aio_expire_rm(aio);
-	nni_mtx_unlock(&eq->eq_mtx);
+	nni_aio_unlock(aio, eq);
 
 	nni_aio_finish_error(aio, rv);
 }
@@ -789,6 +970,9 @@ nni_aio_expire_q_free(nni_aio_expire_q *eq)
 	nni_thr_fini(&eq->eq_thr);
 	nni_cv_fini(&eq->eq_cv);
 	nni_mtx_fini(&eq->eq_mtx);
+	if (eq->eq_heap != NULL) {
+		nni_free(eq->eq_heap, sizeof(nni_aio *) * eq->eq_cap);
+	}
 	NNI_FREE_STRUCT(eq);
 }
 
@@ -802,7 +986,6 @@ nni_aio_expire_q_alloc(void)
 	}
 	nni_mtx_init(&eq->eq_mtx);
 	nni_cv_init(&eq->eq_cv, &eq->eq_mtx);
-	NNI_LIST_INIT(&eq->eq_list, nni_aio, a_expire_node);
 	eq->eq_next = NNI_TIME_NEVER;
 	eq->eq_exit = false;
 
@@ -193,6 +193,27 @@ extern void nni_aio_completions_run(nni_aio_completions *);
 extern void nni_aio_completions_add(
     nni_aio_completions *, nni_aio *, int, size_t);
 
+// nni_aio_set_inline permits the completion callback of the aio to run
+// directly on the I/O thread that completes it, rather than on the task
+// queue.  This saves a thread hop, but is only suitable for callbacks
+// that are short and never block.
+extern void nni_aio_set_inline(nni_aio *, bool);
+
+// nni_aio_completions_defer is for providers completing I/O on their
+// own I/O threads.  If the completion list is not NULL and the aio
+// permits inline completion, the aio is added to the list, which the
+// provider runs after dropping its locks.  Otherwise the aio is simply
+// finished with nni_aio_finish.  The aio must not be on any list.
+extern void nni_aio_completions_defer(
+    nni_aio_completions *, nni_aio *, int, size_t);
+
+// nni_aio_completing_inline is for use in the completion callback, before
+// the aio is restarted.  It reports whether the callback is running
+// inline on an I/O thread.  Such a callback must not run the callbacks
+// of other aios synchronously (e.g. with nni_aio_finish_sync), as those
+// may take locks or run for longer, stalling the I/O thread.
+extern bool nni_aio_completing_inline(nni_aio *);
+
 extern int  nni_aio_sys_init(void);
 extern void nni_aio_sys_fini(void);
 
@@ -214,7 +235,10 @@ struct nng_aio {
 	bool         a_expire_ok;  // Expire from sleep is ok
 	bool         a_expiring;   // Expiration in progress
 	bool         a_use_expire; // Use expire instead of timeout
+	bool         a_inline;     // Completion may run on the I/O thread
+	bool         a_inline_now; // Completion is running on the I/O thread
 	nni_task     a_task;
+	nni_mtx      a_mtx; // Protects cancellation state
 
 	// Read/write operations.
 	nni_iov  a_iov[8];
@@ -235,7 +259,7 @@ struct nng_aio {
 	void             *a_prov_data;
 	nni_list_node     a_prov_node; // Linkage on provider list.
 	nni_aio_expire_q *a_expire_q;
-	nni_list_node     a_expire_node; // Expiration node
+	unsigned          a_expire_idx; // Position in expire heap, plus one
 	nni_reap_node     a_reap_node;
 };
 
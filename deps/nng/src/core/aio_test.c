@@ -12,6 +12,8 @@
 
 #include <nuts.h>
 
+#include "core/nng_impl.h"
+
 static void
 cb_done(void *p)
 {
@@ -397,6 +399,251 @@ test_aio_busy(void)
 	nng_aio_free(aio);
 }
 
+typedef struct {
+	nng_mtx *mx;
+	nng_cv  *cv;
+	int      done;
+	int      timedout;
+	int      canceled;
+} timer_stress;
+
+typedef struct {
+	nng_aio      *aio;
+	timer_stress *ts;
+} timer_stress_aio;
+
+static void
+timer_stress_cb(void *arg)
+{
+	timer_stress_aio *ta = arg;
+	timer_stress     *ts = ta->ts;
+	int               rv = nng_aio_result(ta->aio);
+
+	nng_mtx_lock(ts->mx);
+	if (rv == NNG_ETIMEDOUT) {
+		ts->timedout++;
+	} else if (rv == NNG_ECANCELED) {
+		ts->canceled++;
+	}
+	ts->done++;
+	nng_cv_wake(ts->cv);
+	nng_mtx_unlock(ts->mx);
+}
+
+// Benchmark the expiration queues with a large number of outstanding
+// timed operations: schedule them all, cancel every other one, and let
+// the rest time out.
+void
+test_aio_timer_stress(void)
+{
+	enum { NAIO = 1000000 };
+	timer_stress      ts;
+	timer_stress_aio *tas;
+	nng_time          t0, t1, t2, t3;
+
+	memset(&ts, 0, sizeof(ts));
+	NUTS_PASS(nng_mtx_alloc(&ts.mx));
+	NUTS_PASS(nng_cv_alloc(&ts.cv, ts.mx));
+	NUTS_ASSERT((tas = calloc(NAIO, sizeof(*tas))) != NULL);
+	for (int i = 0; i < NAIO; i++) {
+		tas[i].ts = &ts;
+		NUTS_PASS(nng_aio_alloc(&tas[i].aio, timer_stress_cb, &tas[i]));
+	}
+
+	// Sleep with a shorter timeout, so that these complete with
+	// NNG_ETIMEDOUT, spreading the deadlines over half a second.  The
+	// deadlines are far enough out that the cancels come first.
+	t0 = nng_clock();
+	for (int i = 0; i < NAIO; i++) {
+		nng_aio_set_timeout(tas[i].aio, 3000 + (i % 500));
+		nng_sleep_aio(60000, tas[i].aio);
+	}
+	t1 = nng_clock();
+	for (int i = 0; i < NAIO; i += 2) {
+		nng_aio_cancel(tas[i].aio);
+	}
+	t2 = nng_clock();
+
+	nng_mtx_lock(ts.mx);
+	while (ts.done < NAIO) {
+		NUTS_PASS(nng_cv_until(ts.cv, nng_clock() + 30000));
+	}
+	nng_mtx_unlock(ts.mx);
+	t3 = nng_clock();
+
+	NUTS_ASSERT(ts.canceled == NAIO / 2);
+	NUTS_ASSERT(ts.timedout == NAIO / 2);
+
+	for (int i = 0; i < NAIO; i++) {
+		nng_aio_free(tas[i].aio);
+	}
+	free(tas);
+	nng_cv_free(ts.cv);
+	nng_mtx_free(ts.mx);
+
+	printf("  %d timed aios: schedule %u ms, cancel half %u ms, "
+	       "rest expired after %u ms\n",
+	    NAIO, (unsigned) (t1 - t0), (unsigned) (t2 - t1),
+	    (unsigned) (t3 - t0));
+}
+
+typedef struct {
+	nng_mtx *mx;
+	nng_aio *aio;
+	bool     active;
+	int      finished;
+	int      canceled;
+} untimed_slot;
+
+static volatile bool untimed_stop;
+
+static void
+untimed_cancel(nng_aio *aio, void *arg, int rv)
+{
+	untimed_slot *slot = arg;
+
+	nng_mtx_lock(slot->mx);
+	if (!slot->active) {
+		nng_mtx_unlock(slot->mx);
+		return;
+	}
+	slot->active = false;
+	nng_mtx_unlock(slot->mx);
+	nng_aio_finish(aio, rv);
+}
+
+static void
+untimed_worker(void *arg)
+{
+	untimed_slot *slot = arg;
+
+	for (int i = 0; i < 100000; i++) {
+		if (!nng_aio_begin(slot->aio)) {
+			continue;
+		}
+		nng_mtx_lock(slot->mx);
+		slot->active = true;
+		nng_aio_defer(slot->aio, untimed_cancel, slot);
+		if (slot->active) {
+			slot->active = false;
+			nng_mtx_unlock(slot->mx);
+			nng_aio_finish(slot->aio, 0);
+		} else {
+			nng_mtx_unlock(slot->mx);
+		}
+		nng_aio_wait(slot->aio);
+		if (nng_aio_result(slot->aio) == NNG_ECANCELED) {
+			slot->canceled++;
+		} else {
+			slot->finished++;
+		}
+	}
+}
+
+static void
+untimed_canceler(void *arg)
+{
+	untimed_slot *slots = arg;
+
+	while (!untimed_stop) {
+		for (int i = 0; i < 4; i++) {
+			nng_aio_cancel(slots[i].aio);
+		}
+	}
+}
+
+// Operations without a deadline should not need the expire queues,
+// even while a consumer is canceling them concurrently.
+void
+test_aio_untimed_race(void)
+{
+	untimed_slot slots[4];
+	nng_thread  *thrs[4];
+	nng_thread  *canceler;
+	nng_time     t0, t1;
+	int          total = 0;
+
+	untimed_stop = false;
+	for (int i = 0; i < 4; i++) {
+		memset(&slots[i], 0, sizeof(slots[i]));
+		NUTS_PASS(nng_mtx_alloc(&slots[i].mx));
+		NUTS_PASS(nng_aio_alloc(&slots[i].aio, NULL, NULL));
+		nng_aio_set_timeout(slots[i].aio, NNG_DURATION_INFINITE);
+	}
+	NUTS_PASS(nng_thread_create(&canceler, untimed_canceler, slots));
+	t0 = nng_clock();
+	for (int i = 0; i < 4; i++) {
+		NUTS_PASS(nng_thread_create(&thrs[i], untimed_worker, &slots[i]));
+	}
+	for (int i = 0; i < 4; i++) {
+		nng_thread_destroy(thrs[i]);
+	}
+	t1           = nng_clock();
+	untimed_stop = true;
+	nng_thread_destroy(canceler);
+
+	for (int i = 0; i < 4; i++) {
+		NUTS_ASSERT(!nng_aio_busy(slots[i].aio));
+		total += slots[i].finished + slots[i].canceled;
+		nng_aio_free(slots[i].aio);
+		nng_mtx_free(slots[i].mx);
+	}
+	NUTS_ASSERT(total == 4 * 100000);
+	printf("  %d untimed operations in %u ms\n", total,
+	    (unsigned) (t1 - t0));
+}
+
+static void
+inline_cb(void *arg)
+{
+	nni_aio **aiop = arg;
+	nni_aio  *aio  = aiop[0];
+
+	// Records whether this was an inline completion.
+	aiop[1] = nni_aio_completing_inline(aio) ? aio : NULL;
+}
+
+// Providers complete inline aios through a completions list, which they
+// run after dropping their locks.  The callback can tell that it is
+// running on the provider's thread, so it can avoid doing much there.
+void
+test_aio_inline(void)
+{
+	nni_aio            *aio;
+	nni_aio            *arg[2] = { NULL, NULL };
+	nni_aio_completions cl;
+
+	NUTS_PASS(nni_init());
+	NUTS_PASS(nni_aio_alloc(&aio, inline_cb, arg));
+	arg[0] = aio;
+
+	// Not inline: the completion goes to the task queue.
+	nni_aio_completions_init(&cl);
+	NUTS_PASS(nni_aio_begin(aio));
+	nni_aio_completions_defer(&cl, aio, 0, 1);
+	NUTS_TRUE(cl == NULL);
+	nni_aio_wait(aio);
+	NUTS_TRUE(arg[1] == NULL);
+
+	// Inline: the completion runs with the list.
+	nni_aio_set_inline(aio, true);
+	NUTS_PASS(nni_aio_begin(aio));
+	nni_aio_completions_defer(&cl, aio, 0, 2);
+	NUTS_TRUE(cl != NULL);
+	nni_aio_completions_run(&cl);
+	NUTS_TRUE(arg[1] == aio);
+	NUTS_TRUE(nni_aio_count(aio) == 2);
+
+	// Without a list, even an inline aio goes to the task queue.
+	NUTS_PASS(nni_aio_begin(aio));
+	nni_aio_completions_defer(NULL, aio, 0, 3);
+	nni_aio_wait(aio);
+	NUTS_TRUE(arg[1] == NULL);
+	NUTS_TRUE(nni_aio_count(aio) == 3);
+
+	nni_aio_free(aio);
+}
+
 NUTS_TESTS = {
 	{ "sleep", test_sleep },
 	{ "sleep timeout", test_sleep_timeout },
@@ -412,5 +659,8 @@ NUTS_TESTS = {
 	{ "sleep loop", test_sleep_loop },
 	{ "sleep cancel", test_sleep_cancel },
 	{ "aio busy", test_aio_busy },
+	{ "aio timer stress", test_aio_timer_stress },
+	{ "aio untimed race", test_aio_untimed_race },
+	{ "aio inline", test_aio_inline },
 	{ NULL, NULL },
 };
@@ -36,6 +36,7 @@ nni_init_helper(void)
 	if (((rv = nni_taskq_sys_init()) != 0) ||
 	    ((rv = nni_reap_sys_init()) != 0) ||
 	    ((rv = nni_aio_sys_init()) != 0) ||
+	    ((rv = nni_msgpool_sys_init()) != 0) ||
 	    ((rv = nni_tls_sys_init()) != 0)) {
 		nni_fini();
 		return (rv);
@@ -171,6 +172,7 @@ nni_fini(void)
 	nni_taskq_sys_fini();
 	nni_reap_sys_fini(); // must be before timer and aio (expire)
 	nni_id_map_sys_fini();
+	nni_msgpool_sys_fini();
 	nni_init_params_fini();
 
 	nni_plat_fini();
@@ -96,8 +96,9 @@ test_init_too_many_expire_threads(void)
 	nng_fini();
 }
 
-// poller tuning only supported on Windows right now
-#ifdef NNG_PLATFORM_WINDOWS
+// poller tuning only supported on Windows and Linux (epoll) right now
+#if defined(NNG_PLATFORM_WINDOWS) || \
+    (defined(NNG_PLATFORM_LINUX) && defined(NNG_HAVE_EPOLL))
 void
 test_init_poller_no_threads(void)
 {
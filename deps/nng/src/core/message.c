@@ -14,18 +14,32 @@
 
 // Message API.
 
-// Message chunk, internal to the message implementation.
+// Message chunk, internal to the message implementation.  If ch_free is
+// set, the buffer belongs to the caller of nni_msg_alloc_external, and
+// is read-only to us; anything that would write to it copies it first.
 typedef struct {
-	size_t   ch_cap; // allocated size
-	size_t   ch_len; // length in use
-	uint8_t *ch_buf; // underlying buffer
-	uint8_t *ch_ptr; // pointer to actual data
+	size_t          ch_cap;  // allocated size
+	size_t          ch_len;  // length in use
+	uint8_t        *ch_buf;  // underlying buffer
+	uint8_t        *ch_ptr;  // pointer to actual data
+	nni_msg_free_cb ch_free; // releases external storage
+	void           *ch_arg;  // argument for ch_free
 } nni_chunk;
 
-// Underlying message structure.
+// Underlying message structure.  The body is normally just m_body.  When
+// data is inserted in front of a large body that has no headroom for it,
+// the data goes into m_front instead of moving the whole body, and the
+// body is then segmented: m_front followed by m_body.  Transports can
+// send the segments directly (see nni_msg_iov), and they are only merged
+// when someone needs a contiguous body.
+//
+// While the body is segmented, m_front always has room after its data
+// for all of m_body, so that merging is just a copy and cannot fail.
+// Anything that grows a segmented body reserves that room first.
 struct nng_msg {
 	uint32_t       m_header_buf[(NNI_MAX_MAX_TTL + 1)];
 	size_t         m_header_len;
+	nni_chunk      m_front; // segment in front of m_body, if not empty
 	nni_chunk      m_body;
 	uint32_t       m_pipe; // set on receive
 	nni_atomic_int m_refcnt;
@@ -76,11 +90,26 @@ nni_msg_dump(const char *banner, const nni_msg *msg)
 	(void) snprintf(buf, sizeof(buf), "--- %s BEGIN ---", banner);
 	nni_println(buf);
 	// TODO: dump the header
+	nni_chunk_dump(&msg->m_front, "FRONT");
 	nni_chunk_dump(&msg->m_body, "BODY");
 	nni_println("--- END ---");
 }
 #endif
 
+// nni_chunk_release gives up the chunk's storage, returning it to
+// the pool, or to its owner if external.
+static void
+nni_chunk_release(nni_chunk *ch)
+{
+	if (ch->ch_free != NULL) {
+		ch->ch_free(ch->ch_buf, ch->ch_cap, ch->ch_arg);
+		ch->ch_free = NULL;
+		ch->ch_arg  = NULL;
+	} else if ((ch->ch_cap != 0) && (ch->ch_buf != NULL)) {
+		nni_msgpool_free(ch->ch_buf, ch->ch_cap);
+	}
+}
+
 // nni_chunk_grow increases the underlying space for a chunk.  It ensures
 // that the desired amount of trailing space (including the length)
 // and headroom (excluding the length) are available.  It also copies
@@ -91,10 +120,18 @@ nni_msg_dump(const char *banner, const nni_msg *msg)
 // Note that having some headroom is useful when data must be prepended
 // to a message - it avoids having to perform extra data copies, so we
 // encourage initial allocations to start with sufficient room.
+//
+// External storage is always replaced by a private copy here, as the
+// caller is about to write to the chunk.
+//
+// New storage is not zeroed.  Message bodies are nearly always filled
+// right after allocation (e.g. by a transport reading from the wire), so
+// clearing them first would just double the memory traffic.
 static int
 nni_chunk_grow(nni_chunk *ch, size_t newsz, size_t headwanted)
 {
 	uint8_t *newbuf;
+	size_t   newcap;
 
 	// We assume that if the pointer is a valid pointer, and inside
 	// the backing store, then the entire data length fits.  In this
@@ -117,7 +154,7 @@ nni_chunk_grow(nni_chunk *ch, size_t newsz, size_t headwanted)
 			headwanted = headroom; // Never shrink this.
 		}
 		if (((newsz + headwanted) <= ch->ch_cap) &&
-		    (headwanted <= headroom)) {
+		    (headwanted <= headroom) && (ch->ch_free == NULL)) {
 			// We have enough space at the ends already.
 			return (0);
 		}
@@ -128,29 +165,31 @@ nni_chunk_grow(nni_chunk *ch, size_t newsz, size_t headwanted)
 			newsz = ch->ch_cap - headroom;
 		}
 
-		if ((newbuf = nni_zalloc(newsz + headwanted)) == NULL) {
+		newcap = newsz + headwanted;
+		if ((newbuf = nni_msgpool_alloc(newcap)) == NULL) {
 			return (NNG_ENOMEM);
 		}
 		// Copy all the data, but not header or trailer.
 		if (ch->ch_len > 0) {
 			memcpy(newbuf + headwanted, ch->ch_ptr, ch->ch_len);
 		}
-		nni_free(ch->ch_buf, ch->ch_cap);
+		nni_chunk_release(ch);
 		ch->ch_buf = newbuf;
 		ch->ch_ptr = newbuf + headwanted;
-		ch->ch_cap = newsz + headwanted;
+		ch->ch_cap = newcap;
 		return (0);
 	}
 
 	// We either don't have a data pointer yet, or it doesn't reference
 	// the backing store.  In this case, we just check against the
 	// allocated capacity and grow, or don't grow.
-	if ((newsz + headwanted) >= ch->ch_cap) {
-		if ((newbuf = nni_zalloc(newsz + headwanted)) == NULL) {
+	if (((newsz + headwanted) >= ch->ch_cap) || (ch->ch_free != NULL)) {
+		newcap = newsz + headwanted;
+		if ((newbuf = nni_msgpool_alloc(newcap)) == NULL) {
 			return (NNG_ENOMEM);
 		}
-		nni_free(ch->ch_buf, ch->ch_cap);
-		ch->ch_cap = newsz + headwanted;
+		nni_chunk_release(ch);
+		ch->ch_cap = newcap;
 		ch->ch_buf = newbuf;
 	}
 
@@ -161,9 +200,7 @@ nni_chunk_grow(nni_chunk *ch, size_t newsz, size_t headwanted)
 static void
 nni_chunk_free(nni_chunk *ch)
 {
-	if ((ch->ch_cap != 0) && (ch->ch_buf != NULL)) {
-		nni_free(ch->ch_buf, ch->ch_cap);
-	}
+	nni_chunk_release(ch);
 	ch->ch_ptr = NULL;
 	ch->ch_buf = NULL;
 	ch->ch_len = 0;
@@ -209,7 +246,7 @@ nni_chunk_trim(nni_chunk *ch, size_t len)
 static int
 nni_chunk_dup(nni_chunk *dst, const nni_chunk *src)
 {
-	if ((dst->ch_buf = nni_zalloc(src->ch_cap)) == NULL) {
+	if ((dst->ch_buf = nni_msgpool_alloc(src->ch_cap)) == NULL) {
 		return (NNG_ENOMEM);
 	}
 	dst->ch_cap = src->ch_cap;
@@ -245,15 +282,6 @@ nni_chunk_append(nni_chunk *ch, const void *data, size_t len)
 	return (0);
 }
 
-// nni_chunk_room determines the extra space we have left in the chunk.
-// This is useful to determine whether we will need to reallocate and
-// copy in order to save space.
-static size_t
-nni_chunk_room(nni_chunk *ch)
-{
-	return (ch->ch_cap - ch->ch_len);
-}
-
 // nni_chunk_insert prepends data to the chunk, as efficiently as possible.
 // If the data pointer is NULL, then no data is actually copied, but the
 // data region will have "grown" in the beginning, with uninitialized data.
@@ -263,12 +291,15 @@ nni_chunk_insert(nni_chunk *ch, const void *data, size_t len)
 	int  rv;
 	bool grow = false;
 
+	if (len == 0) {
+		return (0);
+	}
 	if (ch->ch_ptr == NULL) {
 		ch->ch_ptr = ch->ch_buf;
 	}
 
 	if ((ch->ch_ptr >= ch->ch_buf) &&
-	    (ch->ch_ptr < (ch->ch_buf + ch->ch_cap))) {
+	    (ch->ch_ptr < (ch->ch_buf + ch->ch_cap)) && (ch->ch_free == NULL)) {
 
 		if (len <= (size_t) (ch->ch_ptr - ch->ch_buf)) {
 			// There is already enough room at the beginning.
@@ -321,9 +352,100 @@ nni_chunk_trim_u32(nni_chunk *ch)
 	return (v);
 }
 
+// Used for external bodies that outlive the message on their own.
+static void
+nni_msg_external_nop(void *buf, size_t sz, void *arg)
+{
+	NNI_ARG_UNUSED(buf);
+	NNI_ARG_UNUSED(sz);
+	NNI_ARG_UNUSED(arg);
+}
+
+// Message structures come from the message pool as well.
+static nni_msg *
+nni_msg_struct_alloc(void)
+{
+	nni_msg *m;
+	if ((m = nni_msgpool_alloc(sizeof(*m))) != NULL) {
+		memset(m, 0, sizeof(*m));
+	}
+	return (m);
+}
+
+static void
+nni_msg_struct_free(nni_msg *m)
+{
+	nni_msgpool_free(m, sizeof(*m));
+}
+
+// Bodies at least this large are segmented, rather than moved, when
+// something is inserted in front of them and there is no headroom.
+#define NNI_MSG_SEGMENT_MIN 1024
+
+// nni_msg_front_reserve makes sure that the front segment has room for
+// its own data, plus extra bytes of headroom, plus a body of the given
+// length after it.
+static int
+nni_msg_front_reserve(nni_msg *m, size_t headroom, size_t body)
+{
+	nni_chunk *front = &m->m_front;
+
+	return (nni_chunk_grow(front, front->ch_len + body, headroom));
+}
+
+// nni_msg_flatten merges the front segment into the body, so that the
+// body is contiguous again.  If the body has headroom for the front data,
+// that is copied in front of it.  Otherwise the body is copied into the
+// space reserved behind the front data, and the front becomes the body.
+static void
+nni_msg_flatten(nni_msg *m)
+{
+	nni_chunk *front = &m->m_front;
+	nni_chunk *body  = &m->m_body;
+
+	if (front->ch_len == 0) {
+		return;
+	}
+	if ((body->ch_free == NULL) && (body->ch_ptr != NULL) &&
+	    (body->ch_ptr >= body->ch_buf) &&
+	    (front->ch_len <= (size_t) (body->ch_ptr - body->ch_buf))) {
+		body->ch_ptr -= front->ch_len;
+		body->ch_len += front->ch_len;
+		memcpy(body->ch_ptr, front->ch_ptr, front->ch_len);
+		front->ch_len = 0;
+		return;
+	}
+	NNI_ASSERT(front->ch_ptr + front->ch_len + body->ch_len <=
+	    front->ch_buf + front->ch_cap);
+	if (body->ch_len > 0) {
+		memcpy(front->ch_ptr + front->ch_len, body->ch_ptr,
+		    body->ch_len);
+	}
+	front->ch_len += body->ch_len;
+	nni_chunk_free(body);
+	*body = *front;
+	memset(front, 0, sizeof(*front));
+}
+
+// nni_msg_copy_body copies the (possibly segmented) body out.
+static void
+nni_msg_copy_body(const nni_msg *m, uint8_t *dst)
+{
+	if (m->m_front.ch_len > 0) {
+		memcpy(dst, m->m_front.ch_ptr, m->m_front.ch_len);
+		dst += m->m_front.ch_len;
+	}
+	if (m->m_body.ch_len > 0) {
+		memcpy(dst, m->m_body.ch_ptr, m->m_body.ch_len);
+	}
+}
+
 void
 nni_msg_clone(nni_msg *m)
 {
+	// Shared messages must not be modified, so merge the segments now,
+	// while we still own the message, rather than in nni_msg_body later.
+	nni_msg_flatten(m);
 	nni_atomic_inc(&m->m_refcnt);
 }
 
@@ -364,8 +486,7 @@ nni_msg_pull_up(nni_msg *m)
 	// This implementation is optimized to ensure that this function
 	// will not copy the message more than once, and it will not
 	// allocate unless there is no other option.
-	if (((nni_chunk_room(&m->m_body) < nni_msg_header_len(m))) ||
-	    (nni_atomic_get(&m->m_refcnt) != 1)) {
+	if (nni_atomic_get(&m->m_refcnt) != 1) {
 		// We have to duplicate the message.
 		nni_msg *m2;
 		uint8_t *dst;
@@ -376,16 +497,17 @@ nni_msg_pull_up(nni_msg *m)
 		dst = nni_msg_body(m2);
 		len = nni_msg_header_len(m);
 		memcpy(dst, nni_msg_header(m), len);
-		dst += len;
-		memcpy(dst, nni_msg_body(m), nni_msg_len(m));
+		nni_msg_copy_body(m, dst + len);
 		nni_msg_free(m);
 		return (m2);
 	}
 
-	// At this point, we have a unique instance of the message.
-	// We also know that we have sufficient space in the message,
-	// so this insert operation cannot fail.
-	nni_msg_insert(m, nni_msg_header(m), nni_msg_header_len(m));
+	// At this point, we have a unique instance of the message.  If
+	// there is no room for the header in front of a large body, the
+	// insert segments the body instead of copying it.
+	if (nni_msg_insert(m, nni_msg_header(m), nni_msg_header_len(m)) != 0) {
+		return (NULL);
+	}
 	nni_msg_header_clear(m);
 	return (m);
 }
@@ -396,7 +518,7 @@ nni_msg_alloc(nni_msg **mp, size_t sz)
 	nni_msg *m;
 	int      rv;
 
-	if ((m = NNI_ALLOC_STRUCT(m)) == NULL) {
+	if ((m = nni_msg_struct_alloc()) == NULL) {
 		return (NNG_ENOMEM);
 	}
 
@@ -411,7 +533,7 @@ nni_msg_alloc(nni_msg **mp, size_t sz)
 		rv = nni_chunk_grow(&m->m_body, sz, 0);
 	}
 	if (rv != 0) {
-		NNI_FREE_STRUCT(m);
+		nni_msg_struct_free(m);
 		return (rv);
 	}
 	if (nni_chunk_append(&m->m_body, NULL, sz) != 0) {
@@ -426,21 +548,52 @@ nni_msg_alloc(nni_msg **mp, size_t sz)
 	return (0);
 }
 
+int
+nni_msg_alloc_external(
+    nni_msg **mp, void *buf, size_t sz, nni_msg_free_cb cb, void *arg)
+{
+	nni_msg *m;
+
+	if ((m = nni_msg_struct_alloc()) == NULL) {
+		return (NNG_ENOMEM);
+	}
+	m->m_body.ch_buf  = buf;
+	m->m_body.ch_ptr  = buf;
+	m->m_body.ch_cap  = sz;
+	m->m_body.ch_len  = sz;
+	m->m_body.ch_free = cb != NULL ? cb : nni_msg_external_nop;
+	m->m_body.ch_arg  = arg;
+
+	nni_atomic_init(&m->m_refcnt);
+	nni_atomic_set(&m->m_refcnt, 1);
+	*mp = m;
+	return (0);
+}
+
 int
 nni_msg_dup(nni_msg **dup, const nni_msg *src)
 {
 	nni_msg *m;
 	int      rv;
 
-	if ((m = NNI_ALLOC_STRUCT(m)) == NULL) {
+	if ((m = nni_msg_struct_alloc()) == NULL) {
 		return (NNG_ENOMEM);
 	}
 
 	memcpy(m->m_header_buf, src->m_header_buf, src->m_header_len);
 	m->m_header_len = src->m_header_len;
 
-	if ((rv = nni_chunk_dup(&m->m_body, &src->m_body)) != 0) {
-		NNI_FREE_STRUCT(m);
+	if (src->m_front.ch_len > 0) {
+		// The copy of a segmented body is contiguous.
+		size_t len = nni_msg_len(src);
+		if ((rv = nni_chunk_grow(&m->m_body, len, 32)) != 0) {
+			nni_msg_struct_free(m);
+			return (rv);
+		}
+		nni_msg_copy_body(src, m->m_body.ch_ptr);
+		m->m_body.ch_len = len;
+	} else if ((rv = nni_chunk_dup(&m->m_body, &src->m_body)) != 0) {
+		nni_msg_struct_free(m);
 		return (rv);
 	}
 
@@ -456,23 +609,25 @@ void
 nni_msg_free(nni_msg *m)
 {
 	if ((m != NULL) && (nni_atomic_dec_nv(&m->m_refcnt) == 0)) {
+		nni_chunk_free(&m->m_front);
 		nni_chunk_free(&m->m_body);
-		NNI_FREE_STRUCT(m);
+		nni_msg_struct_free(m);
 	}
 }
 
 int
 nni_msg_realloc(nni_msg *m, size_t sz)
 {
-	if (m->m_body.ch_len < sz) {
-		int rv =
-		    nni_chunk_append(&m->m_body, NULL, sz - m->m_body.ch_len);
+	size_t len = nni_msg_len(m);
+
+	if (len < sz) {
+		int rv = nni_msg_append(m, NULL, sz - len);
 		if (rv != 0) {
 			return (rv);
 		}
 	} else {
 		// "Shrinking", just mark bytes at end usable again.
-		nni_chunk_chop(&m->m_body, m->m_body.ch_len - sz);
+		nni_msg_chop(m, len - sz);
 	}
 	return (0);
 }
@@ -480,14 +635,16 @@ nni_msg_realloc(nni_msg *m, size_t sz)
 int
 nni_msg_reserve(nni_msg *m, size_t capacity)
 {
+	nni_msg_flatten(m);
 	return (nni_chunk_grow(&m->m_body, capacity, 0));
 }
 
 size_t
 nni_msg_capacity(nni_msg *m)
 {
-	return ((size_t) ((m->m_body.ch_buf + m->m_body.ch_cap) -
-	    m->m_body.ch_ptr));
+	return (m->m_front.ch_len +
+	    (size_t) ((m->m_body.ch_buf + m->m_body.ch_cap) -
+	        m->m_body.ch_ptr));
 }
 
 void *
@@ -505,42 +662,138 @@ nni_msg_header_len(const nni_msg *m)
 void *
 nni_msg_body(nni_msg *m)
 {
+	nni_msg_flatten(m);
 	return (m->m_body.ch_ptr);
 }
 
+void *
+nni_msg_peek(nni_msg *m, size_t len)
+{
+	if (m->m_front.ch_len == 0) {
+		return (m->m_body.ch_ptr);
+	}
+	if (m->m_front.ch_len >= len) {
+		return (m->m_front.ch_ptr);
+	}
+	return (nni_msg_body(m));
+}
+
 size_t
 nni_msg_len(const nni_msg *m)
 {
-	return (m->m_body.ch_len);
+	return (m->m_front.ch_len + m->m_body.ch_len);
+}
+
+unsigned
+nni_msg_iov(nni_msg *m, nni_iov *iov)
+{
+	unsigned n = 0;
+
+	if (m->m_front.ch_len > 0) {
+		iov[n].iov_buf = m->m_front.ch_ptr;
+		iov[n].iov_len = m->m_front.ch_len;
+		n++;
+	}
+	if (m->m_body.ch_len > 0) {
+		iov[n].iov_buf = m->m_body.ch_ptr;
+		iov[n].iov_len = m->m_body.ch_len;
+		n++;
+	}
+	return (n);
 }
 
 int
 nni_msg_append(nni_msg *m, const void *data, size_t len)
 {
+	int rv;
+
+	if ((m->m_front.ch_len > 0) &&
+	    ((rv = nni_msg_front_reserve(
+	          m, 0, m->m_body.ch_len + len)) != 0)) {
+		return (rv);
+	}
 	return (nni_chunk_append(&m->m_body, data, len));
 }
 
 int
 nni_msg_insert(nni_msg *m, const void *data, size_t len)
 {
-	return (nni_chunk_insert(&m->m_body, data, len));
+	nni_chunk *body  = &m->m_body;
+	nni_chunk *front = &m->m_front;
+	int        rv;
+
+	if (len == 0) {
+		return (0);
+	}
+	if (front->ch_len == 0) {
+		// Insert into the body itself if that can be done in place,
+		// or if the body is small enough that moving it is cheap.
+		if ((body->ch_len < NNI_MSG_SEGMENT_MIN) ||
+		    ((body->ch_free == NULL) && (body->ch_ptr != NULL) &&
+		        (body->ch_ptr >= body->ch_buf) &&
+		        (len <= (size_t) (body->ch_ptr - body->ch_buf)))) {
+			return (nni_chunk_insert(body, data, len));
+		}
+		// Otherwise start a front segment, leaving some headroom
+		// for anything inserted after this.
+		if ((rv = nni_msg_front_reserve(
+		         m, len + 32, body->ch_len)) != 0) {
+			return (rv);
+		}
+	} else if ((rv = nni_msg_front_reserve(m, len, body->ch_len)) != 0) {
+		return (rv);
+	}
+	// This lands in the headroom, keeping the room behind the data.
+	return (nni_chunk_insert(front, data, len));
 }
 
 int
 nni_msg_trim(nni_msg *m, size_t len)
 {
-	return (nni_chunk_trim(&m->m_body, len));
+	size_t n;
+
+	if (len > nni_msg_len(m)) {
+		return (NNG_EINVAL);
+	}
+	n = len < m->m_front.ch_len ? len : m->m_front.ch_len;
+	(void) nni_chunk_trim(&m->m_front, n);
+	return (nni_chunk_trim(&m->m_body, len - n));
 }
 
 uint32_t
 nni_msg_trim_u32(nni_msg *m)
 {
-	return (nni_chunk_trim_u32(&m->m_body));
+	uint8_t  buf[sizeof(uint32_t)];
+	uint32_t v;
+	size_t   n;
+
+	if (m->m_front.ch_len == 0) {
+		return (nni_chunk_trim_u32(&m->m_body));
+	}
+	if (m->m_front.ch_len >= sizeof(v)) {
+		return (nni_chunk_trim_u32(&m->m_front));
+	}
+	// The value straddles the segments.
+	NNI_ASSERT(nni_msg_len(m) >= sizeof(v));
+	n = m->m_front.ch_len;
+	memcpy(buf, m->m_front.ch_ptr, n);
+	memcpy(buf + n, m->m_body.ch_ptr, sizeof(v) - n);
+	(void) nni_msg_trim(m, sizeof(v));
+	NNI_GET32(buf, v);
+	return (v);
 }
 
 int
 nni_msg_chop(nni_msg *m, size_t len)
 {
+	if (len > m->m_body.ch_len) {
+		if (len > nni_msg_len(m)) {
+			return (NNG_EINVAL);
+		}
+		len -= m->m_body.ch_len;
+		m->m_body.ch_len = 0;
+		return (nni_chunk_chop(&m->m_front, len));
+	}
 	return (nni_chunk_chop(&m->m_body, len));
 }
 
@@ -636,6 +889,7 @@ nni_msg_header_poke_u32(nni_msg *m, uint32_t val)
 void
 nni_msg_clear(nni_msg *m)
 {
+	nni_chunk_clear(&m->m_front);
 	nni_chunk_clear(&m->m_body);
 }
 
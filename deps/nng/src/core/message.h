@@ -14,7 +14,11 @@
 // Internally used message API.  Again, this is not part of our public API.
 // "trim" operations work from the front, and "chop" work from the end.
 
+typedef void (*nni_msg_free_cb)(void *, size_t, void *);
+
 extern int      nni_msg_alloc(nni_msg **, size_t);
+extern int      nni_msg_alloc_external(
+         nni_msg **, void *, size_t, nni_msg_free_cb, void *);
 extern void     nni_msg_free(nni_msg *);
 extern int      nni_msg_realloc(nni_msg *, size_t);
 extern int      nni_msg_reserve(nni_msg *, size_t);
@@ -22,7 +26,6 @@ extern size_t   nni_msg_capacity(nni_msg *);
 extern int      nni_msg_dup(nni_msg **, const nni_msg *);
 extern void *   nni_msg_header(nni_msg *);
 extern size_t   nni_msg_header_len(const nni_msg *);
-extern void *   nni_msg_body(nni_msg *);
 extern size_t   nni_msg_len(const nni_msg *);
 extern int      nni_msg_append(nni_msg *, const void *, size_t);
 extern int      nni_msg_insert(nni_msg *, const void *, size_t);
@@ -46,6 +49,20 @@ extern void     nni_msg_header_poke_u32(nni_msg *, uint32_t);
 extern void     nni_msg_set_pipe(nni_msg *, uint32_t);
 extern uint32_t nni_msg_get_pipe(const nni_msg *);
 
+// The body of a message may be segmented, which happens when data is
+// inserted in front of a large body.  nni_msg_body merges the segments
+// (if needed) and returns the contiguous body.  Room for that is set
+// aside when the body is segmented, so it cannot fail.  nni_msg_peek is
+// the same, but only needs the first given number of bytes to be
+// contiguous, so it rarely has to merge.
+// nni_msg_iov fills in up to NNI_MSG_MAX_IOV entries describing the body
+// as it is, and returns the number used; transports use it to send the
+// segments without merging them.
+#define NNI_MSG_MAX_IOV 2
+extern void *   nni_msg_body(nni_msg *);
+extern void *   nni_msg_peek(nni_msg *, size_t);
+extern unsigned nni_msg_iov(nni_msg *, nni_iov *);
+
 // Reference counting messages. This allows the same message to be
 // cheaply reused instead of copied over and over again.  Callers of
 // this functionality MUST be certain to use nni_msg_unique() before
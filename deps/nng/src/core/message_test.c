@@ -8,10 +8,12 @@
 // found online at https://opensource.org/licenses/MIT.
 //
 
+#include <stdio.h>
 #include <string.h>
 
 #include <nng/nng.h>
 
+#include "core/nng_impl.h"
 #include "nuts.h"
 
 void
@@ -539,6 +541,441 @@ test_msg_insert_stress(void)
 	}
 }
 
+void
+test_msg_pool_reuse(void)
+{
+#ifdef NNG_ENABLE_STATS
+	nng_stat *stats;
+	nng_stat *pool;
+	nng_stat *item;
+	uint64_t  hits;
+	nng_msg  *msgs[16];
+
+	// The pool is only live while the library is initialized.
+	NUTS_PASS(nng_stats_get(&stats));
+	nng_stats_free(stats);
+
+	// Warm the pool, then it should serve a second round.
+	for (int i = 0; i < 16; i++) {
+		NUTS_PASS(nng_msg_alloc(&msgs[i], 100 + i * 50));
+	}
+	for (int i = 0; i < 16; i++) {
+		nng_msg_free(msgs[i]);
+	}
+
+	NUTS_PASS(nng_stats_get(&stats));
+	NUTS_ASSERT((pool = nng_stat_find(stats, "msgpool")) != NULL);
+	NUTS_ASSERT((item = nng_stat_find(pool, "hits")) != NULL);
+	hits = nng_stat_value(item);
+	NUTS_ASSERT((item = nng_stat_find(pool, "retained")) != NULL);
+	NUTS_ASSERT(nng_stat_value(item) > 0);
+	NUTS_ASSERT(nng_stat_unit(item) == NNG_UNIT_BYTES);
+	nng_stats_free(stats);
+
+	for (int i = 0; i < 16; i++) {
+		NUTS_PASS(nng_msg_alloc(&msgs[i], 100 + i * 50));
+		memset(nng_msg_body(msgs[i]), 'a', nng_msg_len(msgs[i]));
+	}
+	for (int i = 0; i < 16; i++) {
+		nng_msg_free(msgs[i]);
+	}
+
+	NUTS_PASS(nng_stats_get(&stats));
+	pool = nng_stat_find(stats, "msgpool");
+	item = nng_stat_find(pool, "hits");
+	NUTS_ASSERT(nng_stat_value(item) >= hits + 32);
+	nng_stats_free(stats);
+#endif
+}
+
+void
+test_msg_pool_after_fini(void)
+{
+#ifdef NNG_ENABLE_STATS
+	nng_stat *stats;
+	nng_stat *item;
+	nng_msg  *msgs[16];
+
+	// Make sure the library (and so the pool) is running.
+	NUTS_PASS(nng_stats_get(&stats));
+	nng_stats_free(stats);
+
+	for (int i = 0; i < 16; i++) {
+		NUTS_PASS(nng_msg_alloc(&msgs[i], 100 + i * 50));
+	}
+	nng_fini();
+
+	// Messages that outlive the library go back to the system,
+	// rather than into caches nobody will drain.
+	for (int i = 0; i < 16; i++) {
+		nng_msg_free(msgs[i]);
+	}
+
+	NUTS_PASS(nng_stats_get(&stats));
+	item = nng_stat_find(nng_stat_find(stats, "msgpool"), "retained");
+	NUTS_ASSERT(item != NULL);
+	NUTS_ASSERT(nng_stat_value(item) == 0);
+	nng_stats_free(stats);
+#endif
+}
+
+typedef struct {
+	void  *buf;
+	size_t sz;
+	int    count;
+} external_release;
+
+static void
+external_free(void *buf, size_t sz, void *arg)
+{
+	external_release *rel = arg;
+	rel->buf              = buf;
+	rel->sz               = sz;
+	rel->count++;
+}
+
+void
+test_msg_external(void)
+{
+	nng_msg         *msg;
+	nng_msg         *dup;
+	char             data[] = "external";
+	external_release rel    = { 0 };
+
+	NUTS_PASS(nng_msg_alloc_external(
+	    &msg, data, sizeof(data), external_free, &rel));
+	NUTS_ASSERT(nng_msg_body(msg) == data);
+	NUTS_ASSERT(nng_msg_len(msg) == sizeof(data));
+	NUTS_PASS(nng_msg_header_append(msg, "hdr", 4));
+
+	// Trimming and chopping only move the view.
+	NUTS_PASS(nng_msg_trim(msg, 1));
+	NUTS_PASS(nng_msg_chop(msg, 1));
+	NUTS_ASSERT(nng_msg_body(msg) == data + 1);
+	NUTS_ASSERT(nng_msg_len(msg) == sizeof(data) - 2);
+
+	// A dup gets its own copy.
+	NUTS_PASS(nng_msg_dup(&dup, msg));
+	NUTS_ASSERT(nng_msg_body(dup) != nng_msg_body(msg));
+	NUTS_ASSERT(memcmp(nng_msg_body(dup), "xternal", 7) == 0);
+	nng_msg_free(dup);
+	NUTS_ASSERT(rel.count == 0);
+
+	nng_msg_free(msg);
+	NUTS_ASSERT(rel.count == 1);
+	NUTS_ASSERT(rel.buf == data);
+	NUTS_ASSERT(rel.sz == sizeof(data));
+
+	// No callback at all is fine too.
+	NUTS_PASS(nng_msg_alloc_external(&msg, data, sizeof(data), NULL, NULL));
+	nng_msg_free(msg);
+	NUTS_FAIL(nng_msg_alloc_external(&msg, NULL, 1, NULL, NULL), NNG_EINVAL);
+}
+
+void
+test_msg_external_cow(void)
+{
+	nng_msg         *msg;
+	char             data[] = "abcdef";
+	external_release rel    = { 0 };
+
+	// Writing into room left by a trim must not touch the caller's data.
+	NUTS_PASS(nng_msg_alloc_external(
+	    &msg, data, sizeof(data), external_free, &rel));
+	NUTS_PASS(nng_msg_trim(msg, 2));
+	NUTS_PASS(nng_msg_insert(msg, "XY", 2));
+	NUTS_ASSERT(nng_msg_body(msg) != data + 0);
+	NUTS_MATCH(nng_msg_body(msg), "XYcdef");
+	NUTS_MATCH(data, "abcdef");
+	NUTS_ASSERT(rel.count == 1);
+	nng_msg_free(msg);
+	NUTS_ASSERT(rel.count == 1);
+
+	// Same for room left by a chop.
+	NUTS_PASS(nng_msg_alloc_external(
+	    &msg, data, sizeof(data), external_free, &rel));
+	NUTS_PASS(nng_msg_chop(msg, 3));
+	NUTS_PASS(nng_msg_append(msg, "Z", 2));
+	NUTS_MATCH(nng_msg_body(msg), "abcdZ");
+	NUTS_MATCH(data, "abcdef");
+	NUTS_ASSERT(rel.count == 2);
+	nng_msg_free(msg);
+	NUTS_ASSERT(rel.count == 2);
+}
+
+// PUB clones one message for every pipe; the buffer is released once,
+// after the last pipe is done with it.
+void
+test_msg_external_fan_out(void)
+{
+	nng_socket       pub;
+	nng_socket       sub1;
+	nng_socket       sub2;
+	nng_msg         *msg;
+	static char      data[4096];
+	external_release rel = { 0 };
+
+	memset(data, 'e', sizeof(data));
+	NUTS_PASS(nng_pub0_open(&pub));
+	NUTS_PASS(nng_sub0_open(&sub1));
+	NUTS_PASS(nng_sub0_open(&sub2));
+	NUTS_PASS(nng_sub0_socket_subscribe(sub1, "", 0));
+	NUTS_PASS(nng_sub0_socket_subscribe(sub2, "", 0));
+	NUTS_PASS(nng_socket_set_ms(sub1, NNG_OPT_RECVTIMEO, 1000));
+	NUTS_PASS(nng_socket_set_ms(sub2, NNG_OPT_RECVTIMEO, 1000));
+	NUTS_MARRY_EX(pub, sub1, "tcp://127.0.0.1:0", NULL, NULL);
+	NUTS_MARRY_EX(pub, sub2, "tcp://127.0.0.1:0", NULL, NULL);
+
+	NUTS_PASS(nng_msg_alloc_external(
+	    &msg, data, sizeof(data), external_free, &rel));
+	NUTS_PASS(nng_sendmsg(pub, msg, 0));
+	NUTS_PASS(nng_recvmsg(sub1, &msg, 0));
+	NUTS_ASSERT(nng_msg_len(msg) == sizeof(data));
+	NUTS_ASSERT(memcmp(nng_msg_body(msg), data, sizeof(data)) == 0);
+	nng_msg_free(msg);
+	NUTS_PASS(nng_recvmsg(sub2, &msg, 0));
+	NUTS_ASSERT(nng_msg_len(msg) == sizeof(data));
+	nng_msg_free(msg);
+
+	for (int i = 0; (i < 100) && (rel.count == 0); i++) {
+		NUTS_SLEEP(10);
+	}
+	NUTS_ASSERT(rel.count == 1);
+
+	NUTS_CLOSE(pub);
+	NUTS_CLOSE(sub1);
+	NUTS_CLOSE(sub2);
+	NUTS_ASSERT(rel.count == 1);
+}
+
+// Over inproc an exclusive message without a header is handed over as
+// is, so the receiver sees the sender's buffer.
+void
+test_msg_external_inproc(void)
+{
+	nng_socket       s1;
+	nng_socket       s2;
+	nng_msg         *msg;
+	char             data[] = "zero copy";
+	external_release rel    = { 0 };
+
+	// PUSH/PULL, as these add no protocol header to pull up.
+	NUTS_PASS(nng_push0_open(&s1));
+	NUTS_PASS(nng_pull0_open(&s2));
+	NUTS_PASS(nng_socket_set_ms(s2, NNG_OPT_RECVTIMEO, 1000));
+	NUTS_MARRY(s1, s2);
+
+	NUTS_PASS(nng_msg_alloc_external(
+	    &msg, data, sizeof(data), external_free, &rel));
+	NUTS_PASS(nng_sendmsg(s1, msg, 0));
+	NUTS_PASS(nng_recvmsg(s2, &msg, 0));
+	NUTS_ASSERT(nng_msg_body(msg) == data);
+	NUTS_ASSERT(rel.count == 0);
+	nng_msg_free(msg);
+	NUTS_ASSERT(rel.count == 1);
+
+	NUTS_CLOSE(s1);
+	NUTS_CLOSE(s2);
+}
+
+// Inserting in front of a large body with no headroom keeps the body in
+// place, and it is only merged when asked for.
+void
+test_msg_segmented(void)
+{
+	nng_msg         *msg;
+	nng_msg         *dup;
+	static char      data[4096];
+	external_release rel = { 0 };
+	uint32_t         v;
+	uint8_t         *body;
+
+	for (size_t i = 0; i < sizeof(data); i++) {
+		data[i] = (char) i;
+	}
+	NUTS_PASS(nng_msg_alloc_external(
+	    &msg, data, sizeof(data), external_free, &rel));
+	NUTS_PASS(nng_msg_insert(msg, "\x01\x02\x03\x04", 4));
+	NUTS_PASS(nng_msg_insert(msg, "ab", 2));
+	NUTS_ASSERT(nng_msg_len(msg) == sizeof(data) + 6);
+	NUTS_ASSERT(rel.count == 0);
+
+	// Trimming across the segments.
+	NUTS_PASS(nng_msg_trim(msg, 1));
+	NUTS_PASS(nng_msg_trim_u32(msg, &v));
+	NUTS_ASSERT(v == 0x62010203u);
+	NUTS_ASSERT(nng_msg_len(msg) == sizeof(data) + 1);
+	NUTS_PASS(nng_msg_chop(msg, 1));
+	NUTS_ASSERT(rel.count == 0);
+
+	// A dup is contiguous.
+	NUTS_PASS(nng_msg_dup(&dup, msg));
+	body = nng_msg_body(dup);
+	NUTS_ASSERT(body[0] == 4);
+	NUTS_ASSERT(memcmp(body + 1, data, sizeof(data) - 1) == 0);
+	nng_msg_free(dup);
+	NUTS_ASSERT(rel.count == 0);
+
+	// Asking for the body merges it, which copies the external buffer.
+	body = nng_msg_body(msg);
+	NUTS_ASSERT(body != NULL);
+	NUTS_ASSERT(rel.count == 1);
+	NUTS_ASSERT(nng_msg_len(msg) == sizeof(data));
+	NUTS_ASSERT(body[0] == 4);
+	NUTS_ASSERT(memcmp(body + 1, data, sizeof(data) - 1) == 0);
+	nng_msg_free(msg);
+	NUTS_ASSERT(rel.count == 1);
+
+	// Chopping into the front segment.
+	NUTS_PASS(nng_msg_alloc_external(
+	    &msg, data, sizeof(data), external_free, &rel));
+	NUTS_PASS(nng_msg_insert(msg, "xyz", 3));
+	NUTS_PASS(nng_msg_chop(msg, sizeof(data) + 1));
+	NUTS_ASSERT(nng_msg_len(msg) == 2);
+	NUTS_ASSERT(memcmp(nng_msg_body(msg), "xy", 2) == 0);
+	nng_msg_free(msg);
+	NUTS_ASSERT(rel.count == 2);
+}
+
+// Growing a segmented body keeps room for merging it, and clones are
+// merged before they are shared.
+void
+test_msg_segmented_grow(void)
+{
+	nng_msg         *msg;
+	static char      data[2048];
+	external_release rel = { 0 };
+	nni_iov          iov[NNI_MSG_MAX_IOV];
+	uint8_t         *body;
+
+	for (size_t i = 0; i < sizeof(data); i++) {
+		data[i] = (char) i;
+	}
+	NUTS_PASS(nng_msg_alloc_external(
+	    &msg, data, sizeof(data), external_free, &rel));
+	NUTS_PASS(nng_msg_insert(msg, "ab", 2));
+	NUTS_PASS(nng_msg_append(msg, "yz", 2));
+	NUTS_PASS(nng_msg_realloc(msg, sizeof(data) + 4 + 5000));
+	for (int i = 0; i < 100; i++) {
+		NUTS_PASS(nng_msg_insert(msg, "-", 1));
+	}
+	NUTS_ASSERT(nni_msg_iov(msg, iov) == 2);
+	NUTS_ASSERT(nng_msg_len(msg) == 100 + sizeof(data) + 4 + 5000);
+
+	body = nng_msg_body(msg);
+	NUTS_ASSERT(nni_msg_iov(msg, iov) == 1);
+	NUTS_ASSERT(body[99] == '-');
+	NUTS_ASSERT(memcmp(body + 100, "ab", 2) == 0);
+	NUTS_ASSERT(memcmp(body + 102, data, sizeof(data)) == 0);
+	NUTS_ASSERT(memcmp(body + 102 + sizeof(data), "yz", 2) == 0);
+	nng_msg_free(msg);
+
+	NUTS_PASS(nng_msg_alloc_external(
+	    &msg, data, sizeof(data), external_free, &rel));
+	NUTS_PASS(nng_msg_insert(msg, "ab", 2));
+	NUTS_ASSERT(nni_msg_iov(msg, iov) == 2);
+	nni_msg_clone(msg);
+	NUTS_ASSERT(nni_msg_iov(msg, iov) == 1);
+	NUTS_ASSERT(iov[0].iov_len == sizeof(data) + 2);
+	nng_msg_free(msg);
+	nng_msg_free(msg);
+	NUTS_ASSERT(rel.count == 2);
+}
+
+// Segmented bodies go out on stream transports as they are, and inproc
+// segments large bodies to pull up the protocol header.
+void
+test_msg_segmented_send(void)
+{
+	const char *schemes[] = { "ipc", "inproc", "tcp" };
+
+	for (int i = 0; i < 3; i++) {
+		nng_socket  req;
+		nng_socket  rep;
+		nng_msg    *msg;
+		uint8_t    *body;
+		const char *addr;
+		size_t      sz = 65536;
+
+		NUTS_PASS(nng_req0_open(&req));
+		NUTS_PASS(nng_rep0_open(&rep));
+		NUTS_PASS(nng_socket_set_ms(req, NNG_OPT_RECVTIMEO, 1000));
+		NUTS_PASS(nng_socket_set_ms(rep, NNG_OPT_RECVTIMEO, 1000));
+		if (strcmp(schemes[i], "tcp") == 0) {
+			addr = "tcp://127.0.0.1:0";
+		} else {
+			NUTS_ADDR(addr, schemes[i]);
+		}
+		NUTS_MARRY_EX(req, rep, addr, NULL, NULL);
+
+		NUTS_PASS(nng_msg_alloc(&msg, sz));
+		memset(nng_msg_body(msg), 'S', sz);
+		NUTS_PASS(nng_msg_insert(msg, "head", 4));
+		NUTS_PASS(nng_sendmsg(req, msg, 0));
+		NUTS_PASS(nng_recvmsg(rep, &msg, 0));
+		NUTS_ASSERT(nng_msg_len(msg) == sz + 4);
+		body = nng_msg_body(msg);
+		NUTS_ASSERT(memcmp(body, "head", 4) == 0);
+		NUTS_ASSERT(body[4] == 'S' && body[sz + 3] == 'S');
+		NUTS_PASS(nng_sendmsg(rep, msg, 0));
+		NUTS_PASS(nng_recvmsg(req, &msg, 0));
+		NUTS_ASSERT(nng_msg_len(msg) == sz + 4);
+		nng_msg_free(msg);
+
+		NUTS_CLOSE(req);
+		NUTS_CLOSE(rep);
+	}
+}
+
+// Benchmark allocating and filling large bodies, the way a transport does
+// on receive, against the same with the body cleared first (which is what
+// allocation used to cost, and what nng_msg_alloc still does).
+void
+test_msg_large_alloc_fill(void)
+{
+	const size_t sz    = 4 * 1024 * 1024;
+	const int    loops = 64;
+	nni_msg     *msg;
+	uint64_t     t0, t1, t2;
+
+	NUTS_CLOCK(t0);
+	for (int i = 0; i < loops; i++) {
+		NUTS_PASS(nni_msg_alloc(&msg, sz));
+		memset(nni_msg_body(msg), i, sz);
+		NUTS_ASSERT(((uint8_t *) nni_msg_body(msg))[sz - 1] == (uint8_t) i);
+		nni_msg_free(msg);
+	}
+	NUTS_CLOCK(t1);
+	for (int i = 0; i < loops; i++) {
+		NUTS_PASS(nni_msg_alloc(&msg, sz));
+		memset(nni_msg_body(msg), 0, sz);
+		memset(nni_msg_body(msg), i, sz);
+		NUTS_ASSERT(((uint8_t *) nni_msg_body(msg))[sz - 1] == (uint8_t) i);
+		nni_msg_free(msg);
+	}
+	NUTS_CLOCK(t2);
+
+	printf("  %d x %u byte bodies: alloc+fill %u ms, "
+	       "alloc+zero+fill %u ms\n",
+	    loops, (unsigned) sz, (unsigned) (t1 - t0), (unsigned) (t2 - t1));
+}
+
+void
+test_msg_alloc_zeroed(void)
+{
+	nng_msg *msg;
+
+	// Dirty a pooled buffer, and make sure we don't see it again.
+	NUTS_PASS(nng_msg_alloc(&msg, 200));
+	memset(nng_msg_body(msg), 0xff, 200);
+	nng_msg_free(msg);
+	NUTS_PASS(nng_msg_alloc(&msg, 200));
+	for (int i = 0; i < 200; i++) {
+		NUTS_ASSERT(((uint8_t *) nng_msg_body(msg))[i] == 0);
+	}
+	nng_msg_free(msg);
+}
+
 TEST_LIST = {
 	{ "msg option", test_msg_option },
 	{ "msg empty", test_msg_empty },
@@ -567,5 +1004,16 @@ TEST_LIST = {
 	{ "msg capacity", test_msg_capacity },
 	{ "msg reserve", test_msg_reserve },
 	{ "msg insert stress", test_msg_insert_stress },
+	{ "msg pool reuse", test_msg_pool_reuse },
+	{ "msg pool after fini", test_msg_pool_after_fini },
+	{ "msg large alloc fill", test_msg_large_alloc_fill },
+	{ "msg alloc zeroed", test_msg_alloc_zeroed },
+	{ "msg external", test_msg_external },
+	{ "msg external copy on write", test_msg_external_cow },
+	{ "msg external fan out", test_msg_external_fan_out },
+	{ "msg external inproc", test_msg_external_inproc },
+	{ "msg segmented", test_msg_segmented },
+	{ "msg segmented grow", test_msg_segmented_grow },
+	{ "msg segmented send", test_msg_segmented_send },
 	{ NULL, NULL },
 };
@@ -0,0 +1,330 @@
+//
+// Copyright 2024 Staysail Systems, Inc. <info@staysail.tech>
+//
+// This software is supplied under the terms of the MIT License, a
+// copy of which should be located in the distribution where this
+// file was obtained (LICENSE.txt).  A copy of the license may also be
+// found online at https://opensource.org/licenses/MIT.
+//
+
+#include "core/nng_impl.h"
+
+// Message buffer pool.  Freed buffers of a pooled size class go to one
+// of MSGPOOL_NCACHES locked caches, and overflow from there to a global
+// depot.  These caches are shards, not true per-thread caches: the shard
+// is chosen by hashing the caller's stack address, so a thread tends to
+// reuse the same one, but unrelated threads can share a shard (and its
+// lock).  Allocation takes from the shard first, refilling it from the
+// depot in batches, and only falls back to the system allocator (counted
+// as a miss) when both are empty.  The total retained memory is capped;
+// half of it is split among the shards, and half is for the depot.
+//
+// The pool is only live between nni_msgpool_sys_init and
+// nni_msgpool_sys_fini.  Outside of that window (for example messages
+// freed by the application after nng_fini) buffers go straight to and
+// from the system allocator, so nothing is left behind in the caches.
+
+#ifndef NNG_MSGPOOL_MAX_BYTES
+#define NNG_MSGPOOL_MAX_BYTES (16 * 1024 * 1024)
+#endif
+
+#define MSGPOOL_NCLASSES 7
+#define MSGPOOL_NCACHES 8
+#define MSGPOOL_REFILL 8
+
+static const size_t msgpool_sizes[MSGPOOL_NCLASSES] = {
+	64,
+	128,
+	256,
+	1024,
+	4096,
+	16384,
+	NNI_MSGPOOL_MAX_SIZE,
+};
+
+typedef struct msgpool_buf {
+	struct msgpool_buf *next;
+} msgpool_buf;
+
+typedef struct {
+	nni_mtx      mtx;
+	msgpool_buf *bufs[MSGPOOL_NCLASSES];
+	size_t       bytes;
+	uint64_t     hits;
+	uint64_t     misses;
+} msgpool_cache;
+
+static msgpool_cache msgpool_caches[MSGPOOL_NCACHES] = {
+	{ .mtx = NNI_MTX_INITIALIZER },
+	{ .mtx = NNI_MTX_INITIALIZER },
+	{ .mtx = NNI_MTX_INITIALIZER },
+	{ .mtx = NNI_MTX_INITIALIZER },
+	{ .mtx = NNI_MTX_INITIALIZER },
+	{ .mtx = NNI_MTX_INITIALIZER },
+	{ .mtx = NNI_MTX_INITIALIZER },
+	{ .mtx = NNI_MTX_INITIALIZER },
+};
+
+static msgpool_cache msgpool_depot = { .mtx = NNI_MTX_INITIALIZER };
+
+// Set while the pool is live.  It is checked under the cache lock, and
+// cleared before the caches are drained, so nothing can be cached after
+// the drain.
+static nni_atomic_bool msgpool_live;
+
+// Limits are only changed during initialization.
+static size_t msgpool_cache_max = NNG_MSGPOOL_MAX_BYTES / 2 / MSGPOOL_NCACHES;
+static size_t msgpool_depot_max = NNG_MSGPOOL_MAX_BYTES / 2;
+
+static int
+msgpool_class(size_t sz)
+{
+	for (int i = 0; i < MSGPOOL_NCLASSES; i++) {
+		if (sz <= msgpool_sizes[i]) {
+			return (i);
+		}
+	}
+	return (-1);
+}
+
+// msgpool_cache_self picks the shard for the calling thread.  C99 has
+// no portable thread-local storage, so we hash the address of a local
+// variable instead.  Every thread has its own stack, so a thread keeps
+// landing on the same shard, and different threads mostly spread out.
+// Each shard is locked, so a collision only costs some contention.
+static msgpool_cache *
+msgpool_cache_self(void)
+{
+	int      local;
+	uint64_t x = (uint64_t) (uintptr_t) &local >> 16;
+
+	x *= 0x9E3779B97F4A7C15ull;
+	return (&msgpool_caches[(x >> 32) % MSGPOOL_NCACHES]);
+}
+
+void *
+nni_msgpool_alloc(size_t sz)
+{
+	msgpool_cache *cache;
+	msgpool_buf   *buf;
+	int            c;
+
+	if ((c = msgpool_class(sz)) < 0) {
+		return (nni_alloc(sz));
+	}
+	sz = msgpool_sizes[c];
+
+	cache = msgpool_cache_self();
+	nni_mtx_lock(&cache->mtx);
+	if (!nni_atomic_get_bool(&msgpool_live)) {
+		nni_mtx_unlock(&cache->mtx);
+		return (nni_alloc(sz));
+	}
+	if ((buf = cache->bufs[c]) == NULL) {
+		// Refill from the depot, keeping the first one for us.
+		nni_mtx_lock(&msgpool_depot.mtx);
+		for (int i = 0; i < MSGPOOL_REFILL; i++) {
+			msgpool_buf *b;
+			if ((b = msgpool_depot.bufs[c]) == NULL) {
+				break;
+			}
+			msgpool_depot.bufs[c] = b->next;
+			msgpool_depot.bytes -= sz;
+			b->next        = cache->bufs[c];
+			cache->bufs[c] = b;
+			cache->bytes += sz;
+		}
+		nni_mtx_unlock(&msgpool_depot.mtx);
+		buf = cache->bufs[c];
+	}
+	if (buf != NULL) {
+		cache->bufs[c] = buf->next;
+		cache->bytes -= sz;
+		cache->hits++;
+	} else {
+		cache->misses++;
+	}
+	nni_mtx_unlock(&cache->mtx);
+
+	if (buf == NULL) {
+		buf = nni_alloc(sz);
+	}
+	return (buf);
+}
+
+void
+nni_msgpool_free(void *ptr, size_t sz)
+{
+	msgpool_cache *cache;
+	msgpool_buf   *buf = ptr;
+	int            c;
+
+	if (ptr == NULL) {
+		return;
+	}
+	if ((c = msgpool_class(sz)) < 0) {
+		nni_free(ptr, sz);
+		return;
+	}
+	sz = msgpool_sizes[c];
+
+	cache = msgpool_cache_self();
+	nni_mtx_lock(&cache->mtx);
+	if (!nni_atomic_get_bool(&msgpool_live)) {
+		nni_mtx_unlock(&cache->mtx);
+		nni_free(buf, sz);
+		return;
+	}
+	if (cache->bytes + sz <= msgpool_cache_max) {
+		buf->next      = cache->bufs[c];
+		cache->bufs[c] = buf;
+		cache->bytes += sz;
+		buf = NULL;
+	}
+	nni_mtx_unlock(&cache->mtx);
+
+	if (buf != NULL) {
+		nni_mtx_lock(&msgpool_depot.mtx);
+		if (msgpool_depot.bytes + sz <= msgpool_depot_max) {
+			buf->next             = msgpool_depot.bufs[c];
+			msgpool_depot.bufs[c] = buf;
+			msgpool_depot.bytes += sz;
+			buf = NULL;
+		}
+		nni_mtx_unlock(&msgpool_depot.mtx);
+	}
+
+	if (buf != NULL) {
+		nni_free(buf, sz);
+	}
+}
+
+void
+nni_msgpool_stats(uint64_t *hits, uint64_t *misses, uint64_t *retained)
+{
+	uint64_t h = 0;
+	uint64_t m = 0;
+	uint64_t r = 0;
+
+	for (int i = 0; i < MSGPOOL_NCACHES; i++) {
+		msgpool_cache *cache = &msgpool_caches[i];
+		nni_mtx_lock(&cache->mtx);
+		h += cache->hits;
+		m += cache->misses;
+		r += cache->bytes;
+		nni_mtx_unlock(&cache->mtx);
+	}
+	nni_mtx_lock(&msgpool_depot.mtx);
+	r += msgpool_depot.bytes;
+	nni_mtx_unlock(&msgpool_depot.mtx);
+
+	*hits     = h;
+	*misses   = m;
+	*retained = r;
+}
+
+static void
+msgpool_drain(msgpool_cache *cache)
+{
+	nni_mtx_lock(&cache->mtx);
+	for (int c = 0; c < MSGPOOL_NCLASSES; c++) {
+		msgpool_buf *buf;
+		while ((buf = cache->bufs[c]) != NULL) {
+			cache->bufs[c] = buf->next;
+			nni_free(buf, msgpool_sizes[c]);
+		}
+	}
+	cache->bytes = 0;
+	nni_mtx_unlock(&cache->mtx);
+}
+
+#ifdef NNG_ENABLE_STATS
+static void msgpool_stat_update(nni_stat_item *);
+
+static nni_stat_item msgpool_stat_root;
+static nni_stat_item msgpool_stat_hits;
+static nni_stat_item msgpool_stat_misses;
+static nni_stat_item msgpool_stat_retained;
+
+static const nni_stat_info msgpool_root_info = {
+	.si_name = "msgpool",
+	.si_desc = "message buffer pool",
+	.si_type = NNG_STAT_SCOPE,
+};
+static const nni_stat_info msgpool_hits_info = {
+	.si_name   = "hits",
+	.si_desc   = "allocations served from the pool",
+	.si_type   = NNG_STAT_COUNTER,
+	.si_unit   = NNG_UNIT_EVENTS,
+	.si_update = msgpool_stat_update,
+};
+static const nni_stat_info msgpool_misses_info = {
+	.si_name   = "misses",
+	.si_desc   = "pooled size allocations that went to the system",
+	.si_type   = NNG_STAT_COUNTER,
+	.si_unit   = NNG_UNIT_EVENTS,
+	.si_update = msgpool_stat_update,
+};
+static const nni_stat_info msgpool_retained_info = {
+	.si_name   = "retained",
+	.si_desc   = "memory held for reuse",
+	.si_type   = NNG_STAT_LEVEL,
+	.si_unit   = NNG_UNIT_BYTES,
+	.si_update = msgpool_stat_update,
+};
+
+static void
+msgpool_stat_update(nni_stat_item *item)
+{
+	uint64_t hits, misses, retained;
+
+	nni_msgpool_stats(&hits, &misses, &retained);
+	if (item == &msgpool_stat_hits) {
+		nni_stat_set_value(item, hits);
+	} else if (item == &msgpool_stat_misses) {
+		nni_stat_set_value(item, misses);
+	} else {
+		nni_stat_set_value(item, retained);
+	}
+}
+#endif
+
+int
+nni_msgpool_sys_init(void)
+{
+	uint64_t max;
+
+	max = nni_init_get_param(
+	    NNG_INIT_MSGPOOL_MAX_BYTES, NNG_MSGPOOL_MAX_BYTES);
+	msgpool_cache_max = (size_t) (max / 2 / MSGPOOL_NCACHES);
+	msgpool_depot_max = (size_t) (max / 2);
+	nni_init_set_effective(NNG_INIT_MSGPOOL_MAX_BYTES, max);
+	nni_atomic_set_bool(&msgpool_live, true);
+
+#ifdef NNG_ENABLE_STATS
+	nni_stat_init(&msgpool_stat_root, &msgpool_root_info);
+	nni_stat_init(&msgpool_stat_hits, &msgpool_hits_info);
+	nni_stat_init(&msgpool_stat_misses, &msgpool_misses_info);
+	nni_stat_init(&msgpool_stat_retained, &msgpool_retained_info);
+	nni_stat_add(&msgpool_stat_root, &msgpool_stat_hits);
+	nni_stat_add(&msgpool_stat_root, &msgpool_stat_misses);
+	nni_stat_add(&msgpool_stat_root, &msgpool_stat_retained);
+	nni_stat_register(&msgpool_stat_root);
+#endif
+	return (0);
+}
+
+void
+nni_msgpool_sys_fini(void)
+{
+#ifdef NNG_ENABLE_STATS
+	nni_stat_unregister(&msgpool_stat_root);
+#endif
+	nni_atomic_set_bool(&msgpool_live, false);
+	for (int i = 0; i < MSGPOOL_NCACHES; i++) {
+		msgpool_drain(&msgpool_caches[i]);
+	}
+	msgpool_drain(&msgpool_depot);
+	msgpool_cache_max = NNG_MSGPOOL_MAX_BYTES / 2 / MSGPOOL_NCACHES;
+	msgpool_depot_max = NNG_MSGPOOL_MAX_BYTES / 2;
+}
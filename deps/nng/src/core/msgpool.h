@@ -0,0 +1,38 @@
+//
+// Copyright 2024 Staysail Systems, Inc. <info@staysail.tech>
+//
+// This software is supplied under the terms of the MIT License, a
+// copy of which should be located in the distribution where this
+// file was obtained (LICENSE.txt).  A copy of the license may also be
+// found online at https://opensource.org/licenses/MIT.
+//
+
+#ifndef CORE_MSGPOOL_H
+#define CORE_MSGPOOL_H
+
+// Message buffer pool.  Message structures and bodies up to
+// NNI_MSGPOOL_MAX_SIZE bytes are rounded up to a size class, and recycled
+// through a small fixed number of locked shards (picked by hashing the
+// caller's stack address) backed by a global depot, so that steady state
+// traffic does not need to go to the system allocator.  Outside of
+// initialization the pool is bypassed.  Memory returned from the pool is
+// NOT zeroed.
+
+#define NNI_MSGPOOL_MAX_SIZE 65536
+
+// nni_msgpool_alloc allocates a buffer of at least the given size.
+// Sizes up to NNI_MSGPOOL_MAX_SIZE are rounded up to a size class.
+extern void *nni_msgpool_alloc(size_t);
+
+// nni_msgpool_free returns a buffer to the pool, or to the system if it
+// is too large or the pool is full.  The size must be the one that was
+// passed to nni_msgpool_alloc.
+extern void nni_msgpool_free(void *, size_t);
+
+// nni_msgpool_stats reports pool hits, misses, and retained bytes.
+extern void nni_msgpool_stats(uint64_t *, uint64_t *, uint64_t *);
+
+extern int  nni_msgpool_sys_init(void);
+extern void nni_msgpool_sys_fini(void);
+
+#endif // CORE_MSGPOOL_H
@@ -34,6 +34,7 @@
 #include "core/list.h"
 #include "core/lmq.h"
 #include "core/message.h"
+#include "core/msgpool.h"
 #include "core/msgqueue.h"
 #include "core/options.h"
 #include "core/panic.h"
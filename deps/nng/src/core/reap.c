@@ -105,6 +105,9 @@ nni_reap_sys_init(void)
 {
 	int rv;
 
+	// Left set by a previous nni_reap_sys_fini.
+	reap_exit = false;
+
 	// If this fails, we don't fail init, instead we will try to
 	// start up at reap time.
 	if ((rv = nni_thr_init(&reap_thr, reap_worker, NULL)) != 0) {
@@ -289,6 +289,9 @@ stat_update(nni_stat *stat)
 		break;
 	case NNG_STAT_COUNTER:
 	case NNG_STAT_LEVEL:
+		if (info->si_update != NULL) {
+			info->si_update((nni_stat_item *) item);
+		}
 		if (info->si_atomic) {
 			stat->s_val.sv_value = nni_atomic_get64(
 			    (nni_atomic_u64 *) &item->si_u.sv_atomic);
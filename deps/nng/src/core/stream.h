@@ -31,6 +31,13 @@ extern int nni_stream_listener_get(
 extern int nni_stream_listener_set(
     nng_stream_listener *, const char *, const void *, size_t, nni_type);
 
+// Internal option, not for normal use.  This tells the stream about the
+// buffer (an nni_iov) that its owner receives into over and over, so that
+// the platform can map it once for all of those receives.  The buffer must
+// stay until the stream is freed.  Streams that have no use for this
+// return NNG_ENOTSUP, which callers may ignore.
+#define NNI_OPT_RECV_BUFFER "recv-buffer"
+
 // This is the common implementation of a connected byte stream.  It should be
 // the first element of any implementation.  Applications are not permitted to
 // access it directly.
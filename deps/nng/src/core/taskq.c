@@ -10,23 +10,128 @@
 
 #include "core/nng_impl.h"
 
+// Each worker thread has its own queue of tasks.  Dispatched tasks go
+// to a queue picked by the dispatching thread, so different threads
+// mostly do not contend with each other.  An idle worker takes work from
+// its own queue first, and then steals from the others.  Idle workers
+// are woken one at a time, and only when there is work for them, rather
+// than all at once on a single shared condition variable.
+//
+// To make sure that a task is never left waiting while a worker sleeps,
+// a worker announces that it is idle before looking at the queues one
+// last time.  A dispatcher appends the task before checking for idle
+// workers.  Either the worker finds the task, or the dispatcher finds
+// the worker.
+
 typedef struct nni_taskq_thr nni_taskq_thr;
 struct nni_taskq_thr {
 	nni_taskq *tqt_tq;
 	nni_thr    tqt_thread;
+	nni_mtx    tqt_mtx;
+	nni_cv     tqt_cv;
+	nni_list   tqt_tasks;
+	bool       tqt_idle; // Waiting for work
+	bool       tqt_wake; // Woken, but not yet running
+	bool       tqt_run;
 };
 struct nni_taskq {
-	nni_list       tq_tasks;
-	nni_mtx        tq_mtx;
-	nni_cv         tq_sched_cv;
-	nni_cv         tq_wait_cv;
 	nni_taskq_thr *tq_threads;
 	int            tq_nthreads;
-	bool           tq_run;
+	nni_atomic_int tq_idle;
 };
 
 static nni_taskq *nni_taskq_systq = NULL;
 
+// nni_taskq_self picks the queue for the calling thread.  Workers use
+// their own queue.  C99 has no portable thread-local storage, so for
+// other threads, as with the message pool, we hash the address of a
+// local variable, which is on the caller's own stack.
+static int
+nni_taskq_self(nni_taskq *tq)
+{
+	int      local;
+	uint64_t x;
+
+	for (int i = 0; i < tq->tq_nthreads; i++) {
+		if (nni_thr_is_self(&tq->tq_threads[i].tqt_thread)) {
+			return (i);
+		}
+	}
+	x = (uint64_t) (uintptr_t) &local >> 16;
+	x *= 0x9E3779B97F4A7C15ull;
+	return ((int) ((x >> 32) % (uint64_t) tq->tq_nthreads));
+}
+
+// nni_taskq_take removes the first task from the worker's own queue, or
+// failing that, from the first other queue that has one.
+static nni_task *
+nni_taskq_take(nni_taskq_thr *thr)
+{
+	nni_taskq *tq   = thr->tqt_tq;
+	int        self = (int) (thr - tq->tq_threads);
+
+	for (int i = 0; i < tq->tq_nthreads; i++) {
+		nni_taskq_thr *victim =
+		    &tq->tq_threads[(self + i) % tq->tq_nthreads];
+		nni_task *task;
+
+		nni_mtx_lock(&victim->tqt_mtx);
+		if ((task = nni_list_first(&victim->tqt_tasks)) != NULL) {
+			nni_list_remove(&victim->tqt_tasks, task);
+		}
+		nni_mtx_unlock(&victim->tqt_mtx);
+		if (task != NULL) {
+			return (task);
+		}
+	}
+	return (NULL);
+}
+
+// nni_taskq_wake_idle wakes one idle worker, if there is one that has
+// not already been woken.
+static void
+nni_taskq_wake_idle(nni_taskq *tq, int start)
+{
+	for (int i = 1; i < tq->tq_nthreads; i++) {
+		nni_taskq_thr *thr =
+		    &tq->tq_threads[(start + i) % tq->tq_nthreads];
+		bool woke = false;
+
+		nni_mtx_lock(&thr->tqt_mtx);
+		if (thr->tqt_idle && !thr->tqt_wake) {
+			thr->tqt_wake = true;
+			nni_cv_wake1(&thr->tqt_cv);
+			woke = true;
+		}
+		nni_mtx_unlock(&thr->tqt_mtx);
+		if (woke) {
+			return;
+		}
+	}
+}
+
+static void
+nni_taskq_push(nni_taskq *tq, nni_task *task)
+{
+	int            self = nni_taskq_self(tq);
+	nni_taskq_thr *thr  = &tq->tq_threads[self];
+
+	nni_mtx_lock(&thr->tqt_mtx);
+	nni_list_append(&thr->tqt_tasks, task);
+	if (thr->tqt_idle && !thr->tqt_wake) {
+		thr->tqt_wake = true;
+		nni_cv_wake1(&thr->tqt_cv);
+		nni_mtx_unlock(&thr->tqt_mtx);
+		return;
+	}
+	nni_mtx_unlock(&thr->tqt_mtx);
+
+	// The owner is busy, so get someone else to steal it.
+	if (nni_atomic_get(&tq->tq_idle) > 0) {
+		nni_taskq_wake_idle(tq, self);
+	}
+}
+
 static void
 nni_taskq_thread(void *self)
 {
@@ -36,34 +141,46 @@ nni_taskq_thread(void *self)
 
 	nni_thr_set_name(NULL, "nng:task");
 
-	nni_mtx_lock(&tq->tq_mtx);
 	for (;;) {
-		if ((task = nni_list_first(&tq->tq_tasks)) != NULL) {
+		if ((task = nni_taskq_take(thr)) == NULL) {
+			bool run;
 
-			nni_list_remove(&tq->tq_tasks, task);
+			nni_mtx_lock(&thr->tqt_mtx);
+			thr->tqt_idle = true;
+			nni_mtx_unlock(&thr->tqt_mtx);
+			nni_atomic_inc(&tq->tq_idle);
 
-			nni_mtx_unlock(&tq->tq_mtx);
+			task = nni_taskq_take(thr);
 
-			task->task_cb(task->task_arg);
-
-			nni_mtx_lock(&task->task_mtx);
-			task->task_busy--;
-			if (task->task_busy == 0) {
-				nni_cv_wake(&task->task_cv);
+			nni_mtx_lock(&thr->tqt_mtx);
+			while ((task == NULL) && (!thr->tqt_wake) &&
+			    (thr->tqt_run) && nni_list_empty(&thr->tqt_tasks)) {
+				nni_cv_wait(&thr->tqt_cv);
+			}
+			run           = thr->tqt_run || thr->tqt_wake ||
+			    !nni_list_empty(&thr->tqt_tasks);
+			thr->tqt_idle = false;
+			thr->tqt_wake = false;
+			nni_mtx_unlock(&thr->tqt_mtx);
+			nni_atomic_dec(&tq->tq_idle);
+
+			if (task == NULL) {
+				if (!run) {
+					break;
+				}
+				continue;
 			}
-			nni_mtx_unlock(&task->task_mtx);
-
-			nni_mtx_lock(&tq->tq_mtx);
-
-			continue;
 		}
 
-		if (!tq->tq_run) {
-			break;
+		task->task_cb(task->task_arg);
+
+		nni_mtx_lock(&task->task_mtx);
+		task->task_busy--;
+		if (task->task_busy == 0) {
+			nni_cv_wake(&task->task_cv);
 		}
-		nni_cv_wait(&tq->tq_sched_cv);
+		nni_mtx_unlock(&task->task_mtx);
 	}
-	nni_mtx_unlock(&tq->tq_mtx);
 }
 
 int
@@ -80,15 +197,18 @@ nni_taskq_init(nni_taskq **tqp, int nthr)
 		return (NNG_ENOMEM);
 	}
 	tq->tq_nthreads = nthr;
-	NNI_LIST_INIT(&tq->tq_tasks, nni_task, task_node);
-
-	nni_mtx_init(&tq->tq_mtx);
-	nni_cv_init(&tq->tq_sched_cv, &tq->tq_mtx);
-	nni_cv_init(&tq->tq_wait_cv, &tq->tq_mtx);
+	nni_atomic_init(&tq->tq_idle);
 
+	for (int i = 0; i < nthr; i++) {
+		nni_taskq_thr *thr = &tq->tq_threads[i];
+		thr->tqt_tq        = tq;
+		thr->tqt_run       = true;
+		NNI_LIST_INIT(&thr->tqt_tasks, nni_task, task_node);
+		nni_mtx_init(&thr->tqt_mtx);
+		nni_cv_init(&thr->tqt_cv, &thr->tqt_mtx);
+	}
 	for (int i = 0; i < nthr; i++) {
 		int rv;
-		tq->tq_threads[i].tqt_tq = tq;
 		rv = nni_thr_init(&tq->tq_threads[i].tqt_thread,
 		    nni_taskq_thread, &tq->tq_threads[i]);
 		if (rv != 0) {
@@ -96,7 +216,6 @@ nni_taskq_init(nni_taskq **tqp, int nthr)
 			return (rv);
 		}
 	}
-	tq->tq_run = true;
 	for (int i = 0; i < tq->tq_nthreads; i++) {
 		nni_thr_run(&tq->tq_threads[i].tqt_thread);
 	}
@@ -110,18 +229,20 @@ nni_taskq_fini(nni_taskq *tq)
 	if (tq == NULL) {
 		return;
 	}
-	if (tq->tq_run) {
-		nni_mtx_lock(&tq->tq_mtx);
-		tq->tq_run = false;
-		nni_cv_wake(&tq->tq_sched_cv);
-		nni_mtx_unlock(&tq->tq_mtx);
+	for (int i = 0; i < tq->tq_nthreads; i++) {
+		nni_taskq_thr *thr = &tq->tq_threads[i];
+		nni_mtx_lock(&thr->tqt_mtx);
+		thr->tqt_run = false;
+		nni_cv_wake(&thr->tqt_cv);
+		nni_mtx_unlock(&thr->tqt_mtx);
 	}
 	for (int i = 0; i < tq->tq_nthreads; i++) {
 		nni_thr_fini(&tq->tq_threads[i].tqt_thread);
 	}
-	nni_cv_fini(&tq->tq_wait_cv);
-	nni_cv_fini(&tq->tq_sched_cv);
-	nni_mtx_fini(&tq->tq_mtx);
+	for (int i = 0; i < tq->tq_nthreads; i++) {
+		nni_cv_fini(&tq->tq_threads[i].tqt_cv);
+		nni_mtx_fini(&tq->tq_threads[i].tqt_mtx);
+	}
 	NNI_FREE_STRUCTS(tq->tq_threads, tq->tq_nthreads);
 	NNI_FREE_STRUCT(tq);
 }
@@ -168,10 +289,7 @@ nni_task_dispatch(nni_task *task)
 	}
 	nni_mtx_unlock(&task->task_mtx);
 
-	nni_mtx_lock(&tq->tq_mtx);
-	nni_list_append(&tq->tq_tasks, task);
-	nni_cv_wake1(&tq->tq_sched_cv); // waking just one waiter is adequate
-	nni_mtx_unlock(&tq->tq_mtx);
+	nni_taskq_push(tq, task);
 }
 
 void
@@ -0,0 +1,143 @@
+//
+// Copyright 2024 Staysail Systems, Inc. <info@staysail.tech>
+//
+// This software is supplied under the terms of the MIT License, a
+// copy of which should be located in the distribution where this
+// file was obtained (LICENSE.txt).  A copy of the license may also be
+// found online at https://opensource.org/licenses/MIT.
+//
+
+#include <nuts.h>
+
+#include "core/nng_impl.h"
+
+#define BENCH_TASKS 64
+#define BENCH_RUNS 2000
+
+typedef struct {
+	nni_mtx mtx;
+	nni_cv  cv;
+	int     done;
+} bench_state;
+
+typedef struct {
+	nni_task     task;
+	int          remain;
+	bench_state *state;
+} bench_task;
+
+// Each task dispatches itself again from its own callback, until it has
+// run BENCH_RUNS times, so that most of the work is submitted by the
+// worker threads themselves.
+static void
+bench_cb(void *arg)
+{
+	bench_task  *bt = arg;
+	bench_state *bs = bt->state;
+
+	if (--bt->remain > 0) {
+		nni_task_dispatch(&bt->task);
+		return;
+	}
+	nni_mtx_lock(&bs->mtx);
+	bs->done++;
+	nni_cv_wake(&bs->cv);
+	nni_mtx_unlock(&bs->mtx);
+}
+
+static void
+bench_taskq(int nthr)
+{
+	nni_taskq  *tq;
+	bench_state bs;
+	bench_task *bts;
+	nni_time    start, end;
+	int         remain = 0;
+
+	NUTS_ASSERT((bts = calloc(BENCH_TASKS, sizeof(*bts))) != NULL);
+	nni_mtx_init(&bs.mtx);
+	nni_cv_init(&bs.cv, &bs.mtx);
+	bs.done = 0;
+	NUTS_PASS(nni_taskq_init(&tq, nthr));
+
+	for (int i = 0; i < BENCH_TASKS; i++) {
+		bts[i].remain = BENCH_RUNS;
+		bts[i].state  = &bs;
+		nni_task_init(&bts[i].task, tq, bench_cb, &bts[i]);
+	}
+	start = nni_clock();
+	for (int i = 0; i < BENCH_TASKS; i++) {
+		nni_task_dispatch(&bts[i].task);
+	}
+	nni_mtx_lock(&bs.mtx);
+	while (bs.done < BENCH_TASKS) {
+		nni_cv_wait(&bs.cv);
+	}
+	nni_mtx_unlock(&bs.mtx);
+	end = nni_clock();
+
+	for (int i = 0; i < BENCH_TASKS; i++) {
+		nni_task_wait(&bts[i].task);
+		remain += bts[i].remain;
+		nni_task_fini(&bts[i].task);
+	}
+	NUTS_TRUE(remain == 0);
+	nni_taskq_fini(tq);
+	nni_cv_fini(&bs.cv);
+	nni_mtx_fini(&bs.mtx);
+	free(bts);
+
+	printf("  %2d threads: %d tasks in %u ms (%u tasks/ms)\n", nthr,
+	    BENCH_TASKS * BENCH_RUNS, (unsigned) (end - start),
+	    (unsigned) ((BENCH_TASKS * BENCH_RUNS) /
+	        (end > start ? end - start : 1)));
+}
+
+void
+test_taskq_bench(void)
+{
+	NUTS_PASS(nni_init());
+	for (int nthr = 1; nthr <= 64; nthr *= 2) {
+		bench_taskq(nthr);
+	}
+	nng_fini();
+}
+
+static void
+wait_cb(void *arg)
+{
+	nni_atomic_int *cnt = arg;
+	nng_msleep(1);
+	nni_atomic_inc(cnt);
+}
+
+// A task dispatched while every worker is busy must still be picked up
+// by whichever worker frees up first, even if it was queued for another.
+void
+test_taskq_steal(void)
+{
+	nni_taskq     *tq;
+	nni_task       tasks[32];
+	nni_atomic_int cnt;
+
+	NUTS_PASS(nni_init());
+	nni_atomic_init(&cnt);
+	NUTS_PASS(nni_taskq_init(&tq, 4));
+	for (int i = 0; i < 32; i++) {
+		nni_task_init(&tasks[i], tq, wait_cb, &cnt);
+		nni_task_dispatch(&tasks[i]);
+	}
+	for (int i = 0; i < 32; i++) {
+		nni_task_wait(&tasks[i]);
+		nni_task_fini(&tasks[i]);
+	}
+	NUTS_TRUE(nni_atomic_get(&cnt) == 32);
+	nni_taskq_fini(tq);
+	nng_fini();
+}
+
+NUTS_TESTS = {
+	{ "taskq steal", test_taskq_steal },
+	{ "taskq bench", test_taskq_bench },
+	{ NULL, NULL },
+};
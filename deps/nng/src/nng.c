@@ -83,6 +83,23 @@ nng_strfree(char *s)
 	nni_strfree(s);
 }
 
+// recv_copy copies out up to len bytes of a received message body,
+// which may be segmented.
+static void
+recv_copy(void *buf, nng_msg *msg, size_t len)
+{
+	nni_iov  iov[NNI_MSG_MAX_IOV];
+	unsigned n = nni_msg_iov(msg, iov);
+	uint8_t *dst = buf;
+
+	for (unsigned i = 0; (i < n) && (len > 0); i++) {
+		size_t k = iov[i].iov_len < len ? iov[i].iov_len : len;
+		memcpy(dst, iov[i].iov_buf, k);
+		dst += k;
+		len -= k;
+	}
+}
+
 int
 nng_recv(nng_socket s, void *buf, size_t *szp, int flags)
 {
@@ -95,8 +112,8 @@ nng_recv(nng_socket s, void *buf, size_t *szp, int flags)
 		return (rv);
 	}
 	if (!(flags & NNG_FLAG_ALLOC)) {
-		memcpy(buf, nng_msg_body(msg),
-		    *szp > nng_msg_len(msg) ? nng_msg_len(msg) : *szp);
+		recv_copy(
+		    buf, msg, *szp > nng_msg_len(msg) ? nng_msg_len(msg) : *szp);
 		*szp = nng_msg_len(msg);
 	} else {
 		// We'd really like to avoid a separate data copy, but since
@@ -113,7 +130,7 @@ nng_recv(nng_socket s, void *buf, size_t *szp, int flags)
 			}
 
 			*(void **) buf = nbuf;
-			memcpy(nbuf, nni_msg_body(msg), nni_msg_len(msg));
+			recv_copy(nbuf, msg, nni_msg_len(msg));
 			*szp = nng_msg_len(msg);
 		} else {
 			*(void **) buf = NULL;
@@ -1511,7 +1528,14 @@ nng_pipe_id(nng_pipe p)
 int
 nng_msg_alloc(nng_msg **msgp, size_t size)
 {
-	return (nni_msg_alloc(msgp, size));
+	int rv;
+
+	// Internal allocations leave the body uninitialized, as they are
+	// filled right away, but applications have always gotten zeros.
+	if (((rv = nni_msg_alloc(msgp, size)) == 0) && (size > 0)) {
+		memset(nni_msg_body(*msgp), 0, size);
+	}
+	return (rv);
 }
 
 int
@@ -1520,6 +1544,16 @@ nng_msg_realloc(nng_msg *msg, size_t sz)
 	return (nni_msg_realloc(msg, sz));
 }
 
+int
+nng_msg_alloc_external(
+    nng_msg **msgp, void *buf, size_t size, nng_msg_free_cb cb, void *arg)
+{
+	if ((buf == NULL) && (size != 0)) {
+		return (NNG_EINVAL);
+	}
+	return (nni_msg_alloc_external(msgp, buf, size, cb, arg));
+}
+
 void
 nng_msg_free(nng_msg *msg)
 {
@@ -1765,7 +1799,7 @@ nng_msg_trim_u16(nng_msg *m, uint16_t *vp)
 	if (nni_msg_len(m) < sizeof(v)) {
 		return (NNG_EINVAL);
 	}
-	body = nni_msg_body(m);
+	body = nni_msg_peek(m, sizeof(v));
 	NNI_GET16(body, v);
 	(void) nni_msg_trim(m, sizeof(v));
 	*vp = v;
@@ -1780,7 +1814,7 @@ nng_msg_trim_u32(nng_msg *m, uint32_t *vp)
 	if (nni_msg_len(m) < sizeof(v)) {
 		return (NNG_EINVAL);
 	}
-	body = nni_msg_body(m);
+	body = nni_msg_peek(m, sizeof(v));
 	NNI_GET32(body, v);
 	(void) nni_msg_trim(m, sizeof(v));
 	*vp = v;
@@ -1795,7 +1829,7 @@ nng_msg_trim_u64(nng_msg *m, uint64_t *vp)
 	if (nni_msg_len(m) < sizeof(v)) {
 		return (NNG_EINVAL);
 	}
-	body = nni_msg_body(m);
+	body = nni_msg_peek(m, sizeof(v));
 	NNI_GET64(body, v);
 	(void) nni_msg_trim(m, sizeof(v));
 	*vp = v;
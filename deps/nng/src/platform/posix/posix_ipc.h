@@ -17,6 +17,7 @@
 
 #ifdef NNG_PLATFORM_POSIX
 #include "platform/posix/posix_aio.h"
+#include "platform/posix/posix_uring.h"
 
 #include <sys/types.h> // For mode_t
 
@@ -31,6 +32,9 @@ struct nni_ipc_conn {
 	nni_ipc_dialer *dialer;
 	nng_sockaddr    sa;
 	nni_reap_node   reap;
+#ifdef NNG_HAVE_IO_URING
+	nni_posix_ustream us; // transfers, if on io_uring (us.ring set)
+#endif
 };
 
 struct nni_ipc_dialer {
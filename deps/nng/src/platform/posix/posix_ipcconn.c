@@ -28,8 +28,10 @@
 
 typedef struct nni_ipc_conn ipc_conn;
 
+// Successful transfers are completed inline if cl is not NULL and the
+// aio allows it.  See ipc_cb.
 static void
-ipc_dowrite(ipc_conn *c)
+ipc_dowrite(ipc_conn *c, nni_aio_completions *cl)
 {
 	nni_aio *aio;
 	int      fd;
@@ -90,7 +92,7 @@ ipc_dowrite(ipc_conn *c)
 		// We completed the entire operation on this aio.
 		// (Sendmsg never returns a partial result.)
 		nni_aio_list_remove(aio);
-		nni_aio_finish(aio, 0, nni_aio_count(aio));
+		nni_aio_completions_defer(cl, aio, 0, nni_aio_count(aio));
 
 		// Go back to start of loop to see if there is another
 		// aio ready for us to process.
@@ -98,7 +100,7 @@ ipc_dowrite(ipc_conn *c)
 }
 
 static void
-ipc_doread(ipc_conn *c)
+ipc_doread(ipc_conn *c, nni_aio_completions *cl)
 {
 	nni_aio *aio;
 	int      fd;
@@ -155,7 +157,7 @@ ipc_doread(ipc_conn *c)
 
 		// We completed the entire operation on this aio.
 		nni_aio_list_remove(aio);
-		nni_aio_finish(aio, 0, nni_aio_count(aio));
+		nni_aio_completions_defer(cl, aio, 0, nni_aio_count(aio));
 
 		// Go back to start of loop to see if there is another
 		// aio ready for us to process.
@@ -186,6 +188,15 @@ ipc_close(void *arg)
 	if (!c->closed) {
 		nni_aio *aio;
 		c->closed = true;
+#ifdef NNG_HAVE_IO_URING
+		if (c->us.ring != NULL) {
+			// Those in the kernel are taken back, so all fail now.
+			nni_posix_ustream_close(&c->us, NNG_ECLOSED);
+			nni_posix_pfd_close(c->pfd);
+			nni_mtx_unlock(&c->mtx);
+			return;
+		}
+#endif
 		while (((aio = nni_list_first(&c->readq)) != NULL) ||
 		    ((aio = nni_list_first(&c->writeq)) != NULL)) {
 			nni_aio_list_remove(aio);
@@ -201,18 +212,30 @@ ipc_close(void *arg)
 static void
 ipc_cb(nni_posix_pfd *pfd, unsigned events, void *arg)
 {
-	ipc_conn *c = arg;
+	ipc_conn           *c = arg;
+	nni_aio_completions cl;
 
-	if (events & (NNI_POLL_HUP | NNI_POLL_ERR | NNI_POLL_INVAL)) {
+	if (events & (NNI_POLL_ERR | NNI_POLL_INVAL)) {
 		ipc_error(c, NNG_ECONNSHUT);
 		return;
 	}
+	// The peer hung up, but whatever it sent before that can still be
+	// read.  Reads see end of file after it, and writes fail, so we
+	// just let both run.
+	if ((events & NNI_POLL_HUP) != 0) {
+		events |= NNI_POLL_IN | NNI_POLL_OUT;
+	}
+	// Completions that permit it are run right here on the poller
+	// thread, once we have dropped the lock.  Only this path does
+	// that.  Transfers started from within those callbacks complete
+	// through the task queue, so the nesting is never deeper than one.
+	nni_aio_completions_init(&cl);
 	nni_mtx_lock(&c->mtx);
 	if ((events & NNI_POLL_IN) != 0) {
-		ipc_doread(c);
+		ipc_doread(c, &cl);
 	}
 	if ((events & NNI_POLL_OUT) != 0) {
-		ipc_dowrite(c);
+		ipc_dowrite(c, &cl);
 	}
 	events = 0;
 	if (!nni_list_empty(&c->writeq)) {
@@ -225,6 +248,7 @@ ipc_cb(nni_posix_pfd *pfd, unsigned events, void *arg)
 		nni_posix_pfd_arm(pfd, events);
 	}
 	nni_mtx_unlock(&c->mtx);
+	nni_aio_completions_run(&cl);
 }
 
 static void
@@ -234,6 +258,11 @@ ipc_cancel(nni_aio *aio, void *arg, int rv)
 
 	nni_mtx_lock(&c->mtx);
 	if (nni_aio_list_active(aio)) {
+#ifdef NNG_HAVE_IO_URING
+		if (c->us.ring != NULL) {
+			nni_posix_ustream_cancel(&c->us, aio);
+		}
+#endif
 		nni_aio_list_remove(aio);
 		nni_aio_finish_error(aio, rv);
 	}
@@ -257,9 +286,16 @@ ipc_send(void *arg, nni_aio *aio)
 		return;
 	}
 	nni_aio_list_append(&c->writeq, aio);
+#ifdef NNG_HAVE_IO_URING
+	if (c->us.ring != NULL) {
+		nni_posix_ustream_send(&c->us);
+		nni_mtx_unlock(&c->mtx);
+		return;
+	}
+#endif
 
 	if (nni_list_first(&c->writeq) == aio) {
-		ipc_dowrite(c);
+		ipc_dowrite(c, NULL);
 		// If we are still the first thing on the list, that
 		// means we didn't finish the job, so arm the poller to
 		// complete us.
@@ -287,13 +323,20 @@ ipc_recv(void *arg, nni_aio *aio)
 		return;
 	}
 	nni_aio_list_append(&c->readq, aio);
+#ifdef NNG_HAVE_IO_URING
+	if (c->us.ring != NULL) {
+		nni_posix_ustream_recv(&c->us);
+		nni_mtx_unlock(&c->mtx);
+		return;
+	}
+#endif
 
 	// If we are only job on the list, go ahead and try to do an
 	// immediate transfer. This allows for faster completions in
 	// many cases.  We also need not arm a list if it was already
 	// armed.
 	if (nni_list_first(&c->readq) == aio) {
-		ipc_doread(c);
+		ipc_doread(c, NULL);
 		// If we are still the first thing on the list, that
 		// means we didn't finish the job, so arm the poller to
 		// complete us.
@@ -379,9 +422,40 @@ ipc_get_addr(void *arg, void *buf, size_t *szp, nni_type t)
 	return (nni_copyout_sockaddr(&c->sa, buf, szp, t));
 }
 
+static int
+ipc_set_recv_buffer(void *arg, const void *buf, size_t sz, nni_type t)
+{
+	ipc_conn *c  = arg;
+	int       rv = NNG_ENOTSUP;
+
+#ifdef NNG_HAVE_IO_URING
+	nni_mtx_lock(&c->mtx);
+	if (c->us.ring != NULL) {
+		rv = nni_posix_ustream_recv_buffer(&c->us, buf, sz, t);
+	}
+	nni_mtx_unlock(&c->mtx);
+#else
+	NNI_ARG_UNUSED(c);
+	NNI_ARG_UNUSED(buf);
+	NNI_ARG_UNUSED(sz);
+	NNI_ARG_UNUSED(t);
+#endif
+	return (rv);
+}
+
 void
 nni_posix_ipc_start(nni_ipc_conn *c)
 {
+#ifdef NNG_HAVE_IO_URING
+	nni_posix_uring *ring;
+
+	if ((ring = nni_posix_uring_get()) != NULL) {
+		// The pfd just holds the descriptor; it is never armed.
+		nni_posix_ustream_init(&c->us, ring, nni_posix_pfd_fd(c->pfd),
+		    &c->mtx, &c->readq, &c->writeq);
+		return;
+	}
+#endif
 	nni_posix_pfd_set_cb(c->pfd, ipc_cb, c);
 }
 
@@ -390,6 +464,11 @@ ipc_reap(void *arg)
 {
 	ipc_conn *c = arg;
 	ipc_close(c);
+#ifdef NNG_HAVE_IO_URING
+	if (c->us.ring != NULL) {
+		nni_posix_ustream_fini(&c->us);
+	}
+#endif
 	if (c->pfd != NULL) {
 		nni_posix_pfd_fini(c->pfd);
 	}
@@ -438,6 +517,10 @@ static const nni_option ipc_options[] = {
 	    .o_name = NNG_OPT_IPC_PEER_ZONEID,
 	    .o_get  = ipc_get_peer_zoneid,
 	},
+	{
+	    .o_name = NNI_OPT_RECV_BUFFER,
+	    .o_set  = ipc_set_recv_buffer,
+	},
 	{
 	    .o_name = NULL,
 	},
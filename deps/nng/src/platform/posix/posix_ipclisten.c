@@ -39,6 +39,9 @@ typedef struct {
 	char *              path;
 	mode_t              perms;
 	nni_mtx             mtx;
+#ifdef NNG_HAVE_IO_URING
+	nni_posix_uaccept ua; // accepts, if on io_uring (ua.ring set)
+#endif
 } ipc_listener;
 
 static void
@@ -53,6 +56,11 @@ ipc_listener_doclose(ipc_listener *l)
 		nni_aio_finish_error(aio, NNG_ECLOSED);
 	}
 
+#ifdef NNG_HAVE_IO_URING
+	if (l->ua.ring != NULL) {
+		nni_posix_uaccept_close(&l->ua);
+	}
+#endif
 	if (l->pfd != NULL) {
 		nni_posix_pfd_close(l->pfd);
 	}
@@ -72,20 +80,22 @@ ipc_listener_close(void *arg)
 	nni_mtx_unlock(&l->mtx);
 }
 
-static void
-ipc_listener_doaccept(ipc_listener *l)
+// ipc_listener_nextfd takes the next connection.  If there is none yet,
+// it returns NNG_EAGAIN, and we come back here when there is.
+static int
+ipc_listener_nextfd(ipc_listener *l, int *fdp)
 {
-	nni_aio *aio;
-
-	while ((aio = nni_list_first(&l->acceptq)) != NULL) {
-		int            newfd;
-		int            fd;
-		int            rv;
-		nni_posix_pfd *pfd;
-		nni_ipc_conn * c;
-
-		fd = nni_posix_pfd_fd(l->pfd);
+	int newfd;
+	int fd;
+	int rv;
 
+#ifdef NNG_HAVE_IO_URING
+	if (l->ua.ring != NULL) {
+		return (nni_posix_uaccept_next(&l->ua, fdp));
+	}
+#endif
+	fd = nni_posix_pfd_fd(l->pfd);
+	for (;;) {
 #ifdef NNG_USE_ACCEPT4
 		newfd = accept4(fd, NULL, NULL, SOCK_CLOEXEC);
 		if ((newfd < 0) && ((errno == ENOSYS) || (errno == ENOTSUP))) {
@@ -94,34 +104,54 @@ ipc_listener_doaccept(ipc_listener *l)
 #else
 		newfd = accept(fd, NULL, NULL);
 #endif
-		if (newfd < 0) {
-			switch (errno) {
-			case EAGAIN:
+		if (newfd >= 0) {
+			*fdp = newfd;
+			return (0);
+		}
+		switch (errno) {
+		case EAGAIN:
 #ifdef EWOULDBLOCK
 #if EWOULDBLOCK != EAGAIN
-			case EWOULDBLOCK:
+		case EWOULDBLOCK:
 #endif
 #endif
-				rv = nni_posix_pfd_arm(l->pfd, NNI_POLL_IN);
-				if (rv != 0) {
-					nni_aio_list_remove(aio);
-					nni_aio_finish_error(aio, rv);
-					continue;
-				}
-				// Come back later...
-				return;
-			case ECONNABORTED:
-			case ECONNRESET:
-				// Eat them, they aren't interesting.
-				continue;
-			default:
-				// Error this one, but keep moving to the next.
-				rv = nni_plat_errno(errno);
-				NNI_ASSERT(rv != 0);
-				nni_aio_list_remove(aio);
-				nni_aio_finish_error(aio, rv);
-				continue;
+			rv = nni_posix_pfd_arm(l->pfd, NNI_POLL_IN);
+			if (rv != 0) {
+				return (rv);
 			}
+			// Come back later...
+			return (NNG_EAGAIN);
+		case ECONNABORTED:
+		case ECONNRESET:
+			// Eat them, they aren't interesting.
+			continue;
+		default:
+			rv = nni_plat_errno(errno);
+			NNI_ASSERT(rv != 0);
+			return (rv);
+		}
+	}
+}
+
+static void
+ipc_listener_doaccept(ipc_listener *l)
+{
+	nni_aio *aio;
+
+	while ((aio = nni_list_first(&l->acceptq)) != NULL) {
+		int            newfd;
+		int            rv;
+		nni_posix_pfd *pfd;
+		nni_ipc_conn * c;
+
+		if ((rv = ipc_listener_nextfd(l, &newfd)) == NNG_EAGAIN) {
+			return;
+		}
+		if (rv != 0) {
+			// Error this one, but keep moving to the next.
+			nni_aio_list_remove(aio);
+			nni_aio_finish_error(aio, rv);
+			continue;
 		}
 
 		if ((rv = nni_posix_ipc_alloc(&c, &l->sa, NULL)) != 0) {
@@ -165,6 +195,18 @@ ipc_listener_cb(nni_posix_pfd *pfd, unsigned events, void *arg)
 	nni_mtx_unlock(&l->mtx);
 }
 
+#ifdef NNG_HAVE_IO_URING
+static void
+ipc_listener_ucb(void *arg)
+{
+	ipc_listener *l = arg;
+
+	nni_mtx_lock(&l->mtx);
+	ipc_listener_doaccept(l);
+	nni_mtx_unlock(&l->mtx);
+}
+#endif
+
 static void
 ipc_listener_cancel(nni_aio *aio, void *arg, int rv)
 {
@@ -309,6 +351,9 @@ ipc_listener_listen(void *arg)
 	int                     fd;
 	nni_posix_pfd *         pfd;
 	char *                  path;
+#ifdef NNG_HAVE_IO_URING
+	nni_posix_uring *ring;
+#endif
 
 	if ((len = nni_posix_nn2sockaddr(&ss, &l->sa)) < sizeof(sa_family_t)) {
 		return (NNG_EADDRINVAL);
@@ -395,6 +440,12 @@ ipc_listener_listen(void *arg)
 #endif
 
 	nni_posix_pfd_set_cb(pfd, ipc_listener_cb, l);
+#ifdef NNG_HAVE_IO_URING
+	if ((ring = nni_posix_uring_get()) != NULL) {
+		// Accepts go through the ring; the pfd is never armed.
+		nni_posix_uaccept_init(&l->ua, ring, fd, ipc_listener_ucb, l);
+	}
+#endif
 
 	l->pfd     = pfd;
 	l->started = true;
@@ -415,6 +466,11 @@ ipc_listener_free(void *arg)
 	pfd = l->pfd;
 	nni_mtx_unlock(&l->mtx);
 
+#ifdef NNG_HAVE_IO_URING
+	if (l->ua.ring != NULL) {
+		nni_posix_uaccept_fini(&l->ua);
+	}
+#endif
 	if (pfd != NULL) {
 		nni_posix_pfd_fini(pfd);
 	}
@@ -1,5 +1,5 @@
 //
-// Copyright 2020 Staysail Systems, Inc. <info@staysail.tech>
+// Copyright 2024 Staysail Systems, Inc. <info@staysail.tech>
 // Copyright 2018 Capitar IT Group BV <info@capitar.com>
 // Copyright 2018 Liam Staskawicz <liam@stask.net>
 //
@@ -22,6 +22,7 @@
 
 #include "core/nng_impl.h"
 #include "platform/posix/posix_pollq.h"
+#include "platform/posix/posix_uring.h"
 
 typedef struct nni_posix_pollq nni_posix_pollq;
 
@@ -34,8 +35,12 @@ typedef struct nni_posix_pollq nni_posix_pollq;
 
 #define NNI_MAX_EPOLL_EVENTS 64
 
-// flags we always want enabled as long as at least one event is active
-#define NNI_EPOLL_FLAGS ((unsigned) EPOLLONESHOT | (unsigned) EPOLLERR)
+// flags we always want enabled, along with the directions watched
+#define NNI_EPOLL_FLAGS_ONESHOT ((unsigned) EPOLLONESHOT | (unsigned) EPOLLERR)
+#define NNI_EPOLL_FLAGS_EDGE ((unsigned) EPOLLET | (unsigned) EPOLLERR)
+
+// conditions delivered to anyone waiting, whatever they wait for
+#define NNI_EPOLL_FAULTS ((unsigned) EPOLLERR | (unsigned) EPOLLHUP)
 
 // Locking strategy:
 //
@@ -46,8 +51,37 @@ typedef struct nni_posix_pollq nni_posix_pollq;
 // operations we don't need it.
 //
 // The pfd mutex protects the pfd's own "closing" flag (test and set),
-// the callback and arg, and its event mask.  This mutex is used a lot,
-// but it should be uncontended excepting possibly when closing.
+// the callback and arg, and its event and ready masks.  This mutex is
+// used a lot, but it should be uncontended excepting possibly when
+// closing.
+//
+// By default descriptors are registered EPOLLONESHOT, and each arm is an
+// EPOLL_CTL_MOD for the directions wanted.  The kernel disarms the
+// descriptor again when it reports it.
+//
+// Alternatively (NNG_INIT_POLLER_EDGE) descriptors are registered
+// edge-triggered, and stay registered.  Arming only records the
+// directions the caller is waiting for in the event mask, and an edge for
+// one of those runs the callback and clears it again, so callers see the
+// same oneshot behavior, without an epoll_ctl per arm.  This relies on
+// callers only arming once they have seen EAGAIN, which the stream,
+// listener, and UDP code all do.  An edge that arrives for a direction
+// nobody is waiting for (say, between that EAGAIN and the arm, on another
+// thread) is noted in the ready mask.  The next arm for it then asks the
+// kernel (EPOLL_CTL_MOD) to report the descriptor again if it is still
+// ready.  Input is always watched.  Output is only watched (the watch
+// mask) from the first time someone waits for it, until an edge for it
+// arrives that nobody wants.  Otherwise every message the peer consumes
+// would wake us up for nothing, as it does for UNIX domain sockets.
+// This saves the epoll_ctl calls, but data arriving while the reader is
+// busy now costs a wakeup, which oneshot avoids, so it is not the default.
+//
+// In either mode errors and hangups are passed to whoever is waiting.
+//
+// There are several pollqs, each with its own epoll instance, eventfd,
+// and thread, so that I/O dispatch is not limited to a single core.  A
+// pfd is assigned to one of them (round-robin) when it is created, and
+// stays there for its lifetime.
 
 // nni_posix_pollq is a work structure that manages state for the epoll-based
 // pollq implementation
@@ -69,13 +103,18 @@ struct nni_posix_pfd {
 	bool             closed;
 	bool             closing;
 	bool             reap;
-	unsigned         events;
+	unsigned         events; // waiting for these
+	unsigned         watch;  // registered with epoll
+	unsigned         ready;  // edges seen that nobody was waiting for
 	nni_mtx          mtx;
 	nni_cv           cv;
 };
 
-// single global instance for now.
-static nni_posix_pollq nni_posix_global_pollq;
+static nni_posix_pollq *nni_posix_pollqs;
+static int              nni_posix_npollq;
+static nni_atomic_int   nni_posix_pollq_next;
+static bool             nni_posix_pollq_edge;
+static unsigned         nni_posix_pollq_flags;
 
 int
 nni_posix_pfd_init(nni_posix_pfd **pfdp, int fd)
@@ -85,7 +124,11 @@ nni_posix_pfd_init(nni_posix_pfd **pfdp, int fd)
 	struct epoll_event ev;
 	int                rv;
 
-	pq = &nni_posix_global_pollq;
+	// Spread descriptors over the pollqs round-robin.  (The counter
+	// runs downwards, which is as good as upwards for this.)
+	pq = &nni_posix_pollqs[(unsigned) nni_atomic_dec_nv(
+	                           &nni_posix_pollq_next) %
+	    (unsigned) nni_posix_npollq];
 
 	(void) fcntl(fd, F_SETFD, FD_CLOEXEC);
 	(void) fcntl(fd, F_SETFL, O_NONBLOCK);
@@ -101,14 +144,17 @@ nni_posix_pfd_init(nni_posix_pfd **pfdp, int fd)
 	pfd->cb      = NULL;
 	pfd->arg     = NULL;
 	pfd->events  = 0;
+	pfd->watch   = nni_posix_pollq_edge ? (unsigned) EPOLLIN : 0;
+	pfd->ready   = 0;
 	pfd->closing = false;
 	pfd->closed  = false;
 
 	NNI_LIST_NODE_INIT(&pfd->node);
 
-	// notifications disabled to begin with
+	// Nothing is delivered until we arm.  (Edge-triggered, the kernel
+	// will report any initial readiness, which just gets noted.)
 	memset(&ev, 0, sizeof(ev));
-	ev.events   = 0;
+	ev.events   = pfd->watch | nni_posix_pollq_flags;
 	ev.data.ptr = pfd;
 
 	if (epoll_ctl(pq->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
@@ -135,18 +181,32 @@ nni_posix_pfd_arm(nni_posix_pfd *pfd, unsigned events)
 
 	nni_mtx_lock(&pfd->mtx);
 	if (!pfd->closing) {
-		struct epoll_event ev;
 		pfd->events |= events;
-		events = pfd->events;
 
-		memset(&ev, 0, sizeof(ev));
-		ev.events   = events | NNI_EPOLL_FLAGS;
-		ev.data.ptr = pfd;
+		// Oneshot, we always rearm.  Edge-triggered, only if we
+		// missed an edge we now want, or are not watching for it;
+		// the kernel reports the descriptor again if it is still
+		// ready.
+		if ((!nni_posix_pollq_edge) || ((events & ~pfd->watch) != 0) ||
+		    ((pfd->ready & (events | NNI_EPOLL_FAULTS)) != 0)) {
+			struct epoll_event ev;
+
+			if (nni_posix_pollq_edge) {
+				pfd->watch |= events;
+				pfd->ready = 0;
+			} else {
+				pfd->watch = pfd->events;
+			}
+			memset(&ev, 0, sizeof(ev));
+			ev.events   = pfd->watch | nni_posix_pollq_flags;
+			ev.data.ptr = pfd;
 
-		if (epoll_ctl(pq->epfd, EPOLL_CTL_MOD, pfd->fd, &ev) != 0) {
-			int rv = nni_plat_errno(errno);
-			nni_mtx_unlock(&pfd->mtx);
-			return (rv);
+			if (epoll_ctl(pq->epfd, EPOLL_CTL_MOD, pfd->fd, &ev) !=
+			    0) {
+				int rv = nni_plat_errno(errno);
+				nni_mtx_unlock(&pfd->mtx);
+				return (rv);
+			}
 		}
 	}
 	nni_mtx_unlock(&pfd->mtx);
@@ -274,20 +334,48 @@ nni_posix_poll_thr(void *arg)
 				nni_posix_pfd *  pfd = ev->data.ptr;
 				nni_posix_pfd_cb cb;
 				void *           cbarg;
+				unsigned         seen;
 				unsigned         mask;
 
-				mask = ev->events &
+				seen = ev->events &
 				    ((unsigned) EPOLLIN | (unsigned) EPOLLOUT |
-				        (unsigned) EPOLLERR);
+				        NNI_EPOLL_FAULTS);
 
+				// Only report what was waited for (errors
+				// go to anyone waiting), and note the rest.
+				// (Oneshot, the rest is never reported.)
 				nni_mtx_lock(&pfd->mtx);
+				mask = 0;
+				if (pfd->events != 0) {
+					mask = seen &
+					    (pfd->events | NNI_EPOLL_FAULTS);
+				}
 				pfd->events &= ~mask;
+				seen &= ~mask;
+				if (!nni_posix_pollq_edge) {
+					seen = 0;
+				}
+				if (((seen & (unsigned) EPOLLOUT) != 0) &&
+				    (!pfd->closing)) {
+					struct epoll_event mod;
+
+					// Stop watching; see above.
+					pfd->watch &= ~(unsigned) EPOLLOUT;
+					seen &= ~(unsigned) EPOLLOUT;
+					memset(&mod, 0, sizeof(mod));
+					mod.events =
+					    pfd->watch | nni_posix_pollq_flags;
+					mod.data.ptr = pfd;
+					(void) epoll_ctl(pq->epfd, EPOLL_CTL_MOD,
+					    pfd->fd, &mod);
+				}
+				pfd->ready |= seen;
 				cb    = pfd->cb;
 				cbarg = pfd->arg;
 				nni_mtx_unlock(&pfd->mtx);
 
 				// Execute the callback with lock released
-				if (cb != NULL) {
+				if ((cb != NULL) && (mask != 0)) {
 					cb(pfd, mask, cbarg);
 				}
 			}
@@ -394,16 +482,88 @@ nni_posix_pollq_create(nni_posix_pollq *pq)
 	return (0);
 }
 
+#ifndef NNG_MAX_POLLER_THREADS
+#define NNG_MAX_POLLER_THREADS 8
+#endif
+#ifndef NNG_NUM_POLLER_THREADS
+#define NNG_NUM_POLLER_THREADS (nni_plat_ncpu())
+#endif
+#ifndef NNG_POLLER_EDGE
+#define NNG_POLLER_EDGE 0
+#endif
+
 int
 nni_posix_pollq_sysinit(void)
 {
-	return (nni_posix_pollq_create(&nni_posix_global_pollq));
+	int  num_thr;
+	int  max_thr;
+	int  rv;
+	bool uring = false;
+
+	max_thr = (int) nni_init_get_param(
+	    NNG_INIT_MAX_POLLER_THREADS, NNG_MAX_POLLER_THREADS);
+
+	num_thr = (int) nni_init_get_param(
+	    NNG_INIT_NUM_POLLER_THREADS, NNG_NUM_POLLER_THREADS);
+
+	if ((max_thr > 0) && (num_thr > max_thr)) {
+		num_thr = max_thr;
+	}
+	if (num_thr < 1) {
+		num_thr = 1;
+	}
+	nni_init_set_effective(NNG_INIT_NUM_POLLER_THREADS, num_thr);
+
+#ifdef NNG_HAVE_IO_URING
+	// Connections and listeners on the rings never arm their pfds.  In
+	// edge mode every arrival would still wake a poller, so use oneshot.
+	uring = nni_posix_uring_sysinit(num_thr);
+#endif
+	nni_posix_pollq_edge = (!uring) &&
+	    (nni_init_get_param(NNG_INIT_POLLER_EDGE, NNG_POLLER_EDGE) != 0);
+	nni_posix_pollq_flags = nni_posix_pollq_edge ? NNI_EPOLL_FLAGS_EDGE
+	                                             : NNI_EPOLL_FLAGS_ONESHOT;
+	nni_init_set_effective(NNG_INIT_POLLER_EDGE, nni_posix_pollq_edge);
+
+	if ((nni_posix_pollqs = NNI_ALLOC_STRUCTS(nni_posix_pollqs, num_thr)) ==
+	    NULL) {
+#ifdef NNG_HAVE_IO_URING
+		nni_posix_uring_sysfini();
+#endif
+		return (NNG_ENOMEM);
+	}
+	for (int i = 0; i < num_thr; i++) {
+		if ((rv = nni_posix_pollq_create(&nni_posix_pollqs[i])) != 0) {
+			while (--i >= 0) {
+				nni_posix_pollq_destroy(&nni_posix_pollqs[i]);
+			}
+			NNI_FREE_STRUCTS(nni_posix_pollqs, num_thr);
+			nni_posix_pollqs = NULL;
+#ifdef NNG_HAVE_IO_URING
+			nni_posix_uring_sysfini();
+#endif
+			return (rv);
+		}
+	}
+	nni_posix_npollq = num_thr;
+	nni_atomic_init(&nni_posix_pollq_next);
+	return (0);
 }
 
 void
 nni_posix_pollq_sysfini(void)
 {
-	nni_posix_pollq_destroy(&nni_posix_global_pollq);
+#ifdef NNG_HAVE_IO_URING
+	nni_posix_uring_sysfini();
+#endif
+	for (int i = 0; i < nni_posix_npollq; i++) {
+		nni_posix_pollq_destroy(&nni_posix_pollqs[i]);
+	}
+	if (nni_posix_pollqs != NULL) {
+		NNI_FREE_STRUCTS(nni_posix_pollqs, nni_posix_npollq);
+		nni_posix_pollqs = NULL;
+	}
+	nni_posix_npollq = 0;
 }
 
 #endif // NNG_HAVE_EPOLL
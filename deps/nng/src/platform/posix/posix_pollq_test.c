@@ -0,0 +1,226 @@
+//
+// Copyright 2024 Staysail Systems, Inc. <info@staysail.tech>
+//
+// This software is supplied under the terms of the MIT License, a
+// copy of which should be located in the distribution where this
+// file was obtained (LICENSE.txt).  A copy of the license may also be
+// found online at https://opensource.org/licenses/MIT.
+//
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "core/nng_impl.h"
+#include "platform/posix/posix_pollq.h"
+
+#include <nuts.h>
+
+uint64_t nni_init_get_effective(nng_init_parameter p);
+
+// Poller tests.  Each runs with oneshot and edge-triggered registration.
+
+typedef struct {
+	nni_mtx  mtx;
+	nni_cv   cv;
+	unsigned events;
+	int      calls;
+} pollq_rec;
+
+static void
+pollq_cb(nni_posix_pfd *pfd, unsigned events, void *arg)
+{
+	pollq_rec *rec = arg;
+	NNI_ARG_UNUSED(pfd);
+
+	nni_mtx_lock(&rec->mtx);
+	rec->events |= events;
+	rec->calls++;
+	nni_cv_wake(&rec->cv);
+	nni_mtx_unlock(&rec->mtx);
+}
+
+// Wait for a callback, returning what it reported.
+static unsigned
+pollq_wait(pollq_rec *rec)
+{
+	nni_time until = nni_clock() + 5000;
+	unsigned events;
+
+	nni_mtx_lock(&rec->mtx);
+	while (rec->calls == 0) {
+		if (nni_cv_until(&rec->cv, until) != 0) {
+			break;
+		}
+	}
+	events      = rec->events;
+	rec->events = 0;
+	rec->calls  = 0;
+	nni_mtx_unlock(&rec->mtx);
+	return (events);
+}
+
+static void
+pollq_restart(bool edge)
+{
+	nng_fini();
+	nng_init_set_parameter(NNG_INIT_POLLER_EDGE, edge ? 1 : 0);
+	NUTS_PASS(nni_init());
+	NUTS_ASSERT(nni_init_get_effective(NNG_INIT_POLLER_EDGE) ==
+	    (edge ? 1u : 0u));
+}
+
+static void
+pollq_check_io(bool edge)
+{
+	nni_posix_pfd *pfd;
+	pollq_rec      rec;
+	int            fds[2];
+	char           buf[8];
+
+	pollq_restart(edge);
+	nni_mtx_init(&rec.mtx);
+	nni_cv_init(&rec.cv, &rec.mtx);
+	rec.events = 0;
+	rec.calls  = 0;
+
+	NUTS_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+	NUTS_PASS(nni_posix_pfd_init(&pfd, fds[0]));
+	nni_posix_pfd_set_cb(pfd, pollq_cb, &rec);
+
+	// Writable right away, and reported only when armed.
+	NUTS_PASS(nni_posix_pfd_arm(pfd, NNI_POLL_OUT));
+	NUTS_TRUE((pollq_wait(&rec) & NNI_POLL_OUT) != 0);
+
+	// Readable data, both arriving while armed and arriving before.
+	NUTS_PASS(nni_posix_pfd_arm(pfd, NNI_POLL_IN));
+	NUTS_ASSERT(write(fds[1], "abc", 3) == 3);
+	NUTS_TRUE((pollq_wait(&rec) & NNI_POLL_IN) != 0);
+	NUTS_ASSERT(read(fds[0], buf, sizeof(buf)) == 3);
+	NUTS_ASSERT(write(fds[1], "def", 3) == 3);
+	nng_msleep(20);
+	NUTS_PASS(nni_posix_pfd_arm(pfd, NNI_POLL_IN));
+	NUTS_TRUE((pollq_wait(&rec) & NNI_POLL_IN) != 0);
+	NUTS_ASSERT(read(fds[0], buf, sizeof(buf)) == 3);
+
+	// The peer sends and goes away before we arm.  We are told of the
+	// hangup, and the data is still there to read.
+	NUTS_ASSERT(write(fds[1], "ghi", 3) == 3);
+	(void) close(fds[1]);
+	nng_msleep(20);
+	NUTS_PASS(nni_posix_pfd_arm(pfd, NNI_POLL_IN));
+	NUTS_TRUE((pollq_wait(&rec) & (NNI_POLL_IN | NNI_POLL_HUP)) ==
+	    (NNI_POLL_IN | NNI_POLL_HUP));
+	NUTS_ASSERT(read(fds[0], buf, sizeof(buf)) == 3);
+	NUTS_ASSERT(read(fds[0], buf, sizeof(buf)) == 0);
+
+	// Waiting only for output still hears of the hangup.
+	NUTS_PASS(nni_posix_pfd_arm(pfd, NNI_POLL_OUT));
+	NUTS_TRUE((pollq_wait(&rec) & NNI_POLL_HUP) != 0);
+
+	nni_posix_pfd_fini(pfd);
+	nni_cv_fini(&rec.cv);
+	nni_mtx_fini(&rec.mtx);
+	nng_fini();
+}
+
+// An IPC peer that sends and then closes at once must not lose the data,
+// even if the poller sees the hangup together with it.
+static void
+pollq_check_ipc_close(bool edge)
+{
+	nng_stream_listener *l;
+	nng_stream_dialer   *d;
+	nng_aio             *raio;
+	nng_aio             *saio;
+	char                *addr;
+
+	pollq_restart(edge);
+	NUTS_ADDR(addr, "ipc");
+	NUTS_PASS(nng_aio_alloc(&raio, NULL, NULL));
+	NUTS_PASS(nng_aio_alloc(&saio, NULL, NULL));
+	nng_aio_set_timeout(raio, 5000);
+	nng_aio_set_timeout(saio, 5000);
+	NUTS_PASS(nng_stream_listener_alloc(&l, addr));
+	NUTS_PASS(nng_stream_listener_listen(l));
+	NUTS_PASS(nng_stream_dialer_alloc(&d, addr));
+
+	for (int i = 0; i < 50; i++) {
+		nng_stream *c1;
+		nng_stream *c2;
+		nng_iov     iov;
+		char        buf[8];
+
+		nng_stream_dialer_dial(d, saio);
+		nng_aio_wait(saio);
+		NUTS_PASS(nng_aio_result(saio));
+		c1 = nng_aio_get_output(saio, 0);
+		nng_stream_listener_accept(l, raio);
+		nng_aio_wait(raio);
+		NUTS_PASS(nng_aio_result(raio));
+		c2 = nng_aio_get_output(raio, 0);
+
+		// Receive first, so that the poller is waiting.
+		iov.iov_buf = buf;
+		iov.iov_len = sizeof(buf);
+		NUTS_PASS(nng_aio_set_iov(raio, 1, &iov));
+		nng_stream_recv(c2, raio);
+
+		iov.iov_buf = "hello";
+		iov.iov_len = 5;
+		NUTS_PASS(nng_aio_set_iov(saio, 1, &iov));
+		nng_stream_send(c1, saio);
+		nng_aio_wait(saio);
+		NUTS_PASS(nng_aio_result(saio));
+		nng_stream_free(c1);
+
+		nng_aio_wait(raio);
+		NUTS_PASS(nng_aio_result(raio));
+		NUTS_TRUE(nng_aio_count(raio) == 5);
+		NUTS_TRUE(memcmp(buf, "hello", 5) == 0);
+
+		// And after that, the end of the stream.
+		iov.iov_buf = buf;
+		NUTS_PASS(nng_aio_set_iov(raio, 1, &iov));
+		nng_stream_recv(c2, raio);
+		nng_aio_wait(raio);
+		NUTS_FAIL(nng_aio_result(raio), NNG_ECONNSHUT);
+		nng_stream_free(c2);
+	}
+	nng_stream_dialer_free(d);
+	nng_stream_listener_free(l);
+	nng_aio_free(saio);
+	nng_aio_free(raio);
+	nng_fini();
+}
+
+static void
+test_pollq_oneshot(void)
+{
+	pollq_check_io(false);
+}
+
+static void
+test_pollq_edge(void)
+{
+	pollq_check_io(true);
+}
+
+static void
+test_pollq_oneshot_ipc_close(void)
+{
+	pollq_check_ipc_close(false);
+}
+
+static void
+test_pollq_edge_ipc_close(void)
+{
+	pollq_check_ipc_close(true);
+}
+
+NUTS_TESTS = {
+	{ "pollq oneshot", test_pollq_oneshot },
+	{ "pollq edge", test_pollq_edge },
+	{ "pollq oneshot ipc close", test_pollq_oneshot_ipc_close },
+	{ "pollq edge ipc close", test_pollq_edge_ipc_close },
+	{ NULL, NULL },
+};
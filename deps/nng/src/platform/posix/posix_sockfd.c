@@ -231,10 +231,15 @@ sfd_cb(nni_posix_pfd *pfd, unsigned events, void *arg)
 {
 	struct nni_sfd_conn *c = arg;
 
-	if (events & (NNI_POLL_HUP | NNI_POLL_ERR | NNI_POLL_INVAL)) {
+	if (events & (NNI_POLL_ERR | NNI_POLL_INVAL)) {
 		sfd_error(c, NNG_ECONNSHUT);
 		return;
 	}
+	// The peer hung up, but what it sent before that can still be read.
+	// Reads see end of file after it, and writes fail.  (See ipc_cb.)
+	if ((events & NNI_POLL_HUP) != 0) {
+		events |= NNI_POLL_IN | NNI_POLL_OUT;
+	}
 	nni_mtx_lock(&c->mtx);
 	if ((events & NNI_POLL_IN) != 0) {
 		sfd_doread(c);
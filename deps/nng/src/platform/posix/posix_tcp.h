@@ -15,6 +15,15 @@
 #include "core/nng_impl.h"
 
 #include "platform/posix/posix_aio.h"
+#include "platform/posix/posix_uring.h"
+
+#include <sys/socket.h>
+
+// Linux can send without copying; see posix_tcpconn.c.
+#if defined(NNG_HAVE_MSG_ZEROCOPY) && defined(MSG_ZEROCOPY) && \
+    defined(SO_ZEROCOPY)
+#define NNI_TCP_ZEROCOPY
+#endif
 
 struct nni_tcp_conn {
 	nng_stream      stream;
@@ -26,6 +35,17 @@ struct nni_tcp_conn {
 	nni_aio *       dial_aio;
 	nni_tcp_dialer *dialer;
 	nni_reap_node   reap;
+	size_t          zc_min;  // write with MSG_ZEROCOPY from this size
+	bool            zc_on;   // SO_ZEROCOPY is set
+	bool            zc_wait; // first write waits for its notification
+	uint32_t        zc_id;   // of the send it waits for
+	uint32_t        zc_next; // id the kernel gives the next send
+	uint32_t        zc_done; // all sends before this id are done
+	int             zc_err;  // the waiting write failed with this
+	bool            zc_drop; // connection reset while waiting
+#ifdef NNG_HAVE_IO_URING
+	nni_posix_ustream us; // transfers, if on io_uring (us.ring set)
+#endif
 };
 
 struct nni_tcp_dialer {
@@ -33,6 +53,7 @@ struct nni_tcp_dialer {
 	bool                    closed;
 	bool                    nodelay;
 	bool                    keepalive;
+	size_t                  zerocopy;
 	struct sockaddr_storage src;
 	size_t                  srclen;
 	nni_mtx                 mtx;
@@ -42,7 +63,7 @@ struct nni_tcp_dialer {
 
 extern int  nni_posix_tcp_alloc(nni_tcp_conn **, nni_tcp_dialer *);
 extern void nni_posix_tcp_init(nni_tcp_conn *, nni_posix_pfd *);
-extern void nni_posix_tcp_start(nni_tcp_conn *, int, int);
+extern void nni_posix_tcp_start(nni_tcp_conn *, int, int, size_t);
 extern void nni_posix_tcp_dialer_rele(nni_tcp_dialer *);
 
 #endif // PLATFORM_POSIX_TCP_H
\ No newline at end of file
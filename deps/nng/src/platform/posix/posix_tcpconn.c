@@ -27,13 +27,151 @@
 
 #include "posix_tcp.h"
 
+#ifdef NNI_TCP_ZEROCOPY
+#include <time.h> // linux/errqueue.h needs struct timespec
+#include <linux/errqueue.h>
+#endif
+
+// Writes of at least zc_min bytes are sent with MSG_ZEROCOPY, so that the
+// kernel takes the data from our buffers as it goes out, rather than
+// copying it into the socket buffer up front.  It goes on reading those
+// buffers until the data is acknowledged, and tells us when it is done
+// with a notification on the socket error queue (which shows up as
+// NNI_POLL_ERR).  So the aio for such a write does not complete until
+// then, and writes after it wait too.  The kernel numbers the zerocopy
+// sends on a socket from zero, and each notification covers a range of
+// them.  (Over loopback the kernel copies the data anyway, but it still
+// sends the notifications.)
+//
+// The write must not complete before that even if it is canceled, or the
+// connection fails or is closed, since the caller would then reuse or
+// free the buffers while the kernel still sends from them.  Instead we
+// reset the connection, which has the kernel drop whatever it has yet to
+// send (rather than wait for the peer to acknowledge it, which it may
+// never do), and fail the write once the notification for that arrives.
+
+#ifdef NNI_TCP_ZEROCOPY
+static bool
+tcp_zc_enable(nni_tcp_conn *c, int fd)
+{
+	int on = 1;
+
+	if ((!c->zc_on) &&
+	    (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on)) != 0)) {
+		// Kernel too old; just copy.
+		c->zc_min = 0;
+		return (false);
+	}
+	c->zc_on = true;
+	return (true);
+}
+
+// tcp_zc_drop resets the connection while a zerocopy write is waiting,
+// so that the kernel lets go of its buffers soon.  See above.
+static void
+tcp_zc_drop(nni_tcp_conn *c, int err)
+{
+	if (c->zc_err == 0) {
+		c->zc_err = err;
+	}
+	if (!c->zc_drop) {
+		struct sockaddr sa;
+
+		// Connecting to AF_UNSPEC disconnects (with a reset),
+		// and unlike close, leaves us the error queue to read.
+		c->zc_drop = true;
+		memset(&sa, 0, sizeof(sa));
+		sa.sa_family = AF_UNSPEC;
+		(void) connect(nni_posix_pfd_fd(c->pfd), &sa, sizeof(sa));
+	}
+	nni_posix_pfd_arm(c->pfd, NNI_POLL_ERR);
+}
+
+// tcp_zc_reap collects the notifications, and completes the waiting write
+// once the kernel is done with it.  It returns an error if there is a
+// real error on the socket.
+static int
+tcp_zc_reap(nni_tcp_conn *c, nni_aio_completions *cl)
+{
+	int       fd = nni_posix_pfd_fd(c->pfd);
+	int       err;
+	socklen_t len = sizeof(err);
+	nni_aio  *aio;
+
+	for (;;) {
+		struct msghdr   hdr;
+		struct cmsghdr *cm;
+		union {
+			struct cmsghdr align;
+			char           buf[128];
+		} ctl;
+
+		memset(&hdr, 0, sizeof(hdr));
+		hdr.msg_control    = ctl.buf;
+		hdr.msg_controllen = sizeof(ctl.buf);
+		if (recvmsg(fd, &hdr, MSG_ERRQUEUE) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		for (cm = CMSG_FIRSTHDR(&hdr); cm != NULL;
+		     cm = CMSG_NXTHDR(&hdr, cm)) {
+			struct sock_extended_err *ee;
+			uint32_t                  end;
+
+			if (!(((cm->cmsg_level == IPPROTO_IP) &&
+			        (cm->cmsg_type == IP_RECVERR)) ||
+			        ((cm->cmsg_level == IPPROTO_IPV6) &&
+			            (cm->cmsg_type == IPV6_RECVERR)))) {
+				continue;
+			}
+			ee = (void *) CMSG_DATA(cm);
+			if ((ee->ee_origin != SO_EE_ORIGIN_ZEROCOPY) ||
+			    (ee->ee_errno != 0)) {
+				continue;
+			}
+			// Covers ee_info through ee_data, inclusive.
+			end = ee->ee_data + 1;
+			if ((int32_t) (end - c->zc_done) > 0) {
+				c->zc_done = end;
+			}
+		}
+	}
+
+	if (c->zc_wait && ((int32_t) (c->zc_done - c->zc_id) > 0)) {
+		c->zc_wait = false;
+		aio        = nni_list_first(&c->writeq);
+		nni_aio_list_remove(aio);
+		if (c->zc_err != 0) {
+			nni_aio_finish_error(aio, c->zc_err);
+		} else {
+			nni_aio_completions_defer(
+			    cl, aio, 0, nni_aio_count(aio));
+		}
+		if (c->zc_drop) {
+			nni_posix_pfd_close(c->pfd);
+		}
+	}
+
+	err = 0;
+	if ((getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0) &&
+	    (err != 0)) {
+		return (nni_plat_errno(err));
+	}
+	return (0);
+}
+#endif
+
+// Successful transfers are completed inline if cl is not NULL and the
+// aio allows it.  See tcp_cb.
 static void
-tcp_dowrite(nni_tcp_conn *c)
+tcp_dowrite(nni_tcp_conn *c, nni_aio_completions *cl)
 {
 	nni_aio *aio;
 	int      fd;
 
-	if (c->closed || ((fd = nni_posix_pfd_fd(c->pfd)) < 0)) {
+	if (c->closed || c->zc_wait || ((fd = nni_posix_pfd_fd(c->pfd)) < 0)) {
 		return;
 	}
 
@@ -45,6 +183,8 @@ tcp_dowrite(nni_tcp_conn *c)
 		nni_iov *     aiov;
 		struct msghdr hdr;
 		struct iovec  iovec[16];
+		size_t        total;
+		bool          zc;
 
 		memset(&hdr, 0, sizeof(hdr));
 		nni_aio_get_iov(aio, &naiov, &aiov);
@@ -55,10 +195,11 @@ tcp_dowrite(nni_tcp_conn *c)
 			continue;
 		}
 
-		for (niov = 0, i = 0; i < naiov; i++) {
+		for (total = 0, niov = 0, i = 0; i < naiov; i++) {
 			if (aiov[i].iov_len > 0) {
 				iovec[niov].iov_len  = aiov[i].iov_len;
 				iovec[niov].iov_base = aiov[i].iov_buf;
+				total += aiov[i].iov_len;
 				niov++;
 			}
 		}
@@ -66,7 +207,25 @@ tcp_dowrite(nni_tcp_conn *c)
 		hdr.msg_iovlen = niov;
 		hdr.msg_iov    = iovec;
 
-		if ((n = sendmsg(fd, &hdr, MSG_NOSIGNAL)) < 0) {
+		zc = false;
+		n  = -1;
+#ifdef NNI_TCP_ZEROCOPY
+		if ((c->zc_min > 0) && (total >= c->zc_min) &&
+		    tcp_zc_enable(c, fd)) {
+			zc = true;
+			n  = sendmsg(fd, &hdr, MSG_NOSIGNAL | MSG_ZEROCOPY);
+			if ((n < 0) && (errno == ENOBUFS)) {
+				// No room to track it; copy this one.
+				zc = false;
+			}
+		}
+#else
+		NNI_ARG_UNUSED(total);
+#endif
+		if (!zc) {
+			n = sendmsg(fd, &hdr, MSG_NOSIGNAL);
+		}
+		if (n < 0) {
 			switch (errno) {
 			case EINTR:
 				continue;
@@ -86,10 +245,17 @@ tcp_dowrite(nni_tcp_conn *c)
 		}
 
 		nni_aio_bump_count(aio, n);
+		if (zc) {
+			// Wait for the kernel to be done with the data.
+			c->zc_wait = true;
+			c->zc_id   = c->zc_next++;
+			c->zc_err  = 0;
+			return;
+		}
 		// We completed the entire operation on this aio.
 		// (Sendmsg never returns a partial result.)
 		nni_aio_list_remove(aio);
-		nni_aio_finish(aio, 0, nni_aio_count(aio));
+		nni_aio_completions_defer(cl, aio, 0, nni_aio_count(aio));
 
 		// Go back to start of loop to see if there is another
 		// aio ready for us to process.
@@ -97,7 +263,7 @@ tcp_dowrite(nni_tcp_conn *c)
 }
 
 static void
-tcp_doread(nni_tcp_conn *c)
+tcp_doread(nni_tcp_conn *c, nni_aio_completions *cl)
 {
 	nni_aio *aio;
 	int      fd;
@@ -154,28 +320,55 @@ tcp_doread(nni_tcp_conn *c)
 
 		// We completed the entire operation on this aio.
 		nni_aio_list_remove(aio);
-		nni_aio_finish(aio, 0, nni_aio_count(aio));
+		nni_aio_completions_defer(cl, aio, 0, nni_aio_count(aio));
 
 		// Go back to start of loop to see if there is another
 		// aio ready for us to process.
 	}
 }
 
+// tcp_fail fails all transfers, except for a zerocopy write still
+// waiting for the kernel; that one fails once the kernel is done with it.
 static void
-tcp_error(void *arg, int err)
+tcp_fail(nni_tcp_conn *c, int err)
 {
-	nni_tcp_conn *c = arg;
-	nni_aio *     aio;
+	nni_aio *aio;
+	nni_aio *zc = c->zc_wait ? nni_list_first(&c->writeq) : NULL;
 
-	nni_mtx_lock(&c->mtx);
-	while (((aio = nni_list_first(&c->readq)) != NULL) ||
-	    ((aio = nni_list_first(&c->writeq)) != NULL)) {
+#ifdef NNG_HAVE_IO_URING
+	if (c->us.ring != NULL) {
+		// Those in the kernel are taken back, so all fail now.
+		nni_posix_ustream_close(&c->us, err);
+		nni_posix_pfd_close(c->pfd);
+		return;
+	}
+#endif
+	while ((aio = nni_list_first(&c->readq)) != NULL) {
+		nni_aio_list_remove(aio);
+		nni_aio_finish_error(aio, err);
+	}
+	while ((aio = nni_list_last(&c->writeq)) != zc) {
 		nni_aio_list_remove(aio);
 		nni_aio_finish_error(aio, err);
 	}
+#ifdef NNI_TCP_ZEROCOPY
+	if (zc != NULL) {
+		tcp_zc_drop(c, err);
+		return;
+	}
+#endif
 	if (c->pfd != NULL) {
 		nni_posix_pfd_close(c->pfd);
 	}
+}
+
+static void
+tcp_error(void *arg, int err)
+{
+	nni_tcp_conn *c = arg;
+
+	nni_mtx_lock(&c->mtx);
+	tcp_fail(c, err);
 	nni_mtx_unlock(&c->mtx);
 }
 
@@ -185,16 +378,8 @@ tcp_close(void *arg)
 	nni_tcp_conn *c = arg;
 	nni_mtx_lock(&c->mtx);
 	if (!c->closed) {
-		nni_aio *aio;
 		c->closed = true;
-		while (((aio = nni_list_first(&c->readq)) != NULL) ||
-		    ((aio = nni_list_first(&c->writeq)) != NULL)) {
-			nni_aio_list_remove(aio);
-			nni_aio_finish_error(aio, NNG_ECLOSED);
-		}
-		if (c->pfd != NULL) {
-			nni_posix_pfd_close(c->pfd);
-		}
+		tcp_fail(c, NNG_ECLOSED);
 	}
 	nni_mtx_unlock(&c->mtx);
 }
@@ -206,6 +391,11 @@ tcp_fini(void *arg)
 {
 	nni_tcp_conn *c = arg;
 	tcp_close(c);
+#ifdef NNG_HAVE_IO_URING
+	if (c->us.ring != NULL) {
+		nni_posix_ustream_fini(&c->us);
+	}
+#endif
 	if (c->pfd != NULL) {
 		nni_posix_pfd_fini(c->pfd);
 	}
@@ -231,30 +421,52 @@ tcp_free(void *arg)
 static void
 tcp_cb(nni_posix_pfd *pfd, unsigned events, void *arg)
 {
-	nni_tcp_conn *c = arg;
+	nni_tcp_conn       *c = arg;
+	nni_aio_completions cl;
 
-	if (events & (NNI_POLL_HUP | NNI_POLL_ERR | NNI_POLL_INVAL)) {
+	if (events & NNI_POLL_INVAL) {
 		tcp_error(c, NNG_ECONNSHUT);
 		return;
 	}
+	// Completions that permit it are run right here on the poller
+	// thread, once we have dropped the lock.  Only this path does
+	// that.  Transfers started from within those callbacks complete
+	// through the task queue, so the nesting is never deeper than one.
+	nni_aio_completions_init(&cl);
 	nni_mtx_lock(&c->mtx);
+	if ((events & (NNI_POLL_ERR | NNI_POLL_HUP)) != 0) {
+		// Unless it is just zerocopy notifications, this is fatal.
+		// (Collect those first, even on a hangup, so that a write
+		// waiting for them can finish.)
+#ifdef NNI_TCP_ZEROCOPY
+		if ((!c->zc_on) || (tcp_zc_reap(c, &cl) != 0) ||
+		    ((events & NNI_POLL_HUP) != 0))
+#endif
+		{
+			nni_mtx_unlock(&c->mtx);
+			tcp_error(c, NNG_ECONNSHUT);
+			nni_aio_completions_run(&cl);
+			return;
+		}
+	}
 	if ((events & NNI_POLL_IN) != 0) {
-		tcp_doread(c);
+		tcp_doread(c, &cl);
 	}
-	if ((events & NNI_POLL_OUT) != 0) {
-		tcp_dowrite(c);
+	if ((events & (NNI_POLL_OUT | NNI_POLL_ERR)) != 0) {
+		tcp_dowrite(c, &cl);
 	}
 	events = 0;
 	if (!nni_list_empty(&c->writeq)) {
-		events |= NNI_POLL_OUT;
+		events |= c->zc_wait ? NNI_POLL_ERR : NNI_POLL_OUT;
 	}
 	if (!nni_list_empty(&c->readq)) {
 		events |= NNI_POLL_IN;
 	}
-	if ((!c->closed) && (events != 0)) {
+	if (((!c->closed) || c->zc_wait) && (events != 0)) {
 		nni_posix_pfd_arm(pfd, events);
 	}
 	nni_mtx_unlock(&c->mtx);
+	nni_aio_completions_run(&cl);
 }
 
 static void
@@ -264,6 +476,20 @@ tcp_cancel(nni_aio *aio, void *arg, int rv)
 
 	nni_mtx_lock(&c->mtx);
 	if (nni_aio_list_active(aio)) {
+#ifdef NNG_HAVE_IO_URING
+		if (c->us.ring != NULL) {
+			nni_posix_ustream_cancel(&c->us, aio);
+		}
+#endif
+#ifdef NNI_TCP_ZEROCOPY
+		if (c->zc_wait && (nni_list_first(&c->writeq) == aio)) {
+			// The kernel may yet read the buffers, so this
+			// fails once it is done; see above.
+			tcp_zc_drop(c, rv);
+			nni_mtx_unlock(&c->mtx);
+			return;
+		}
+#endif
 		nni_aio_list_remove(aio);
 		nni_aio_finish_error(aio, rv);
 	}
@@ -287,14 +513,22 @@ tcp_send(void *arg, nni_aio *aio)
 		return;
 	}
 	nni_aio_list_append(&c->writeq, aio);
+#ifdef NNG_HAVE_IO_URING
+	if (c->us.ring != NULL) {
+		nni_posix_ustream_send(&c->us);
+		nni_mtx_unlock(&c->mtx);
+		return;
+	}
+#endif
 
 	if (nni_list_first(&c->writeq) == aio) {
-		tcp_dowrite(c);
+		tcp_dowrite(c, NULL);
 		// If we are still the first thing on the list, that
 		// means we didn't finish the job, so arm the poller to
 		// complete us.
 		if (nni_list_first(&c->writeq) == aio) {
-			nni_posix_pfd_arm(c->pfd, POLLOUT);
+			nni_posix_pfd_arm(
+			    c->pfd, c->zc_wait ? NNI_POLL_ERR : NNI_POLL_OUT);
 		}
 	}
 	nni_mtx_unlock(&c->mtx);
@@ -317,13 +551,20 @@ tcp_recv(void *arg, nni_aio *aio)
 		return;
 	}
 	nni_aio_list_append(&c->readq, aio);
+#ifdef NNG_HAVE_IO_URING
+	if (c->us.ring != NULL) {
+		nni_posix_ustream_recv(&c->us);
+		nni_mtx_unlock(&c->mtx);
+		return;
+	}
+#endif
 
 	// If we are only job on the list, go ahead and try to do an
 	// immediate transfer. This allows for faster completions in
 	// many cases.  We also need not arm a list if it was already
 	// armed.
 	if (nni_list_first(&c->readq) == aio) {
-		tcp_doread(c);
+		tcp_doread(c, NULL);
 		// If we are still the first thing on the list, that
 		// means we didn't finish the job, so arm the poller to
 		// complete us.
@@ -442,6 +683,64 @@ tcp_get_keepalive(void *arg, void *buf, size_t *szp, nni_type t)
 	return (nni_copyout_bool(val, buf, szp, t));
 }
 
+static int
+tcp_set_zerocopy(void *arg, const void *buf, size_t sz, nni_type t)
+{
+	nni_tcp_conn *c = arg;
+	size_t        val;
+	int           rv;
+
+	if (((rv = nni_copyin_size(&val, buf, sz, 0, NNI_MAXSZ, t)) != 0) ||
+	    (c == NULL)) {
+		return (rv);
+	}
+#ifndef NNI_TCP_ZEROCOPY
+	if (val != 0) {
+		return (NNG_ENOTSUP);
+	}
+#endif
+	nni_mtx_lock(&c->mtx);
+	c->zc_min = val;
+#ifdef NNG_HAVE_IO_URING
+	c->us.zc_min = val;
+#endif
+	nni_mtx_unlock(&c->mtx);
+	return (0);
+}
+
+static int
+tcp_get_zerocopy(void *arg, void *buf, size_t *szp, nni_type t)
+{
+	nni_tcp_conn *c = arg;
+	size_t        val;
+
+	nni_mtx_lock(&c->mtx);
+	val = c->zc_min;
+	nni_mtx_unlock(&c->mtx);
+	return (nni_copyout_size(val, buf, szp, t));
+}
+
+static int
+tcp_set_recv_buffer(void *arg, const void *buf, size_t sz, nni_type t)
+{
+	nni_tcp_conn *c  = arg;
+	int           rv = NNG_ENOTSUP;
+
+#ifdef NNG_HAVE_IO_URING
+	nni_mtx_lock(&c->mtx);
+	if (c->us.ring != NULL) {
+		rv = nni_posix_ustream_recv_buffer(&c->us, buf, sz, t);
+	}
+	nni_mtx_unlock(&c->mtx);
+#else
+	NNI_ARG_UNUSED(c);
+	NNI_ARG_UNUSED(buf);
+	NNI_ARG_UNUSED(sz);
+	NNI_ARG_UNUSED(t);
+#endif
+	return (rv);
+}
+
 static const nni_option tcp_options[] = {
 	{
 	    .o_name = NNG_OPT_REMADDR,
@@ -461,6 +760,15 @@ static const nni_option tcp_options[] = {
 	    .o_get  = tcp_get_keepalive,
 	    .o_set  = tcp_set_keepalive,
 	},
+	{
+	    .o_name = NNG_OPT_TCP_ZEROCOPY,
+	    .o_get  = tcp_get_zerocopy,
+	    .o_set  = tcp_set_zerocopy,
+	},
+	{
+	    .o_name = NNI_OPT_RECV_BUFFER,
+	    .o_set  = tcp_set_recv_buffer,
+	},
 	{
 	    .o_name = NULL,
 	},
@@ -513,13 +821,28 @@ nni_posix_tcp_init(nni_tcp_conn *c, nni_posix_pfd *pfd)
 }
 
 void
-nni_posix_tcp_start(nni_tcp_conn *c, int nodelay, int keepalive)
+nni_posix_tcp_start(
+    nni_tcp_conn *c, int nodelay, int keepalive, size_t zerocopy)
 {
+#ifdef NNG_HAVE_IO_URING
+	nni_posix_uring *ring;
+#endif
+
 	// Configure the initial socket options.
 	(void) setsockopt(nni_posix_pfd_fd(c->pfd), IPPROTO_TCP, TCP_NODELAY,
 	    &nodelay, sizeof(int));
 	(void) setsockopt(nni_posix_pfd_fd(c->pfd), SOL_SOCKET, SO_KEEPALIVE,
 	    &keepalive, sizeof(int));
-
+	c->zc_min = zerocopy;
+
+#ifdef NNG_HAVE_IO_URING
+	if ((ring = nni_posix_uring_get()) != NULL) {
+		// The pfd just holds the descriptor; it is never armed.
+		nni_posix_ustream_init(&c->us, ring, nni_posix_pfd_fd(c->pfd),
+		    &c->mtx, &c->readq, &c->writeq);
+		c->us.zc_min = zerocopy;
+		return;
+	}
+#endif
 	nni_posix_pfd_set_cb(c->pfd, tcp_cb, c);
 }
@@ -123,6 +123,7 @@ tcp_dialer_cb(nni_posix_pfd *pfd, unsigned ev, void *arg)
 	int             rv;
 	int             ka;
 	int             nd;
+	size_t          zc;
 
 	nni_mtx_lock(&d->mtx);
 	aio = c->dial_aio;
@@ -155,6 +156,7 @@ tcp_dialer_cb(nni_posix_pfd *pfd, unsigned ev, void *arg)
 	nni_aio_set_prov_data(aio, NULL);
 	nd = d->nodelay ? 1 : 0;
 	ka = d->keepalive ? 1 : 0;
+	zc = d->zerocopy;
 
 	nni_mtx_unlock(&d->mtx);
 
@@ -165,7 +167,7 @@ tcp_dialer_cb(nni_posix_pfd *pfd, unsigned ev, void *arg)
 		return;
 	}
 
-	nni_posix_tcp_start(c, nd, ka);
+	nni_posix_tcp_start(c, nd, ka, zc);
 	nni_aio_set_output(aio, 0, c);
 	nni_aio_finish(aio, 0, 0);
 }
@@ -183,6 +185,7 @@ nni_tcp_dial(nni_tcp_dialer *d, const nni_sockaddr *sa, nni_aio *aio)
 	int                     rv;
 	int                     ka;
 	int                     nd;
+	size_t                  zc;
 
 	if (nni_aio_begin(aio) != 0) {
 		return;
@@ -253,8 +256,9 @@ nni_tcp_dial(nni_tcp_dialer *d, const nni_sockaddr *sa, nni_aio *aio)
 	nni_aio_set_prov_data(aio, NULL);
 	nd = d->nodelay ? 1 : 0;
 	ka = d->keepalive ? 1 : 0;
+	zc = d->zerocopy;
 	nni_mtx_unlock(&d->mtx);
-	nni_posix_tcp_start(c, nd, ka);
+	nni_posix_tcp_start(c, nd, ka, zc);
 	nni_aio_set_output(aio, 0, c);
 	nni_aio_finish(aio, 0, 0);
 	return;
@@ -320,6 +324,39 @@ tcp_dialer_get_keepalive(void *arg, void *buf, size_t *szp, nni_type t)
 	return (nni_copyout_bool(b, buf, szp, t));
 }
 
+static int
+tcp_dialer_set_zerocopy(void *arg, const void *buf, size_t sz, nni_type t)
+{
+	nni_tcp_dialer *d = arg;
+	int             rv;
+	size_t          val;
+
+	if (((rv = nni_copyin_size(&val, buf, sz, 0, NNI_MAXSZ, t)) != 0) ||
+	    (d == NULL)) {
+		return (rv);
+	}
+#ifndef NNI_TCP_ZEROCOPY
+	if (val != 0) {
+		return (NNG_ENOTSUP);
+	}
+#endif
+	nni_mtx_lock(&d->mtx);
+	d->zerocopy = val;
+	nni_mtx_unlock(&d->mtx);
+	return (0);
+}
+
+static int
+tcp_dialer_get_zerocopy(void *arg, void *buf, size_t *szp, nni_type t)
+{
+	size_t          val;
+	nni_tcp_dialer *d = arg;
+	nni_mtx_lock(&d->mtx);
+	val = d->zerocopy;
+	nni_mtx_unlock(&d->mtx);
+	return (nni_copyout_size(val, buf, szp, t));
+}
+
 static int
 tcp_dialer_get_locaddr(void *arg, void *buf, size_t *szp, nni_type t)
 {
@@ -404,6 +441,11 @@ static const nni_option tcp_dialer_options[] = {
 	    .o_get  = tcp_dialer_get_keepalive,
 	    .o_set  = tcp_dialer_set_keepalive,
 	},
+	{
+	    .o_name = NNG_OPT_TCP_ZEROCOPY,
+	    .o_get  = tcp_dialer_get_zerocopy,
+	    .o_set  = tcp_dialer_set_zerocopy,
+	},
 	{
 	    .o_name = NULL,
 	},
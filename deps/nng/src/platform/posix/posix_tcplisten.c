@@ -40,7 +40,12 @@ struct nni_tcp_listener {
 	bool           closed;
 	bool           nodelay;
 	bool           keepalive;
+	bool           reuseport;
+	size_t         zerocopy;
 	nni_mtx        mtx;
+#ifdef NNG_HAVE_IO_URING
+	nni_posix_uaccept ua; // accepts, if on io_uring (ua.ring set)
+#endif
 };
 
 int
@@ -73,6 +78,11 @@ tcp_listener_doclose(nni_tcp_listener *l)
 		nni_aio_finish_error(aio, NNG_ECLOSED);
 	}
 
+#ifdef NNG_HAVE_IO_URING
+	if (l->ua.ring != NULL) {
+		nni_posix_uaccept_close(&l->ua);
+	}
+#endif
 	if (l->pfd != NULL) {
 		nni_posix_pfd_close(l->pfd);
 	}
@@ -86,22 +96,22 @@ nni_tcp_listener_close(nni_tcp_listener *l)
 	nni_mtx_unlock(&l->mtx);
 }
 
-static void
-tcp_listener_doaccept(nni_tcp_listener *l)
+// tcp_listener_nextfd takes the next connection.  If there is none yet,
+// it returns NNG_EAGAIN, and we come back here when there is.
+static int
+tcp_listener_nextfd(nni_tcp_listener *l, int *fdp)
 {
-	nni_aio *aio;
-
-	while ((aio = nni_list_first(&l->acceptq)) != NULL) {
-		int            newfd;
-		int            fd;
-		int            rv;
-		int            nd;
-		int            ka;
-		nni_posix_pfd *pfd;
-		nni_tcp_conn  *c;
-
-		fd = nni_posix_pfd_fd(l->pfd);
+	int newfd;
+	int fd;
+	int rv;
 
+#ifdef NNG_HAVE_IO_URING
+	if (l->ua.ring != NULL) {
+		return (nni_posix_uaccept_next(&l->ua, fdp));
+	}
+#endif
+	fd = nni_posix_pfd_fd(l->pfd);
+	for (;;) {
 #ifdef NNG_USE_ACCEPT4
 		newfd = accept4(fd, NULL, NULL, SOCK_CLOEXEC);
 		if ((newfd < 0) && ((errno == ENOSYS) || (errno == ENOTSUP))) {
@@ -110,34 +120,56 @@ tcp_listener_doaccept(nni_tcp_listener *l)
 #else
 		newfd = accept(fd, NULL, NULL);
 #endif
-		if (newfd < 0) {
-			switch (errno) {
-			case EAGAIN:
+		if (newfd >= 0) {
+			*fdp = newfd;
+			return (0);
+		}
+		switch (errno) {
+		case EAGAIN:
 #ifdef EWOULDBLOCK
 #if EWOULDBLOCK != EAGAIN
-			case EWOULDBLOCK:
+		case EWOULDBLOCK:
 #endif
 #endif
-				rv = nni_posix_pfd_arm(l->pfd, NNI_POLL_IN);
-				if (rv != 0) {
-					nni_aio_list_remove(aio);
-					nni_aio_finish_error(aio, rv);
-					continue;
-				}
-				// Come back later...
-				return;
-			case ECONNABORTED:
-			case ECONNRESET:
-				// Eat them, they aren't interesting.
-				continue;
-			default:
-				// Error this one, but keep moving to the next.
-				rv = nni_plat_errno(errno);
-				NNI_ASSERT(rv != 0);
-				nni_aio_list_remove(aio);
-				nni_aio_finish_error(aio, rv);
-				continue;
+			rv = nni_posix_pfd_arm(l->pfd, NNI_POLL_IN);
+			if (rv != 0) {
+				return (rv);
 			}
+			// Come back later...
+			return (NNG_EAGAIN);
+		case ECONNABORTED:
+		case ECONNRESET:
+			// Eat them, they aren't interesting.
+			continue;
+		default:
+			rv = nni_plat_errno(errno);
+			NNI_ASSERT(rv != 0);
+			return (rv);
+		}
+	}
+}
+
+static void
+tcp_listener_doaccept(nni_tcp_listener *l)
+{
+	nni_aio *aio;
+
+	while ((aio = nni_list_first(&l->acceptq)) != NULL) {
+		int            newfd;
+		int            rv;
+		int            nd;
+		int            ka;
+		nni_posix_pfd *pfd;
+		nni_tcp_conn  *c;
+
+		if ((rv = tcp_listener_nextfd(l, &newfd)) == NNG_EAGAIN) {
+			return;
+		}
+		if (rv != 0) {
+			// Error this one, but keep moving to the next.
+			nni_aio_list_remove(aio);
+			nni_aio_finish_error(aio, rv);
+			continue;
 		}
 
 		if ((rv = nni_posix_tcp_alloc(&c, NULL)) != 0) {
@@ -160,7 +192,7 @@ tcp_listener_doaccept(nni_tcp_listener *l)
 		ka = l->keepalive ? 1 : 0;
 		nd = l->nodelay ? 1 : 0;
 		nni_aio_list_remove(aio);
-		nni_posix_tcp_start(c, nd, ka);
+		nni_posix_tcp_start(c, nd, ka, l->zerocopy);
 		nni_aio_set_output(aio, 0, c);
 		nni_aio_finish(aio, 0, 0);
 	}
@@ -184,6 +216,18 @@ tcp_listener_cb(nni_posix_pfd *pfd, unsigned events, void *arg)
 	nni_mtx_unlock(&l->mtx);
 }
 
+#ifdef NNG_HAVE_IO_URING
+static void
+tcp_listener_ucb(void *arg)
+{
+	nni_tcp_listener *l = arg;
+
+	nni_mtx_lock(&l->mtx);
+	tcp_listener_doaccept(l);
+	nni_mtx_unlock(&l->mtx);
+}
+#endif
+
 static void
 tcp_listener_cancel(nni_aio *aio, void *arg, int rv)
 {
@@ -208,6 +252,9 @@ nni_tcp_listener_listen(nni_tcp_listener *l, const nni_sockaddr *sa)
 	int                     rv;
 	int                     fd;
 	nni_posix_pfd          *pfd;
+#ifdef NNG_HAVE_IO_URING
+	nni_posix_uring *ring;
+#endif
 
 	if (((len = nni_posix_nn2sockaddr(&ss, sa)) == 0) ||
 #ifdef NNG_ENABLE_IPV6
@@ -253,6 +300,21 @@ nni_tcp_listener_listen(nni_tcp_listener *l, const nni_sockaddr *sa)
 	}
 #endif
 
+#ifdef SO_REUSEPORT
+	// Unlike SO_REUSEADDR above, this was asked for explicitly, so
+	// failing to set it is an error rather than a surprise later.
+	if (l->reuseport) {
+		int on = 1;
+		if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) <
+		    0) {
+			rv = nni_plat_errno(errno);
+			nni_mtx_unlock(&l->mtx);
+			nni_posix_pfd_fini(pfd);
+			return (rv);
+		}
+	}
+#endif
+
 	if (bind(fd, (struct sockaddr *) &ss, len) < 0) {
 		rv = nni_plat_errno(errno);
 		nni_mtx_unlock(&l->mtx);
@@ -270,6 +332,12 @@ nni_tcp_listener_listen(nni_tcp_listener *l, const nni_sockaddr *sa)
 	}
 
 	nni_posix_pfd_set_cb(pfd, tcp_listener_cb, l);
+#ifdef NNG_HAVE_IO_URING
+	if ((ring = nni_posix_uring_get()) != NULL) {
+		// Accepts go through the ring; the pfd is never armed.
+		nni_posix_uaccept_init(&l->ua, ring, fd, tcp_listener_ucb, l);
+	}
+#endif
 
 	l->pfd     = pfd;
 	l->started = true;
@@ -288,6 +356,11 @@ nni_tcp_listener_fini(nni_tcp_listener *l)
 	pfd = l->pfd;
 	nni_mtx_unlock(&l->mtx);
 
+#ifdef NNG_HAVE_IO_URING
+	if (l->ua.ring != NULL) {
+		nni_posix_uaccept_fini(&l->ua);
+	}
+#endif
 	if (pfd != NULL) {
 		nni_posix_pfd_fini(pfd);
 	}
@@ -404,6 +477,75 @@ tcp_listener_get_keepalive(void *arg, void *buf, size_t *szp, nni_type t)
 	return (nni_copyout_bool(b, buf, szp, t));
 }
 
+static int
+tcp_listener_set_reuseport(void *arg, const void *buf, size_t sz, nni_type t)
+{
+	nni_tcp_listener *l = arg;
+	int               rv;
+	bool              b;
+
+	if (((rv = nni_copyin_bool(&b, buf, sz, t)) != 0) || (l == NULL)) {
+		return (rv);
+	}
+#ifndef SO_REUSEPORT
+	if (b) {
+		return (NNG_ENOTSUP);
+	}
+#endif
+	nni_mtx_lock(&l->mtx);
+	if (l->started) {
+		nni_mtx_unlock(&l->mtx);
+		return (NNG_EBUSY);
+	}
+	l->reuseport = b;
+	nni_mtx_unlock(&l->mtx);
+	return (0);
+}
+
+static int
+tcp_listener_get_reuseport(void *arg, void *buf, size_t *szp, nni_type t)
+{
+	bool              b;
+	nni_tcp_listener *l = arg;
+	nni_mtx_lock(&l->mtx);
+	b = l->reuseport;
+	nni_mtx_unlock(&l->mtx);
+	return (nni_copyout_bool(b, buf, szp, t));
+}
+
+static int
+tcp_listener_set_zerocopy(void *arg, const void *buf, size_t sz, nni_type t)
+{
+	nni_tcp_listener *l = arg;
+	int               rv;
+	size_t            val;
+
+	if (((rv = nni_copyin_size(&val, buf, sz, 0, NNI_MAXSZ, t)) != 0) ||
+	    (l == NULL)) {
+		return (rv);
+	}
+#ifndef NNI_TCP_ZEROCOPY
+	if (val != 0) {
+		return (NNG_ENOTSUP);
+	}
+#endif
+	nni_mtx_lock(&l->mtx);
+	l->zerocopy = val;
+	nni_mtx_unlock(&l->mtx);
+	return (0);
+}
+
+static int
+tcp_listener_get_zerocopy(void *arg, void *buf, size_t *szp, nni_type t)
+{
+	size_t            val;
+	nni_tcp_listener *l = arg;
+	nni_mtx_lock(&l->mtx);
+	val = l->zerocopy;
+	nni_mtx_unlock(&l->mtx);
+	return (nni_copyout_size(val, buf, szp, t));
+}
+
 static const nni_option tcp_listener_options[] = {
 	{
 	    .o_name = NNG_OPT_LOCADDR,
@@ -419,6 +561,16 @@ static const nni_option tcp_listener_options[] = {
 	    .o_set  = tcp_listener_set_keepalive,
 	    .o_get  = tcp_listener_get_keepalive,
 	},
+	{
+	    .o_name = NNG_OPT_TCP_REUSEPORT,
+	    .o_set  = tcp_listener_set_reuseport,
+	    .o_get  = tcp_listener_get_reuseport,
+	},
+	{
+	    .o_name = NNG_OPT_TCP_ZEROCOPY,
+	    .o_set  = tcp_listener_set_zerocopy,
+	    .o_get  = tcp_listener_get_zerocopy,
+	},
 	{
 	    .o_name = NULL,
 	},
@@ -299,7 +299,11 @@ nni_plat_udp_recv(nni_plat_udp *udp, nni_aio *aio)
 	}
 	nni_list_append(&udp->udp_recvq, aio);
 	if (nni_list_first(&udp->udp_recvq) == aio) {
-		if ((rv = nni_posix_pfd_arm(udp->udp_pfd, POLLIN)) != 0) {
+		// Try it right away; the poller may only tell us about
+		// changes, not what is already there.
+		nni_posix_udp_dorecv(udp);
+		if ((nni_list_first(&udp->udp_recvq) == aio) &&
+		    ((rv = nni_posix_pfd_arm(udp->udp_pfd, POLLIN)) != 0)) {
 			nni_aio_list_remove(aio);
 			nni_aio_finish_error(aio, rv);
 		}
@@ -322,7 +326,11 @@ nni_plat_udp_send(nni_plat_udp *udp, nni_aio *aio)
 	}
 	nni_list_append(&udp->udp_sendq, aio);
 	if (nni_list_first(&udp->udp_sendq) == aio) {
-		if ((rv = nni_posix_pfd_arm(udp->udp_pfd, POLLOUT)) != 0) {
+		// Try it right away; the poller may only tell us about
+		// changes, not what is already there.
+		nni_posix_udp_dosend(udp);
+		if ((nni_list_first(&udp->udp_sendq) == aio) &&
+		    ((rv = nni_posix_pfd_arm(udp->udp_pfd, POLLOUT)) != 0)) {
 			nni_aio_list_remove(aio);
 			nni_aio_finish_error(aio, rv);
 		}
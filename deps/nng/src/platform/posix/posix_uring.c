@@ -0,0 +1,1078 @@
+//
+// Copyright 2024 Staysail Systems, Inc. <info@staysail.tech>
+//
+// This software is supplied under the terms of the MIT License, a
+// copy of which should be located in the distribution where this
+// file was obtained (LICENSE.txt).  A copy of the license may also be
+// found online at https://opensource.org/licenses/MIT.
+//
+
+#include "core/nng_impl.h"
+
+#ifdef NNG_HAVE_IO_URING
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "platform/posix/posix_uring.h"
+
+// With io_uring (NNG_INIT_IO_URING), stream transfers and accepts do not
+// wait for readiness and then make the system call themselves.  Instead
+// each is a request (SQE) in a submission ring, which the kernel carries
+// out when it can, posting the result to a completion ring (CQE).  There
+// are several rings, like the pollqs, each with a thread that reaps the
+// completions and runs the callbacks.  Connections and listeners are
+// spread over the rings round-robin.
+//
+// Requests made on the ring thread, which is where a connection starts
+// its next read as the last one completes, are only queued.  They reach
+// the kernel in the same io_uring_enter that waits for the next
+// completions, so a busy ring costs one system call per pass, however
+// many transfers it runs.  Requests from other threads are submitted
+// right away, much as they would have made the system call themselves.
+// The thread handles every completion that is there before it waits
+// again.
+//
+// A connection keeps at most one read and one write in the kernel, for
+// the aio at the head of each queue.  Canceling or closing takes them
+// back with IORING_REGISTER_SYNC_CANCEL, which returns only once the
+// kernel is done with their buffers, and then fails the aio right away,
+// just as with the pollers.  (It has to: once nni_aio_close has canceled
+// an aio, nni_aio_stop no longer waits for it.)  The completion still
+// arrives later, and is ignored, but the connection stays until it does.
+// Writes use MSG_WAITALL, so the kernel finishes them itself, and a short
+// write is only resubmitted if it was cut off.
+// Zerocopy writes (IORING_OP_SENDMSG_ZC, where the kernel has it) finish
+// when the kernel's notification arrives.
+//
+// Each ring has a table of registered buffers, which a connection can use
+// for the buffer it reads into over and over (see NNI_OPT_RECV_BUFFER).
+// The kernel then maps the pages just once, rather than for every read.
+// Listeners use multishot accept, so one request goes on accepting until
+// it is canceled, which we do when nobody takes the connections.
+//
+// If the kernel lacks io_uring, or features we depend on (all there in
+// 6.0 and later), we log it and
+// use the pollers and system calls as before.
+
+#define NNI_URING_ENTRIES 256
+#define NNI_URING_BUFFERS 256 // registered buffers per ring
+#define NNI_URING_ACCEPTS 16  // accepted ahead, before we stop for a while
+
+struct nni_posix_uring {
+	int                  fd;
+	nni_mtx              mtx; // submission ring producers, buffer slots
+	nni_thr              thr;
+	nni_atomic_bool      stop;
+	unsigned            *sq_head;
+	unsigned            *sq_tail;
+	unsigned             sq_mask;
+	unsigned             sq_entries;
+	struct io_uring_sqe *sqes;
+	unsigned            *cq_head;
+	unsigned            *cq_tail;
+	unsigned             cq_mask;
+	struct io_uring_cqe *cqes;
+	void                *sq_ring;
+	size_t               sq_ring_size;
+	void                *cq_ring;
+	size_t               cq_ring_size;
+	size_t               sqes_size;
+	bool                *bufs; // registered buffer slots in use
+	unsigned             nbufs;
+};
+
+static nni_posix_uring *nni_posix_urings;
+static int              nni_posix_nuring;
+static nni_atomic_int   nni_posix_uring_next;
+static bool             nni_posix_uring_zc;    // IORING_OP_SENDMSG_ZC
+static bool             nni_posix_uring_multi; // multishot accept
+
+// nni_posix_uring_enter submits whatever is queued, and optionally waits.
+// The kernel skips the wait if it submits fewer requests than we say, so
+// we must ask for exactly what is there.
+static int
+nni_posix_uring_enter(nni_posix_uring *r, unsigned wait, unsigned flags)
+{
+	unsigned n = __atomic_load_n(r->sq_tail, __ATOMIC_ACQUIRE) -
+	    __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+
+	return ((int) syscall(
+	    __NR_io_uring_enter, r->fd, n, wait, flags, NULL, 0));
+}
+
+// nni_posix_uring_push queues a request, and submits it unless we are on
+// the ring thread, which submits it when it next waits.
+static void
+nni_posix_uring_push(nni_posix_uring *r, const struct io_uring_sqe *sqe)
+{
+	nni_mtx_lock(&r->mtx);
+	for (;;) {
+		unsigned head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+		unsigned tail = *r->sq_tail;
+
+		if (tail - head < r->sq_entries) {
+			r->sqes[tail & r->sq_mask] = *sqe;
+			__atomic_store_n(
+			    r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+			break;
+		}
+		// Ring is full, so hand what we have to the kernel.
+		(void) nni_posix_uring_enter(r, 0, 0);
+	}
+	nni_mtx_unlock(&r->mtx);
+	if (!nni_thr_is_self(&r->thr)) {
+		(void) nni_posix_uring_enter(r, 0, 0);
+	}
+}
+
+// nni_posix_uring_cancel asks the kernel to cancel the request for op.
+// Nothing waits for the result of that; the request itself completes
+// (with -ECANCELED if it was still waiting).  Requests are taken from the
+// ring in order, so a cancel cannot reach a later request for the op.
+static void
+nni_posix_uring_cancel(nni_posix_uring *r, nni_posix_uring_op *op)
+{
+	struct io_uring_sqe sqe;
+
+	memset(&sqe, 0, sizeof(sqe));
+	sqe.opcode = IORING_OP_ASYNC_CANCEL;
+	sqe.fd     = -1;
+	sqe.addr   = (uint64_t) (uintptr_t) op;
+	nni_posix_uring_push(r, &sqe);
+}
+
+// nni_posix_uring_stop cancels the request for op, and unlike the above
+// returns only once the kernel will no longer touch its buffers.  The
+// kernel takes the request under the same lock that it runs it with, so
+// it is either done or will not run again.  Its completion is delivered
+// as usual.  The request might still be queued here, where the kernel
+// cannot find it, so anything queued is submitted first.
+static void
+nni_posix_uring_stop(nni_posix_uring *r, nni_posix_uring_op *op)
+{
+	struct io_uring_sync_cancel_reg sc;
+
+	(void) nni_posix_uring_enter(r, 0, 0);
+	memset(&sc, 0, sizeof(sc));
+	sc.addr            = (uint64_t) (uintptr_t) op;
+	sc.fd              = -1;
+	sc.timeout.tv_sec  = -1;
+	sc.timeout.tv_nsec = -1;
+	while ((syscall(__NR_io_uring_register, r->fd,
+	           IORING_REGISTER_SYNC_CANCEL, &sc, 1) < 0) &&
+	    (errno == EINTR)) {
+		continue;
+	}
+}
+
+static int
+nni_posix_uring_buf_add(nni_posix_uring *r, void *buf, size_t len, int *ip)
+{
+	struct io_uring_rsrc_update2 up;
+	struct iovec                 iov;
+	unsigned                     i;
+	int                          rv;
+
+	nni_mtx_lock(&r->mtx);
+	for (i = 0; i < r->nbufs; i++) {
+		if (!r->bufs[i]) {
+			r->bufs[i] = true;
+			break;
+		}
+	}
+	nni_mtx_unlock(&r->mtx);
+	if (i == r->nbufs) {
+		return (NNG_ENOSPC);
+	}
+
+	iov.iov_base = buf;
+	iov.iov_len  = len;
+	memset(&up, 0, sizeof(up));
+	up.offset = i;
+	up.data   = (uint64_t) (uintptr_t) &iov;
+	up.nr     = 1;
+	if (syscall(__NR_io_uring_register, r->fd,
+	        IORING_REGISTER_BUFFERS_UPDATE, &up, sizeof(up)) < 0) {
+		// Most likely RLIMIT_MEMLOCK, as registered pages are pinned.
+		rv = nni_plat_errno(errno);
+		nni_mtx_lock(&r->mtx);
+		r->bufs[i] = false;
+		nni_mtx_unlock(&r->mtx);
+		return (rv);
+	}
+	*ip = (int) i;
+	return (0);
+}
+
+static void
+nni_posix_uring_buf_rm(nni_posix_uring *r, int i)
+{
+	struct io_uring_rsrc_update2 up;
+	struct iovec                 iov;
+
+	// Requests still using the buffer keep it until they are done.
+	memset(&iov, 0, sizeof(iov));
+	memset(&up, 0, sizeof(up));
+	up.offset = (unsigned) i;
+	up.data   = (uint64_t) (uintptr_t) &iov;
+	up.nr     = 1;
+	(void) syscall(__NR_io_uring_register, r->fd,
+	    IORING_REGISTER_BUFFERS_UPDATE, &up, sizeof(up));
+	nni_mtx_lock(&r->mtx);
+	r->bufs[i] = false;
+	nni_mtx_unlock(&r->mtx);
+}
+
+static bool
+nni_posix_uring_has(const struct io_uring_probe *p, unsigned op)
+{
+	return ((op <= p->last_op) &&
+	    ((p->ops[op].flags & IO_URING_OP_SUPPORTED) != 0));
+}
+
+// nni_posix_uring_probe checks that the kernel has the requests we use.
+static int
+nni_posix_uring_probe(nni_posix_uring *r)
+{
+	struct io_uring_probe          *p;
+	struct io_uring_sync_cancel_reg sc;
+	size_t                          sz;
+	int                             rv;
+	static const unsigned           need[] = {
+                IORING_OP_NOP,
+                IORING_OP_READV,
+                IORING_OP_READ_FIXED,
+                IORING_OP_SENDMSG,
+                IORING_OP_ACCEPT,
+                IORING_OP_ASYNC_CANCEL,
+	};
+
+	sz = sizeof(*p) + 256 * sizeof(struct io_uring_probe_op);
+	if ((p = nni_zalloc(sz)) == NULL) {
+		return (NNG_ENOMEM);
+	}
+	if (syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_PROBE, p,
+	        256) < 0) {
+		rv = nni_plat_errno(errno);
+		nni_free(p, sz);
+		return (rv);
+	}
+	rv = 0;
+	for (size_t i = 0; i < NNI_NUM_ELEMENTS(need); i++) {
+		if (!nni_posix_uring_has(p, need[i])) {
+			rv = NNG_ENOTSUP;
+		}
+	}
+	nni_posix_uring_zc = nni_posix_uring_has(p, IORING_OP_SENDMSG_ZC);
+	// There is no asking for multishot accept, but it came in the
+	// same release (5.19) as IORING_OP_SOCKET.
+	nni_posix_uring_multi = nni_posix_uring_has(p, IORING_OP_SOCKET);
+	nni_free(p, sz);
+
+	// Synchronous cancel came in 6.0.  There is nothing for this one to
+	// find, so it should say just that.
+	memset(&sc, 0, sizeof(sc));
+	sc.fd              = -1;
+	sc.timeout.tv_sec  = -1;
+	sc.timeout.tv_nsec = -1;
+	if ((syscall(__NR_io_uring_register, r->fd,
+	         IORING_REGISTER_SYNC_CANCEL, &sc, 1) < 0) &&
+	    (errno != ENOENT)) {
+		rv = NNG_ENOTSUP;
+	}
+	return (rv);
+}
+
+static void
+nni_posix_uring_teardown(nni_posix_uring *r)
+{
+	(void) munmap(r->sqes, r->sqes_size);
+	(void) munmap(r->cq_ring, r->cq_ring_size);
+	(void) munmap(r->sq_ring, r->sq_ring_size);
+	(void) close(r->fd);
+	if (r->bufs != NULL) {
+		NNI_FREE_STRUCTS(r->bufs, r->nbufs);
+	}
+	nni_mtx_fini(&r->mtx);
+}
+
+static int
+nni_posix_uring_setup(nni_posix_uring *r)
+{
+	struct io_uring_params       p;
+	struct io_uring_rsrc_register reg;
+	unsigned                    *array;
+	char                        *sq;
+	char                        *cq;
+	int                          rv;
+	// We cannot lose completions, nor have reads and writes on sockets
+	// tie up kernel worker threads while they wait.
+	const unsigned need = IORING_FEAT_NODROP | IORING_FEAT_FAST_POLL;
+	// The ring thread is in the kernel often enough to run the work for
+	// completions, so it need not be interrupted for it (5.19 and
+	// later).  Older kernels lack that, and before 5.18 SUBMIT_ALL.
+	static const unsigned flags[] = {
+		IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN,
+		IORING_SETUP_SUBMIT_ALL,
+		0,
+	};
+
+	memset(r, 0, sizeof(*r));
+	for (int i = 0; i < (int) NNI_NUM_ELEMENTS(flags); i++) {
+		memset(&p, 0, sizeof(p));
+		p.flags      = IORING_SETUP_CQSIZE | flags[i];
+		p.cq_entries = NNI_URING_ENTRIES * 4;
+		r->fd =
+		    (int) syscall(__NR_io_uring_setup, NNI_URING_ENTRIES, &p);
+		if ((r->fd >= 0) || (errno != EINVAL)) {
+			break;
+		}
+	}
+	if (r->fd < 0) {
+		return (nni_plat_errno(errno));
+	}
+	(void) fcntl(r->fd, F_SETFD, FD_CLOEXEC);
+	if (((p.features & need) != need) ||
+	    ((rv = nni_posix_uring_probe(r)) != 0)) {
+		(void) close(r->fd);
+		return (NNG_ENOTSUP);
+	}
+
+	r->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	r->cq_ring_size =
+	    p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+	r->sq_ring = mmap(NULL, r->sq_ring_size, PROT_READ | PROT_WRITE,
+	    MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+	r->cq_ring = mmap(NULL, r->cq_ring_size, PROT_READ | PROT_WRITE,
+	    MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+	r->sqes    = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE,
+	       MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+	if ((r->sq_ring == MAP_FAILED) || (r->cq_ring == MAP_FAILED) ||
+	    (r->sqes == MAP_FAILED)) {
+		if (r->sq_ring != MAP_FAILED) {
+			(void) munmap(r->sq_ring, r->sq_ring_size);
+		}
+		if (r->cq_ring != MAP_FAILED) {
+			(void) munmap(r->cq_ring, r->cq_ring_size);
+		}
+		if (r->sqes != MAP_FAILED) {
+			(void) munmap(r->sqes, r->sqes_size);
+		}
+		(void) close(r->fd);
+		return (NNG_ENOMEM);
+	}
+
+	sq            = r->sq_ring;
+	cq            = r->cq_ring;
+	r->sq_head    = (unsigned *) (sq + p.sq_off.head);
+	r->sq_tail    = (unsigned *) (sq + p.sq_off.tail);
+	r->sq_mask    = *(unsigned *) (sq + p.sq_off.ring_mask);
+	r->sq_entries = p.sq_entries;
+	r->cq_head    = (unsigned *) (cq + p.cq_off.head);
+	r->cq_tail    = (unsigned *) (cq + p.cq_off.tail);
+	r->cq_mask    = *(unsigned *) (cq + p.cq_off.ring_mask);
+	r->cqes       = (struct io_uring_cqe *) (cq + p.cq_off.cqes);
+
+	// Submission slots are always used in order, so the indirection
+	// array is just the identity.
+	array = (unsigned *) (sq + p.sq_off.array);
+	for (unsigned i = 0; i < p.sq_entries; i++) {
+		array[i] = i;
+	}
+
+	// An empty table, for buffers to be registered into later.  Without
+	// it (before 5.19), connections just do without.
+	memset(&reg, 0, sizeof(reg));
+	reg.nr    = NNI_URING_BUFFERS;
+	reg.flags = IORING_RSRC_REGISTER_SPARSE;
+	if ((syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_BUFFERS2,
+	         &reg, sizeof(reg)) == 0) &&
+	    ((r->bufs = NNI_ALLOC_STRUCTS(r->bufs, NNI_URING_BUFFERS)) !=
+	        NULL)) {
+		r->nbufs = NNI_URING_BUFFERS;
+	}
+
+	nni_mtx_init(&r->mtx);
+	nni_atomic_init_bool(&r->stop);
+	return (0);
+}
+
+static void
+nni_posix_uring_thr(void *arg)
+{
+	nni_posix_uring *r = arg;
+
+	while (!nni_atomic_get_bool(&r->stop)) {
+		unsigned head;
+		unsigned tail;
+
+		// This also submits the requests the callbacks queued in
+		// the last pass.
+		(void) nni_posix_uring_enter(r, 1, IORING_ENTER_GETEVENTS);
+
+		head = *r->cq_head;
+		tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+		while (head != tail) {
+			struct io_uring_cqe *cqe = &r->cqes[head & r->cq_mask];
+			nni_posix_uring_op  *op;
+			int                  res   = cqe->res;
+			unsigned             flags = cqe->flags;
+
+			// Zero is for requests nobody waits for (cancels).
+			op = (nni_posix_uring_op *) (uintptr_t) cqe->user_data;
+			head++;
+			__atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+			if (head == tail) {
+				// Pick up anything that completed meanwhile.
+				tail = __atomic_load_n(
+				    r->cq_tail, __ATOMIC_ACQUIRE);
+			}
+			if (op != NULL) {
+				op->cb(op, res, flags);
+			}
+		}
+	}
+}
+
+static int
+nni_posix_uring_create(nni_posix_uring *r)
+{
+	int rv;
+
+	if ((rv = nni_posix_uring_setup(r)) != 0) {
+		return (rv);
+	}
+	if ((rv = nni_thr_init(&r->thr, nni_posix_uring_thr, r)) != 0) {
+		nni_posix_uring_teardown(r);
+		return (rv);
+	}
+	nni_thr_set_name(&r->thr, "nng:poll:uring");
+	nni_thr_run(&r->thr);
+	return (0);
+}
+
+static void
+nni_posix_uring_destroy(nni_posix_uring *r)
+{
+	struct io_uring_sqe sqe;
+
+	// Wake the thread with a request that completes at once.
+	nni_atomic_set_bool(&r->stop, true);
+	memset(&sqe, 0, sizeof(sqe));
+	sqe.opcode = IORING_OP_NOP;
+	nni_posix_uring_push(r, &sqe);
+	nni_thr_fini(&r->thr);
+	nni_posix_uring_teardown(r);
+}
+
+#ifndef NNG_IO_URING
+#define NNG_IO_URING 0
+#endif
+
+// nni_posix_uring_sysinit sets up the rings, if they are wanted and the
+// kernel lets us have them, and returns whether it did.
+bool
+nni_posix_uring_sysinit(int nring)
+{
+	int rv;
+
+	if ((nni_init_get_param(NNG_INIT_IO_URING, NNG_IO_URING) == 0) ||
+	    ((nni_posix_urings = NNI_ALLOC_STRUCTS(nni_posix_urings, nring)) ==
+	        NULL)) {
+		nni_init_set_effective(NNG_INIT_IO_URING, 0);
+		return (false);
+	}
+	for (int i = 0; i < nring; i++) {
+		if ((rv = nni_posix_uring_create(&nni_posix_urings[i])) != 0) {
+			nng_log_info("NNG-IO-URING",
+			    "io_uring unavailable (%s), using epoll",
+			    nng_strerror(rv));
+			while (--i >= 0) {
+				nni_posix_uring_destroy(&nni_posix_urings[i]);
+			}
+			NNI_FREE_STRUCTS(nni_posix_urings, nring);
+			nni_posix_urings = NULL;
+			nni_init_set_effective(NNG_INIT_IO_URING, 0);
+			return (false);
+		}
+	}
+	nni_posix_nuring = nring;
+	nni_atomic_init(&nni_posix_uring_next);
+	nni_init_set_effective(NNG_INIT_IO_URING, 1);
+	return (true);
+}
+
+void
+nni_posix_uring_sysfini(void)
+{
+	for (int i = 0; i < nni_posix_nuring; i++) {
+		nni_posix_uring_destroy(&nni_posix_urings[i]);
+	}
+	if (nni_posix_urings != NULL) {
+		NNI_FREE_STRUCTS(nni_posix_urings, nni_posix_nuring);
+		nni_posix_urings = NULL;
+	}
+	nni_posix_nuring = 0;
+}
+
+nni_posix_uring *
+nni_posix_uring_get(void)
+{
+	if (nni_posix_nuring == 0) {
+		return (NULL);
+	}
+	return (&nni_posix_urings[(unsigned) nni_atomic_dec_nv(
+	                              &nni_posix_uring_next) %
+	    (unsigned) nni_posix_nuring]);
+}
+
+// Streams.
+
+// ustream_drop resets the connection under a zerocopy write, so that the
+// kernel lets go of the data soon, rather than waiting for a peer that
+// may never acknowledge it.  (Connecting to AF_UNSPEC does that for TCP,
+// which is the only stream that writes zerocopy.)
+static void
+ustream_drop(nni_posix_ustream *us)
+{
+	struct sockaddr sa;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_family = AF_UNSPEC;
+	(void) connect(us->fd, &sa, sizeof(sa));
+}
+
+static void
+ustream_doread(nni_posix_ustream *us)
+{
+	nni_aio *aio;
+
+	while ((!us->rbusy) && ((aio = nni_list_first(us->readq)) != NULL)) {
+		struct io_uring_sqe sqe;
+		unsigned            naiov;
+		nni_iov            *aiov;
+		unsigned            niov;
+		uint8_t            *base;
+
+		if (us->closed) {
+			nni_aio_list_remove(aio);
+			nni_aio_finish_error(aio, NNG_ECLOSED);
+			continue;
+		}
+		nni_aio_get_iov(aio, &naiov, &aiov);
+		if (naiov > NNI_NUM_ELEMENTS(us->riov)) {
+			nni_aio_list_remove(aio);
+			nni_aio_finish_error(aio, NNG_EINVAL);
+			continue;
+		}
+		niov = 0;
+		for (unsigned i = 0; i < naiov; i++) {
+			if (aiov[i].iov_len != 0) {
+				us->riov[niov].iov_base = aiov[i].iov_buf;
+				us->riov[niov].iov_len  = aiov[i].iov_len;
+				niov++;
+			}
+		}
+
+		memset(&sqe, 0, sizeof(sqe));
+		sqe.fd        = us->fd;
+		sqe.user_data = (uint64_t) (uintptr_t) &us->rop;
+		base          = us->riov[0].iov_base;
+		if ((niov == 1) && (us->ridx >= 0) && (base >= us->rbuf) &&
+		    (base + us->riov[0].iov_len <= us->rbuf + us->rlen)) {
+			sqe.opcode    = IORING_OP_READ_FIXED;
+			sqe.addr      = (uint64_t) (uintptr_t) base;
+			sqe.len       = (uint32_t) us->riov[0].iov_len;
+			sqe.buf_index = (uint16_t) us->ridx;
+		} else {
+			sqe.opcode = IORING_OP_READV;
+			sqe.addr   = (uint64_t) (uintptr_t) us->riov;
+			sqe.len    = niov;
+		}
+		us->raio  = aio;
+		us->rbusy = true;
+		nni_posix_uring_push(us->ring, &sqe);
+	}
+}
+
+static void
+ustream_write_submit(nni_posix_ustream *us)
+{
+	struct io_uring_sqe sqe;
+
+	memset(&sqe, 0, sizeof(sqe));
+	sqe.opcode    = us->wzc ? IORING_OP_SENDMSG_ZC : IORING_OP_SENDMSG;
+	sqe.fd        = us->fd;
+	sqe.addr      = (uint64_t) (uintptr_t) &us->whdr;
+	sqe.len       = 1;
+	sqe.msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+	sqe.user_data = (uint64_t) (uintptr_t) &us->wop;
+	nni_posix_uring_push(us->ring, &sqe);
+}
+
+// ustream_advance skips over what a short write did send, and returns
+// whether anything is left.
+static bool
+ustream_advance(nni_posix_ustream *us, size_t n)
+{
+	struct msghdr *h = &us->whdr;
+
+	while ((h->msg_iovlen > 0) && (n >= h->msg_iov[0].iov_len)) {
+		n -= h->msg_iov[0].iov_len;
+		h->msg_iov++;
+		h->msg_iovlen--;
+	}
+	if (h->msg_iovlen == 0) {
+		return (false);
+	}
+	h->msg_iov[0].iov_base = (uint8_t *) h->msg_iov[0].iov_base + n;
+	h->msg_iov[0].iov_len -= n;
+	return (true);
+}
+
+static void
+ustream_dowrite(nni_posix_ustream *us)
+{
+	nni_aio *aio;
+
+	while ((!us->wbusy) && ((aio = nni_list_first(us->writeq)) != NULL)) {
+		unsigned naiov;
+		nni_iov *aiov;
+		unsigned niov;
+		size_t   total;
+
+		if (us->closed) {
+			nni_aio_list_remove(aio);
+			nni_aio_finish_error(aio, NNG_ECLOSED);
+			continue;
+		}
+		nni_aio_get_iov(aio, &naiov, &aiov);
+		if (naiov > NNI_NUM_ELEMENTS(us->wiov)) {
+			nni_aio_list_remove(aio);
+			nni_aio_finish_error(aio, NNG_EINVAL);
+			continue;
+		}
+		niov  = 0;
+		total = 0;
+		for (unsigned i = 0; i < naiov; i++) {
+			if (aiov[i].iov_len != 0) {
+				us->wiov[niov].iov_base = aiov[i].iov_buf;
+				us->wiov[niov].iov_len  = aiov[i].iov_len;
+				total += aiov[i].iov_len;
+				niov++;
+			}
+		}
+		memset(&us->whdr, 0, sizeof(us->whdr));
+		us->whdr.msg_iov    = us->wiov;
+		us->whdr.msg_iovlen = niov;
+
+		us->wzc = nni_posix_uring_zc && (us->zc_min > 0) &&
+		    (total >= us->zc_min);
+		if ((!us->wzc) && (!nni_thr_is_self(&us->ring->thr))) {
+			// Try it right away, as there is usually room, and
+			// that saves waking the ring thread to complete it.
+			// The ring only gets what does not fit.
+			int n = sendmsg(us->fd, &us->whdr, MSG_NOSIGNAL);
+			if ((n < 0) && (errno != EAGAIN) && (errno != EINTR)) {
+				nni_aio_list_remove(aio);
+				nni_aio_finish_error(
+				    aio, nni_plat_errno(errno));
+				continue;
+			}
+			if (n > 0) {
+				nni_aio_bump_count(aio, (size_t) n);
+				if (!ustream_advance(us, (size_t) n)) {
+					nni_aio_list_remove(aio);
+					nni_aio_finish(
+					    aio, 0, nni_aio_count(aio));
+					continue;
+				}
+			}
+		}
+		us->waio  = aio;
+		us->wbusy = true;
+		us->wres  = 0;
+		ustream_write_submit(us);
+	}
+}
+
+// Completions that permit it are run right here on the ring thread, once
+// we have dropped the lock, as the poller callbacks do.
+static void
+ustream_read_cb(nni_posix_uring_op *op, int res, unsigned flags)
+{
+	nni_posix_ustream  *us = op->arg;
+	nni_aio_completions cl;
+	nni_aio            *aio;
+
+	NNI_ARG_UNUSED(flags);
+	nni_aio_completions_init(&cl);
+	nni_mtx_lock(us->mtx);
+	us->rbusy = false;
+	// If the aio is gone, it was canceled, and has failed already.
+	if ((aio = us->raio) != NULL) {
+		us->raio = NULL;
+		nni_aio_list_remove(aio);
+		if (res > 0) {
+			nni_aio_bump_count(aio, (size_t) res);
+			nni_aio_completions_defer(
+			    &cl, aio, 0, nni_aio_count(aio));
+		} else if (res == 0) {
+			// No bytes indicates a closed descriptor.
+			nni_aio_finish_error(aio, NNG_ECONNSHUT);
+		} else {
+			nni_aio_finish_error(aio, nni_plat_errno(-res));
+		}
+	}
+	ustream_doread(us);
+	if (us->closed) {
+		nni_cv_wake(&us->cv);
+	}
+	nni_mtx_unlock(us->mtx);
+	nni_aio_completions_run(&cl);
+}
+
+static void
+ustream_write_cb(nni_posix_uring_op *op, int res, unsigned flags)
+{
+	nni_posix_ustream  *us = op->arg;
+	nni_aio_completions cl;
+	nni_aio            *aio;
+
+	nni_aio_completions_init(&cl);
+	nni_mtx_lock(us->mtx);
+	if ((flags & IORING_CQE_F_NOTIF) == 0) {
+		us->wres = res;
+		if ((flags & IORING_CQE_F_MORE) != 0) {
+			// Zerocopy, and the kernel still has the data.
+			nni_mtx_unlock(us->mtx);
+			return;
+		}
+	}
+	aio = us->waio;
+	res = us->wres;
+	if ((aio != NULL) && (res > 0)) {
+		nni_aio_bump_count(aio, (size_t) res);
+		if (ustream_advance(us, (size_t) res)) {
+			// Cut short, so send the rest.
+			ustream_write_submit(us);
+			nni_mtx_unlock(us->mtx);
+			return;
+		}
+	}
+	us->wbusy = false;
+	// If the aio is gone, it was canceled, and has failed already.
+	if (aio != NULL) {
+		us->waio = NULL;
+		nni_aio_list_remove(aio);
+		if (res >= 0) {
+			nni_aio_completions_defer(
+			    &cl, aio, 0, nni_aio_count(aio));
+		} else {
+			nni_aio_finish_error(aio, nni_plat_errno(-res));
+		}
+	}
+	ustream_dowrite(us);
+	if (us->closed) {
+		nni_cv_wake(&us->cv);
+	}
+	nni_mtx_unlock(us->mtx);
+	nni_aio_completions_run(&cl);
+}
+
+void
+nni_posix_ustream_init(nni_posix_ustream *us, nni_posix_uring *r, int fd,
+    nni_mtx *mtx, nni_list *readq, nni_list *writeq)
+{
+	us->ring    = r;
+	us->fd      = fd;
+	us->mtx     = mtx;
+	us->readq   = readq;
+	us->writeq  = writeq;
+	us->rop.cb  = ustream_read_cb;
+	us->rop.arg = us;
+	us->wop.cb  = ustream_write_cb;
+	us->wop.arg = us;
+	us->raio    = NULL;
+	us->waio    = NULL;
+	us->rbusy   = false;
+	us->wbusy   = false;
+	us->closed  = false;
+	us->zc_min  = 0;
+	us->rbuf    = NULL;
+	us->rlen    = 0;
+	us->ridx    = -1;
+	nni_cv_init(&us->cv, mtx);
+}
+
+// nni_posix_ustream_fini waits for the completions of the transfers that
+// closing took back from the kernel.
+void
+nni_posix_ustream_fini(nni_posix_ustream *us)
+{
+	nni_mtx_lock(us->mtx);
+	NNI_ASSERT(us->closed);
+	while (us->rbusy || us->wbusy) {
+		nni_cv_wait(&us->cv);
+	}
+	nni_mtx_unlock(us->mtx);
+	if (us->ridx >= 0) {
+		nni_posix_uring_buf_rm(us->ring, us->ridx);
+	}
+	nni_cv_fini(&us->cv);
+}
+
+void
+nni_posix_ustream_recv(nni_posix_ustream *us)
+{
+	ustream_doread(us);
+}
+
+void
+nni_posix_ustream_send(nni_posix_ustream *us)
+{
+	ustream_dowrite(us);
+}
+
+// nni_posix_ustream_cancel takes the aio back from the kernel, if it is
+// there, after which the caller can fail it as usual.  A zerocopy write
+// also resets the connection, so that the kernel does not hang on to the
+// data while it waits for the peer.
+void
+nni_posix_ustream_cancel(nni_posix_ustream *us, nni_aio *aio)
+{
+	if (aio == us->raio) {
+		nni_posix_uring_stop(us->ring, &us->rop);
+		us->raio = NULL;
+	} else if (aio == us->waio) {
+		if (us->wzc) {
+			ustream_drop(us);
+		}
+		nni_posix_uring_stop(us->ring, &us->wop);
+		us->waio = NULL;
+	}
+}
+
+void
+nni_posix_ustream_close(nni_posix_ustream *us, int err)
+{
+	nni_aio *aio;
+
+	us->closed = true;
+	if (us->raio != NULL) {
+		nni_posix_ustream_cancel(us, us->raio);
+	}
+	if (us->waio != NULL) {
+		nni_posix_ustream_cancel(us, us->waio);
+	}
+	while ((aio = nni_list_first(us->readq)) != NULL) {
+		nni_aio_list_remove(aio);
+		nni_aio_finish_error(aio, err);
+	}
+	while ((aio = nni_list_first(us->writeq)) != NULL) {
+		nni_aio_list_remove(aio);
+		nni_aio_finish_error(aio, err);
+	}
+}
+
+// nni_posix_ustream_recv_buffer registers the buffer (an nni_iov) that the
+// stream's owner receives into, so that reads into it use the registered
+// pages (IORING_OP_READ_FIXED).  It replaces any earlier one.
+int
+nni_posix_ustream_recv_buffer(
+    nni_posix_ustream *us, const void *v, size_t sz, nni_type t)
+{
+	nni_iov iov;
+	int     idx = -1;
+	int     rv;
+
+	if (t != NNI_TYPE_OPAQUE) {
+		return (NNG_EBADTYPE);
+	}
+	if (sz != sizeof(iov)) {
+		return (NNG_EINVAL);
+	}
+	memcpy(&iov, v, sizeof(iov));
+	if ((rv = nni_posix_uring_buf_add(
+	         us->ring, iov.iov_buf, iov.iov_len, &idx)) != 0) {
+		return (rv);
+	}
+	if (us->ridx >= 0) {
+		nni_posix_uring_buf_rm(us->ring, us->ridx);
+	}
+	us->rbuf = iov.iov_buf;
+	us->rlen = iov.iov_len;
+	us->ridx = idx;
+	return (0);
+}
+
+// Listeners.
+
+static void
+uaccept_arm(nni_posix_uaccept *ua)
+{
+	struct io_uring_sqe sqe;
+
+	memset(&sqe, 0, sizeof(sqe));
+	sqe.opcode       = IORING_OP_ACCEPT;
+	sqe.fd           = ua->fd;
+	sqe.accept_flags = SOCK_CLOEXEC;
+	sqe.ioprio       = nni_posix_uring_multi ? IORING_ACCEPT_MULTISHOT : 0;
+	sqe.user_data    = (uint64_t) (uintptr_t) &ua->op;
+	ua->armed        = true;
+	nni_posix_uring_push(ua->ring, &sqe);
+}
+
+static void
+uaccept_cb(nni_posix_uring_op *op, int res, unsigned flags)
+{
+	nni_posix_uaccept *ua = op->arg;
+
+	nni_mtx_lock(&ua->mtx);
+	if ((flags & IORING_CQE_F_MORE) == 0) {
+		ua->armed = false;
+	}
+	if ((res >= 0) && (ua->closed)) {
+		(void) close(res);
+	} else if (res >= 0) {
+		if (ua->nfds == ua->cap) {
+			int     *fds;
+			unsigned cap = ua->cap == 0 ? 4 : ua->cap * 2;
+
+			if ((fds = nni_alloc(cap * sizeof(int))) == NULL) {
+				(void) close(res);
+				ua->err = NNG_ENOMEM;
+				goto done;
+			}
+			if (ua->nfds > 0) {
+				memcpy(fds, ua->fds, ua->nfds * sizeof(int));
+				nni_free(ua->fds, ua->cap * sizeof(int));
+			}
+			ua->fds = fds;
+			ua->cap = cap;
+		}
+		ua->fds[ua->nfds++] = res;
+		if (ua->armed && (ua->nfds == NNI_URING_ACCEPTS)) {
+			// Nobody is taking them, so leave the rest with
+			// the kernel (in the listen backlog) for now.
+			nni_posix_uring_cancel(ua->ring, &ua->op);
+		}
+	} else {
+		switch (-res) {
+		case ECANCELED:
+		case ECONNABORTED:
+		case ECONNRESET:
+			// Eat them, they aren't interesting.
+			break;
+		default:
+			ua->err = nni_plat_errno(-res);
+			break;
+		}
+	}
+done:
+	if (ua->closed) {
+		nni_cv_wake(&ua->cv);
+		nni_mtx_unlock(&ua->mtx);
+		return;
+	}
+	ua->busy++;
+	nni_mtx_unlock(&ua->mtx);
+
+	ua->cb(ua->arg);
+
+	nni_mtx_lock(&ua->mtx);
+	ua->busy--;
+	nni_cv_wake(&ua->cv);
+	nni_mtx_unlock(&ua->mtx);
+}
+
+void
+nni_posix_uaccept_init(nni_posix_uaccept *ua, nni_posix_uring *r, int fd,
+    void (*cb)(void *), void *arg)
+{
+	ua->ring   = r;
+	ua->fd     = fd;
+	ua->op.cb  = uaccept_cb;
+	ua->op.arg = ua;
+	ua->armed  = false;
+	ua->closed = false;
+	ua->busy   = 0;
+	ua->err    = 0;
+	ua->fds    = NULL;
+	ua->nfds   = 0;
+	ua->cap    = 0;
+	ua->cb     = cb;
+	ua->arg    = arg;
+	nni_mtx_init(&ua->mtx);
+	nni_cv_init(&ua->cv, &ua->mtx);
+}
+
+void
+nni_posix_uaccept_close(nni_posix_uaccept *ua)
+{
+	nni_mtx_lock(&ua->mtx);
+	if (!ua->closed) {
+		ua->closed = true;
+		if (ua->armed) {
+			nni_posix_uring_cancel(ua->ring, &ua->op);
+		}
+		for (unsigned i = 0; i < ua->nfds; i++) {
+			(void) close(ua->fds[i]);
+		}
+		ua->nfds = 0;
+	}
+	nni_mtx_unlock(&ua->mtx);
+}
+
+void
+nni_posix_uaccept_fini(nni_posix_uaccept *ua)
+{
+	nni_posix_uaccept_close(ua);
+	nni_mtx_lock(&ua->mtx);
+	while (ua->armed || (ua->busy > 0)) {
+		nni_cv_wait(&ua->cv);
+	}
+	nni_mtx_unlock(&ua->mtx);
+	if (ua->fds != NULL) {
+		nni_free(ua->fds, ua->cap * sizeof(int));
+	}
+	nni_cv_fini(&ua->cv);
+	nni_mtx_fini(&ua->mtx);
+}
+
+// nni_posix_uaccept_next takes an accepted connection.  If there is none
+// yet it returns NNG_EAGAIN, and the callback runs when there is.
+int
+nni_posix_uaccept_next(nni_posix_uaccept *ua, int *fdp)
+{
+	int rv;
+
+	nni_mtx_lock(&ua->mtx);
+	if (ua->nfds > 0) {
+		*fdp = ua->fds[0];
+		ua->nfds--;
+		memmove(ua->fds, ua->fds + 1, ua->nfds * sizeof(int));
+		rv = 0;
+	} else if (ua->err != 0) {
+		rv      = ua->err;
+		ua->err = 0;
+	} else if (ua->closed) {
+		rv = NNG_ECLOSED;
+	} else {
+		if (!ua->armed) {
+			uaccept_arm(ua);
+		}
+		rv = NNG_EAGAIN;
+	}
+	nni_mtx_unlock(&ua->mtx);
+	return (rv);
+}
+
+#endif // NNG_HAVE_IO_URING
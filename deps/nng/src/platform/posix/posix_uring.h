@@ -0,0 +1,115 @@
+//
+// Copyright 2024 Staysail Systems, Inc. <info@staysail.tech>
+//
+// This software is supplied under the terms of the MIT License, a
+// copy of which should be located in the distribution where this
+// file was obtained (LICENSE.txt).  A copy of the license may also be
+// found online at https://opensource.org/licenses/MIT.
+//
+
+#ifndef PLATFORM_POSIX_URING_H
+#define PLATFORM_POSIX_URING_H
+
+#ifdef NNG_HAVE_IO_URING
+
+// On Linux, TCP and IPC connections and listeners can do their I/O with
+// io_uring instead of the poller (see NNG_INIT_IO_URING).  Reads, writes,
+// and accepts are then submitted to the kernel as requests, and their
+// results come back on the ring thread, so there is no readiness
+// notification, re-arm, or separate readv/sendmsg for each transfer.
+// See posix_uring.c for the details.
+
+#include "core/nng_impl.h"
+
+#include <linux/io_uring.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+typedef struct nni_posix_uring    nni_posix_uring;
+typedef struct nni_posix_uring_op nni_posix_uring_op;
+
+// Completion callbacks run on the ring thread, with the result and the
+// flags of the completion.
+typedef void (*nni_posix_uring_cb)(nni_posix_uring_op *, int, unsigned);
+
+// A request in the kernel is identified by its op, which must stay put
+// until the last completion for it has been delivered.
+struct nni_posix_uring_op {
+	nni_posix_uring_cb cb;
+	void              *arg;
+};
+
+// nni_posix_ustream carries the stream transfers of one connection.  It
+// uses the connection's own lock and aio queues; the first aio of each
+// queue is the one in the kernel.  All of the functions below are called
+// with that lock held, except for init and fini.
+typedef struct {
+	nni_posix_uring   *ring;
+	int                fd;
+	nni_mtx           *mtx;
+	nni_list          *readq;
+	nni_list          *writeq;
+	nni_cv             cv;   // signaled when a transfer leaves the kernel
+	nni_posix_uring_op rop;  // the read
+	nni_posix_uring_op wop;  // the write
+	nni_aio           *raio;  // the read is for this aio, if any
+	nni_aio           *waio;  // the write is for this aio, if any
+	bool               rbusy; // the read is in the kernel
+	bool               wbusy; // the write is in the kernel
+	int                wres;  // result of a write waiting for its notif
+	bool               wzc;  // the write is zerocopy
+	bool               closed;
+	size_t             zc_min; // zerocopy writes of at least this size
+	struct msghdr      whdr;
+	struct iovec       wiov[16];
+	struct iovec       riov[16];
+	uint8_t           *rbuf; // registered receive buffer
+	size_t             rlen;
+	int                ridx; // its index in the ring, or -1
+} nni_posix_ustream;
+
+// nni_posix_uaccept accepts connections for a listener.  It has a lock
+// of its own, which nests inside the listener's.
+typedef struct {
+	nni_posix_uring   *ring;
+	int                fd;
+	nni_posix_uring_op op;
+	nni_mtx            mtx;
+	nni_cv             cv;
+	bool               armed;  // accept in the kernel
+	bool               closed; // no more accepts
+	int                busy;   // callbacks running
+	int                err;    // to report to the next accept
+	int               *fds;    // accepted, nobody has taken them yet
+	unsigned           nfds;
+	unsigned           cap;
+	void (*cb)(void *);        // there is something to take
+	void *arg;
+} nni_posix_uaccept;
+
+extern bool nni_posix_uring_sysinit(int);
+extern void nni_posix_uring_sysfini(void);
+
+// nni_posix_uring_get returns a ring for a new connection or listener,
+// or NULL if io_uring is not in use.
+extern nni_posix_uring *nni_posix_uring_get(void);
+
+extern void nni_posix_ustream_init(nni_posix_ustream *, nni_posix_uring *,
+    int, nni_mtx *, nni_list *, nni_list *);
+extern void nni_posix_ustream_fini(nni_posix_ustream *);
+extern void nni_posix_ustream_recv(nni_posix_ustream *);
+extern void nni_posix_ustream_send(nni_posix_ustream *);
+extern void nni_posix_ustream_cancel(nni_posix_ustream *, nni_aio *);
+extern void nni_posix_ustream_close(nni_posix_ustream *, int);
+extern int  nni_posix_ustream_recv_buffer(
+     nni_posix_ustream *, const void *, size_t, nni_type);
+
+extern void nni_posix_uaccept_init(nni_posix_uaccept *, nni_posix_uring *,
+    int, void (*)(void *), void *);
+extern void nni_posix_uaccept_fini(nni_posix_uaccept *);
+extern int  nni_posix_uaccept_next(nni_posix_uaccept *, int *);
+extern void nni_posix_uaccept_close(nni_posix_uaccept *);
+
+#endif // NNG_HAVE_IO_URING
+
+#endif // PLATFORM_POSIX_URING_H
@@ -0,0 +1,447 @@
+//
+// Copyright 2024 Staysail Systems, Inc. <info@staysail.tech>
+//
+// This software is supplied under the terms of the MIT License, a
+// copy of which should be located in the distribution where this
+// file was obtained (LICENSE.txt).  A copy of the license may also be
+// found online at https://opensource.org/licenses/MIT.
+//
+
+#include "core/nng_impl.h"
+
+#include <nuts.h>
+
+uint64_t nni_init_get_effective(nng_init_parameter p);
+
+// io_uring tests.  Each restarts the library with io_uring on (or off, to
+// compare), and skips the rest if the kernel will not let us have it.
+
+static bool
+uring_restart(bool on)
+{
+	nng_fini();
+	nng_init_set_parameter(NNG_INIT_IO_URING, on ? 1 : 0);
+	NUTS_PASS(nni_init());
+	if (nni_init_get_effective(NNG_INIT_IO_URING) != (on ? 1u : 0u)) {
+		NUTS_MSG("io_uring not available");
+		return (false);
+	}
+	return (true);
+}
+
+typedef struct {
+	nng_stream_listener *l;
+	nng_stream_dialer   *d;
+	nng_aio             *raio;
+	nng_aio             *saio;
+	nng_stream          *c1; // dialed
+	nng_stream          *c2; // accepted
+} uring_pair;
+
+static void
+uring_connect(uring_pair *p, const char *scheme)
+{
+	char  url[64];
+	char *addr;
+	int   port;
+
+	NUTS_PASS(nng_aio_alloc(&p->raio, NULL, NULL));
+	NUTS_PASS(nng_aio_alloc(&p->saio, NULL, NULL));
+	nng_aio_set_timeout(p->raio, 5000);
+	nng_aio_set_timeout(p->saio, 5000);
+	if (strcmp(scheme, "tcp") == 0) {
+		NUTS_PASS(
+		    nng_stream_listener_alloc(&p->l, "tcp://127.0.0.1:0"));
+		NUTS_PASS(nng_stream_listener_listen(p->l));
+		NUTS_PASS(nng_stream_listener_get_int(
+		    p->l, NNG_OPT_TCP_BOUND_PORT, &port));
+		(void) snprintf(url, sizeof(url), "tcp://127.0.0.1:%d", port);
+		addr = url;
+	} else {
+		NUTS_ADDR(addr, scheme);
+		NUTS_PASS(nng_stream_listener_alloc(&p->l, addr));
+		NUTS_PASS(nng_stream_listener_listen(p->l));
+	}
+	NUTS_PASS(nng_stream_dialer_alloc(&p->d, addr));
+
+	nng_stream_listener_accept(p->l, p->raio);
+	nng_stream_dialer_dial(p->d, p->saio);
+	nng_aio_wait(p->saio);
+	nng_aio_wait(p->raio);
+	NUTS_PASS(nng_aio_result(p->saio));
+	NUTS_PASS(nng_aio_result(p->raio));
+	p->c1 = nng_aio_get_output(p->saio, 0);
+	p->c2 = nng_aio_get_output(p->raio, 0);
+}
+
+static void
+uring_disconnect(uring_pair *p)
+{
+	nng_stream_free(p->c1);
+	nng_stream_free(p->c2);
+	nng_stream_dialer_free(p->d);
+	nng_stream_listener_free(p->l);
+	nng_aio_free(p->saio);
+	nng_aio_free(p->raio);
+}
+
+// Send all of sbuf over c1 while receiving it over c2.
+static void
+uring_xfer(uring_pair *p, const char *sbuf, char *rbuf, size_t len)
+{
+	size_t sent = 0;
+	size_t rcvd = 0;
+	bool   sbusy = false;
+	bool   rbusy = false;
+
+	while ((sent < len) || (rcvd < len) || sbusy || rbusy) {
+		nng_iov iov;
+
+		if ((!sbusy) && (sent < len)) {
+			iov.iov_buf = (char *) sbuf + sent;
+			iov.iov_len = len - sent;
+			NUTS_PASS(nng_aio_set_iov(p->saio, 1, &iov));
+			nng_stream_send(p->c1, p->saio);
+			sbusy = true;
+		}
+		if ((!rbusy) && (rcvd < len)) {
+			iov.iov_buf = rbuf + rcvd;
+			iov.iov_len = len - rcvd;
+			NUTS_PASS(nng_aio_set_iov(p->raio, 1, &iov));
+			nng_stream_recv(p->c2, p->raio);
+			rbusy = true;
+		}
+		if (rbusy) {
+			nng_aio_wait(p->raio);
+			NUTS_PASS(nng_aio_result(p->raio));
+			rcvd += nng_aio_count(p->raio);
+			rbusy = false;
+		}
+		if (sbusy && ((rcvd == len) || !nng_aio_busy(p->saio))) {
+			nng_aio_wait(p->saio);
+			NUTS_PASS(nng_aio_result(p->saio));
+			sent += nng_aio_count(p->saio);
+			sbusy = false;
+		}
+	}
+	NUTS_TRUE(memcmp(sbuf, rbuf, len) == 0);
+}
+
+static void
+uring_check_xfer(const char *scheme)
+{
+	uring_pair p;
+	size_t     big = 4 * 1024 * 1024;
+	char      *sbuf;
+	char      *rbuf;
+
+	if (!uring_restart(true)) {
+		return;
+	}
+	NUTS_ASSERT((sbuf = nni_alloc(big)) != NULL);
+	NUTS_ASSERT((rbuf = nni_alloc(big)) != NULL);
+	for (size_t i = 0; i < big; i++) {
+		sbuf[i] = (char) (i * 7);
+	}
+	uring_connect(&p, scheme);
+	uring_xfer(&p, "hello", rbuf, 5);
+	uring_xfer(&p, sbuf, rbuf, big);
+	uring_disconnect(&p);
+	nni_free(sbuf, big);
+	nni_free(rbuf, big);
+	nng_fini();
+}
+
+void
+test_uring_tcp_xfer(void)
+{
+	uring_check_xfer("tcp");
+}
+
+void
+test_uring_ipc_xfer(void)
+{
+	uring_check_xfer("ipc");
+}
+
+// Connections that arrive before anyone accepts are held (more than the
+// listener keeps ahead of the callers), and none are lost.
+void
+test_uring_accept_backlog(void)
+{
+	enum { NCONN = 40 };
+	nng_stream_listener *l;
+	nng_stream_dialer   *d;
+	nng_aio             *aio;
+	nng_stream          *c[NCONN];
+	char                 url[64];
+	int                  port;
+
+	if (!uring_restart(true)) {
+		return;
+	}
+	NUTS_PASS(nng_aio_alloc(&aio, NULL, NULL));
+	nng_aio_set_timeout(aio, 5000);
+	NUTS_PASS(nng_stream_listener_alloc(&l, "tcp://127.0.0.1:0"));
+	NUTS_PASS(nng_stream_listener_listen(l));
+	NUTS_PASS(
+	    nng_stream_listener_get_int(l, NNG_OPT_TCP_BOUND_PORT, &port));
+	(void) snprintf(url, sizeof(url), "tcp://127.0.0.1:%d", port);
+	NUTS_PASS(nng_stream_dialer_alloc(&d, url));
+
+	// Prime the accept, so that it is in the kernel.
+	nng_stream_listener_accept(l, aio);
+	nng_aio_cancel(aio);
+	nng_aio_wait(aio);
+	NUTS_FAIL(nng_aio_result(aio), NNG_ECANCELED);
+
+	for (int i = 0; i < NCONN; i++) {
+		nng_stream_dialer_dial(d, aio);
+		nng_aio_wait(aio);
+		NUTS_PASS(nng_aio_result(aio));
+		c[i] = nng_aio_get_output(aio, 0);
+	}
+	for (int i = 0; i < NCONN; i++) {
+		nng_stream_listener_accept(l, aio);
+		nng_aio_wait(aio);
+		NUTS_PASS(nng_aio_result(aio));
+		nng_stream_free(nng_aio_get_output(aio, 0));
+		nng_stream_free(c[i]);
+	}
+	nng_stream_dialer_free(d);
+	nng_stream_listener_free(l);
+	nng_aio_free(aio);
+	nng_fini();
+}
+
+// Receives waiting in the kernel fail as soon as they are canceled or
+// closed, as the kernel has let go of their buffers by then.
+void
+test_uring_recv_abort(void)
+{
+	uring_pair p;
+	nng_iov    iov;
+	char       buf[8];
+
+	if (!uring_restart(true)) {
+		return;
+	}
+	uring_connect(&p, "tcp");
+	iov.iov_buf = buf;
+	iov.iov_len = sizeof(buf);
+	NUTS_PASS(nng_aio_set_iov(p.raio, 1, &iov));
+
+	nng_stream_recv(p.c2, p.raio);
+	nng_msleep(20);
+	nng_aio_cancel(p.raio);
+	nng_aio_wait(p.raio);
+	NUTS_FAIL(nng_aio_result(p.raio), NNG_ECANCELED);
+
+	// The connection is still good after that.
+	uring_xfer(&p, "again", buf, 5);
+
+	// Freeing the aio stops it, and the buffer may go with it, as when
+	// a transport closes a pipe.
+	NUTS_PASS(nng_aio_set_iov(p.saio, 1, &iov));
+	nng_stream_recv(p.c1, p.saio);
+	nng_msleep(20);
+	nng_aio_free(p.saio);
+	p.saio = NULL;
+
+	NUTS_PASS(nng_aio_set_iov(p.raio, 1, &iov));
+	nng_stream_recv(p.c2, p.raio);
+	nng_msleep(20);
+	nng_stream_close(p.c2);
+	nng_aio_wait(p.raio);
+	NUTS_FAIL(nng_aio_result(p.raio), NNG_ECLOSED);
+
+	uring_disconnect(&p);
+	nng_fini();
+}
+
+// An IPC peer that sends and then closes at once must not lose the data.
+void
+test_uring_ipc_close(void)
+{
+	if (!uring_restart(true)) {
+		return;
+	}
+	for (int i = 0; i < 50; i++) {
+		uring_pair p;
+		nng_iov    iov;
+		char       buf[8];
+
+		uring_connect(&p, "ipc");
+		iov.iov_buf = buf;
+		iov.iov_len = sizeof(buf);
+		NUTS_PASS(nng_aio_set_iov(p.raio, 1, &iov));
+		nng_stream_recv(p.c2, p.raio);
+
+		iov.iov_buf = "hello";
+		iov.iov_len = 5;
+		NUTS_PASS(nng_aio_set_iov(p.saio, 1, &iov));
+		nng_stream_send(p.c1, p.saio);
+		nng_aio_wait(p.saio);
+		NUTS_PASS(nng_aio_result(p.saio));
+		nng_stream_free(p.c1);
+		p.c1 = NULL;
+
+		nng_aio_wait(p.raio);
+		NUTS_PASS(nng_aio_result(p.raio));
+		NUTS_TRUE(nng_aio_count(p.raio) == 5);
+		NUTS_TRUE(memcmp(buf, "hello", 5) == 0);
+
+		iov.iov_buf = buf;
+		iov.iov_len = sizeof(buf);
+		NUTS_PASS(nng_aio_set_iov(p.raio, 1, &iov));
+		nng_stream_recv(p.c2, p.raio);
+		nng_aio_wait(p.raio);
+		NUTS_FAIL(nng_aio_result(p.raio), NNG_ECONNSHUT);
+		uring_disconnect(&p);
+	}
+	nng_fini();
+}
+
+// Receives into a registered buffer, in whole or in part, and elsewhere.
+void
+test_uring_recv_buffer(void)
+{
+	uring_pair p;
+	nni_iov    reg;
+	char       buf[64];
+	char       other[8];
+
+	reg.iov_buf = buf;
+	reg.iov_len = sizeof(buf);
+
+	// Without io_uring, the option is not there.
+	(void) uring_restart(false);
+	uring_connect(&p, "tcp");
+	NUTS_FAIL(nni_stream_set(p.c2, NNI_OPT_RECV_BUFFER, &reg,
+	              sizeof(reg), NNI_TYPE_OPAQUE),
+	    NNG_ENOTSUP);
+	uring_disconnect(&p);
+
+	if (!uring_restart(true)) {
+		return;
+	}
+	uring_connect(&p, "tcp");
+	NUTS_FAIL(nni_stream_set(p.c2, NNI_OPT_RECV_BUFFER, &reg, 1,
+	              NNI_TYPE_OPAQUE),
+	    NNG_EINVAL);
+	NUTS_FAIL(nni_stream_set(p.c2, NNI_OPT_RECV_BUFFER, &reg,
+	              sizeof(reg), NNI_TYPE_INT32),
+	    NNG_EBADTYPE);
+	NUTS_PASS(nni_stream_set(p.c2, NNI_OPT_RECV_BUFFER, &reg,
+	    sizeof(reg), NNI_TYPE_OPAQUE));
+	uring_xfer(&p, "0123456789abcdef", buf, 16);
+	uring_xfer(&p, "registered", buf + 40, 10);
+	uring_xfer(&p, "plain", other, 5);
+	uring_disconnect(&p);
+	nng_fini();
+}
+
+// Zerocopy writes finish once the kernel is done with the data.
+void
+test_uring_zerocopy(void)
+{
+	uring_pair p;
+	size_t     big = 1024 * 1024;
+	size_t     zc  = 64 * 1024;
+	char      *sbuf;
+	char      *rbuf;
+
+	if (!uring_restart(true)) {
+		return;
+	}
+	NUTS_ASSERT((sbuf = nni_alloc(big)) != NULL);
+	NUTS_ASSERT((rbuf = nni_alloc(big)) != NULL);
+	memset(sbuf, 'Z', big);
+	uring_connect(&p, "tcp");
+	NUTS_PASS(nng_stream_set_size(p.c1, NNG_OPT_TCP_ZEROCOPY, zc));
+	for (int i = 0; i < 8; i++) {
+		sbuf[i] = (char) i;
+		uring_xfer(&p, sbuf, rbuf, big);
+	}
+	uring_xfer(&p, "small", rbuf, 5);
+	uring_disconnect(&p);
+	nni_free(sbuf, big);
+	nni_free(rbuf, big);
+	nng_fini();
+}
+
+// Messages per second through a pair of sockets, with and without
+// io_uring, for comparison.
+static void
+uring_bench(bool on, const char *scheme)
+{
+	enum { COUNT = 20000, SIZE = 128 };
+	nng_socket   s1;
+	nng_socket   s2;
+	nng_listener l;
+	char        *addr;
+	char         url[64];
+	int          port;
+	char         buf[SIZE];
+	uint64_t     t0, t1;
+
+	if (!uring_restart(on)) {
+		return;
+	}
+	NUTS_PASS(nng_pair1_open(&s1));
+	NUTS_PASS(nng_pair1_open(&s2));
+	NUTS_PASS(nng_socket_set_ms(s1, NNG_OPT_SENDTIMEO, 5000));
+	NUTS_PASS(nng_socket_set_ms(s2, NNG_OPT_RECVTIMEO, 5000));
+	if (strcmp(scheme, "tcp") == 0) {
+		NUTS_PASS(nng_listen(s2, "tcp://127.0.0.1:0", &l, 0));
+		NUTS_PASS(
+		    nng_listener_get_int(l, NNG_OPT_TCP_BOUND_PORT, &port));
+		(void) snprintf(url, sizeof(url), "tcp://127.0.0.1:%d", port);
+		addr = url;
+	} else {
+		NUTS_ADDR(addr, scheme);
+		NUTS_PASS(nng_listen(s2, addr, NULL, 0));
+	}
+	NUTS_PASS(nng_dial(s1, addr, NULL, 0));
+	memset(buf, 'U', sizeof(buf));
+
+	NUTS_CLOCK(t0);
+	for (int i = 0; i < COUNT; i++) {
+		size_t sz = sizeof(buf);
+		NUTS_PASS(nng_send(s1, buf, SIZE, 0));
+		NUTS_PASS(nng_recv(s2, buf, &sz, 0));
+		NUTS_ASSERT(sz == SIZE);
+	}
+	NUTS_CLOCK(t1);
+	NUTS_CLOSE(s1);
+	NUTS_CLOSE(s2);
+	if (t1 == t0) {
+		t1++;
+	}
+	printf("  %s, %s: %d x %d bytes ping-pong, %u ms, %u msgs/s\n",
+	    scheme, on ? "io_uring" : "epoll", COUNT, SIZE,
+	    (unsigned) (t1 - t0),
+	    (unsigned) ((uint64_t) COUNT * 1000 / (t1 - t0)));
+	nng_fini();
+}
+
+void
+test_uring_throughput(void)
+{
+	uring_bench(false, "tcp");
+	uring_bench(true, "tcp");
+	uring_bench(false, "ipc");
+	uring_bench(true, "ipc");
+}
+
+NUTS_TESTS = {
+	{ "uring tcp transfer", test_uring_tcp_xfer },
+	{ "uring ipc transfer", test_uring_ipc_xfer },
+	{ "uring accept backlog", test_uring_accept_backlog },
+	{ "uring recv abort", test_uring_recv_abort },
+	{ "uring ipc close", test_uring_ipc_close },
+	{ "uring recv buffer", test_uring_recv_buffer },
+	{ "uring zerocopy", test_uring_zerocopy },
+	{ "uring throughput", test_uring_throughput },
+	{ NULL, NULL },
+};
@@ -381,6 +381,27 @@ tcp_dialer_set_locaddr(void *arg, const void *buf, size_t sz, nni_type t)
 	return (0);
 }
 
+// Windows has no equivalent of MSG_ZEROCOPY for these sockets.
+static int
+tcp_dialer_set_zerocopy(void *arg, const void *buf, size_t sz, nni_type t)
+{
+	int    rv;
+	size_t val;
+
+	NNI_ARG_UNUSED(arg);
+	if ((rv = nni_copyin_size(&val, buf, sz, 0, NNI_MAXSZ, t)) != 0) {
+		return (rv);
+	}
+	return (val != 0 ? NNG_ENOTSUP : 0);
+}
+
+static int
+tcp_dialer_get_zerocopy(void *arg, void *buf, size_t *szp, nni_type t)
+{
+	NNI_ARG_UNUSED(arg);
+	return (nni_copyout_size(0, buf, szp, t));
+}
+
 static const nni_option tcp_dialer_options[] = {
 	{
 	    .o_name = NNG_OPT_LOCADDR,
@@ -397,6 +418,11 @@ static const nni_option tcp_dialer_options[] = {
 	    .o_get  = tcp_dialer_get_keepalive,
 	    .o_set  = tcp_dialer_set_keepalive,
 	},
+	{
+	    .o_name = NNG_OPT_TCP_ZEROCOPY,
+	    .o_get  = tcp_dialer_get_zerocopy,
+	    .o_set  = tcp_dialer_set_zerocopy,
+	},
 	{
 	    .o_name = NULL,
 	},
@@ -469,6 +469,48 @@ tcp_listener_get_keepalive(void *arg, void *buf, size_t *szp, nni_type t)
 	return (nni_copyout_bool(b, buf, szp, t));
 }
 
+// Windows has no SO_REUSEPORT; SO_REUSEADDR there means something else.
+static int
+tcp_listener_set_reuseport(void *arg, const void *buf, size_t sz, nni_type t)
+{
+	int  rv;
+	bool b;
+
+	NNI_ARG_UNUSED(arg);
+	if ((rv = nni_copyin_bool(&b, buf, sz, t)) != 0) {
+		return (rv);
+	}
+	return (b ? NNG_ENOTSUP : 0);
+}
+
+static int
+tcp_listener_get_reuseport(void *arg, void *buf, size_t *szp, nni_type t)
+{
+	NNI_ARG_UNUSED(arg);
+	return (nni_copyout_bool(false, buf, szp, t));
+}
+
+// Windows has no equivalent of MSG_ZEROCOPY for these sockets.
+static int
+tcp_listener_set_zerocopy(void *arg, const void *buf, size_t sz, nni_type t)
+{
+	int    rv;
+	size_t val;
+
+	NNI_ARG_UNUSED(arg);
+	if ((rv = nni_copyin_size(&val, buf, sz, 0, NNI_MAXSZ, t)) != 0) {
+		return (rv);
+	}
+	return (val != 0 ? NNG_ENOTSUP : 0);
+}
+
+static int
+tcp_listener_get_zerocopy(void *arg, void *buf, size_t *szp, nni_type t)
+{
+	NNI_ARG_UNUSED(arg);
+	return (nni_copyout_size(0, buf, szp, t));
+}
+
 static const nni_option tcp_listener_options[] = {
 	{
 	    .o_name = NNG_OPT_LOCADDR,
@@ -484,6 +526,16 @@ static const nni_option tcp_listener_options[] = {
 	    .o_set  = tcp_listener_set_keepalive,
 	    .o_get  = tcp_listener_get_keepalive,
 	},
+	{
+	    .o_name = NNG_OPT_TCP_REUSEPORT,
+	    .o_set  = tcp_listener_set_reuseport,
+	    .o_get  = tcp_listener_get_reuseport,
+	},
+	{
+	    .o_name = NNG_OPT_TCP_ZEROCOPY,
+	    .o_set  = tcp_listener_set_zerocopy,
+	    .o_get  = tcp_listener_get_zerocopy,
+	},
 	{
 	    .o_name = NULL,
 	},
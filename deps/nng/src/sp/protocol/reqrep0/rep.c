@@ -513,7 +513,7 @@ rep0_pipe_recv_cb(void *arg)
 			nni_pipe_close(p->pipe);
 			return;
 		}
-		body = nni_msg_body(msg);
+		body = nni_msg_peek(msg, 4);
 		end  = ((body[0] & 0x80u) != 0);
 		if (nni_msg_header_append(msg, body, 4) != 0) {
 			// Out of memory, so drop it.
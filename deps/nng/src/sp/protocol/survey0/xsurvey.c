@@ -249,7 +249,7 @@ xsurv0_recv_cb(void *arg)
 			nni_pipe_close(p->npipe);
 			return;
 		}
-		body = nni_msg_body(msg);
+		body = nni_msg_peek(msg, sizeof(uint32_t));
 		end  = ((body[0] & 0x80u) != 0);
 
 		if (nni_msg_header_append(msg, body, sizeof(uint32_t)) != 0) {
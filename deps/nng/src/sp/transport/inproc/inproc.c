@@ -16,6 +16,19 @@
 // Inproc transport.  This just transports messages from one
 // peer to another.  The inproc transport is only valid within the same
 // process.
+//
+// By default a message is handed straight from a sender to a waiting
+// receiver, so the sender waits for the receiver, and both take the
+// queue lock for every message.  With NNG_OPT_INPROC_BUFFER, each queue
+// instead has a ring of messages.  The protocols never have more than
+// one send, or one receive, outstanding on a pipe, so each ring has
+// just one producer and one consumer, and they pass messages through
+// it without taking the lock.  The lock is only needed when one side
+// has to wait: a receiver when the ring is empty, or a sender when it
+// is full.  Much as with the task queues, a side announces that it is
+// waiting before looking at the ring one last time, and the other side
+// looks for waiters after it has moved a message.  Either the waiter
+// sees the message (or the room), or the other side sees the waiter.
 
 typedef struct inproc_pair  inproc_pair;
 typedef struct inproc_pipe  inproc_pipe;
@@ -38,10 +51,18 @@ struct inproc_pipe {
 };
 
 struct inproc_queue {
-	nni_list readers;
-	nni_list writers;
-	nni_mtx  lock;
-	bool     closed;
+	nni_list        readers;
+	nni_list        writers;
+	nni_mtx         lock;
+	bool            closed;
+	nni_msg       **ring; // NULL unless buffered
+	size_t          ring_cap;
+	size_t          ring_mask; // allocated size less one, a power of 2
+	nni_atomic_u64  ring_put;  // only moved by the sender
+	nni_atomic_u64  ring_get;  // only moved by the receiver
+	nni_atomic_bool ring_closed;
+	nni_atomic_bool rd_wait; // readers is not empty
+	nni_atomic_bool wr_wait; // writers is not empty
 };
 
 // inproc_pair represents a pair of pipes.  Because we control both
@@ -60,6 +81,7 @@ struct inproc_ep {
 	nni_list      clients;
 	nni_list      aios;
 	size_t        rcvmax;
+	int           bufsz;
 	nni_mtx       mtx;
 };
 
@@ -86,11 +108,68 @@ static void
 inproc_pair_destroy(inproc_pair *pair)
 {
 	for (int i = 0; i < 2; i++) {
-		nni_mtx_fini(&pair->queues[i].lock);
+		inproc_queue *queue = &pair->queues[i];
+		if (queue->ring != NULL) {
+			// Toss whatever the receiver did not get to.
+			uint64_t get = nni_atomic_get64(&queue->ring_get);
+			uint64_t put = nni_atomic_get64(&queue->ring_put);
+			while (get != put) {
+				nni_msg_free(
+				    queue->ring[get & queue->ring_mask]);
+				get++;
+			}
+			nni_free(queue->ring,
+			    sizeof(nni_msg *) * (queue->ring_mask + 1));
+		}
+		nni_mtx_fini(&queue->lock);
 	}
 	NNI_FREE_STRUCT(pair);
 }
 
+// inproc_pair_init sets up the queues, with rings if either end asked
+// for them.
+static int
+inproc_pair_init(inproc_pair *pair, inproc_ep *cli, inproc_ep *srv)
+{
+	size_t cap;
+	size_t alloc;
+	int    rv = 0;
+
+	nni_mtx_lock(&cli->mtx);
+	cap = (size_t) cli->bufsz;
+	nni_mtx_unlock(&cli->mtx);
+	nni_mtx_lock(&srv->mtx);
+	if ((size_t) srv->bufsz > cap) {
+		cap = (size_t) srv->bufsz;
+	}
+	nni_mtx_unlock(&srv->mtx);
+
+	alloc = 2;
+	while (alloc < cap) {
+		alloc *= 2;
+	}
+	for (int i = 0; i < 2; i++) {
+		inproc_queue *queue = &pair->queues[i];
+		nni_aio_list_init(&queue->readers);
+		nni_aio_list_init(&queue->writers);
+		nni_mtx_init(&queue->lock);
+		nni_atomic_init64(&queue->ring_put);
+		nni_atomic_init64(&queue->ring_get);
+		nni_atomic_init_bool(&queue->ring_closed);
+		nni_atomic_init_bool(&queue->rd_wait);
+		nni_atomic_init_bool(&queue->wr_wait);
+		if ((cap > 0) && (rv == 0)) {
+			queue->ring = nni_alloc(sizeof(nni_msg *) * alloc);
+			if (queue->ring == NULL) {
+				rv = NNG_ENOMEM;
+			}
+			queue->ring_cap  = cap;
+			queue->ring_mask = alloc - 1;
+		}
+	}
+	return (rv);
+}
+
 static int
 inproc_pipe_alloc(inproc_pipe **pipep, inproc_ep *ep)
 {
@@ -199,6 +278,135 @@ inproc_queue_cancel(nni_aio *aio, void *arg, int rv)
 	nni_mtx_unlock(&queue->lock);
 }
 
+// inproc_ring_run moves messages from waiting writers into the ring, and
+// from the ring to waiting readers.  This is called with the lock held,
+// whenever a reader or writer starts to wait, and by the other side when
+// it finds one waiting.  Nothing else touches the ring while a side is
+// waiting, except for that side's peer moving its own end.
+static void
+inproc_ring_run(inproc_queue *queue)
+{
+	if (queue->closed) {
+		inproc_queue_run_closed(queue);
+	}
+	nni_atomic_set_bool(&queue->rd_wait, !nni_list_empty(&queue->readers));
+	nni_atomic_set_bool(&queue->wr_wait, !nni_list_empty(&queue->writers));
+	for (;;) {
+		uint64_t get = nni_atomic_get64(&queue->ring_get);
+		uint64_t put = nni_atomic_get64(&queue->ring_put);
+		nni_aio *aio;
+		nni_msg *msg;
+
+		if (((aio = nni_list_first(&queue->writers)) != NULL) &&
+		    (put - get < queue->ring_cap)) {
+			// The message must be on the ring before the
+			// writer finishes, and can send again.
+			msg = nni_aio_get_msg(aio);
+			queue->ring[put & queue->ring_mask] = msg;
+			nni_atomic_set64(&queue->ring_put, put + 1);
+			nni_aio_list_remove(aio);
+			nni_aio_set_msg(aio, NULL);
+			nni_aio_finish(aio, 0, nni_msg_len(msg));
+		} else if (((aio = nni_list_first(&queue->readers)) != NULL) &&
+		    (get != put)) {
+			msg = queue->ring[get & queue->ring_mask];
+			nni_atomic_set64(&queue->ring_get, get + 1);
+			nni_aio_list_remove(aio);
+			nni_aio_set_msg(aio, msg);
+			nni_aio_finish(aio, 0, nni_msg_len(msg));
+		} else {
+			break;
+		}
+	}
+	nni_atomic_set_bool(&queue->rd_wait, !nni_list_empty(&queue->readers));
+	nni_atomic_set_bool(&queue->wr_wait, !nni_list_empty(&queue->writers));
+}
+
+// inproc_ring_wake runs the ring, if the peer is waiting on it.
+static void
+inproc_ring_wake(inproc_queue *queue, nni_atomic_bool *wait)
+{
+	if (nni_atomic_get_bool(wait)) {
+		nni_mtx_lock(&queue->lock);
+		inproc_ring_run(queue);
+		nni_mtx_unlock(&queue->lock);
+	}
+}
+
+static void
+inproc_ring_send(inproc_queue *queue, nni_aio *aio)
+{
+	nni_msg *msg = nni_aio_get_msg(aio);
+	nni_msg *pu;
+	uint64_t put;
+	int      rv;
+
+	// Do the receiver's pull up now, so that the ring only holds
+	// messages that are ready to go.  As with the unbuffered case, a
+	// message we cannot pull up is accounted as sent, and dropped.
+	if ((pu = nni_msg_pull_up(msg)) == NULL) {
+		nni_aio_set_msg(aio, NULL);
+		nni_aio_finish(
+		    aio, 0, nni_msg_len(msg) + nni_msg_header_len(msg));
+		nni_msg_free(msg);
+		return;
+	}
+	msg = pu;
+	nni_aio_set_msg(aio, msg);
+
+	put = nni_atomic_get64(&queue->ring_put);
+	if ((!nni_atomic_get_bool(&queue->ring_closed)) &&
+	    (put - nni_atomic_get64(&queue->ring_get) < queue->ring_cap)) {
+		queue->ring[put & queue->ring_mask] = msg;
+		nni_atomic_set64(&queue->ring_put, put + 1);
+		nni_aio_set_msg(aio, NULL);
+		nni_aio_finish(aio, 0, nni_msg_len(msg));
+		inproc_ring_wake(queue, &queue->rd_wait);
+		return;
+	}
+
+	// Full (or closed), so wait for room.
+	nni_mtx_lock(&queue->lock);
+	if ((rv = nni_aio_schedule(aio, inproc_queue_cancel, queue)) != 0) {
+		nni_mtx_unlock(&queue->lock);
+		nni_aio_finish_error(aio, rv);
+		return;
+	}
+	nni_aio_list_append(&queue->writers, aio);
+	inproc_ring_run(queue);
+	nni_mtx_unlock(&queue->lock);
+}
+
+static void
+inproc_ring_recv(inproc_queue *queue, nni_aio *aio)
+{
+	nni_msg *msg;
+	uint64_t get;
+	int      rv;
+
+	get = nni_atomic_get64(&queue->ring_get);
+	if ((!nni_atomic_get_bool(&queue->ring_closed)) &&
+	    (get != nni_atomic_get64(&queue->ring_put))) {
+		msg = queue->ring[get & queue->ring_mask];
+		nni_atomic_set64(&queue->ring_get, get + 1);
+		nni_aio_set_msg(aio, msg);
+		nni_aio_finish(aio, 0, nni_msg_len(msg));
+		inproc_ring_wake(queue, &queue->wr_wait);
+		return;
+	}
+
+	// Empty (or closed), so wait for a message.
+	nni_mtx_lock(&queue->lock);
+	if ((rv = nni_aio_schedule(aio, inproc_queue_cancel, queue)) != 0) {
+		nni_mtx_unlock(&queue->lock);
+		nni_aio_finish_error(aio, rv);
+		return;
+	}
+	nni_aio_list_append(&queue->readers, aio);
+	inproc_ring_run(queue);
+	nni_mtx_unlock(&queue->lock);
+}
+
 static void
 inproc_pipe_send(void *arg, nni_aio *aio)
 {
@@ -213,6 +421,10 @@ inproc_pipe_send(void *arg, nni_aio *aio)
 		nni_aio_set_msg(aio, NULL);
 		return;
 	}
+	if (queue->ring != NULL) {
+		inproc_ring_send(queue, aio);
+		return;
+	}
 
 	nni_mtx_lock(&queue->lock);
 	if ((rv = nni_aio_schedule(aio, inproc_queue_cancel, queue)) != 0) {
@@ -235,6 +447,10 @@ inproc_pipe_recv(void *arg, nni_aio *aio)
 	if (nni_aio_begin(aio) != 0) {
 		return;
 	}
+	if (queue->ring != NULL) {
+		inproc_ring_recv(queue, aio);
+		return;
+	}
 
 	nni_mtx_lock(&queue->lock);
 	if ((rv = nni_aio_schedule(aio, inproc_queue_cancel, queue)) != 0) {
@@ -257,6 +473,7 @@ inproc_pipe_close(void *arg)
 		inproc_queue *queue = &pair->queues[i];
 		nni_mtx_lock(&queue->lock);
 		queue->closed = true;
+		nni_atomic_set_bool(&queue->ring_closed, true);
 		inproc_queue_run_closed(queue);
 		nni_mtx_unlock(&queue->lock);
 	}
@@ -296,6 +513,7 @@ inproc_dialer_init(void **epp, nni_url *url, nni_dialer *ndialer)
 	ep->listener = false;
 	ep->proto    = nni_sock_proto_id(sock);
 	ep->rcvmax   = 0;
+	ep->bufsz    = 0;
 	NNI_LIST_INIT(&ep->clients, inproc_ep, node);
 	nni_aio_list_init(&ep->aios);
 
@@ -319,6 +537,7 @@ inproc_listener_init(void **epp, nni_url *url, nni_listener *nlistener)
 	ep->listener = true;
 	ep->proto    = nni_sock_proto_id(sock);
 	ep->rcvmax   = 0;
+	ep->bufsz    = 0;
 	NNI_LIST_INIT(&ep->clients, inproc_ep, node);
 	nni_aio_list_init(&ep->aios);
 
@@ -407,10 +626,11 @@ inproc_accept_clients(inproc_ep *srv)
 				    saio, NNG_ENOMEM, srv, NULL);
 				continue;
 			}
-			for (int i = 0; i < 2; i++) {
-				nni_aio_list_init(&pair->queues[i].readers);
-				nni_aio_list_init(&pair->queues[i].writers);
-				nni_mtx_init(&pair->queues[i].lock);
+			if ((rv = inproc_pair_init(pair, cli, srv)) != 0) {
+				inproc_conn_finish(caio, rv, cli, NULL);
+				inproc_conn_finish(saio, rv, srv, NULL);
+				inproc_pair_destroy(pair);
+				continue;
 			}
 			nni_atomic_init(&pair->ref);
 			nni_atomic_set(&pair->ref, 2);
@@ -580,6 +800,31 @@ inproc_ep_set_recvmaxsz(void *arg, const void *v, size_t sz, nni_opt_type t)
 	return (rv);
 }
 
+static int
+inproc_ep_get_buffer(void *arg, void *v, size_t *szp, nni_opt_type t)
+{
+	inproc_ep *ep = arg;
+	int        rv;
+	nni_mtx_lock(&ep->mtx);
+	rv = nni_copyout_int(ep->bufsz, v, szp, t);
+	nni_mtx_unlock(&ep->mtx);
+	return (rv);
+}
+
+static int
+inproc_ep_set_buffer(void *arg, const void *v, size_t sz, nni_opt_type t)
+{
+	inproc_ep *ep = arg;
+	int        val;
+	int        rv;
+	if ((rv = nni_copyin_int(&val, v, sz, 0, 8192, t)) == 0) {
+		nni_mtx_lock(&ep->mtx);
+		ep->bufsz = val;
+		nni_mtx_unlock(&ep->mtx);
+	}
+	return (rv);
+}
+
 static int
 inproc_ep_get_addr(void *arg, void *v, size_t *szp, nni_opt_type t)
 {
@@ -629,6 +874,11 @@ static const nni_option inproc_ep_options[] = {
 	    .o_get  = inproc_ep_get_recvmaxsz,
 	    .o_set  = inproc_ep_set_recvmaxsz,
 	},
+	{
+	    .o_name = NNG_OPT_INPROC_BUFFER,
+	    .o_get  = inproc_ep_get_buffer,
+	    .o_set  = inproc_ep_set_buffer,
+	},
 	{
 	    .o_name = NNG_OPT_LOCADDR,
 	    .o_get  = inproc_ep_get_addr,
@@ -0,0 +1,295 @@
+//
+// Copyright 2024 Staysail Systems, Inc. <info@staysail.tech>
+//
+// This software is supplied under the terms of the MIT License, a
+// copy of which should be located in the distribution where this
+// file was obtained (LICENSE.txt).  A copy of the license may also be
+// found online at https://opensource.org/licenses/MIT.
+//
+
+#include <nuts.h>
+
+// Inproc tests.
+
+static void
+test_inproc_buffer_option(void)
+{
+	nng_socket   s;
+	nng_listener l;
+	nng_dialer   d;
+	char        *addr;
+	int          v;
+	bool         b;
+
+	NUTS_ADDR(addr, "inproc");
+	NUTS_OPEN(s);
+	NUTS_PASS(nng_listener_create(&l, s, addr));
+	NUTS_PASS(nng_listener_get_int(l, NNG_OPT_INPROC_BUFFER, &v));
+	NUTS_TRUE(v == 0);
+	NUTS_PASS(nng_listener_set_int(l, NNG_OPT_INPROC_BUFFER, 64));
+	NUTS_PASS(nng_listener_get_int(l, NNG_OPT_INPROC_BUFFER, &v));
+	NUTS_TRUE(v == 64);
+	NUTS_FAIL(
+	    nng_listener_set_int(l, NNG_OPT_INPROC_BUFFER, -1), NNG_EINVAL);
+	NUTS_FAIL(nng_listener_set_int(l, NNG_OPT_INPROC_BUFFER, 1000000),
+	    NNG_EINVAL);
+	NUTS_FAIL(nng_listener_set_bool(l, NNG_OPT_INPROC_BUFFER, true),
+	    NNG_EBADTYPE);
+	NUTS_FAIL(nng_listener_get_bool(l, NNG_OPT_INPROC_BUFFER, &b),
+	    NNG_EBADTYPE);
+
+	NUTS_PASS(nng_dialer_create(&d, s, addr));
+	NUTS_PASS(nng_dialer_set_int(d, NNG_OPT_INPROC_BUFFER, 8));
+	NUTS_PASS(nng_dialer_get_int(d, NNG_OPT_INPROC_BUFFER, &v));
+	NUTS_TRUE(v == 8);
+	NUTS_CLOSE(s);
+}
+
+typedef struct {
+	nng_socket s;
+	int        count;
+	int        size;
+	int        rv;
+} inproc_sender;
+
+static void
+inproc_send_seq(void *arg)
+{
+	inproc_sender *snd = arg;
+	char           buf[256];
+
+	memset(buf, 0, sizeof(buf));
+	for (int i = 0; i < snd->count; i++) {
+		(void) snprintf(buf, sizeof(buf), "%d", i);
+		if ((snd->rv = nng_send(snd->s, buf, (size_t) snd->size, 0)) !=
+		    0) {
+			break;
+		}
+	}
+}
+
+static void
+test_inproc_buffered_send(void)
+{
+	enum { BUFSZ = 16, COUNT = 10000 };
+	inproc_sender snd;
+	nng_thread   *thr;
+	nng_socket    push;
+	nng_socket    pull;
+	nng_listener  l;
+	char         *addr;
+
+	NUTS_ADDR(addr, "inproc");
+	NUTS_PASS(nng_push0_open(&push));
+	NUTS_PASS(nng_pull0_open(&pull));
+	NUTS_PASS(nng_socket_set_ms(push, NNG_OPT_SENDTIMEO, 1000));
+	NUTS_PASS(nng_socket_set_ms(pull, NNG_OPT_RECVTIMEO, 5000));
+	NUTS_PASS(nng_listener_create(&l, pull, addr));
+	NUTS_PASS(nng_listener_set_int(l, NNG_OPT_INPROC_BUFFER, BUFSZ));
+	NUTS_PASS(nng_listener_start(l, 0));
+	NUTS_PASS(nng_dial(push, addr, NULL, 0));
+
+	// Without the buffer, the second of these would wait for a
+	// receive that never comes.
+	for (int i = 0; i < BUFSZ; i++) {
+		char buf[16];
+		(void) snprintf(buf, sizeof(buf), "%d", i);
+		NUTS_PASS(nng_send(push, buf, strlen(buf) + 1, 0));
+	}
+	for (int i = 0; i < BUFSZ; i++) {
+		char   buf[16];
+		char   num[16];
+		size_t sz = sizeof(buf);
+		NUTS_PASS(nng_recv(pull, buf, &sz, 0));
+		(void) snprintf(num, sizeof(num), "%d", i);
+		NUTS_MATCH(buf, num);
+	}
+
+	// Now stream, so that both sides wait on the ring at times.
+	snd.s     = push;
+	snd.count = COUNT;
+	snd.size  = 64;
+	snd.rv    = 0;
+	NUTS_PASS(nng_thread_create(&thr, inproc_send_seq, &snd));
+	for (int i = 0; i < COUNT; i++) {
+		nng_msg *msg;
+		char     num[16];
+		NUTS_PASS(nng_recvmsg(pull, &msg, 0));
+		NUTS_TRUE(nng_msg_len(msg) == 64);
+		(void) snprintf(num, sizeof(num), "%d", i);
+		NUTS_MATCH(nng_msg_body(msg), num);
+		nng_msg_free(msg);
+	}
+	nng_thread_destroy(thr);
+	NUTS_PASS(snd.rv);
+
+	// Messages still in the ring go away with the pipe.
+	for (int i = 0; i < BUFSZ / 2; i++) {
+		NUTS_SEND(push, "left");
+	}
+	NUTS_CLOSE(push);
+	NUTS_CLOSE(pull);
+}
+
+static void
+test_inproc_buffered_req_rep(void)
+{
+	nng_socket req;
+	nng_socket rep;
+	nng_dialer d;
+	char      *addr;
+
+	NUTS_ADDR(addr, "inproc");
+	NUTS_PASS(nng_req0_open(&req));
+	NUTS_PASS(nng_rep0_open(&rep));
+	NUTS_PASS(nng_socket_set_ms(req, NNG_OPT_RECVTIMEO, 1000));
+	NUTS_PASS(nng_socket_set_ms(rep, NNG_OPT_RECVTIMEO, 1000));
+	NUTS_PASS(nng_listen(rep, addr, NULL, 0));
+	NUTS_PASS(nng_dialer_create(&d, req, addr));
+	NUTS_PASS(nng_dialer_set_int(d, NNG_OPT_INPROC_BUFFER, 4));
+	NUTS_PASS(nng_dialer_start(d, 0));
+
+	for (int i = 0; i < 100; i++) {
+		NUTS_SEND(req, "ping");
+		NUTS_RECV(rep, "ping");
+		NUTS_SEND(rep, "pong");
+		NUTS_RECV(req, "pong");
+	}
+	NUTS_CLOSE(req);
+	NUTS_CLOSE(rep);
+}
+
+// Throughput of one or more pushers feeding one puller, each on its own
+// pipe and thread.
+static void
+inproc_bench_throughput(int nsend, int bufsz)
+{
+	enum { TOTAL = 100000, SIZE = 64 };
+	static inproc_sender snd[8];
+	nng_thread          *thr[8];
+	nng_socket           pull;
+	nng_listener         l;
+	char                *addr;
+	char                 buf[SIZE];
+	size_t               sz;
+	uint64_t             t0, t1;
+
+	NUTS_ASSERT(nsend <= 8);
+	NUTS_ADDR(addr, "inproc");
+	NUTS_PASS(nng_pull0_open(&pull));
+	NUTS_PASS(nng_socket_set_ms(pull, NNG_OPT_RECVTIMEO, 5000));
+	NUTS_PASS(nng_listener_create(&l, pull, addr));
+	NUTS_PASS(nng_listener_set_int(l, NNG_OPT_INPROC_BUFFER, bufsz));
+	NUTS_PASS(nng_listener_start(l, 0));
+	for (int i = 0; i < nsend; i++) {
+		NUTS_PASS(nng_push0_open(&snd[i].s));
+		NUTS_PASS(
+		    nng_socket_set_ms(snd[i].s, NNG_OPT_SENDTIMEO, 5000));
+		NUTS_PASS(nng_dial(snd[i].s, addr, NULL, 0));
+		snd[i].count = TOTAL / nsend;
+		snd[i].size  = SIZE;
+		snd[i].rv    = 0;
+	}
+
+	NUTS_CLOCK(t0);
+	for (int i = 0; i < nsend; i++) {
+		NUTS_PASS(
+		    nng_thread_create(&thr[i], inproc_send_seq, &snd[i]));
+	}
+	for (int i = 0; i < (TOTAL / nsend) * nsend; i++) {
+		sz = sizeof(buf);
+		NUTS_PASS(nng_recv(pull, buf, &sz, 0));
+		NUTS_ASSERT(sz == SIZE);
+	}
+	NUTS_CLOCK(t1);
+	for (int i = 0; i < nsend; i++) {
+		nng_thread_destroy(thr[i]);
+		NUTS_PASS(snd[i].rv);
+		NUTS_CLOSE(snd[i].s);
+	}
+	NUTS_CLOSE(pull);
+
+	if (t1 == t0) {
+		t1++;
+	}
+	printf("  %d sender(s), buffer %d: %u msgs/s\n", nsend, bufsz,
+	    (unsigned) ((uint64_t) TOTAL * 1000 / (t1 - t0)));
+}
+
+static void
+inproc_echo(void *arg)
+{
+	nng_socket rep = *(nng_socket *) arg;
+	nng_msg   *msg;
+
+	while (nng_recvmsg(rep, &msg, 0) == 0) {
+		if (nng_sendmsg(rep, msg, 0) != 0) {
+			nng_msg_free(msg);
+			break;
+		}
+	}
+}
+
+// Round trip latency of request/reply.
+static void
+inproc_bench_latency(int bufsz)
+{
+	enum { ROUNDS = 10000 };
+	nng_socket   req;
+	nng_socket   rep;
+	nng_listener l;
+	nng_thread  *thr;
+	char        *addr;
+	uint64_t     t0, t1;
+
+	NUTS_ADDR(addr, "inproc");
+	NUTS_PASS(nng_req0_open(&req));
+	NUTS_PASS(nng_rep0_open(&rep));
+	NUTS_PASS(nng_socket_set_ms(req, NNG_OPT_RECVTIMEO, 5000));
+	NUTS_PASS(nng_listener_create(&l, rep, addr));
+	NUTS_PASS(nng_listener_set_int(l, NNG_OPT_INPROC_BUFFER, bufsz));
+	NUTS_PASS(nng_listener_start(l, 0));
+	NUTS_PASS(nng_dial(req, addr, NULL, 0));
+	NUTS_PASS(nng_thread_create(&thr, inproc_echo, &rep));
+
+	NUTS_CLOCK(t0);
+	for (int i = 0; i < ROUNDS; i++) {
+		char   buf[64];
+		size_t sz = sizeof(buf);
+		memset(buf, 0, sizeof(buf));
+		NUTS_PASS(nng_send(req, buf, sizeof(buf), 0));
+		NUTS_PASS(nng_recv(req, buf, &sz, 0));
+	}
+	NUTS_CLOCK(t1);
+	NUTS_CLOSE(req);
+	NUTS_CLOSE(rep);
+	nng_thread_destroy(thr);
+
+	printf("  buffer %d: %u ns per round trip\n", bufsz,
+	    (unsigned) ((t1 - t0) * 1000000 / ROUNDS));
+}
+
+static void
+test_inproc_throughput(void)
+{
+	inproc_bench_throughput(1, 0);
+	inproc_bench_throughput(1, 64);
+	inproc_bench_throughput(8, 0);
+	inproc_bench_throughput(8, 64);
+}
+
+static void
+test_inproc_latency(void)
+{
+	inproc_bench_latency(0);
+	inproc_bench_latency(64);
+}
+
+NUTS_TESTS = {
+	{ "inproc buffer option", test_inproc_buffer_option },
+	{ "inproc buffered send", test_inproc_buffered_send },
+	{ "inproc buffered req rep", test_inproc_buffered_req_rep },
+	{ "inproc throughput", test_inproc_throughput },
+	{ "inproc latency", test_inproc_latency },
+	{ NULL, NULL },
+};
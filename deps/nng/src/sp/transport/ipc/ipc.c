@@ -10,6 +10,7 @@
 //
 
 #include <stdio.h>
+#include <string.h>
 
 #include "core/nng_impl.h"
 
@@ -20,6 +21,14 @@
 // Windows named pipes.  Other platforms could use other mechanisms,
 // but all implementations on the platform must use the same mechanism.
 
+// Received data is read into a buffer, as much as is available, and
+// messages are carved out of that.  A message with a body larger than
+// IPC_RX_COPY bytes is not waited for in the buffer; the rest of its body
+// is read directly into the message instead.
+#define IPC_RX_BUF_SIZE 65536
+#define IPC_RX_COPY 4096
+#define IPC_HEAD_SIZE (1 + sizeof(uint64_t))
+
 typedef struct ipc_pipe ipc_pipe;
 typedef struct ipc_ep   ipc_ep;
 
@@ -46,7 +55,11 @@ struct ipc_pipe {
 	nni_aio         tx_aio;
 	nni_aio         rx_aio;
 	nni_aio         neg_aio;
-	nni_msg        *rx_msg;
+	nni_msg        *rx_msg;  // large message, body being read
+	size_t          rx_got;  // bytes of rx_msg body read so far
+	uint8_t        *rx_buf;  // allocated on first receive
+	size_t          rx_pos;  // first unparsed byte in rx_buf
+	size_t          rx_end;  // end of the data in rx_buf
 	nni_mtx         mtx;
 };
 
@@ -157,6 +170,9 @@ ipc_pipe_fini(void *arg)
 	if (p->rx_msg) {
 		nni_msg_free(p->rx_msg);
 	}
+	if (p->rx_buf != NULL) {
+		nni_free(p->rx_buf, IPC_RX_BUF_SIZE);
+	}
 	nni_mtx_fini(&p->mtx);
 	NNI_FREE_STRUCT(p);
 }
@@ -181,6 +197,9 @@ ipc_pipe_alloc(ipc_pipe **pipe_p)
 	nni_aio_init(&p->tx_aio, ipc_pipe_send_cb, p);
 	nni_aio_init(&p->rx_aio, ipc_pipe_recv_cb, p);
 	nni_aio_init(&p->neg_aio, ipc_pipe_nego_cb, p);
+	// These callbacks are short, so let them run on the poller.
+	nni_aio_set_inline(&p->tx_aio, true);
+	nni_aio_set_inline(&p->rx_aio, true);
 	nni_aio_list_init(&p->send_q);
 	nni_aio_list_init(&p->recv_q);
 	nni_atomic_flag_reset(&p->reaped);
@@ -294,6 +313,7 @@ ipc_pipe_send_cb(void *arg)
 	size_t    n;
 	nni_msg  *msg;
 	nni_aio  *tx_aio = &p->tx_aio;
+	bool      inl    = nni_aio_completing_inline(tx_aio);
 
 	nni_mtx_lock(&p->mtx);
 	if ((rv = nni_aio_result(tx_aio)) != 0) {
@@ -331,7 +351,118 @@ ipc_pipe_send_cb(void *arg)
 
 	nni_aio_set_msg(aio, NULL);
 	nni_msg_free(msg);
-	nni_aio_finish_sync(aio, 0, n);
+	// Protocol callbacks take socket locks, so they must not run on
+	// the poller thread.
+	if (inl) {
+		nni_aio_finish(aio, 0, n);
+	} else {
+		nni_aio_finish_sync(aio, 0, n);
+	}
+}
+
+// ipc_pipe_recv_parse takes the next message from what has been read,
+// returning NNG_EAGAIN if more must be read first.
+static int
+ipc_pipe_recv_parse(ipc_pipe *p, nni_msg **msg_p)
+{
+	nni_msg *msg;
+	uint64_t len;
+	size_t   avail = p->rx_end - p->rx_pos;
+	size_t   n;
+	int      rv;
+
+	if ((msg = p->rx_msg) != NULL) {
+		if (p->rx_got < nni_msg_len(msg)) {
+			return (NNG_EAGAIN);
+		}
+		p->rx_msg = NULL;
+		*msg_p    = msg;
+		return (0);
+	}
+
+	// The header is the message type, which must be 1, and the length.
+	if (avail < IPC_HEAD_SIZE) {
+		return (NNG_EAGAIN);
+	}
+	if (p->rx_buf[p->rx_pos] != 1) {
+		return (NNG_EPROTO);
+	}
+	NNI_GET64(p->rx_buf + p->rx_pos + 1, len);
+
+	// Make sure the message payload is not too big.  If it is
+	// the caller will shut down the pipe.
+	if ((len > p->rcv_max) && (p->rcv_max > 0)) {
+		uint64_t pid;
+		char     peer[64] = "";
+		if (nng_stream_get_uint64(p->conn, NNG_OPT_PEER_PID, &pid) ==
+		    0) {
+			snprintf(peer, sizeof(peer), " from PID %lu",
+			    (unsigned long) pid);
+		}
+		nng_log_warn("NNG-RCVMAX",
+		    "Oversize message of %lu bytes (> %lu) "
+		    "on socket<%u> pipe<%u> from IPC%s",
+		    (unsigned long) len, (unsigned long) p->rcv_max,
+		    nni_pipe_sock_id(p->pipe), nni_pipe_id(p->pipe), peer);
+		return (NNG_EMSGSIZE);
+	}
+	avail -= IPC_HEAD_SIZE;
+	if ((len <= IPC_RX_COPY) && (avail < len)) {
+		return (NNG_EAGAIN);
+	}
+
+	// Note that all IO on this pipe is blocked behind this
+	// allocation.  We could possibly look at using a separate
+	// lock for the read side in the future, so that we allow
+	// transmits to proceed normally.  In practice this is
+	// unlikely to be much of an issue though.
+	if ((rv = nni_msg_alloc(&msg, (size_t) len)) != 0) {
+		return (rv);
+	}
+	p->rx_pos += IPC_HEAD_SIZE;
+	n = avail < len ? avail : (size_t) len;
+	if (n > 0) {
+		memcpy(nni_msg_body(msg), p->rx_buf + p->rx_pos, n);
+		p->rx_pos += n;
+	}
+	if (n < len) {
+		p->rx_msg = msg;
+		p->rx_got = n;
+		return (NNG_EAGAIN);
+	}
+	*msg_p = msg;
+	return (0);
+}
+
+// ipc_pipe_recv_read reads whatever is available into the buffer,
+// after the rest of the body of a large message if there is one.
+static void
+ipc_pipe_recv_read(ipc_pipe *p)
+{
+	nni_iov iov[2];
+	int     n_iov = 0;
+
+	if (p->rx_pos == p->rx_end) {
+		p->rx_pos = 0;
+		p->rx_end = 0;
+	} else if (p->rx_pos > 0) {
+		memmove(
+		    p->rx_buf, p->rx_buf + p->rx_pos, p->rx_end - p->rx_pos);
+		p->rx_end -= p->rx_pos;
+		p->rx_pos = 0;
+	}
+	if (p->rx_msg != NULL) {
+		iov[n_iov].iov_buf =
+		    (uint8_t *) nni_msg_body(p->rx_msg) + p->rx_got;
+		iov[n_iov].iov_len = nni_msg_len(p->rx_msg) - p->rx_got;
+		n_iov++;
+	}
+	iov[n_iov].iov_buf = p->rx_buf + p->rx_end;
+	iov[n_iov].iov_len = IPC_RX_BUF_SIZE - p->rx_end;
+	n_iov++;
+
+	nni_aio_set_iov(&p->rx_aio, n_iov, iov);
+	nng_stream_recv(p->conn, &p->rx_aio);
 }
 
 static void
@@ -343,6 +474,7 @@ ipc_pipe_recv_cb(void *arg)
 	size_t    n;
 	nni_msg  *msg;
 	nni_aio  *rx_aio = &p->rx_aio;
+	bool      inl    = nni_aio_completing_inline(rx_aio);
 
 	nni_mtx_lock(&p->mtx);
 
@@ -354,86 +486,44 @@ ipc_pipe_recv_cb(void *arg)
 	}
 
 	n = nni_aio_count(rx_aio);
-	nni_aio_iov_advance(rx_aio, n);
-	if (nni_aio_iov_count(rx_aio) != 0) {
-		// Was this a partial read?  If so then resubmit for the rest.
-		nng_stream_recv(p->conn, rx_aio);
+	if (p->rx_msg != NULL) {
+		size_t want = nni_msg_len(p->rx_msg) - p->rx_got;
+		if (n < want) {
+			p->rx_got += n;
+			n = 0;
+		} else {
+			p->rx_got += want;
+			n -= want;
+		}
+	}
+	p->rx_end += n;
+
+	if ((rv = ipc_pipe_recv_parse(p, &msg)) == NNG_EAGAIN) {
+		ipc_pipe_recv_read(p);
 		nni_mtx_unlock(&p->mtx);
 		return;
 	}
-
-	// If we don't have a message yet, we were reading the message
-	// header, which is just the length.  This tells us the size of the
-	// message to allocate and how much more to expect.
-	if (p->rx_msg == NULL) {
-		uint64_t len;
-
-		// Check to make sure we got msg type 1.
-		if (p->rx_head[0] != 1) {
-			rv = NNG_EPROTO;
-			goto error;
-		}
-
-		// We should have gotten a message header.
-		NNI_GET64(p->rx_head + 1, len);
-
-		// Make sure the message payload is not too big.  If it is
-		// the caller will shut down the pipe.
-		if ((len > p->rcv_max) && (p->rcv_max > 0)) {
-			uint64_t pid;
-			char     peer[64] = "";
-			if (nng_stream_get_uint64(
-			        p->conn, NNG_OPT_PEER_PID, &pid) == 0) {
-				snprintf(peer, sizeof(peer), " from PID %lu",
-				    (unsigned long) pid);
-			}
-			nng_log_warn("NNG-RCVMAX",
-			    "Oversize message of %lu bytes (> %lu) "
-			    "on socket<%u> pipe<%u> from IPC%s",
-			    (unsigned long) len, (unsigned long) p->rcv_max,
-			    nni_pipe_sock_id(p->pipe), nni_pipe_id(p->pipe),
-			    peer);
-			rv = NNG_EMSGSIZE;
-			goto error;
-		}
-
-		// Note that all IO on this pipe is blocked behind this
-		// allocation.  We could possibly look at using a separate
-		// lock for the read side in the future, so that we allow
-		// transmits to proceed normally.  In practice this is
-		// unlikely to be much of an issue though.
-		if ((rv = nni_msg_alloc(&p->rx_msg, (size_t) len)) != 0) {
-			goto error;
-		}
-
-		if (len != 0) {
-			nni_iov iov;
-			// Submit the rest of the data for a read -- we want to
-			// read the entire message now.
-			iov.iov_buf = nni_msg_body(p->rx_msg);
-			iov.iov_len = (size_t) len;
-
-			nni_aio_set_iov(rx_aio, 1, &iov);
-			nng_stream_recv(p->conn, rx_aio);
-			nni_mtx_unlock(&p->mtx);
-			return;
-		}
+	if (rv != 0) {
+		goto error;
 	}
 
 	// Otherwise, we got a message read completely.  Let the user know the
-	// good news.
+	// good news.  Any messages already read for the next receivers go to
+	// them too.
 
 	aio = nni_list_first(&p->recv_q);
 	nni_aio_list_remove(aio);
-	msg       = p->rx_msg;
-	p->rx_msg = NULL;
-	n         = nni_msg_len(msg);
+	n = nni_msg_len(msg);
 	nni_pipe_bump_rx(p->pipe, n);
 	ipc_pipe_recv_start(p);
 	nni_mtx_unlock(&p->mtx);
 
 	nni_aio_set_msg(aio, msg);
-	nni_aio_finish_sync(aio, 0, n);
+	if (inl) {
+		nni_aio_finish(aio, 0, n);
+	} else {
+		nni_aio_finish_sync(aio, 0, n);
+	}
 	return;
 
 error:
@@ -481,7 +571,7 @@ ipc_pipe_send_start(ipc_pipe *p)
 	nni_aio *aio;
 	nni_msg *msg;
 	int      nio;
-	nni_iov  iov[3];
+	nni_iov  iov[2 + NNI_MSG_MAX_IOV];
 	uint64_t len;
 
 	if (p->closed) {
@@ -511,11 +601,8 @@ ipc_pipe_send_start(ipc_pipe *p)
 		iov[nio].iov_len = nni_msg_header_len(msg);
 		nio++;
 	}
-	if (nni_msg_len(msg) > 0) {
-		iov[nio].iov_buf = nni_msg_body(msg);
-		iov[nio].iov_len = nni_msg_len(msg);
-		nio++;
-	}
+	// The body may be segmented; send the segments as they are.
+	nio += nni_msg_iov(msg, &iov[nio]);
 	nni_aio_set_iov(&p->tx_aio, nio, iov);
 	nng_stream_send(p->conn, &p->tx_aio);
 }
@@ -572,11 +659,12 @@ ipc_pipe_recv_cancel(nni_aio *aio, void *arg, int rv)
 static void
 ipc_pipe_recv_start(ipc_pipe *p)
 {
-	nni_iov iov;
-	NNI_ASSERT(p->rx_msg == NULL);
+	nni_aio *aio;
+	nni_msg *msg;
+	size_t   n;
+	int      rv;
 
 	if (p->closed) {
-		nni_aio *aio;
 		while ((aio = nni_list_first(&p->recv_q)) != NULL) {
 			nni_list_remove(&p->recv_q, aio);
 			nni_aio_finish_error(aio, NNG_ECLOSED);
@@ -586,13 +674,44 @@ ipc_pipe_recv_start(ipc_pipe *p)
 	if (nni_list_empty(&p->recv_q)) {
 		return;
 	}
+	if (p->rx_buf == NULL) {
+		nni_iov iov;
 
-	// Schedule a read of the IPC header.
-	iov.iov_buf = p->rx_head;
-	iov.iov_len = sizeof(p->rx_head);
-	nni_aio_set_iov(&p->rx_aio, 1, &iov);
+		if ((p->rx_buf = nni_alloc(IPC_RX_BUF_SIZE)) == NULL) {
+			aio = nni_list_first(&p->recv_q);
+			nni_aio_list_remove(aio);
+			nni_aio_finish_error(aio, NNG_ENOMEM);
+			return;
+		}
+		// We read into it for as long as the pipe lives, so the
+		// stream may want to map it just once.
+		iov.iov_buf = p->rx_buf;
+		iov.iov_len = IPC_RX_BUF_SIZE;
+		(void) nni_stream_set(p->conn, NNI_OPT_RECV_BUFFER, &iov,
+		    sizeof(iov), NNI_TYPE_OPAQUE);
+	}
 
-	nng_stream_recv(p->conn, &p->rx_aio);
+	// Hand out messages we already have, and read more only when
+	// someone is still waiting.
+	while ((aio = nni_list_first(&p->recv_q)) != NULL) {
+		if ((rv = ipc_pipe_recv_parse(p, &msg)) == NNG_EAGAIN) {
+			ipc_pipe_recv_read(p);
+			return;
+		}
+		if (rv != 0) {
+			while ((aio = nni_list_first(&p->recv_q)) != NULL) {
+				nni_aio_list_remove(aio);
+				nni_aio_finish_error(aio, rv);
+			}
+			nni_pipe_bump_error(p->pipe, rv);
+			return;
+		}
+		nni_aio_list_remove(aio);
+		n = nni_msg_len(msg);
+		nni_pipe_bump_rx(p->pipe, n);
+		nni_aio_set_msg(aio, msg);
+		nni_aio_finish(aio, 0, n);
+	}
 }
 
 static void
@@ -433,6 +433,68 @@ test_ipc_pipe_peer(void)
 #endif // NNG_PLATFORM_POSIX
 }
 
+static size_t
+ipc_recv_batch_size(int i)
+{
+	// Mostly small, with some that are read straight into the message,
+	// and a few larger than the receive buffer.
+	if ((i % 50) == 49) {
+		return (100000);
+	}
+	return ((i % 5) == 4 ? 5000 : (size_t) (i % 3) * 40);
+}
+
+void
+test_ipc_recv_batch(void)
+{
+	enum { COUNT = 200 };
+	nng_socket push;
+	nng_socket pull;
+	char      *addr;
+
+	NUTS_ADDR(addr, "ipc");
+
+	// With no room on the receiving socket, its pipe stops reading, so
+	// the messages pile up to be read several at once.
+	NUTS_PASS(nng_push0_open(&push));
+	NUTS_PASS(nng_pull0_open(&pull));
+	NUTS_PASS(nng_socket_set_int(push, NNG_OPT_SENDBUF, COUNT));
+	NUTS_PASS(nng_socket_set_int(pull, NNG_OPT_RECVBUF, 1));
+	NUTS_PASS(nng_socket_set_ms(push, NNG_OPT_SENDTIMEO, 5000));
+	NUTS_PASS(nng_socket_set_ms(pull, NNG_OPT_RECVTIMEO, 5000));
+	NUTS_PASS(nng_listen(push, addr, NULL, 0));
+	NUTS_PASS(nng_dial(pull, addr, NULL, 0));
+	NUTS_SLEEP(100);
+
+	for (int i = 0; i < COUNT; i++) {
+		nng_msg *msg;
+		size_t   len = ipc_recv_batch_size(i);
+		NUTS_PASS(nng_msg_alloc(&msg, len));
+		for (size_t j = 0; j < len; j++) {
+			((uint8_t *) nng_msg_body(msg))[j] = (uint8_t) (i + j);
+		}
+		NUTS_PASS(nng_sendmsg(push, msg, 0));
+	}
+	NUTS_SLEEP(100);
+
+	for (int i = 0; i < COUNT; i++) {
+		nng_msg *msg;
+		size_t   len = ipc_recv_batch_size(i);
+		bool     ok  = true;
+		NUTS_PASS(nng_recvmsg(pull, &msg, 0));
+		NUTS_TRUE(nng_msg_len(msg) == len);
+		for (size_t j = 0; ok && (j < len); j++) {
+			ok = ((uint8_t *) nng_msg_body(msg))[j] ==
+			    (uint8_t) (i + j);
+		}
+		NUTS_TRUE(ok);
+		nng_msg_free(msg);
+	}
+
+	NUTS_CLOSE(pull);
+	NUTS_CLOSE(push);
+}
+
 TEST_LIST = {
 	{ "ipc path too long", test_path_too_long },
 	{ "ipc dialer perms", test_ipc_dialer_perms },
@@ -446,5 +508,6 @@ TEST_LIST = {
 	{ "ipc abstract embedded null", test_abstract_null },
 	{ "ipc unix alias", test_unix_alias },
 	{ "ipc peer id", test_ipc_pipe_peer },
+	{ "ipc recv batch", test_ipc_recv_batch },
 	{ NULL, NULL },
 };
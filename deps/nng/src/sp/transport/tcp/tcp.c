@@ -18,6 +18,33 @@
 // TCP transport.   Platform specific TCP operations must be
 // supplied as well.
 
+// Protocols give a pipe one message at a time, and only send the next
+// one when that completes.  So that several can be written at once, the
+// pipe takes messages from the protocol right away (completing the send)
+// whenever it cannot write them immediately, as long as it holds fewer
+// than TCPTRAN_TX_MSGS messages and TCPTRAN_TX_BYTES bytes, and writes as
+// many of them together as it can.  (A send that is written right away
+// completes when the write does, as it always has.)
+// The length prefixes, message headers, and any body of up to
+// TCPTRAN_TX_COPY bytes are copied into a staging buffer, which is one
+// I/O vector no matter how many messages it holds; larger bodies are
+// written from where they are.  A write is also limited by the vectors
+// an aio can carry.
+#define TCPTRAN_TX_MSGS 64
+#define TCPTRAN_TX_BYTES 65536
+#define TCPTRAN_TX_IOV 8
+#define TCPTRAN_TX_BUFSZ 4096
+#define TCPTRAN_TX_COPY 256
+
+// Received data is read into a buffer, as much as is available, and
+// messages are carved out of that, so that a stream of small messages
+// needs far fewer reads than the two per message it would otherwise take.
+// A message with a body larger than TCPTRAN_RX_COPY bytes is not waited
+// for in the buffer; the rest of its body is read directly into the
+// message instead.
+#define TCPTRAN_RX_BUFSZ 65536
+#define TCPTRAN_RX_COPY 4096
+
 typedef struct tcptran_pipe tcptran_pipe;
 typedef struct tcptran_ep   tcptran_ep;
 
@@ -40,18 +67,38 @@ struct tcptran_pipe {
 	size_t          wanttxhead;
 	size_t          wantrxhead;
 	nni_list        recvq;
-	nni_list        sendq;
+	nni_list        sendq;     // waiting for room in txmsgs
+	nni_msg        *txmsgs[TCPTRAN_TX_MSGS];
+	nni_aio        *txaios[TCPTRAN_TX_MSGS]; // to finish when written
+	unsigned        ntxmsgs;   // taken from the protocol
+	unsigned        txsent;    // of those, being written
+	size_t          txbytes;   // size of txmsgs, as written
+	uint8_t        *txbuf;     // staging, allocated on first send
+	nni_duration    txdelay;   // time to wait for more, if not full
+	bool            txwait;    // waiting for more to send
+	bool            txdelayed; // already waited, so send now
+	bool            txstale;   // written while waiting
 	nni_aio        *txaio;
 	nni_aio        *rxaio;
 	nni_aio        *negoaio;
-	nni_msg        *rxmsg;
+	nni_aio        *delayaio;
+	nni_msg        *rxmsg;     // large message, body being read
+	size_t          rxgot;     // bytes of rxmsg body read so far
+	uint8_t        *rxbuf;     // allocated on first receive
+	size_t          rxhead;    // first unparsed byte in rxbuf
+	size_t          rxtail;    // end of the data in rxbuf
 	nni_mtx         mtx;
+#ifdef NNG_ENABLE_STATS
+	nni_stat_item st_tx_writes;
+	nni_stat_item st_rx_reads;
+#endif
 };
 
 struct tcptran_ep {
 	nni_mtx              mtx;
 	uint16_t             proto;
 	size_t               rcvmax;
+	nni_duration         txdelay;
 	bool                 fini;
 	bool                 started;
 	bool                 closed;
@@ -76,6 +123,7 @@ struct tcptran_ep {
 static void tcptran_pipe_send_start(tcptran_pipe *);
 static void tcptran_pipe_recv_start(tcptran_pipe *);
 static void tcptran_pipe_send_cb(void *);
+static void tcptran_pipe_delay_cb(void *);
 static void tcptran_pipe_recv_cb(void *);
 static void tcptran_pipe_nego_cb(void *);
 static void tcptran_ep_fini(void *);
@@ -113,6 +161,7 @@ tcptran_pipe_close(void *arg)
 	nni_aio_close(p->rxaio);
 	nni_aio_close(p->txaio);
 	nni_aio_close(p->negoaio);
+	nni_aio_close(p->delayaio);
 
 	nng_stream_close(p->conn);
 }
@@ -125,6 +174,7 @@ tcptran_pipe_stop(void *arg)
 	nni_aio_stop(p->rxaio);
 	nni_aio_stop(p->txaio);
 	nni_aio_stop(p->negoaio);
+	nni_aio_stop(p->delayaio);
 }
 
 static int
@@ -133,6 +183,26 @@ tcptran_pipe_init(void *arg, nni_pipe *npipe)
 	tcptran_pipe *p = arg;
 	p->npipe        = npipe;
 
+#ifdef NNG_ENABLE_STATS
+	static const nni_stat_info tx_writes_info = {
+		.si_name   = "tx_writes",
+		.si_desc   = "writes of one or more messages",
+		.si_type   = NNG_STAT_COUNTER,
+		.si_unit   = NNG_UNIT_EVENTS,
+		.si_atomic = true,
+	};
+	static const nni_stat_info rx_reads_info = {
+		.si_name   = "rx_reads",
+		.si_desc   = "reads of one or more messages",
+		.si_type   = NNG_STAT_COUNTER,
+		.si_unit   = NNG_UNIT_EVENTS,
+		.si_atomic = true,
+	};
+	nni_stat_init(&p->st_tx_writes, &tx_writes_info);
+	nni_stat_init(&p->st_rx_reads, &rx_reads_info);
+	nni_pipe_add_stat(npipe, &p->st_tx_writes);
+	nni_pipe_add_stat(npipe, &p->st_rx_reads);
+#endif
 	return (0);
 }
 
@@ -157,7 +227,17 @@ tcptran_pipe_fini(void *arg)
 	nni_aio_free(p->rxaio);
 	nni_aio_free(p->txaio);
 	nni_aio_free(p->negoaio);
+	nni_aio_free(p->delayaio);
 	nni_msg_free(p->rxmsg);
+	for (unsigned i = 0; i < p->ntxmsgs; i++) {
+		nni_msg_free(p->txmsgs[i]);
+	}
+	if (p->txbuf != NULL) {
+		nni_free(p->txbuf, TCPTRAN_TX_BUFSZ);
+	}
+	if (p->rxbuf != NULL) {
+		nni_free(p->rxbuf, TCPTRAN_RX_BUFSZ);
+	}
 	nni_mtx_fini(&p->mtx);
 	NNI_FREE_STRUCT(p);
 }
@@ -186,10 +266,15 @@ tcptran_pipe_alloc(tcptran_pipe **pipep)
 	if (((rv = nni_aio_alloc(&p->txaio, tcptran_pipe_send_cb, p)) != 0) ||
 	    ((rv = nni_aio_alloc(&p->rxaio, tcptran_pipe_recv_cb, p)) != 0) ||
 	    ((rv = nni_aio_alloc(&p->negoaio, tcptran_pipe_nego_cb, p)) !=
+	        0) ||
+	    ((rv = nni_aio_alloc(&p->delayaio, tcptran_pipe_delay_cb, p)) !=
 	        0)) {
 		tcptran_pipe_fini(p);
 		return (rv);
 	}
+	// These callbacks are short, so let them run on the poller.
+	nni_aio_set_inline(p->txaio, true);
+	nni_aio_set_inline(p->rxaio, true);
 	nni_aio_list_init(&p->recvq);
 	nni_aio_list_init(&p->sendq);
 	nni_atomic_flag_reset(&p->reaped);
@@ -213,6 +298,7 @@ tcptran_ep_match(tcptran_ep *ep)
 	nni_list_append(&ep->busypipes, p);
 	ep->useraio = NULL;
 	p->rcvmax   = ep->rcvmax;
+	p->txdelay  = ep->txdelay;
 	nni_aio_set_output(aio, 0, p);
 	nni_aio_finish(aio, 0, 0);
 }
@@ -299,19 +385,26 @@ error:
 	tcptran_pipe_reap(p);
 }
 
+// tcptran_pipe_send_size returns the size of a message as written.
+static size_t
+tcptran_pipe_send_size(nni_msg *msg)
+{
+	return (
+	    sizeof(uint64_t) + nni_msg_header_len(msg) + nni_msg_len(msg));
+}
+
 static void
 tcptran_pipe_send_cb(void *arg)
 {
 	tcptran_pipe *p = arg;
 	int           rv;
-	nni_aio      *aio;
-	size_t        n;
-	nni_msg      *msg;
+	unsigned      n;
+	nni_msg      *done[TCPTRAN_TX_MSGS];
+	nni_aio      *aios[TCPTRAN_TX_MSGS];
 	nni_aio      *txaio = p->txaio;
+	bool          inl   = nni_aio_completing_inline(txaio);
 
 	nni_mtx_lock(&p->mtx);
-	aio = nni_list_first(&p->sendq);
-
 	if ((rv = nni_aio_result(txaio)) != 0) {
 		nni_pipe_bump_error(p->npipe, rv);
 		// Intentionally we do not queue up another transfer.
@@ -319,31 +412,182 @@ tcptran_pipe_send_cb(void *arg)
 		// usable, with a partial transfer.
 		// The protocol should see this error, and close the
 		// pipe itself, we hope.
-		nni_aio_list_remove(aio);
-		nni_mtx_unlock(&p->mtx);
-		nni_aio_finish_error(aio, rv);
-		return;
+	} else {
+		size_t count = nni_aio_count(txaio);
+		nni_aio_iov_advance(txaio, count);
+		if (nni_aio_iov_count(txaio) > 0) {
+			nng_stream_send(p->conn, txaio);
+			nni_mtx_unlock(&p->mtx);
+			return;
+		}
 	}
 
-	n = nni_aio_count(txaio);
-	nni_aio_iov_advance(txaio, n);
-	if (nni_aio_iov_count(txaio) > 0) {
-		nng_stream_send(p->conn, txaio);
-		nni_mtx_unlock(&p->mtx);
-		return;
+	n = p->txsent;
+	for (unsigned i = 0; i < n; i++) {
+		done[i] = p->txmsgs[i];
+		aios[i] = p->txaios[i];
+		p->txbytes -= tcptran_pipe_send_size(done[i]);
+		if (rv == 0) {
+			nni_pipe_bump_tx(p->npipe, nni_msg_len(done[i]));
+		}
 	}
+	nni_mtx_unlock(&p->mtx);
 
-	nni_aio_list_remove(aio);
-	tcptran_pipe_send_start(p);
+	// Finish the send that was waiting for this write first.  We are
+	// still writing as far as anyone can tell, so whatever the protocol
+	// sends next is taken at once, and can be written with what has
+	// queued up meanwhile.
+	for (unsigned i = 0; i < n; i++) {
+		if (aios[i] == NULL) {
+			continue;
+		}
+		if (rv != 0) {
+			// The message goes back to the protocol.
+			nni_aio_finish_error(aios[i], rv);
+		} else {
+			size_t len = nni_msg_len(done[i]);
+			nni_aio_set_msg(aios[i], NULL);
+			nni_msg_free(done[i]);
+			// Protocol callbacks take socket locks, so they
+			// must not run on the poller thread.
+			if (inl) {
+				nni_aio_finish(aios[i], 0, len);
+			} else {
+				nni_aio_finish_sync(aios[i], 0, len);
+			}
+		}
+	}
 
-	msg = nni_aio_get_msg(aio);
-	n   = nni_msg_len(msg);
-	nni_pipe_bump_tx(p->npipe, n);
+	nni_mtx_lock(&p->mtx);
+	p->ntxmsgs -= n;
+	memmove(p->txmsgs, p->txmsgs + n, p->ntxmsgs * sizeof(nni_msg *));
+	memmove(p->txaios, p->txaios + n, p->ntxmsgs * sizeof(nni_aio *));
+	p->txsent = 0;
+	if (rv == 0) {
+		tcptran_pipe_send_start(p);
+	}
 	nni_mtx_unlock(&p->mtx);
 
-	nni_aio_set_msg(aio, NULL);
-	nni_msg_free(msg);
-	nni_aio_finish_sync(aio, 0, n);
+	for (unsigned i = 0; i < n; i++) {
+		if (aios[i] == NULL) {
+			nni_msg_free(done[i]);
+		}
+	}
+}
+
+static void
+tcptran_pipe_delay_cb(void *arg)
+{
+	tcptran_pipe *p = arg;
+
+	nni_mtx_lock(&p->mtx);
+	p->txwait = false;
+	// Unless what it waited for has been written already.
+	if (!p->txstale) {
+		p->txdelayed = true;
+	}
+	p->txstale = false;
+	tcptran_pipe_send_start(p);
+	nni_mtx_unlock(&p->mtx);
+}
+
+// tcptran_pipe_recv_parse takes the next message from what has been read,
+// returning NNG_EAGAIN if more must be read first.
+static int
+tcptran_pipe_recv_parse(tcptran_pipe *p, nni_msg **msgp)
+{
+	nni_msg *msg;
+	uint64_t len;
+	size_t   avail = p->rxtail - p->rxhead;
+	size_t   n;
+	int      rv;
+
+	if ((msg = p->rxmsg) != NULL) {
+		if (p->rxgot < nni_msg_len(msg)) {
+			return (NNG_EAGAIN);
+		}
+		p->rxmsg = NULL;
+		*msgp    = msg;
+		return (0);
+	}
+
+	// The TCP message header is just the length.
+	if (avail < sizeof(uint64_t)) {
+		return (NNG_EAGAIN);
+	}
+	NNI_GET64(p->rxbuf + p->rxhead, len);
+
+	// Make sure the message payload is not too big.  If it is
+	// the caller will shut down the pipe.
+	if ((len > p->rcvmax) && (p->rcvmax > 0)) {
+		nng_sockaddr_storage ss;
+		nng_sockaddr        *sa = (nng_sockaddr *) &ss;
+		char                 peername[64] = "unknown";
+		if (nng_stream_get_addr(p->conn, NNG_OPT_REMADDR, sa) == 0) {
+			(void) nng_str_sockaddr(sa, peername, sizeof(peername));
+		}
+		nng_log_warn("NNG-RCVMAX",
+		    "Oversize message of %lu bytes (> %lu) "
+		    "on socket<%u> pipe<%u> from TCP %s",
+		    (unsigned long) len, (unsigned long) p->rcvmax,
+		    nni_pipe_sock_id(p->npipe), nni_pipe_id(p->npipe),
+		    peername);
+		return (NNG_EMSGSIZE);
+	}
+	avail -= sizeof(uint64_t);
+	if ((len <= TCPTRAN_RX_COPY) && (avail < len)) {
+		return (NNG_EAGAIN);
+	}
+
+	if ((rv = nni_msg_alloc(&msg, (size_t) len)) != 0) {
+		return (rv);
+	}
+	p->rxhead += sizeof(uint64_t);
+	n = avail < len ? avail : (size_t) len;
+	if (n > 0) {
+		memcpy(nni_msg_body(msg), p->rxbuf + p->rxhead, n);
+		p->rxhead += n;
+	}
+	if (n < len) {
+		p->rxmsg = msg;
+		p->rxgot = n;
+		return (NNG_EAGAIN);
+	}
+	*msgp = msg;
+	return (0);
+}
+
+// tcptran_pipe_recv_read reads whatever is available into the buffer,
+// after the rest of the body of a large message if there is one.
+static void
+tcptran_pipe_recv_read(tcptran_pipe *p)
+{
+	nni_iov iov[2];
+	int     niov = 0;
+
+	if (p->rxhead == p->rxtail) {
+		p->rxhead = 0;
+		p->rxtail = 0;
+	} else if (p->rxhead > 0) {
+		memmove(p->rxbuf, p->rxbuf + p->rxhead, p->rxtail - p->rxhead);
+		p->rxtail -= p->rxhead;
+		p->rxhead = 0;
+	}
+	if (p->rxmsg != NULL) {
+		iov[niov].iov_buf =
+		    (uint8_t *) nni_msg_body(p->rxmsg) + p->rxgot;
+		iov[niov].iov_len = nni_msg_len(p->rxmsg) - p->rxgot;
+		niov++;
+	}
+	iov[niov].iov_buf = p->rxbuf + p->rxtail;
+	iov[niov].iov_len = TCPTRAN_RX_BUFSZ - p->rxtail;
+	niov++;
+
+#ifdef NNG_ENABLE_STATS
+	nni_stat_inc(&p->st_rx_reads, 1);
+#endif
+	nni_aio_set_iov(p->rxaio, niov, iov);
+	nng_stream_recv(p->conn, p->rxaio);
 }
 
 static void
@@ -355,6 +599,7 @@ tcptran_pipe_recv_cb(void *arg)
 	size_t        n;
 	nni_msg      *msg;
 	nni_aio      *rxaio = p->rxaio;
+	bool          inl   = nni_aio_completing_inline(rxaio);
 
 	nni_mtx_lock(&p->mtx);
 	aio = nni_list_first(&p->recvq);
@@ -369,72 +614,42 @@ tcptran_pipe_recv_cb(void *arg)
 	}
 
 	n = nni_aio_count(rxaio);
-	nni_aio_iov_advance(rxaio, n);
-	if (nni_aio_iov_count(rxaio) > 0) {
-		nng_stream_recv(p->conn, rxaio);
+	if (p->rxmsg != NULL) {
+		size_t want = nni_msg_len(p->rxmsg) - p->rxgot;
+		if (n < want) {
+			p->rxgot += n;
+			n = 0;
+		} else {
+			p->rxgot += want;
+			n -= want;
+		}
+	}
+	p->rxtail += n;
+
+	if ((rv = tcptran_pipe_recv_parse(p, &msg)) == NNG_EAGAIN) {
+		tcptran_pipe_recv_read(p);
 		nni_mtx_unlock(&p->mtx);
 		return;
 	}
-
-	// If we don't have a message yet, we were reading the TCP message
-	// header, which is just the length.  This tells us the size of the
-	// message to allocate and how much more to expect.
-	if (p->rxmsg == NULL) {
-		uint64_t len;
-		// We should have gotten a message header.
-		NNI_GET64(p->rxlen, len);
-
-		// Make sure the message payload is not too big.  If it is
-		// the caller will shut down the pipe.
-		if ((len > p->rcvmax) && (p->rcvmax > 0)) {
-			nng_sockaddr_storage ss;
-			nng_sockaddr        *sa = (nng_sockaddr *) &ss;
-			char                 peername[64] = "unknown";
-			if ((rv = nng_stream_get_addr(
-			         p->conn, NNG_OPT_REMADDR, sa)) == 0) {
-				(void) nng_str_sockaddr(
-				    sa, peername, sizeof(peername));
-			}
-			nng_log_warn("NNG-RCVMAX",
-			    "Oversize message of %lu bytes (> %lu) "
-			    "on socket<%u> pipe<%u> from TCP %s",
-			    (unsigned long) len, (unsigned long) p->rcvmax,
-			    nni_pipe_sock_id(p->npipe), nni_pipe_id(p->npipe),
-			    peername);
-			rv = NNG_EMSGSIZE;
-			goto recv_error;
-		}
-
-		if ((rv = nni_msg_alloc(&p->rxmsg, (size_t) len)) != 0) {
-			goto recv_error;
-		}
-
-		// Submit the rest of the data for a read -- we want to
-		// read the entire message now.
-		if (len != 0) {
-			nni_iov iov;
-			iov.iov_buf = nni_msg_body(p->rxmsg);
-			iov.iov_len = (size_t) len;
-
-			nni_aio_set_iov(rxaio, 1, &iov);
-			nng_stream_recv(p->conn, rxaio);
-			nni_mtx_unlock(&p->mtx);
-			return;
-		}
+	if (rv != 0) {
+		goto recv_error;
 	}
 
 	// We read a message completely.  Let the user know the good news.
+	// Any messages already read for the next receivers go to them too.
 	nni_aio_list_remove(aio);
-	msg      = p->rxmsg;
-	p->rxmsg = NULL;
-	n        = nni_msg_len(msg);
+	n = nni_msg_len(msg);
 
 	nni_pipe_bump_rx(p->npipe, n);
 	tcptran_pipe_recv_start(p);
 	nni_mtx_unlock(&p->mtx);
 
 	nni_aio_set_msg(aio, msg);
-	nni_aio_finish_sync(aio, 0, n);
+	if (inl) {
+		nni_aio_finish(aio, 0, n);
+	} else {
+		nni_aio_finish_sync(aio, 0, n);
+	}
 	return;
 
 recv_error:
@@ -455,16 +670,18 @@ tcptran_pipe_send_cancel(nni_aio *aio, void *arg, int rv)
 {
 	tcptran_pipe *p = arg;
 
+	// Sends still waiting for room are just removed.  A send we held
+	// on to is being written, so cancel the write; the callback on the
+	// txaio will cause the send to be canceled too.  The others are
+	// done as far as the protocol is concerned.
 	nni_mtx_lock(&p->mtx);
 	if (!nni_aio_list_active(aio)) {
-		nni_mtx_unlock(&p->mtx);
-		return;
-	}
-	// If this is being sent, then cancel the pending transfer.
-	// The callback on the txaio will cause the user aio to
-	// be canceled too.
-	if (nni_list_first(&p->sendq) == aio) {
-		nni_aio_abort(p->txaio, rv);
+		for (unsigned i = 0; i < p->txsent; i++) {
+			if (p->txaios[i] == aio) {
+				nni_aio_abort(p->txaio, rv);
+				break;
+			}
+		}
 		nni_mtx_unlock(&p->mtx);
 		return;
 	}
@@ -478,11 +695,13 @@ static void
 tcptran_pipe_send_start(tcptran_pipe *p)
 {
 	nni_aio *aio;
-	nni_aio *txaio;
-	nni_msg *msg;
-	int      niov;
-	nni_iov  iov[3];
-	uint64_t len;
+	nni_iov  iov[TCPTRAN_TX_IOV];
+	nni_iov  body[NNI_MSG_MAX_IOV];
+	unsigned niov;
+	unsigned nmsg;
+	size_t   staged; // bytes used in txbuf
+	bool     full;
+	bool     ref; // last vector is not staged
 
 	if (p->closed) {
 		while ((aio = nni_list_first(&p->sendq)) != NULL) {
@@ -492,33 +711,131 @@ tcptran_pipe_send_start(tcptran_pipe *p)
 		return;
 	}
 
-	if ((aio = nni_list_first(&p->sendq)) == NULL) {
+	if ((p->txbuf == NULL) &&
+	    ((p->txbuf = nni_alloc(TCPTRAN_TX_BUFSZ)) == NULL)) {
+		if ((aio = nni_list_first(&p->sendq)) != NULL) {
+			nni_aio_list_remove(aio);
+			nni_aio_finish_error(aio, NNG_ENOMEM);
+		}
 		return;
 	}
 
-	// This runs to send the message.
-	msg = nni_aio_get_msg(aio);
-	len = nni_msg_len(msg) + nni_msg_header_len(msg);
+	// Take what we have room for.  Unless we are about to write it,
+	// the send is done as far as the protocol is concerned, so that it
+	// can give us the next one.
+	while ((aio = nni_list_first(&p->sendq)) != NULL) {
+		nni_msg *msg = nni_aio_get_msg(aio);
+		size_t   len = tcptran_pipe_send_size(msg);
 
-	NNI_PUT64(p->txlen, len);
+		if ((p->ntxmsgs == TCPTRAN_TX_MSGS) ||
+		    ((p->ntxmsgs > 0) &&
+		        (p->txbytes + len > TCPTRAN_TX_BYTES))) {
+			break;
+		}
+		nni_aio_list_remove(aio);
+		p->txmsgs[p->ntxmsgs] = msg;
+		p->txaios[p->ntxmsgs] = NULL;
+		p->txbytes += len;
+		if ((p->ntxmsgs == 0) && (p->txsent == 0) &&
+		    (p->txdelay <= 0)) {
+			p->txaios[p->ntxmsgs] = aio;
+		} else {
+			nni_aio_set_msg(aio, NULL);
+			nni_aio_finish(aio, 0, nni_msg_len(msg));
+		}
+		p->ntxmsgs++;
+	}
 
-	txaio          = p->txaio;
-	niov           = 0;
-	iov[0].iov_buf = p->txlen;
-	iov[0].iov_len = sizeof(p->txlen);
-	niov++;
-	if (nni_msg_header_len(msg) > 0) {
-		iov[niov].iov_buf = nni_msg_header(msg);
-		iov[niov].iov_len = nni_msg_header_len(msg);
-		niov++;
+	if ((p->txsent > 0) || (p->ntxmsgs == 0)) {
+		return;
 	}
-	if (nni_msg_len(msg) > 0) {
-		iov[niov].iov_buf = nni_msg_body(msg);
-		iov[niov].iov_len = nni_msg_len(msg);
-		niov++;
+
+	// See how many messages we can write together.  The first one
+	// always fits.
+	niov   = 0;
+	staged = 0;
+	ref    = true;
+	full   = (p->ntxmsgs == TCPTRAN_TX_MSGS) || !nni_list_empty(&p->sendq);
+	for (nmsg = 0; nmsg < p->ntxmsgs; nmsg++) {
+		nni_msg *msg  = p->txmsgs[nmsg];
+		size_t   need = sizeof(uint64_t) + nni_msg_header_len(msg);
+		unsigned nref = 0;
+
+		if (nni_msg_len(msg) <= TCPTRAN_TX_COPY) {
+			need += nni_msg_len(msg);
+		} else {
+			nref = nni_msg_iov(msg, body);
+		}
+		if ((staged + need > TCPTRAN_TX_BUFSZ) ||
+		    (niov + nref + (ref ? 1 : 0) > TCPTRAN_TX_IOV)) {
+			full = true;
+			break;
+		}
+		staged += need;
+		niov += nref + (ref ? 1 : 0);
+		ref = (nref > 0);
+	}
+
+	// If there is room for more, and we are allowed to, wait a bit
+	// (once) for them, rather than writing a short batch now.
+	if ((!full) && (p->txdelay > 0) && (!p->txdelayed)) {
+		if (!p->txwait) {
+			p->txwait = true;
+			nni_sleep_aio(p->txdelay, p->delayaio);
+		}
+		return;
+	}
+	p->txdelayed = false;
+	if (p->txwait) {
+		// Filled up while we were waiting.  Until the callback
+		// has run, the next batch waits for it, then for itself.
+		p->txstale = true;
+		nni_aio_abort(p->delayaio, NNG_ECANCELED);
+	}
+
+	niov   = 0;
+	staged = 0;
+	ref    = true;
+	for (unsigned i = 0; i < nmsg; i++) {
+		nni_msg *msg   = p->txmsgs[i];
+		uint8_t *dst   = p->txbuf + staged;
+		size_t   hlen  = nni_msg_header_len(msg);
+		unsigned nbody = nni_msg_iov(msg, body);
+		bool     copy  = nni_msg_len(msg) <= TCPTRAN_TX_COPY;
+
+		NNI_PUT64(dst, (uint64_t) (hlen + nni_msg_len(msg)));
+		dst += sizeof(uint64_t);
+		if (hlen > 0) {
+			memcpy(dst, nni_msg_header(msg), hlen);
+			dst += hlen;
+		}
+		if (copy) {
+			for (unsigned j = 0; j < nbody; j++) {
+				memcpy(dst, body[j].iov_buf, body[j].iov_len);
+				dst += body[j].iov_len;
+			}
+		}
+		if (ref) {
+			iov[niov].iov_buf = p->txbuf + staged;
+			iov[niov].iov_len = 0;
+			niov++;
+		}
+		iov[niov - 1].iov_len += (size_t) (dst - (p->txbuf + staged));
+		staged = (size_t) (dst - p->txbuf);
+
+		// A large body may be segmented; send the segments as
+		// they are.
+		ref = !copy;
+		for (unsigned j = 0; (!copy) && (j < nbody); j++) {
+			iov[niov++] = body[j];
+		}
 	}
-	nni_aio_set_iov(txaio, niov, iov);
-	nng_stream_send(p->conn, txaio);
+	p->txsent = nmsg;
+#ifdef NNG_ENABLE_STATS
+	nni_stat_inc(&p->st_tx_writes, 1);
+#endif
+	nni_aio_set_iov(p->txaio, niov, iov);
+	nng_stream_send(p->conn, p->txaio);
 }
 
 static void
@@ -541,9 +858,7 @@ tcptran_pipe_send(void *arg, nni_aio *aio)
 		return;
 	}
 	nni_list_append(&p->sendq, aio);
-	if (nni_list_first(&p->sendq) == aio) {
-		tcptran_pipe_send_start(p);
-	}
+	tcptran_pipe_send_start(p);
 	nni_mtx_unlock(&p->mtx);
 }
 
@@ -573,12 +888,12 @@ tcptran_pipe_recv_cancel(nni_aio *aio, void *arg, int rv)
 static void
 tcptran_pipe_recv_start(tcptran_pipe *p)
 {
-	nni_aio *rxaio;
-	nni_iov  iov;
-	NNI_ASSERT(p->rxmsg == NULL);
+	nni_aio *aio;
+	nni_msg *msg;
+	size_t   n;
+	int      rv;
 
 	if (p->closed) {
-		nni_aio *aio;
 		while ((aio = nni_list_first(&p->recvq)) != NULL) {
 			nni_list_remove(&p->recvq, aio);
 			nni_aio_finish_error(aio, NNG_ECLOSED);
@@ -588,14 +903,41 @@ tcptran_pipe_recv_start(tcptran_pipe *p)
 	if (nni_list_empty(&p->recvq)) {
 		return;
 	}
+	if (p->rxbuf == NULL) {
+		nni_iov iov;
 
-	// Schedule a read of the header.
-	rxaio       = p->rxaio;
-	iov.iov_buf = p->rxlen;
-	iov.iov_len = sizeof(p->rxlen);
-	nni_aio_set_iov(rxaio, 1, &iov);
-
-	nng_stream_recv(p->conn, rxaio);
+		if ((p->rxbuf = nni_alloc(TCPTRAN_RX_BUFSZ)) == NULL) {
+			aio = nni_list_first(&p->recvq);
+			nni_aio_list_remove(aio);
+			nni_aio_finish_error(aio, NNG_ENOMEM);
+			return;
+		}
+		// We read into it for as long as the pipe lives, so the
+		// stream may want to map it just once.
+		iov.iov_buf = p->rxbuf;
+		iov.iov_len = TCPTRAN_RX_BUFSZ;
+		(void) nni_stream_set(p->conn, NNI_OPT_RECV_BUFFER, &iov,
+		    sizeof(iov), NNI_TYPE_OPAQUE);
+	}
+
+	// Hand out messages we already have, and read more only when
+	// someone is still waiting.
+	while ((aio = nni_list_first(&p->recvq)) != NULL) {
+		if ((rv = tcptran_pipe_recv_parse(p, &msg)) == NNG_EAGAIN) {
+			tcptran_pipe_recv_read(p);
+			return;
+		}
+		nni_aio_list_remove(aio);
+		if (rv != 0) {
+			nni_pipe_bump_error(p->npipe, rv);
+			nni_aio_finish_error(aio, rv);
+			return;
+		}
+		n = nni_msg_len(msg);
+		nni_pipe_bump_rx(p->npipe, n);
+		nni_aio_set_msg(aio, msg);
+		nni_aio_finish(aio, 0, n);
+	}
 }
 
 static void
@@ -1093,6 +1435,32 @@ tcptran_ep_set_recvmaxsz(void *arg, const void *v, size_t sz, nni_opt_type t)
 	return (rv);
 }
 
+static int
+tcptran_ep_get_senddelay(void *arg, void *v, size_t *szp, nni_opt_type t)
+{
+	tcptran_ep *ep = arg;
+	int         rv;
+
+	nni_mtx_lock(&ep->mtx);
+	rv = nni_copyout_ms(ep->txdelay, v, szp, t);
+	nni_mtx_unlock(&ep->mtx);
+	return (rv);
+}
+
+static int
+tcptran_ep_set_senddelay(void *arg, const void *v, size_t sz, nni_opt_type t)
+{
+	tcptran_ep  *ep = arg;
+	nni_duration val;
+	int          rv;
+	if ((rv = nni_copyin_ms(&val, v, sz, t)) == 0) {
+		nni_mtx_lock(&ep->mtx);
+		ep->txdelay = val;
+		nni_mtx_unlock(&ep->mtx);
+	}
+	return (rv);
+}
+
 static int
 tcptran_ep_bind(void *arg)
 {
@@ -1162,6 +1530,11 @@ static const nni_option tcptran_ep_opts[] = {
 	    .o_name = NNG_OPT_URL,
 	    .o_get  = tcptran_ep_get_url,
 	},
+	{
+	    .o_name = NNG_OPT_TCP_SEND_DELAY,
+	    .o_get  = tcptran_ep_get_senddelay,
+	    .o_set  = tcptran_ep_set_senddelay,
+	},
 	// terminate list
 	{
 	    .o_name = NULL,
@@ -12,6 +12,8 @@
 
 #include <nuts.h>
 
+uint64_t nni_init_get_effective(nng_init_parameter p);
+
 // TCP tests.
 
 static void
@@ -244,6 +246,57 @@ test_tcp_keep_alive_option(void)
 	NUTS_CLOSE(s);
 }
 
+void
+test_tcp_reuseport_option(void)
+{
+	nng_socket   s1;
+	nng_socket   s2;
+	nng_socket   s3;
+	nng_listener l1;
+	nng_listener l2;
+	nng_listener l3;
+	bool         v;
+	char        *addr;
+
+	NUTS_ADDR(addr, "tcp");
+
+	NUTS_OPEN(s1);
+	NUTS_OPEN(s2);
+	NUTS_OPEN(s3);
+	NUTS_PASS(nng_listener_create(&l1, s1, addr));
+	NUTS_PASS(nng_listener_get_bool(l1, NNG_OPT_TCP_REUSEPORT, &v));
+	NUTS_TRUE(v == false);
+	NUTS_FAIL(
+	    nng_listener_set_int(l1, NNG_OPT_TCP_REUSEPORT, 1), NNG_EBADTYPE);
+
+#ifdef NNG_PLATFORM_POSIX
+	NUTS_PASS(nng_listener_set_bool(l1, NNG_OPT_TCP_REUSEPORT, true));
+	NUTS_PASS(nng_listener_get_bool(l1, NNG_OPT_TCP_REUSEPORT, &v));
+	NUTS_TRUE(v);
+	NUTS_PASS(nng_listener_start(l1, 0));
+	NUTS_FAIL(nng_listener_set_bool(l1, NNG_OPT_TCP_REUSEPORT, false),
+	    NNG_EBUSY);
+
+	// A second listener with the option shares the port.
+	NUTS_PASS(nng_listener_create(&l2, s2, addr));
+	NUTS_PASS(nng_listener_set_bool(l2, NNG_OPT_TCP_REUSEPORT, true));
+	NUTS_PASS(nng_listener_start(l2, 0));
+
+	// One without it is still refused.
+	NUTS_PASS(nng_listener_create(&l3, s3, addr));
+	NUTS_FAIL(nng_listener_start(l3, 0), NNG_EADDRINUSE);
+#else
+	NUTS_FAIL(nng_listener_set_bool(l1, NNG_OPT_TCP_REUSEPORT, true),
+	    NNG_ENOTSUP);
+	(void) l2;
+	(void) l3;
+#endif
+
+	NUTS_CLOSE(s3);
+	NUTS_CLOSE(s2);
+	NUTS_CLOSE(s1);
+}
+
 void
 test_tcp_recv_max(void)
 {
@@ -278,6 +331,580 @@ test_tcp_recv_max(void)
 	NUTS_CLOSE(s1);
 }
 
+void
+test_tcp_send_delay_option(void)
+{
+	nng_socket   s;
+	nng_dialer   d;
+	nng_listener l;
+	nng_duration t;
+	bool         b;
+	char        *addr;
+
+	NUTS_ADDR(addr, "tcp");
+
+	NUTS_OPEN(s);
+	NUTS_PASS(nng_dialer_create(&d, s, addr));
+	NUTS_PASS(nng_dialer_get_ms(d, NNG_OPT_TCP_SEND_DELAY, &t));
+	NUTS_TRUE(t == 0);
+	NUTS_PASS(nng_dialer_set_ms(d, NNG_OPT_TCP_SEND_DELAY, 5));
+	NUTS_PASS(nng_dialer_get_ms(d, NNG_OPT_TCP_SEND_DELAY, &t));
+	NUTS_TRUE(t == 5);
+	NUTS_FAIL(nng_dialer_get_bool(d, NNG_OPT_TCP_SEND_DELAY, &b),
+	    NNG_EBADTYPE);
+
+	NUTS_PASS(nng_listener_create(&l, s, addr));
+	NUTS_PASS(nng_listener_get_ms(l, NNG_OPT_TCP_SEND_DELAY, &t));
+	NUTS_TRUE(t == 0);
+	NUTS_PASS(nng_listener_set_ms(l, NNG_OPT_TCP_SEND_DELAY, 10));
+	NUTS_PASS(nng_listener_get_ms(l, NNG_OPT_TCP_SEND_DELAY, &t));
+	NUTS_TRUE(t == 10);
+	NUTS_FAIL(nng_listener_set_bool(l, NNG_OPT_TCP_SEND_DELAY, true),
+	    NNG_EBADTYPE);
+	NUTS_CLOSE(s);
+}
+
+// A batch that fills up while waiting is written at once.  The message
+// after it must still wait, even though the first wait is then over.
+void
+test_tcp_send_delay_full(void)
+{
+	enum { DELAY = 500, COUNT = 64 }; // COUNT fills a batch
+	nng_socket   push;
+	nng_socket   pull;
+	nng_listener l;
+	nng_dialer   d;
+	char         addr[64];
+	int          port;
+	char         buf[8];
+	size_t       sz;
+	nng_time     t0;
+
+	NUTS_PASS(nng_push0_open(&push));
+	NUTS_PASS(nng_pull0_open(&pull));
+	NUTS_PASS(nng_socket_set_int(push, NNG_OPT_SENDBUF, COUNT));
+	NUTS_PASS(nng_socket_set_ms(pull, NNG_OPT_RECVTIMEO, 5000));
+	NUTS_PASS(nng_listen(pull, "tcp://127.0.0.1:0", &l, 0));
+	NUTS_PASS(nng_listener_get_int(l, NNG_OPT_TCP_BOUND_PORT, &port));
+	(void) snprintf(addr, sizeof(addr), "tcp://127.0.0.1:%d", port);
+	NUTS_PASS(nng_dialer_create(&d, push, addr));
+	NUTS_PASS(nng_dialer_set_ms(d, NNG_OPT_TCP_SEND_DELAY, DELAY));
+	NUTS_PASS(nng_dialer_start(d, 0));
+	NUTS_SLEEP(100);
+
+	for (int i = 0; i < COUNT; i++) {
+		NUTS_PASS(nng_send(push, "x", 1, 0));
+	}
+	for (int i = 0; i < COUNT; i++) {
+		sz = sizeof(buf);
+		NUTS_PASS(nng_recv(pull, buf, &sz, 0));
+	}
+	NUTS_SLEEP(DELAY + 100);
+
+	t0 = nng_clock();
+	NUTS_PASS(nng_send(push, "y", 1, 0));
+	sz = sizeof(buf);
+	NUTS_PASS(nng_recv(pull, buf, &sz, 0));
+	NUTS_TRUE(sz == 1);
+	NUTS_TRUE(nng_clock() - t0 >= DELAY - 50);
+
+	NUTS_CLOSE(push);
+	NUTS_CLOSE(pull);
+}
+
+// tcp_stat_sum adds up the named statistic everywhere it appears.
+static uint64_t
+tcp_stat_sum(nng_stat *st, const char *name)
+{
+	uint64_t sum = 0;
+
+	for (; st != NULL; st = nng_stat_next(st)) {
+		if (strcmp(nng_stat_name(st), name) == 0) {
+			sum += nng_stat_value(st);
+		}
+		sum += tcp_stat_sum(nng_stat_child(st), name);
+	}
+	return (sum);
+}
+
+void
+test_tcp_send_coalesce(void)
+{
+	enum { COUNT = 200 };
+	nng_socket   pub;
+	nng_socket   sub;
+	nng_listener l;
+	nng_stat    *stats;
+	char        *addr;
+	uint64_t     msgs;
+	uint64_t     writes;
+
+	NUTS_ADDR(addr, "tcp");
+
+	// A send delay makes sure the messages queue up to be written
+	// together, however fast or slow we are.
+	NUTS_PASS(nng_pub0_open(&pub));
+	NUTS_PASS(nng_sub0_open(&sub));
+	NUTS_PASS(nng_socket_set_int(pub, NNG_OPT_SENDBUF, COUNT));
+	NUTS_PASS(nng_socket_set_int(sub, NNG_OPT_RECVBUF, COUNT));
+	NUTS_PASS(nng_socket_set_ms(sub, NNG_OPT_RECVTIMEO, 5000));
+	NUTS_PASS(nng_sub0_socket_subscribe(sub, "", 0));
+	NUTS_PASS(nng_listener_create(&l, pub, addr));
+	NUTS_PASS(nng_listener_set_ms(l, NNG_OPT_TCP_SEND_DELAY, 20));
+	NUTS_PASS(nng_listener_start(l, 0));
+	NUTS_PASS(nng_dial(sub, addr, NULL, 0));
+	NUTS_SLEEP(100);
+
+	for (int i = 0; i < COUNT; i++) {
+		char buf[512];
+		int  len = (i % 2) ? 16 : (int) sizeof(buf);
+		memset(buf, 0, sizeof(buf));
+		NUTS_ASSERT(snprintf(buf, sizeof(buf), "%d", i) > 0);
+		NUTS_PASS(nng_send(pub, buf, (size_t) len, 0));
+	}
+	for (int i = 0; i < COUNT; i++) {
+		nng_msg *msg;
+		char     num[16];
+		NUTS_PASS(nng_recvmsg(sub, &msg, 0));
+		NUTS_TRUE(nng_msg_len(msg) == ((i % 2) ? 16 : 512));
+		(void) snprintf(num, sizeof(num), "%d", i);
+		NUTS_MATCH(nng_msg_body(msg), num);
+		nng_msg_free(msg);
+	}
+
+	// The last write may still be finishing up on the sending side.
+	for (int i = 0; i < 100; i++) {
+		NUTS_PASS(nng_stats_get(&stats));
+		msgs   = tcp_stat_sum(stats, "tx_msgs");
+		writes = tcp_stat_sum(stats, "tx_writes");
+		nng_stats_free(stats);
+		if (msgs == COUNT) {
+			break;
+		}
+		NUTS_SLEEP(10);
+	}
+	NUTS_TRUE(msgs == COUNT);
+	NUTS_TRUE(writes > 0);
+	NUTS_TRUE(writes < msgs / 4);
+	printf("  %u messages in %u writes\n", (unsigned) msgs,
+	    (unsigned) writes);
+
+	NUTS_CLOSE(sub);
+	NUTS_CLOSE(pub);
+}
+
+static size_t
+tcp_recv_batch_size(int i)
+{
+	// Mostly small, with some that are read straight into the message,
+	// and a few larger than the receive buffer.
+	if ((i % 50) == 49) {
+		return (100000);
+	}
+	return ((i % 5) == 4 ? 5000 : (size_t) (i % 3) * 40);
+}
+
+void
+test_tcp_recv_batch(void)
+{
+	enum { COUNT = 200 };
+	nng_socket   push;
+	nng_socket   pull;
+	nng_listener l;
+	nng_stat    *stats;
+	char        *addr;
+	uint64_t     msgs;
+	uint64_t     reads;
+
+	NUTS_ADDR(addr, "tcp");
+
+	// Writing the messages together lets the reader find several at
+	// once, whatever the scheduling.
+	NUTS_PASS(nng_push0_open(&push));
+	NUTS_PASS(nng_pull0_open(&pull));
+	NUTS_PASS(nng_socket_set_int(push, NNG_OPT_SENDBUF, COUNT));
+	NUTS_PASS(nng_socket_set_ms(push, NNG_OPT_SENDTIMEO, 5000));
+	NUTS_PASS(nng_socket_set_ms(pull, NNG_OPT_RECVTIMEO, 5000));
+	NUTS_PASS(nng_listener_create(&l, push, addr));
+	NUTS_PASS(nng_listener_set_ms(l, NNG_OPT_TCP_SEND_DELAY, 20));
+	NUTS_PASS(nng_listener_start(l, 0));
+	NUTS_PASS(nng_dial(pull, addr, NULL, 0));
+	NUTS_SLEEP(100);
+
+	for (int i = 0; i < COUNT; i++) {
+		nng_msg *msg;
+		size_t   len = tcp_recv_batch_size(i);
+		NUTS_PASS(nng_msg_alloc(&msg, len));
+		for (size_t j = 0; j < len; j++) {
+			((uint8_t *) nng_msg_body(msg))[j] = (uint8_t) (i + j);
+		}
+		NUTS_PASS(nng_sendmsg(push, msg, 0));
+	}
+	for (int i = 0; i < COUNT; i++) {
+		nng_msg *msg;
+		size_t   len = tcp_recv_batch_size(i);
+		bool     ok  = true;
+		NUTS_PASS(nng_recvmsg(pull, &msg, 0));
+		NUTS_TRUE(nng_msg_len(msg) == len);
+		for (size_t j = 0; ok && (j < len); j++) {
+			ok = ((uint8_t *) nng_msg_body(msg))[j] ==
+			    (uint8_t) (i + j);
+		}
+		NUTS_TRUE(ok);
+		nng_msg_free(msg);
+	}
+
+	NUTS_PASS(nng_stats_get(&stats));
+	msgs  = tcp_stat_sum(stats, "rx_msgs");
+	reads = tcp_stat_sum(stats, "rx_reads");
+	nng_stats_free(stats);
+	NUTS_TRUE(msgs == COUNT);
+	NUTS_TRUE(reads > 0);
+	NUTS_TRUE(reads < msgs / 2);
+	printf("  %u messages in %u reads\n", (unsigned) msgs,
+	    (unsigned) reads);
+
+	NUTS_CLOSE(pull);
+	NUTS_CLOSE(push);
+}
+
+static void
+tcp_inline_sender(void *arg)
+{
+	nng_socket s = *(nng_socket *) arg;
+	char       buf[600];
+
+	memset(buf, 'x', sizeof(buf));
+	while (nng_send(s, buf, sizeof(buf), 0) == 0) {
+		continue;
+	}
+}
+
+// Pipe reads and writes complete on the poller thread, and hand off to
+// the protocol from there.  Run traffic both ways, then close the sockets
+// while completions are still arriving.
+void
+test_tcp_inline_completion(void)
+{
+	for (int i = 0; i < 20; i++) {
+		nng_socket   push;
+		nng_socket   pull;
+		nng_listener l;
+		nng_thread  *thr;
+		char         addr[64];
+		int          port;
+
+		NUTS_PASS(nng_push0_open(&push));
+		NUTS_PASS(nng_pull0_open(&pull));
+		NUTS_PASS(nng_socket_set_ms(push, NNG_OPT_SENDTIMEO, 1000));
+		NUTS_PASS(nng_socket_set_ms(pull, NNG_OPT_RECVTIMEO, 1000));
+		NUTS_PASS(nng_listen(pull, "tcp://127.0.0.1:0", &l, 0));
+		NUTS_PASS(
+		    nng_listener_get_int(l, NNG_OPT_TCP_BOUND_PORT, &port));
+		(void) snprintf(addr, sizeof(addr), "tcp://127.0.0.1:%d", port);
+		NUTS_PASS(nng_dial(push, addr, NULL, 0));
+		NUTS_PASS(nng_thread_create(&thr, tcp_inline_sender, &push));
+
+		for (int j = 0; j < 50 + i * 10; j++) {
+			char   buf[600];
+			size_t sz = sizeof(buf);
+			NUTS_PASS(nng_recv(pull, buf, &sz, 0));
+			NUTS_TRUE(sz == sizeof(buf));
+		}
+		if ((i % 2) == 0) {
+			NUTS_CLOSE(pull);
+			NUTS_CLOSE(push);
+		} else {
+			NUTS_CLOSE(push);
+			NUTS_CLOSE(pull);
+		}
+		nng_thread_destroy(thr);
+	}
+}
+
+void
+test_tcp_zerocopy(void)
+{
+	enum { COUNT = 24, BIG = 1 << 20 };
+	nng_socket   push;
+	nng_socket   pull;
+	nng_listener l;
+	nng_dialer   d;
+	size_t       sz;
+	char        *addr;
+#ifdef NNG_PLATFORM_LINUX
+	nng_pipe p;
+#endif
+
+	NUTS_ADDR(addr, "tcp");
+	NUTS_PASS(nng_push0_open(&push));
+	NUTS_PASS(nng_pull0_open(&pull));
+	NUTS_PASS(nng_socket_set_ms(push, NNG_OPT_SENDTIMEO, 5000));
+	NUTS_PASS(nng_socket_set_ms(pull, NNG_OPT_RECVTIMEO, 5000));
+	NUTS_PASS(nng_listener_create(&l, push, addr));
+	NUTS_PASS(nng_dialer_create(&d, pull, addr));
+	NUTS_PASS(nng_listener_get_size(l, NNG_OPT_TCP_ZEROCOPY, &sz));
+	NUTS_TRUE(sz == 0);
+	NUTS_FAIL(nng_listener_set_bool(l, NNG_OPT_TCP_ZEROCOPY, true),
+	    NNG_EBADTYPE);
+
+#ifdef NNG_PLATFORM_LINUX
+	NUTS_PASS(nng_listener_set_size(l, NNG_OPT_TCP_ZEROCOPY, 65536));
+	NUTS_PASS(nng_listener_get_size(l, NNG_OPT_TCP_ZEROCOPY, &sz));
+	NUTS_TRUE(sz == 65536);
+	NUTS_PASS(nng_dialer_set_size(d, NNG_OPT_TCP_ZEROCOPY, 4096));
+	NUTS_PASS(nng_dialer_get_size(d, NNG_OPT_TCP_ZEROCOPY, &sz));
+	NUTS_TRUE(sz == 4096);
+	NUTS_PASS(nng_listener_start(l, 0));
+	NUTS_PASS(nng_dialer_start(d, 0));
+
+	// Large messages go out from their bodies, the small ones in
+	// between are copied as usual, and they must all arrive intact
+	// and in order.  (Loopback makes the kernel copy after all, but
+	// we still have to wait for it to say so.)
+	// PULL does not buffer, so take each message as it comes.
+	for (int i = 0; i < COUNT; i++) {
+		nng_msg *msg;
+		size_t   len = (i % 3) ? BIG : 100;
+		bool     ok  = true;
+		NUTS_PASS(nng_msg_alloc(&msg, len));
+		for (size_t j = 0; j < len; j += 4096) {
+			((uint8_t *) nng_msg_body(msg))[j] = (uint8_t) (i + j);
+		}
+		NUTS_PASS(nng_sendmsg(push, msg, 0));
+		NUTS_PASS(nng_recvmsg(pull, &msg, 0));
+		NUTS_TRUE(nng_msg_len(msg) == len);
+		for (size_t j = 0; ok && (j < len); j += 4096) {
+			ok = ((uint8_t *) nng_msg_body(msg))[j] ==
+			    (uint8_t) (i + j);
+		}
+		NUTS_TRUE(ok);
+		p = nng_msg_get_pipe(msg);
+		nng_msg_free(msg);
+	}
+
+	// The connection has it too.
+	NUTS_PASS(nng_pipe_get_size(p, NNG_OPT_TCP_ZEROCOPY, &sz));
+	NUTS_TRUE(sz == 4096);
+#else
+	NUTS_FAIL(nng_listener_set_size(l, NNG_OPT_TCP_ZEROCOPY, 65536),
+	    NNG_ENOTSUP);
+	NUTS_PASS(nng_listener_set_size(l, NNG_OPT_TCP_ZEROCOPY, 0));
+#endif
+	NUTS_CLOSE(pull);
+	NUTS_CLOSE(push);
+}
+
+#ifdef NNG_PLATFORM_LINUX
+// A zerocopy write that is canceled, or whose connection is closed, while
+// the kernel still has some of it to send must not complete before the
+// kernel is done with the buffer.  Otherwise the caller changes it, and
+// the peer may get the changed data.
+static void
+tcp_zerocopy_abandon(bool close)
+{
+	enum { SIZE = 8 << 20, RSIZE = 65536 };
+	nng_stream_listener *l;
+	nng_stream_dialer   *d;
+	nng_stream          *c1;
+	nng_stream          *c2;
+	nng_aio             *aio;
+	nng_iov              iov;
+	uint8_t             *buf;
+	uint8_t             *rbuf;
+	size_t               got;
+	bool                 ok;
+	int                  port;
+	char                 addr[64];
+
+	NUTS_ASSERT((buf = malloc(SIZE)) != NULL);
+	NUTS_ASSERT((rbuf = malloc(RSIZE)) != NULL);
+	for (size_t j = 0; j < SIZE; j++) {
+		buf[j] = (uint8_t) (j % 251);
+	}
+	NUTS_PASS(nng_aio_alloc(&aio, NULL, NULL));
+	nng_aio_set_timeout(aio, 1000);
+	NUTS_PASS(nng_stream_listener_alloc(&l, "tcp://127.0.0.1:0"));
+	NUTS_PASS(nng_stream_listener_listen(l));
+	NUTS_PASS(
+	    nng_stream_listener_get_int(l, NNG_OPT_TCP_BOUND_PORT, &port));
+	(void) snprintf(addr, sizeof(addr), "tcp://127.0.0.1:%d", port);
+	NUTS_PASS(nng_stream_dialer_alloc(&d, addr));
+	NUTS_PASS(nng_stream_dialer_set_size(d, NNG_OPT_TCP_ZEROCOPY, 4096));
+	nng_stream_dialer_dial(d, aio);
+	nng_aio_wait(aio);
+	NUTS_PASS(nng_aio_result(aio));
+	c1 = nng_aio_get_output(aio, 0);
+	nng_stream_listener_accept(l, aio);
+	nng_aio_wait(aio);
+	NUTS_PASS(nng_aio_result(aio));
+	c2 = nng_aio_get_output(aio, 0);
+
+	// The peer is not reading yet, so most of this stays with us.
+	iov.iov_buf = buf;
+	iov.iov_len = SIZE;
+	NUTS_PASS(nng_aio_set_iov(aio, 1, &iov));
+	nng_stream_send(c1, aio);
+	NUTS_SLEEP(100);
+	NUTS_TRUE(nng_aio_busy(aio));
+	if (close) {
+		nng_stream_close(c1);
+	} else {
+		nng_aio_cancel(aio);
+	}
+	nng_aio_wait(aio);
+	NUTS_FAIL(nng_aio_result(aio), close ? NNG_ECLOSED : NNG_ECANCELED);
+	memset(buf, 0xff, SIZE);
+
+	// Whatever does arrive is what we sent.
+	got = 0;
+	ok  = true;
+	for (;;) {
+		iov.iov_buf = rbuf;
+		iov.iov_len = RSIZE;
+		NUTS_PASS(nng_aio_set_iov(aio, 1, &iov));
+		nng_stream_recv(c2, aio);
+		nng_aio_wait(aio);
+		if (nng_aio_result(aio) != 0) {
+			break;
+		}
+		for (size_t j = 0; j < nng_aio_count(aio); j++) {
+			if (rbuf[j] != (uint8_t) ((got + j) % 251)) {
+				ok = false;
+			}
+		}
+		got += nng_aio_count(aio);
+	}
+	NUTS_TRUE(ok);
+	NUTS_TRUE(got < SIZE);
+	NUTS_TRUE(nng_aio_result(aio) != NNG_ETIMEDOUT);
+
+	nng_stream_free(c1);
+	nng_stream_free(c2);
+	nng_stream_dialer_free(d);
+	nng_stream_listener_free(l);
+	nng_aio_free(aio);
+	free(rbuf);
+	free(buf);
+}
+#endif
+
+void
+test_tcp_zerocopy_cancel(void)
+{
+#ifdef NNG_PLATFORM_LINUX
+	tcp_zerocopy_abandon(false);
+#endif
+}
+
+void
+test_tcp_zerocopy_close(void)
+{
+#ifdef NNG_PLATFORM_LINUX
+	tcp_zerocopy_abandon(true);
+#endif
+}
+
+typedef struct {
+	nng_socket s;
+	int        count;
+	int        size;
+	int        rv;
+} tcp_bench_sender;
+
+static void
+tcp_bench_send(void *arg)
+{
+	tcp_bench_sender *snd = arg;
+	char              buf[1024];
+
+	memset(buf, 'T', sizeof(buf));
+	for (int i = 0; i < snd->count; i++) {
+		if ((snd->rv = nng_send(snd->s, buf, snd->size, 0)) != 0) {
+			break;
+		}
+	}
+}
+
+// Benchmark the aggregate throughput of many connections feeding one
+// listener, which spreads the I/O over all of the poller threads (or
+// rings, with io_uring).
+static void
+tcp_bench_many_conn(int npoll, bool uring)
+{
+	enum { NCONN = 64, COUNT = 2000, SIZE = 512 };
+	static tcp_bench_sender snd[NCONN];
+	nng_thread             *thr[NCONN];
+	nng_socket              pull;
+	nng_listener            l;
+	char                    addr[NNG_MAXADDRLEN];
+	int                     port;
+	char                    buf[SIZE];
+	size_t                  sz;
+	uint64_t                t0, t1;
+
+	// Restart with the given number of poller threads.
+	nng_fini();
+	nng_init_set_parameter(NNG_INIT_NUM_POLLER_THREADS, npoll);
+	nng_init_set_parameter(NNG_INIT_MAX_POLLER_THREADS, 0);
+	nng_init_set_parameter(NNG_INIT_IO_URING, uring ? 1 : 0);
+
+	NUTS_PASS(nng_pull0_open(&pull));
+	NUTS_PASS(nng_socket_set_ms(pull, NNG_OPT_RECVTIMEO, 5000));
+	NUTS_PASS(nng_listen(pull, "tcp://127.0.0.1:0", &l, 0));
+	NUTS_PASS(nng_listener_get_int(l, NNG_OPT_TCP_BOUND_PORT, &port));
+	(void) snprintf(addr, sizeof(addr), "tcp://127.0.0.1:%d", port);
+	for (int i = 0; i < NCONN; i++) {
+		NUTS_PASS(nng_push0_open(&snd[i].s));
+		NUTS_PASS(nng_socket_set_ms(snd[i].s, NNG_OPT_SENDTIMEO, 5000));
+		NUTS_PASS(nng_dial(snd[i].s, addr, NULL, 0));
+		snd[i].count = COUNT;
+		snd[i].size  = SIZE;
+		snd[i].rv    = 0;
+	}
+
+	NUTS_CLOCK(t0);
+	for (int i = 0; i < NCONN; i++) {
+		NUTS_PASS(nng_thread_create(&thr[i], tcp_bench_send, &snd[i]));
+	}
+	for (int i = 0; i < NCONN * COUNT; i++) {
+		sz = sizeof(buf);
+		NUTS_PASS(nng_recv(pull, buf, &sz, 0));
+		NUTS_ASSERT(sz == SIZE);
+	}
+	NUTS_CLOCK(t1);
+	for (int i = 0; i < NCONN; i++) {
+		nng_thread_destroy(thr[i]);
+		NUTS_PASS(snd[i].rv);
+		NUTS_CLOSE(snd[i].s);
+	}
+	NUTS_CLOSE(pull);
+
+	NUTS_ASSERT(nni_init_get_effective(NNG_INIT_NUM_POLLER_THREADS) ==
+	    (uint64_t) npoll);
+	// Without io_uring (other platforms, or old kernels) this is
+	// just epoll again.
+	uring = (nni_init_get_effective(NNG_INIT_IO_URING) == 1);
+	if (t1 == t0) {
+		t1++;
+	}
+	printf("  %d connections, %d x %d bytes each, %u poller threads%s: "
+	       "%u ms, %u msgs/s\n",
+	    NCONN, COUNT, SIZE, npoll, uring ? " (io_uring)" : "",
+	    (unsigned) (t1 - t0),
+	    (unsigned) ((uint64_t) NCONN * COUNT * 1000 / (t1 - t0)));
+	nng_fini();
+}
+
+void
+test_tcp_many_conn_throughput(void)
+{
+	tcp_bench_many_conn(1, false);
+	tcp_bench_many_conn(4, false);
+	tcp_bench_many_conn(1, true);
+	tcp_bench_many_conn(4, true);
+}
+
 NUTS_TESTS = {
 
 	{ "tcp wild card connect fail", test_tcp_wild_card_connect_fail },
@@ -289,6 +916,16 @@ NUTS_TESTS = {
 	{ "tcp malformed address", test_tcp_malformed_address },
 	{ "tcp no delay option", test_tcp_no_delay_option },
 	{ "tcp keep alive option", test_tcp_keep_alive_option },
+	{ "tcp reuseport option", test_tcp_reuseport_option },
 	{ "tcp recv max", test_tcp_recv_max },
+	{ "tcp send delay option", test_tcp_send_delay_option },
+	{ "tcp send delay full", test_tcp_send_delay_full },
+	{ "tcp send coalesce", test_tcp_send_coalesce },
+	{ "tcp recv batch", test_tcp_recv_batch },
+	{ "tcp inline completion", test_tcp_inline_completion },
+	{ "tcp zerocopy", test_tcp_zerocopy },
+	{ "tcp zerocopy cancel", test_tcp_zerocopy_cancel },
+	{ "tcp zerocopy close", test_tcp_zerocopy_close },
+	{ "tcp many connection throughput", test_tcp_many_conn_throughput },
 	{ NULL, NULL },
 };
@@ -3,21 +3,130 @@ const binding = require('../build/Release/nng_bindings.node');
 // Protocol constants
 const Protocol = binding.Protocol;
 
+// Duration sentinel: use the socket's send-timeout/recv-timeout option
+const DURATION_DEFAULT = -2;
+
+// Options that carry an nng_duration rather than a plain integer
+const DURATION_OPTIONS = new Set([
+    'recv-timeout',
+    'send-timeout',
+    'reconnect-time-min',
+    'reconnect-time-max',
+    'req:resend-time',
+    'surveyor:survey-time'
+]);
+
+function isDurationOption(name) {
+    return name.endsWith(':ms') || DURATION_OPTIONS.has(name);
+}
+
+// Run a cancellable native aio operation, wiring an AbortSignal to it
+async function runAioOp(start, options) {
+    const { signal, timeoutMs } = options;
+
+    if (timeoutMs !== undefined && (!Number.isInteger(timeoutMs) || timeoutMs < 0)) {
+        throw new Error('timeoutMs must be a non-negative integer');
+    }
+    if (signal && signal.aborted) {
+        throw abortError(signal);
+    }
+
+    const op = start(timeoutMs === undefined ? DURATION_DEFAULT : timeoutMs);
+    if (!signal) {
+        return op.promise;
+    }
+
+    const onAbort = () => binding.aioCancel(op.id);
+    signal.addEventListener('abort', onAbort, { once: true });
+    try {
+        return await op.promise;
+    } catch (err) {
+        throw signal.aborted ? abortError(signal) : err;
+    } finally {
+        signal.removeEventListener('abort', onAbort);
+    }
+}
+
+function abortError(signal) {
+    const err = new Error('The operation was aborted');
+    err.name = 'AbortError';
+    err.cause = signal.reason;
+    return err;
+}
+
 // Socket class wrapper
 class Socket {
-    constructor(protocol) {
-        this._id = binding.socketOpen(protocol);
+    // options.raw opens the raw variant of the protocol, which carries
+    // protocol headers through untouched and is meant for devices.
+    constructor(protocol, options = {}) {
+        this._id = binding.socketOpen(protocol, options.raw === true);
         this._closed = false;
         this._recvCallback = null;
+        this._poller = null;
+        this._batching = false;
     }
 
-    startRecv(callback) {
+    startRecv(callback, options = {}) {
         if (this._closed) throw new Error('Socket is closed');
         if (typeof callback !== 'function') {
             throw new Error('Callback must be a function');
         }
+        if (options.filter !== undefined && (options.filter === null || typeof options.filter !== 'object')) {
+            throw new Error('Filter must be an object');
+        }
+        if (options.pool !== undefined && (options.pool === null || typeof options.pool !== 'object')) {
+            throw new Error('Pool must be an object');
+        }
+        if (options.batched !== undefined && typeof options.batched !== 'boolean') {
+            throw new Error('batched must be a boolean');
+        }
+        if (options.batched && options.pool) {
+            throw new Error('Batched receive cannot use a pool');
+        }
         this._recvCallback = callback;
-        binding.socketStartRecv(this._id, callback);
+
+        // Pooled messages arrive as (err, slab, offset, length) and are
+        // handed to the callback as Buffer views into the slab.
+        // Batched envelopes arrive as (err, records, lengths) and are
+        // handed to the callback as an array of Buffer views.
+        let deliver = callback;
+        if (options.batched) {
+            deliver = (err, data, lengths) => {
+                if (lengths === undefined) {
+                    callback(err, null);
+                    return;
+                }
+                const messages = new Array(lengths.length);
+                let offset = 0;
+                for (let i = 0; i < lengths.length; i++) {
+                    messages[i] = data.subarray(offset, offset + lengths[i]);
+                    offset += lengths[i];
+                }
+                callback(err, messages);
+            };
+        } else if (options.pool) {
+            deliver = (err, data, offset, length) => {
+                if (offset === undefined) {
+                    callback(err, data);
+                } else {
+                    callback(err, Buffer.from(data, offset, length));
+                }
+            };
+        }
+        binding.socketStartRecv(this._id, deliver, options);
+    }
+
+    // Return a pooled receive buffer to its slab. The buffer must not be
+    // used afterwards; returns false unless it is a delivered pooled buffer,
+    // whole and not yet released.
+    release(buffer) {
+        if (this._closed) return false;
+        return binding.socketRecvRelease(this._id, buffer);
+    }
+
+    recvStats() {
+        if (this._closed) throw new Error('Socket is closed');
+        return binding.socketRecvStats(this._id);
     }
 
     stopRecv() {
@@ -40,7 +149,7 @@ class Socket {
         binding.socketDial(this._id, url);
     }
 
-    async send(data) {
+    async send(data, options = {}) {
         if (this._closed) throw new Error('Socket is closed');
 
         let buffer;
@@ -52,11 +161,97 @@ class Socket {
             throw new Error('Data must be a Buffer or string');
         }
 
+        if (this._batching) {
+            if (options.signal || options.timeoutMs !== undefined) {
+                throw new Error('signal and timeoutMs are not supported while batching');
+            }
+            binding.socketBatchSend(this._id, buffer);
+            return;
+        }
+        if (options.signal || options.timeoutMs !== undefined) {
+            return runAioOp(timeout => binding.socketSendAio(this._id, buffer, timeout), options);
+        }
         return binding.socketSend(this._id, buffer);
     }
 
-    async recv() {
+    async sendMany(items) {
+        if (this._closed) throw new Error('Socket is closed');
+        if (!Array.isArray(items)) {
+            throw new Error('Data must be an array of Buffers or strings');
+        }
+
+        const buffers = items.map(data => {
+            if (Buffer.isBuffer(data)) {
+                return data;
+            } else if (typeof data === 'string') {
+                return Buffer.from(data, 'utf8');
+            }
+            throw new Error('Data must be a Buffer or string');
+        });
+
+        if (this._batching) {
+            for (let i = 0; i < buffers.length; i++) {
+                try {
+                    binding.socketBatchSend(this._id, buffers[i]);
+                } catch (err) {
+                    err.sent = i;
+                    throw err;
+                }
+            }
+            return buffers.length;
+        }
+
+        // Resolves with the number of messages sent; on failure the
+        // rejection error carries the count accepted before it in `sent`.
+        return binding.socketSendMany(this._id, buffers);
+    }
+
+    // Coalesce sends into varint-framed envelopes: { maxDelayMs, maxBytes,
+    // maxMessages, maxQueued }, or null to turn batching off (unsent
+    // messages are dropped; flush() first). Peers must receive with
+    // { batched: true }. Sends fail with NNG_EAGAIN while maxQueued
+    // envelopes (default 64) are waiting to go out.
+    setBatching(options) {
+        if (this._closed) throw new Error('Socket is closed');
+        if (options === null || options === false) {
+            if (this._batching) {
+                binding.socketBatchStop(this._id);
+                this._batching = false;
+            }
+            return;
+        }
+        if (typeof options !== 'object') {
+            throw new Error('Batching options must be an object or null');
+        }
+        for (const key of ['maxDelayMs', 'maxBytes', 'maxMessages', 'maxQueued']) {
+            const value = options[key];
+            if (value !== undefined && (!Number.isInteger(value) || value < 0)) {
+                throw new Error(`${key} must be a non-negative integer`);
+            }
+        }
+        binding.socketBatchStart(this._id, options);
+        this._batching = true;
+    }
+
+    // Send the current envelope now; resolves once everything batched so
+    // far has been handed to the transport, or rejects with the number of
+    // messages that failed in `failed`.
+    async flush() {
+        if (this._closed) throw new Error('Socket is closed');
+        if (!this._batching) return;
+        return binding.socketBatchFlush(this._id);
+    }
+
+    batchStats() {
         if (this._closed) throw new Error('Socket is closed');
+        return this._batching ? binding.socketBatchStats(this._id) : null;
+    }
+
+    async recv(options = {}) {
+        if (this._closed) throw new Error('Socket is closed');
+        if (options.signal || options.timeoutMs !== undefined) {
+            return runAioOp(timeout => binding.socketRecvAio(this._id, timeout), options);
+        }
         return binding.socketRecv(this._id);
     }
 
@@ -66,7 +261,7 @@ class Socket {
         if (typeof value === 'string') {
             binding.socketSetoptString(this._id, name, value);
         } else if (typeof value === 'number') {
-            if (name.endsWith(':ms') || name === 'recv-timeout' || name === 'send-timeout') {
+            if (isDurationOption(name)) {
                 binding.socketSetoptMs(this._id, name, value);
             } else {
                 binding.socketSetoptInt(this._id, name, value);
@@ -76,6 +271,27 @@ class Socket {
         }
     }
 
+    // Open a context on this socket (REQ, REP, SURVEYOR, RESPONDENT, SUB)
+    openContext() {
+        if (this._closed) throw new Error('Socket is closed');
+        return new Context(this);
+    }
+
+    // One survey round on a fresh context; resolves with every response
+    // gathered before the survey time (options.timeoutMs, or the socket's
+    // surveyor:survey-time) expires.
+    async survey(data, options = {}) {
+        const ctx = this.openContext();
+        try {
+            if (options.timeoutMs !== undefined) {
+                ctx.setOpt('surveyor:survey-time', options.timeoutMs);
+            }
+            return await ctx.survey(data);
+        } finally {
+            ctx.close();
+        }
+    }
+
     getOpt(name) {
         if (this._closed) throw new Error('Socket is closed');
 
@@ -89,6 +305,14 @@ class Socket {
 
     close() {
         if (!this._closed) {
+            // Leave any poller before closing
+            if (this._poller) {
+                this._poller.remove(this);
+            }
+            if (this._batching) {
+                binding.socketBatchStop(this._id);
+                this._batching = false;
+            }
             // Stop receiving before closing
             if (this._recvCallback) {
                 try {
@@ -104,6 +328,68 @@ class Socket {
     }
 }
 
+// Context class wrapper: an independent protocol state machine on a socket,
+// so several surveys can be in flight on one SURVEYOR socket.
+class Context {
+    constructor(socket) {
+        if (!(socket instanceof Socket)) {
+            throw new Error('First argument must be a Socket instance');
+        }
+        this._id = binding.ctxOpen(socket.id);
+        this._closed = false;
+    }
+
+    get id() {
+        return this._id;
+    }
+
+    setOpt(name, value) {
+        if (this._closed) throw new Error('Context is closed');
+        if (typeof value !== 'number') {
+            throw new Error('Value must be a number');
+        }
+
+        if (isDurationOption(name)) {
+            binding.ctxSetoptMs(this._id, name, value);
+        } else {
+            binding.ctxSetoptInt(this._id, name, value);
+        }
+    }
+
+    // Send a survey and resolve with the array of response Buffers
+    // received before surveyor:survey-time expires.
+    async survey(data) {
+        if (this._closed) throw new Error('Context is closed');
+
+        let buffer;
+        if (Buffer.isBuffer(data)) {
+            buffer = data;
+        } else if (typeof data === 'string') {
+            buffer = Buffer.from(data, 'utf8');
+        } else {
+            throw new Error('Data must be a Buffer or string');
+        }
+
+        return binding.ctxSurvey(this._id, buffer);
+    }
+
+    close() {
+        if (!this._closed) {
+            binding.ctxClose(this._id);
+            this._closed = true;
+        }
+    }
+}
+
+// Forward messages between two raw sockets natively until either socket
+// is closed. A single socket forwards back to itself (reflector).
+function device(socket1, socket2) {
+    if (!(socket1 instanceof Socket) || !(socket2 instanceof Socket)) {
+        throw new Error('Arguments must be Socket instances');
+    }
+    return binding.socketDevice(socket1.id, socket2.id);
+}
+
 // Dialer class wrapper
 class Dialer {
     constructor(socket, url) {
@@ -142,6 +428,58 @@ class Listener {
         binding.listenerStart(this._id);
     }
 
+    // Hand an already-connected stream to a started socket:// listener.
+    // Accepts a file descriptor or a net.Socket; the descriptor is
+    // duplicated natively and a net.Socket is destroyed afterwards. The
+    // stream must not have been read by Node past any bytes the caller
+    // consumed itself (use net.createServer({ pauseOnConnect: true })).
+    adoptFd(fdOrSocket) {
+        if (this._closed) throw new Error('Listener is closed');
+
+        if (typeof fdOrSocket === 'number') {
+            binding.listenerAdoptFd(this._id, fdOrSocket);
+            return;
+        }
+
+        const handle = fdOrSocket && fdOrSocket._handle;
+        if (!handle || typeof handle.fd !== 'number' || handle.fd < 0) {
+            throw new Error('Argument must be a file descriptor or a connected net.Socket');
+        }
+        fdOrSocket.pause();
+        binding.listenerAdoptFd(this._id, handle.fd);
+        fdOrSocket.destroy();
+    }
+
+    // Bind-time options such as 'tcp-reuseport' must be set before start()
+    setOpt(name, value) {
+        if (this._closed) throw new Error('Listener is closed');
+
+        if (typeof value === 'boolean') {
+            binding.listenerSetoptBool(this._id, name, value);
+        } else if (typeof value === 'string') {
+            binding.listenerSetoptString(this._id, name, value);
+        } else if (typeof value === 'number') {
+            if (isDurationOption(name)) {
+                binding.listenerSetoptMs(this._id, name, value);
+            } else {
+                binding.listenerSetoptInt(this._id, name, value);
+            }
+        } else {
+            throw new Error('Value must be a boolean, string or number');
+        }
+    }
+
+    getOpt(name) {
+        if (this._closed) throw new Error('Listener is closed');
+
+        // Try to get as bool first, fall back to int
+        try {
+            return binding.listenerGetoptBool(this._id, name);
+        } catch (e) {
+            return binding.listenerGetoptInt(this._id, name);
+        }
+    }
+
     close() {
         if (!this._closed) {
             binding.listenerClose(this._id);
@@ -150,37 +488,198 @@ class Listener {
     }
 }
 
+// Poller class wrapper: receives from many sockets through one callback.
+// The callback is invoked with (err, batch), where batch is an array of
+// { socket, data } entries (or { socket, error }) in arrival order. An
+// error entry ends that socket's polling; remove and add it to resume.
+class Poller {
+    constructor(callback) {
+        if (typeof callback !== 'function') {
+            throw new Error('Callback must be a function');
+        }
+        this._id = binding.pollerCreate(callback);
+        this._sockets = new Set();
+        this._closed = false;
+    }
+
+    add(socket) {
+        if (this._closed) throw new Error('Poller is closed');
+        if (!(socket instanceof Socket)) {
+            throw new Error('Argument must be a Socket instance');
+        }
+        if (socket._poller) {
+            throw new Error('Socket already belongs to a poller');
+        }
+        binding.pollerAdd(this._id, socket.id);
+        socket._poller = this;
+        this._sockets.add(socket);
+    }
+
+    remove(socket) {
+        if (this._closed || !this._sockets.has(socket)) return;
+        binding.pollerRemove(this._id, socket.id);
+        socket._poller = null;
+        this._sockets.delete(socket);
+    }
+
+    get size() {
+        return this._sockets.size;
+    }
+
+    close() {
+        if (!this._closed) {
+            binding.pollerClose(this._id);
+            for (const socket of this._sockets) {
+                socket._poller = null;
+            }
+            this._sockets.clear();
+            this._closed = true;
+        }
+    }
+}
+
+// HTTP server wrapper over NNG's native server. Static, file, directory
+// and redirect routes are served natively; route() handlers run in JS and
+// may return a string/Buffer body, { status, headers, body }, or nothing
+// (204). ws:// SP listeners on the same address share this server.
+class HttpServer {
+    constructor(url) {
+        this._routes = [];
+        this._id = binding.httpServerCreate(url, (index, request) => this._dispatch(index, request));
+        this._closed = false;
+    }
+
+    static(path, content, contentType) {
+        if (this._closed) throw new Error('HTTP server is closed');
+        const body = Buffer.isBuffer(content) ? content : Buffer.from(String(content), 'utf8');
+        binding.httpAddStatic(this._id, path, body, contentType);
+        return this;
+    }
+
+    file(path, filePath) {
+        if (this._closed) throw new Error('HTTP server is closed');
+        binding.httpAddFile(this._id, path, filePath);
+        return this;
+    }
+
+    directory(path, dirPath) {
+        if (this._closed) throw new Error('HTTP server is closed');
+        binding.httpAddDirectory(this._id, path, dirPath);
+        return this;
+    }
+
+    redirect(path, location, status = 301) {
+        if (this._closed) throw new Error('HTTP server is closed');
+        binding.httpAddRedirect(this._id, path, status, location);
+        return this;
+    }
+
+    // options: method (default 'GET', null for any), tree (match child
+    // paths), maxBody (bytes of request body to collect), headers (names
+    // of request headers to pass to the handler)
+    route(path, handler, options = {}) {
+        if (this._closed) throw new Error('HTTP server is closed');
+        if (typeof handler !== 'function') {
+            throw new Error('Handler must be a function');
+        }
+        const index = this._routes.length;
+        this._routes.push(handler);
+        const native = {
+            tree: options.tree === true,
+            headers: (options.headers || []).map(String)
+        };
+        if (options.method !== undefined) native.method = options.method;
+        if (options.maxBody !== undefined) native.maxBody = options.maxBody;
+        binding.httpAddRoute(this._id, path, index, native);
+        return this;
+    }
+
+    start() {
+        if (this._closed) throw new Error('HTTP server is closed');
+        binding.httpServerStart(this._id);
+    }
+
+    get port() {
+        if (this._closed) throw new Error('HTTP server is closed');
+        return binding.httpServerPort(this._id);
+    }
+
+    async _dispatch(index, request) {
+        let status = 200;
+        let headers = {};
+        let body;
+        try {
+            const result = await this._routes[index](request);
+            if (result === undefined || result === null) {
+                status = 204;
+            } else if (Buffer.isBuffer(result) || typeof result === 'string') {
+                body = result;
+            } else {
+                status = result.status || 200;
+                headers = result.headers || {};
+                body = result.body;
+            }
+        } catch (err) {
+            status = 500;
+            body = undefined;
+        }
+        if (typeof body === 'string') {
+            body = Buffer.from(body, 'utf8');
+        }
+        binding.httpRespond(request.id, status, headers, body);
+    }
+
+    close() {
+        if (!this._closed) {
+            binding.httpServerClose(this._id);
+            this._closed = true;
+        }
+    }
+}
+
 // Factory functions
-function bus() {
-    return new Socket(Protocol.BUS);
+function bus(options) {
+    return new Socket(Protocol.BUS, options);
+}
+
+function pair(options) {
+    return new Socket(Protocol.PAIR, options);
+}
+
+function pair1(options) {
+    return new Socket(Protocol.PAIR1, options);
+}
+
+function pull(options) {
+    return new Socket(Protocol.PULL, options);
 }
 
-function pair() {
-    return new Socket(Protocol.PAIR);
+function push(options) {
+    return new Socket(Protocol.PUSH, options);
 }
 
-function pull() {
-    return new Socket(Protocol.PULL);
+function pub(options) {
+    return new Socket(Protocol.PUB, options);
 }
 
-function push() {
-    return new Socket(Protocol.PUSH);
+function sub(options) {
+    return new Socket(Protocol.SUB, options);
 }
 
-function pub() {
-    return new Socket(Protocol.PUB);
+function rep(options) {
+    return new Socket(Protocol.REP, options);
 }
 
-function sub() {
-    return new Socket(Protocol.SUB);
+function req(options) {
+    return new Socket(Protocol.REQ, options);
 }
 
-function rep() {
-    return new Socket(Protocol.REP);
+function surveyor(options) {
+    return new Socket(Protocol.SURVEYOR, options);
 }
 
-function req() {
-    return new Socket(Protocol.REQ);
+function respondent(options) {
+    return new Socket(Protocol.RESPONDENT, options);
 }
 
 // Export API
@@ -189,12 +688,19 @@ module.exports = {
     Socket,
     Dialer,
     Listener,
+    Poller,
+    Context,
+    HttpServer,
+    device,
     bus,
     pair,
+    pair1,
     pull,
     push,
     pub,
     sub,
     rep,
-    req
+    req,
+    surveyor,
+    respondent
 };
\ No newline at end of file
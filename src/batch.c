@@ -0,0 +1,661 @@
+#include <node_api.h>
+#include <nng/nng.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+// Shared helpers from nng_bindings.c
+napi_value create_error(napi_env env, int rv);
+
+// Micro-batching.
+//
+// With batching enabled, send() appends the message to the socket's
+// current envelope as a varint (LEB128) length followed by the bytes. The
+// envelope goes out as one NNG message once it reaches maxBytes or
+// maxMessages, or when the delay timer fires, whichever comes first.
+// Envelopes are sent one at a time on a single aio, so ordering holds.
+// At most maxQueued sealed envelopes wait for it; past that send() fails
+// with NNG_EAGAIN rather than let a stalled socket grow memory unbounded.
+// Receivers opt in with startRecv(cb, { batched: true }) and get each
+// envelope unpacked natively into an array of messages.
+
+typedef struct BatchEnvelope {
+    nng_msg *msg;
+    uint32_t count;
+    struct BatchEnvelope *next;
+} BatchEnvelope;
+
+typedef struct FlushWaiter {
+    napi_deferred deferred;
+    struct FlushWaiter *next;
+} FlushWaiter;
+
+typedef struct {
+    uint32_t socket_id;
+    nng_socket sock;
+    pthread_mutex_t mutex;
+    size_t max_bytes;
+    uint32_t max_messages;
+    uint32_t max_queued;
+    nng_duration delay;
+    nng_msg *pending;         // envelope being filled
+    uint32_t pending_count;
+    BatchEnvelope *head;      // sealed, waiting for the send aio
+    BatchEnvelope *tail;
+    uint32_t queued;          // envelopes on the head/tail list
+    uint32_t inflight_count;  // messages in the envelope being sent
+    bool timer_running;
+    bool sending;
+    bool closed;
+    nng_aio *timer_aio;
+    nng_aio *send_aio;
+    napi_threadsafe_function tsfn;
+    FlushWaiter *waiters;
+    uint64_t messages;
+    uint64_t batches;
+    uint64_t failed;
+    uint64_t failed_since_flush;
+    int last_error;
+} Batcher;
+
+// Global batcher storage, one per socket
+#define MAX_BATCHERS 256
+static Batcher* g_batchers[MAX_BATCHERS] = {0};
+static pthread_mutex_t g_batcher_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Find batcher by socket ID
+static Batcher* find_batcher(uint32_t socket_id) {
+    pthread_mutex_lock(&g_batcher_mutex);
+    Batcher *b = NULL;
+    for (int i = 0; i < MAX_BATCHERS; i++) {
+        if (g_batchers[i] && g_batchers[i]->socket_id == socket_id) {
+            b = g_batchers[i];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_batcher_mutex);
+    return b;
+}
+
+// Store batcher
+static int store_batcher(Batcher *b) {
+    pthread_mutex_lock(&g_batcher_mutex);
+    int slot = -1;
+    for (int i = 0; i < MAX_BATCHERS; i++) {
+        if (g_batchers[i] == NULL) {
+            g_batchers[i] = b;
+            slot = i;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_batcher_mutex);
+    return slot;
+}
+
+// Remove batcher
+static void remove_batcher(uint32_t socket_id) {
+    pthread_mutex_lock(&g_batcher_mutex);
+    for (int i = 0; i < MAX_BATCHERS; i++) {
+        if (g_batchers[i] && g_batchers[i]->socket_id == socket_id) {
+            g_batchers[i] = NULL;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_batcher_mutex);
+}
+
+// Encode a length as LEB128; returns the number of bytes written (<= 10)
+size_t batch_encode_varint(uint64_t value, uint8_t *out) {
+    size_t n = 0;
+    do {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        if (value) {
+            byte |= 0x80;
+        }
+        out[n++] = byte;
+    } while (value);
+    return n;
+}
+
+// Decode a LEB128 length; returns bytes consumed, or 0 if malformed
+size_t batch_decode_varint(const uint8_t *in, size_t len, uint64_t *value) {
+    uint64_t result = 0;
+    for (size_t i = 0; i < len && i < 10; i++) {
+        result |= (uint64_t)(in[i] & 0x7F) << (7 * i);
+        if ((in[i] & 0x80) == 0) {
+            *value = result;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+// Move the pending envelope to the send queue (mutex held)
+static void batch_seal(Batcher *b) {
+    if (!b->pending) {
+        return;
+    }
+
+    BatchEnvelope *env = malloc(sizeof(BatchEnvelope));
+    if (env) {
+        env->msg = b->pending;
+        env->count = b->pending_count;
+        env->next = NULL;
+        if (b->tail) {
+            b->tail->next = env;
+        } else {
+            b->head = env;
+        }
+        b->tail = env;
+        b->queued++;
+    } else {
+        nng_msg_free(b->pending);
+        b->failed += b->pending_count;
+        b->failed_since_flush += b->pending_count;
+        b->last_error = NNG_ENOMEM;
+    }
+    b->pending = NULL;
+    b->pending_count = 0;
+}
+
+// Take the next envelope if the send aio is idle (mutex held). The caller
+// submits it with batch_submit after dropping the mutex.
+static BatchEnvelope *batch_next(Batcher *b) {
+    if (b->sending || !b->head) {
+        return NULL;
+    }
+    BatchEnvelope *env = b->head;
+    b->head = env->next;
+    if (!b->head) {
+        b->tail = NULL;
+    }
+    b->queued--;
+    b->sending = true;
+    b->inflight_count = env->count;
+    return env;
+}
+
+// Submit an envelope on the send aio (mutex not held)
+static void batch_submit(Batcher *b, BatchEnvelope *env) {
+    nng_aio_set_msg(b->send_aio, env->msg);
+    free(env);
+    nng_send_aio(b->sock, b->send_aio);
+}
+
+static void batch_timer_callback(void *arg) {
+    Batcher *b = (Batcher *)arg;
+
+    pthread_mutex_lock(&b->mutex);
+    b->timer_running = false;
+    BatchEnvelope *env = NULL;
+    if (!b->closed) {
+        batch_seal(b);
+        env = batch_next(b);
+    }
+    pthread_mutex_unlock(&b->mutex);
+
+    if (env) {
+        batch_submit(b, env);
+    }
+}
+
+static void batch_send_callback(void *arg) {
+    Batcher *b = (Batcher *)arg;
+    int rv = nng_aio_result(b->send_aio);
+
+    pthread_mutex_lock(&b->mutex);
+    if (rv == 0) {
+        b->batches++;
+    } else {
+        // A failed send leaves the message with the aio
+        nng_msg_free(nng_aio_get_msg(b->send_aio));
+        nng_aio_set_msg(b->send_aio, NULL);
+        b->failed += b->inflight_count;
+        b->failed_since_flush += b->inflight_count;
+        b->last_error = rv;
+    }
+    b->inflight_count = 0;
+    b->sending = false;
+
+    BatchEnvelope *env = NULL;
+    bool notify = false;
+    if (!b->closed) {
+        env = batch_next(b);
+        notify = !b->sending && b->waiters != NULL;
+    }
+    pthread_mutex_unlock(&b->mutex);
+
+    if (env) {
+        batch_submit(b, env);
+    }
+    if (notify) {
+        napi_call_threadsafe_function(b->tsfn, NULL, napi_tsfn_nonblocking);
+    }
+}
+
+// Resolve flush() promises once everything sealed so far has been sent
+static void batch_call_js(napi_env env, napi_value js_cb, void *context, void *data) {
+    Batcher *b = (Batcher *)context;
+
+    // env is NULL when the threadsafe function is being torn down
+    if (env == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&b->mutex);
+    if (b->sending || b->head) {
+        pthread_mutex_unlock(&b->mutex);
+        return;
+    }
+    FlushWaiter *waiter = b->waiters;
+    b->waiters = NULL;
+    uint64_t failed = b->failed_since_flush;
+    int last_error = b->last_error;
+    b->failed_since_flush = 0;
+    pthread_mutex_unlock(&b->mutex);
+
+    while (waiter) {
+        FlushWaiter *next = waiter->next;
+        if (failed == 0) {
+            napi_value undefined;
+            napi_get_undefined(env, &undefined);
+            napi_resolve_deferred(env, waiter->deferred, undefined);
+        } else {
+            napi_value error = create_error(env, last_error);
+            napi_value count;
+            napi_create_double(env, (double)failed, &count);
+            napi_set_named_property(env, error, "failed", count);
+            napi_reject_deferred(env, waiter->deferred, error);
+        }
+        free(waiter);
+        waiter = next;
+    }
+
+    napi_unref_threadsafe_function(env, b->tsfn);
+}
+
+static void batch_finalize(napi_env env, void *finalize_data, void *finalize_hint) {
+    Batcher *b = (Batcher *)finalize_data;
+    pthread_mutex_destroy(&b->mutex);
+    free(b);
+}
+
+// Tear down a batcher (JS thread); unsent messages are dropped
+static void batch_destroy(napi_env env, Batcher *b) {
+    remove_batcher(b->socket_id);
+
+    pthread_mutex_lock(&b->mutex);
+    b->closed = true;
+    pthread_mutex_unlock(&b->mutex);
+
+    // No callbacks run past these
+    nng_aio_stop(b->timer_aio);
+    nng_aio_stop(b->send_aio);
+    nng_aio_free(b->timer_aio);
+    nng_aio_free(b->send_aio);
+
+    if (b->pending) {
+        nng_msg_free(b->pending);
+    }
+    BatchEnvelope *envl = b->head;
+    while (envl) {
+        BatchEnvelope *next = envl->next;
+        nng_msg_free(envl->msg);
+        free(envl);
+        envl = next;
+    }
+
+    FlushWaiter *waiter = b->waiters;
+    while (waiter) {
+        FlushWaiter *next = waiter->next;
+        napi_reject_deferred(env, waiter->deferred, create_error(env, NNG_ECLOSED));
+        free(waiter);
+        waiter = next;
+    }
+
+    napi_release_threadsafe_function(b->tsfn, napi_tsfn_abort);
+}
+
+// Enable or reconfigure batching:
+// (socketId, { maxDelayMs, maxBytes, maxMessages, maxQueued })
+static napi_value socket_batch_start(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 2) {
+        napi_throw_error(env, NULL, "Expected socket ID and batching options");
+        return NULL;
+    }
+
+    uint32_t id;
+    napi_get_value_uint32(env, args[0], &id);
+
+    uint32_t delay = 1;
+    uint32_t max_bytes = 16 * 1024;
+    uint32_t max_messages = 1024;
+    uint32_t max_queued = 64;
+    bool has;
+    napi_value val;
+
+    napi_has_named_property(env, args[1], "maxDelayMs", &has);
+    if (has) {
+        napi_get_named_property(env, args[1], "maxDelayMs", &val);
+        napi_get_value_uint32(env, val, &delay);
+    }
+    napi_has_named_property(env, args[1], "maxBytes", &has);
+    if (has) {
+        napi_get_named_property(env, args[1], "maxBytes", &val);
+        napi_get_value_uint32(env, val, &max_bytes);
+    }
+    napi_has_named_property(env, args[1], "maxMessages", &has);
+    if (has) {
+        napi_get_named_property(env, args[1], "maxMessages", &val);
+        napi_get_value_uint32(env, val, &max_messages);
+    }
+    napi_has_named_property(env, args[1], "maxQueued", &has);
+    if (has) {
+        napi_get_named_property(env, args[1], "maxQueued", &val);
+        napi_get_value_uint32(env, val, &max_queued);
+    }
+    if (max_bytes == 0 || max_messages == 0 || max_queued == 0) {
+        napi_throw_range_error(env, NULL, "maxBytes, maxMessages and maxQueued must be positive");
+        return NULL;
+    }
+
+    Batcher *b = find_batcher(id);
+    if (b) {
+        pthread_mutex_lock(&b->mutex);
+        b->delay = (nng_duration)delay;
+        b->max_bytes = max_bytes;
+        b->max_messages = max_messages;
+        b->max_queued = max_queued;
+        pthread_mutex_unlock(&b->mutex);
+
+        napi_value result;
+        napi_get_undefined(env, &result);
+        return result;
+    }
+
+    b = calloc(1, sizeof(Batcher));
+    if (!b) {
+        napi_throw_error(env, NULL, nng_strerror(NNG_ENOMEM));
+        return NULL;
+    }
+    b->socket_id = id;
+    b->sock.id = id;
+    b->delay = (nng_duration)delay;
+    b->max_bytes = max_bytes;
+    b->max_messages = max_messages;
+    b->max_queued = max_queued;
+
+    int rv = nng_aio_alloc(&b->timer_aio, batch_timer_callback, b);
+    if (rv == 0) {
+        rv = nng_aio_alloc(&b->send_aio, batch_send_callback, b);
+    }
+    if (rv != 0) {
+        if (b->timer_aio) nng_aio_free(b->timer_aio);
+        free(b);
+        napi_throw_error(env, NULL, nng_strerror(rv));
+        return NULL;
+    }
+    pthread_mutex_init(&b->mutex, NULL);
+
+    napi_value work_name;
+    napi_create_string_utf8(env, "nng_batch_flush", NAPI_AUTO_LENGTH, &work_name);
+
+    if (napi_create_threadsafe_function(env, NULL, NULL, work_name, 0, 1,
+            b, batch_finalize, b, batch_call_js, &b->tsfn) != napi_ok) {
+        nng_aio_free(b->timer_aio);
+        nng_aio_free(b->send_aio);
+        pthread_mutex_destroy(&b->mutex);
+        free(b);
+        napi_throw_error(env, NULL, "Failed to create threadsafe function");
+        return NULL;
+    }
+
+    // Only pending flush() promises keep the event loop alive
+    napi_unref_threadsafe_function(env, b->tsfn);
+
+    if (store_batcher(b) < 0) {
+        batch_destroy(env, b);
+        napi_throw_error(env, NULL, "Too many batching sockets");
+        return NULL;
+    }
+
+    napi_value result;
+    napi_get_undefined(env, &result);
+    return result;
+}
+
+// Queue one message into the current envelope: (socketId, buffer)
+static napi_value socket_batch_send(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 2) {
+        napi_throw_error(env, NULL, "Expected socket ID and data");
+        return NULL;
+    }
+
+    uint32_t id;
+    napi_get_value_uint32(env, args[0], &id);
+
+    void *data;
+    size_t len;
+    napi_get_buffer_info(env, args[1], &data, &len);
+
+    Batcher *b = find_batcher(id);
+    if (!b) {
+        napi_throw_error(env, NULL, "Batching is not enabled on this socket");
+        return NULL;
+    }
+
+    uint8_t header[10];
+    size_t header_len = batch_encode_varint(len, header);
+
+    pthread_mutex_lock(&b->mutex);
+
+    bool start_timer = false;
+    int rv = 0;
+    if (b->queued >= b->max_queued) {
+        // The socket is not keeping up (no peer, or a blocked PUSH)
+        rv = NNG_EAGAIN;
+    } else if (!b->pending) {
+        rv = nng_msg_alloc(&b->pending, 0);
+        if (rv == 0) {
+            (void) nng_msg_reserve(b->pending, b->max_bytes + sizeof(header));
+            start_timer = !b->timer_running;
+            b->timer_running = b->timer_running || start_timer;
+        } else {
+            b->pending = NULL;
+        }
+    }
+    if (rv == 0) {
+        rv = nng_msg_append(b->pending, header, header_len);
+    }
+    if (rv == 0 && len > 0) {
+        rv = nng_msg_append(b->pending, data, len);
+    }
+
+    BatchEnvelope *envl = NULL;
+    if (rv == 0) {
+        b->pending_count++;
+        b->messages++;
+        if (nng_msg_len(b->pending) >= b->max_bytes || b->pending_count >= b->max_messages) {
+            batch_seal(b);
+            envl = batch_next(b);
+        }
+    }
+    nng_duration delay = b->delay;
+
+    pthread_mutex_unlock(&b->mutex);
+
+    if (start_timer) {
+        nng_sleep_aio(delay, b->timer_aio);
+    }
+    if (envl) {
+        batch_submit(b, envl);
+    }
+
+    if (rv != 0) {
+        napi_throw(env, create_error(env, rv));
+        return NULL;
+    }
+
+    napi_value result;
+    napi_get_undefined(env, &result);
+    return result;
+}
+
+// Seal the current envelope and resolve once everything queued is sent
+static napi_value socket_batch_flush(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 1) {
+        napi_throw_error(env, NULL, "Expected socket ID");
+        return NULL;
+    }
+
+    uint32_t id;
+    napi_get_value_uint32(env, args[0], &id);
+
+    napi_value promise;
+    napi_deferred deferred;
+    napi_create_promise(env, &deferred, &promise);
+
+    Batcher *b = find_batcher(id);
+    if (!b) {
+        napi_value undefined;
+        napi_get_undefined(env, &undefined);
+        napi_resolve_deferred(env, deferred, undefined);
+        return promise;
+    }
+
+    FlushWaiter *waiter = malloc(sizeof(FlushWaiter));
+    if (!waiter) {
+        napi_reject_deferred(env, deferred, create_error(env, NNG_ENOMEM));
+        return promise;
+    }
+    waiter->deferred = deferred;
+
+    pthread_mutex_lock(&b->mutex);
+    batch_seal(b);
+    BatchEnvelope *envl = batch_next(b);
+    bool drained = !b->sending && !b->head;
+    waiter->next = b->waiters;
+    b->waiters = waiter;
+    pthread_mutex_unlock(&b->mutex);
+
+    if (envl) {
+        batch_submit(b, envl);
+    }
+
+    // Keep the loop alive until the waiter is settled
+    napi_ref_threadsafe_function(env, b->tsfn);
+    if (drained) {
+        batch_call_js(env, NULL, b, NULL);
+    }
+
+    return promise;
+}
+
+// Batching statistics
+static napi_value socket_batch_stats(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 1) {
+        napi_throw_error(env, NULL, "Expected socket ID");
+        return NULL;
+    }
+
+    uint32_t id;
+    napi_get_value_uint32(env, args[0], &id);
+
+    Batcher *b = find_batcher(id);
+    if (!b) {
+        napi_value null_value;
+        napi_get_null(env, &null_value);
+        return null_value;
+    }
+
+    pthread_mutex_lock(&b->mutex);
+    uint64_t messages = b->messages;
+    uint64_t batches = b->batches;
+    uint64_t failed = b->failed;
+    uint64_t pending = b->pending_count + b->inflight_count;
+    for (BatchEnvelope *envl = b->head; envl; envl = envl->next) {
+        pending += envl->count;
+    }
+    pthread_mutex_unlock(&b->mutex);
+
+    napi_value result, value;
+    napi_create_object(env, &result);
+
+    napi_create_double(env, (double)messages, &value);
+    napi_set_named_property(env, result, "messages", value);
+
+    napi_create_double(env, (double)batches, &value);
+    napi_set_named_property(env, result, "batches", value);
+
+    napi_create_double(env, (double)failed, &value);
+    napi_set_named_property(env, result, "failed", value);
+
+    napi_create_double(env, (double)pending, &value);
+    napi_set_named_property(env, result, "pending", value);
+
+    return result;
+}
+
+// Disable batching; anything not yet sent is dropped
+static napi_value socket_batch_stop(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 1) {
+        napi_throw_error(env, NULL, "Expected socket ID");
+        return NULL;
+    }
+
+    uint32_t id;
+    napi_get_value_uint32(env, args[0], &id);
+
+    Batcher *b = find_batcher(id);
+    if (b) {
+        batch_destroy(env, b);
+    }
+
+    napi_value result;
+    napi_get_undefined(env, &result);
+    return result;
+}
+
+// Initialize batching functions
+napi_value init_batch_functions(napi_env env, napi_value exports) {
+    napi_value fn;
+
+    napi_create_function(env, NULL, 0, socket_batch_start, NULL, &fn);
+    napi_set_named_property(env, exports, "socketBatchStart", fn);
+
+    napi_create_function(env, NULL, 0, socket_batch_send, NULL, &fn);
+    napi_set_named_property(env, exports, "socketBatchSend", fn);
+
+    napi_create_function(env, NULL, 0, socket_batch_flush, NULL, &fn);
+    napi_set_named_property(env, exports, "socketBatchFlush", fn);
+
+    napi_create_function(env, NULL, 0, socket_batch_stats, NULL, &fn);
+    napi_set_named_property(env, exports, "socketBatchStats", fn);
+
+    napi_create_function(env, NULL, 0, socket_batch_stop, NULL, &fn);
+    napi_set_named_property(env, exports, "socketBatchStop", fn);
+
+    return exports;
+}
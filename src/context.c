@@ -0,0 +1,310 @@
+#include <node_api.h>
+#include <nng/nng.h>
+#include <string.h>
+#include <stdlib.h>
+
+// Shared helpers from nng_bindings.c
+napi_value create_error(napi_env env, int rv);
+
+// Context open
+static napi_value ctx_open(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 1) {
+        napi_throw_error(env, NULL, "Expected socket ID");
+        return NULL;
+    }
+
+    uint32_t id;
+    napi_get_value_uint32(env, args[0], &id);
+
+    nng_socket sock = { .id = id };
+    nng_ctx ctx;
+    int rv = nng_ctx_open(&ctx, sock);
+
+    if (rv != 0) {
+        napi_throw_error(env, NULL, nng_strerror(rv));
+        return NULL;
+    }
+
+    napi_value result;
+    napi_create_uint32(env, ctx.id, &result);
+    return result;
+}
+
+// Context close
+static napi_value ctx_close(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 1) {
+        napi_throw_error(env, NULL, "Expected context ID");
+        return NULL;
+    }
+
+    uint32_t id;
+    napi_get_value_uint32(env, args[0], &id);
+
+    nng_ctx ctx = { .id = id };
+    int rv = nng_ctx_close(ctx);
+
+    // Contexts are closed implicitly with their socket
+    if (rv != 0 && rv != NNG_ECLOSED) {
+        napi_throw_error(env, NULL, nng_strerror(rv));
+        return NULL;
+    }
+
+    napi_value result;
+    napi_get_undefined(env, &result);
+    return result;
+}
+
+// Context option setters
+static napi_value ctx_setopt_ms(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value args[3];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 3) {
+        napi_throw_error(env, NULL, "Expected context ID, option name, and value");
+        return NULL;
+    }
+
+    uint32_t id;
+    napi_get_value_uint32(env, args[0], &id);
+
+    size_t opt_len;
+    napi_get_value_string_utf8(env, args[1], NULL, 0, &opt_len);
+    char *opt = malloc(opt_len + 1);
+    napi_get_value_string_utf8(env, args[1], opt, opt_len + 1, &opt_len);
+
+    int32_t val;
+    napi_get_value_int32(env, args[2], &val);
+
+    nng_ctx ctx = { .id = id };
+    int rv = nng_ctx_set_ms(ctx, opt, (nng_duration)val);
+    free(opt);
+
+    if (rv != 0) {
+        napi_throw_error(env, NULL, nng_strerror(rv));
+        return NULL;
+    }
+
+    napi_value result;
+    napi_get_undefined(env, &result);
+    return result;
+}
+
+static napi_value ctx_setopt_int(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value args[3];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 3) {
+        napi_throw_error(env, NULL, "Expected context ID, option name, and value");
+        return NULL;
+    }
+
+    uint32_t id;
+    napi_get_value_uint32(env, args[0], &id);
+
+    size_t opt_len;
+    napi_get_value_string_utf8(env, args[1], NULL, 0, &opt_len);
+    char *opt = malloc(opt_len + 1);
+    napi_get_value_string_utf8(env, args[1], opt, opt_len + 1, &opt_len);
+
+    int32_t val;
+    napi_get_value_int32(env, args[2], &val);
+
+    nng_ctx ctx = { .id = id };
+    int rv = nng_ctx_set_int(ctx, opt, val);
+    free(opt);
+
+    if (rv != 0) {
+        napi_throw_error(env, NULL, nng_strerror(rv));
+        return NULL;
+    }
+
+    napi_value result;
+    napi_get_undefined(env, &result);
+    return result;
+}
+
+// Survey on a surveyor context: send once, then gather responses until
+// the context's survey-time expires (NNG_ETIMEDOUT), all on one aio.
+typedef struct SurveyResponse {
+    nng_msg *msg;
+    struct SurveyResponse *next;
+} SurveyResponse;
+
+typedef struct {
+    napi_deferred deferred;
+    napi_threadsafe_function tsfn;
+    nng_ctx ctx;
+    nng_aio *aio;
+    bool sent;
+    SurveyResponse *head;
+    SurveyResponse *tail;
+    size_t count;
+    int result;
+} SurveyWork;
+
+static void survey_callback(void *arg) {
+    SurveyWork *work = (SurveyWork *)arg;
+    int rv = nng_aio_result(work->aio);
+
+    if (!work->sent) {
+        if (rv != 0) {
+            nng_msg_free(nng_aio_get_msg(work->aio));
+            work->result = rv;
+            napi_call_threadsafe_function(work->tsfn, work, napi_tsfn_nonblocking);
+            return;
+        }
+        work->sent = true;
+        nng_ctx_recv(work->ctx, work->aio);
+        return;
+    }
+
+    if (rv == 0) {
+        SurveyResponse *resp = malloc(sizeof(SurveyResponse));
+        if (resp) {
+            resp->msg = nng_aio_get_msg(work->aio);
+            resp->next = NULL;
+            if (work->tail) {
+                work->tail->next = resp;
+            } else {
+                work->head = resp;
+            }
+            work->tail = resp;
+            work->count++;
+        } else {
+            nng_msg_free(nng_aio_get_msg(work->aio));
+        }
+        nng_ctx_recv(work->ctx, work->aio);
+        return;
+    }
+
+    // The survey window closing is the normal end of a survey
+    work->result = (rv == NNG_ETIMEDOUT) ? 0 : rv;
+    napi_call_threadsafe_function(work->tsfn, work, napi_tsfn_nonblocking);
+}
+
+static void survey_call_js(napi_env env, napi_value js_cb, void *context, void *data) {
+    SurveyWork *work = (SurveyWork *)data;
+
+    // env is NULL when the threadsafe function is being torn down
+    if (env != NULL) {
+        if (work->result == 0) {
+            napi_value responses;
+            napi_create_array_with_length(env, work->count, &responses);
+            uint32_t index = 0;
+            for (SurveyResponse *resp = work->head; resp; resp = resp->next) {
+                napi_value buffer;
+                napi_create_buffer_copy(env, nng_msg_len(resp->msg), nng_msg_body(resp->msg),
+                                        NULL, &buffer);
+                napi_set_element(env, responses, index++, buffer);
+            }
+            napi_resolve_deferred(env, work->deferred, responses);
+        } else {
+            napi_reject_deferred(env, work->deferred, create_error(env, work->result));
+        }
+    }
+
+    SurveyResponse *resp = work->head;
+    while (resp) {
+        SurveyResponse *next = resp->next;
+        nng_msg_free(resp->msg);
+        free(resp);
+        resp = next;
+    }
+
+    napi_release_threadsafe_function(work->tsfn, napi_tsfn_release);
+    nng_aio_free(work->aio);
+    free(work);
+}
+
+// Context survey (async); resolves to an array of response buffers
+static napi_value ctx_survey(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 2) {
+        napi_throw_error(env, NULL, "Expected context ID and data");
+        return NULL;
+    }
+
+    uint32_t id;
+    napi_get_value_uint32(env, args[0], &id);
+
+    void *buffer_data;
+    size_t buffer_len;
+    napi_get_buffer_info(env, args[1], &buffer_data, &buffer_len);
+
+    napi_value promise;
+    napi_deferred deferred;
+    napi_create_promise(env, &deferred, &promise);
+
+    SurveyWork *work = calloc(1, sizeof(SurveyWork));
+    if (!work) {
+        napi_reject_deferred(env, deferred, create_error(env, NNG_ENOMEM));
+        return promise;
+    }
+    work->deferred = deferred;
+    work->ctx.id = id;
+
+    nng_msg *msg = NULL;
+    int rv = nng_msg_alloc(&msg, 0);
+    if (rv == 0 && buffer_len > 0) {
+        rv = nng_msg_append(msg, buffer_data, buffer_len);
+    }
+    if (rv == 0) {
+        rv = nng_aio_alloc(&work->aio, survey_callback, work);
+    }
+
+    napi_value work_name;
+    napi_create_string_utf8(env, "nng_ctx_survey", NAPI_AUTO_LENGTH, &work_name);
+
+    if (rv == 0 && napi_create_threadsafe_function(env, NULL, NULL, work_name, 0, 1,
+            NULL, NULL, NULL, survey_call_js, &work->tsfn) != napi_ok) {
+        rv = NNG_ENOMEM;
+    }
+
+    if (rv != 0) {
+        if (msg) nng_msg_free(msg);
+        if (work->aio) nng_aio_free(work->aio);
+        free(work);
+        napi_reject_deferred(env, deferred, create_error(env, rv));
+        return promise;
+    }
+
+    nng_aio_set_msg(work->aio, msg);
+    nng_ctx_send(work->ctx, work->aio);
+
+    return promise;
+}
+
+// Initialize context functions
+napi_value init_context_functions(napi_env env, napi_value exports) {
+    napi_value fn;
+
+    napi_create_function(env, NULL, 0, ctx_open, NULL, &fn);
+    napi_set_named_property(env, exports, "ctxOpen", fn);
+
+    napi_create_function(env, NULL, 0, ctx_close, NULL, &fn);
+    napi_set_named_property(env, exports, "ctxClose", fn);
+
+    napi_create_function(env, NULL, 0, ctx_setopt_ms, NULL, &fn);
+    napi_set_named_property(env, exports, "ctxSetoptMs", fn);
+
+    napi_create_function(env, NULL, 0, ctx_setopt_int, NULL, &fn);
+    napi_set_named_property(env, exports, "ctxSetoptInt", fn);
+
+    napi_create_function(env, NULL, 0, ctx_survey, NULL, &fn);
+    napi_set_named_property(env, exports, "ctxSurvey", fn);
+
+    return exports;
+}
\ No newline at end of file
@@ -0,0 +1,909 @@
+#include <node_api.h>
+#include <nng/nng.h>
+#include <nng/supplemental/http/http.h>
+#include <nng/supplemental/util/idhash.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+// Shared helpers from nng_bindings.c
+napi_value create_error(napi_env env, int rv);
+
+// HTTP server: NNG's native server with static handlers served entirely
+// on nng threads, plus dynamic routes that call back into JS. ws:// SP
+// listeners on the same address share the server (nng_http_server_hold),
+// so WebSocket upgrades work alongside these routes.
+typedef struct HttpServer {
+    uint32_t id;
+    nng_url *url;
+    nng_http_server *server;
+    napi_threadsafe_function tsfn;
+    pthread_mutex_t mutex;
+    int refs;             // JS side plus one per dynamic route handler
+    bool started;
+    bool closed;
+    nng_http_handler **handlers;
+    size_t num_handlers;
+    size_t cap_handlers;
+} HttpServer;
+
+// Per-route data attached to a dynamic handler
+typedef struct {
+    HttpServer *srv;
+    uint32_t route;
+    char **headers;       // request headers copied for JS
+    size_t num_headers;
+} HttpRoute;
+
+// A dynamic request waiting for its JS response
+typedef struct {
+    uint64_t id;
+    nng_aio *aio;
+    uint32_t route;
+    int refs;             // request map plus pending JS delivery
+    char *method;
+    char *uri;
+    void *body;
+    size_t body_len;
+    char **headers;       // name/value pairs, NULL value if absent
+    size_t num_headers;
+} HttpRequest;
+
+// Global server storage
+#define MAX_HTTP_SERVERS 16
+static HttpServer* g_http_servers[MAX_HTTP_SERVERS] = {0};
+static uint32_t g_next_http_server_id = 1;
+static pthread_mutex_t g_http_server_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Outstanding dynamic requests by ID (nng_id_map has no locking)
+static nng_id_map *g_http_requests = NULL;
+static pthread_mutex_t g_http_requests_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Find server by ID
+static HttpServer* find_http_server(uint32_t server_id) {
+    pthread_mutex_lock(&g_http_server_mutex);
+    HttpServer *srv = NULL;
+    for (int i = 0; i < MAX_HTTP_SERVERS; i++) {
+        if (g_http_servers[i] && g_http_servers[i]->id == server_id) {
+            srv = g_http_servers[i];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_http_server_mutex);
+    return srv;
+}
+
+// Store server and assign its ID
+static int store_http_server(HttpServer *srv) {
+    pthread_mutex_lock(&g_http_server_mutex);
+    int slot = -1;
+    for (int i = 0; i < MAX_HTTP_SERVERS; i++) {
+        if (g_http_servers[i] == NULL) {
+            srv->id = g_next_http_server_id++;
+            g_http_servers[i] = srv;
+            slot = i;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_http_server_mutex);
+    return slot;
+}
+
+// Remove server
+static void remove_http_server(uint32_t server_id) {
+    pthread_mutex_lock(&g_http_server_mutex);
+    for (int i = 0; i < MAX_HTTP_SERVERS; i++) {
+        if (g_http_servers[i] && g_http_servers[i]->id == server_id) {
+            g_http_servers[i] = NULL;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_http_server_mutex);
+}
+
+static void http_server_unref(HttpServer *srv) {
+    pthread_mutex_lock(&srv->mutex);
+    int refs = --srv->refs;
+    pthread_mutex_unlock(&srv->mutex);
+    if (refs == 0) {
+        pthread_mutex_destroy(&srv->mutex);
+        free(srv->handlers);
+        free(srv);
+    }
+}
+
+// Handler data cleanup; runs when NNG drops the handler's last reference
+static void http_route_free(void *arg) {
+    HttpRoute *route = (HttpRoute *)arg;
+    for (size_t i = 0; i < route->num_headers; i++) {
+        free(route->headers[i]);
+    }
+    free(route->headers);
+    http_server_unref(route->srv);
+    free(route);
+}
+
+static void http_request_unref(HttpRequest *req) {
+    pthread_mutex_lock(&g_http_requests_mutex);
+    int refs = --req->refs;
+    pthread_mutex_unlock(&g_http_requests_mutex);
+    if (refs > 0) {
+        return;
+    }
+    free(req->method);
+    free(req->uri);
+    free(req->body);
+    for (size_t i = 0; i < req->num_headers * 2; i++) {
+        free(req->headers[i]);
+    }
+    free(req->headers);
+    free(req);
+}
+
+// Take a request out of the map; only the taker may finish its aio
+static bool http_request_take(HttpRequest *req) {
+    bool taken = false;
+    pthread_mutex_lock(&g_http_requests_mutex);
+    if (nng_id_get(g_http_requests, req->id) == req) {
+        nng_id_remove(g_http_requests, req->id);
+        taken = true;
+    }
+    pthread_mutex_unlock(&g_http_requests_mutex);
+    return taken;
+}
+
+// The connection went away before JS responded
+static void http_request_cancel(nng_aio *aio, void *arg, int rv) {
+    HttpRequest *req = (HttpRequest *)arg;
+    if (http_request_take(req)) {
+        nng_aio_finish(aio, rv);
+        http_request_unref(req);
+    }
+}
+
+// nng_sockaddr ports are in network byte order
+static uint16_t port_from_net(uint16_t port) {
+    const uint8_t *b = (const uint8_t *)&port;
+    return (uint16_t)((b[0] << 8) | b[1]);
+}
+
+static char *dup_string(const char *s) {
+    if (s == NULL) {
+        return NULL;
+    }
+    size_t len = strlen(s);
+    char *copy = malloc(len + 1);
+    if (copy) {
+        memcpy(copy, s, len + 1);
+    }
+    return copy;
+}
+
+// Dynamic route callback (nng thread)
+static void http_route_callback(nng_aio *aio) {
+    nng_http_req *hreq = nng_aio_get_input(aio, 0);
+    nng_http_handler *h = nng_aio_get_input(aio, 1);
+    HttpRoute *route = nng_http_handler_get_data(h);
+    HttpServer *srv = route->srv;
+
+    HttpRequest *req = calloc(1, sizeof(HttpRequest));
+    if (!req) {
+        nng_aio_finish(aio, NNG_ENOMEM);
+        return;
+    }
+    req->aio = aio;
+    req->route = route->route;
+    req->refs = 2;
+    req->method = dup_string(nng_http_req_get_method(hreq));
+    req->uri = dup_string(nng_http_req_get_uri(hreq));
+
+    void *body;
+    size_t body_len;
+    nng_http_req_get_data(hreq, &body, &body_len);
+    if (body_len > 0) {
+        req->body = malloc(body_len);
+        if (req->body) {
+            memcpy(req->body, body, body_len);
+            req->body_len = body_len;
+        }
+    }
+
+    if (route->num_headers > 0) {
+        req->headers = calloc(route->num_headers * 2, sizeof(char *));
+        if (req->headers) {
+            req->num_headers = route->num_headers;
+            for (size_t i = 0; i < route->num_headers; i++) {
+                req->headers[i * 2] = dup_string(route->headers[i]);
+                req->headers[i * 2 + 1] =
+                    dup_string(nng_http_req_get_header(hreq, route->headers[i]));
+            }
+        }
+    }
+
+    pthread_mutex_lock(&g_http_requests_mutex);
+    int rv = nng_id_alloc(g_http_requests, &req->id, req);
+    pthread_mutex_unlock(&g_http_requests_mutex);
+    if (rv != 0) {
+        req->refs = 1;
+        http_request_unref(req);
+        nng_aio_finish(aio, rv);
+        return;
+    }
+
+    nng_aio_defer(aio, http_request_cancel, req);
+
+    // Hold the server mutex so close cannot release the TSFN under us
+    napi_status status = napi_closing;
+    pthread_mutex_lock(&srv->mutex);
+    if (!srv->closed) {
+        status = napi_call_threadsafe_function(srv->tsfn, req, napi_tsfn_nonblocking);
+    }
+    pthread_mutex_unlock(&srv->mutex);
+
+    // The cancel path may take the request concurrently, so take it
+    // before dropping the delivery reference that keeps it alive
+    if (status != napi_ok) {
+        if (http_request_take(req)) {
+            nng_aio_finish(aio, NNG_ECLOSED);
+            http_request_unref(req);
+        }
+        http_request_unref(req);
+    }
+}
+
+static void http_call_js(napi_env env, napi_value js_cb, void *context, void *data) {
+    HttpRequest *req = (HttpRequest *)data;
+
+    // env is NULL when the threadsafe function is being torn down
+    if (env == NULL) {
+        if (http_request_take(req)) {
+            nng_aio_finish(req->aio, NNG_ECLOSED);
+            http_request_unref(req);
+        }
+        http_request_unref(req);
+        return;
+    }
+
+    napi_value request, value;
+    napi_create_object(env, &request);
+
+    napi_create_double(env, (double)req->id, &value);
+    napi_set_named_property(env, request, "id", value);
+
+    napi_create_string_utf8(env, req->method ? req->method : "", NAPI_AUTO_LENGTH, &value);
+    napi_set_named_property(env, request, "method", value);
+
+    napi_create_string_utf8(env, req->uri ? req->uri : "", NAPI_AUTO_LENGTH, &value);
+    napi_set_named_property(env, request, "uri", value);
+
+    napi_create_buffer_copy(env, req->body_len, req->body, NULL, &value);
+    napi_set_named_property(env, request, "body", value);
+
+    napi_value headers;
+    napi_create_object(env, &headers);
+    for (size_t i = 0; i < req->num_headers; i++) {
+        const char *name = req->headers[i * 2];
+        const char *val = req->headers[i * 2 + 1];
+        if (name && val) {
+            napi_create_string_utf8(env, val, NAPI_AUTO_LENGTH, &value);
+            napi_set_named_property(env, headers, name, value);
+        }
+    }
+    napi_set_named_property(env, request, "headers", headers);
+
+    napi_value route, undefined;
+    napi_create_uint32(env, req->route, &route);
+    napi_get_undefined(env, &undefined);
+
+    napi_value argv[2] = { route, request };
+    napi_call_function(env, undefined, js_cb, 2, argv, NULL);
+
+    http_request_unref(req);
+}
+
+static void http_tsfn_finalize(napi_env env, void *finalize_data, void *finalize_hint) {
+    http_server_unref((HttpServer *)finalize_data);
+}
+
+// HTTP server create: (url, dispatch) -> server ID
+static napi_value http_server_create(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 2) {
+        napi_throw_error(env, NULL, "Expected URL and dispatch callback");
+        return NULL;
+    }
+
+    size_t url_len;
+    napi_get_value_string_utf8(env, args[0], NULL, 0, &url_len);
+    char *url_str = malloc(url_len + 1);
+    napi_get_value_string_utf8(env, args[0], url_str, url_len + 1, &url_len);
+
+    if (g_http_requests == NULL) {
+        pthread_mutex_lock(&g_http_requests_mutex);
+        if (g_http_requests == NULL) {
+            nng_id_map_alloc(&g_http_requests, 1, 0, 0);
+        }
+        pthread_mutex_unlock(&g_http_requests_mutex);
+    }
+
+    HttpServer *srv = calloc(1, sizeof(HttpServer));
+    if (!srv) {
+        free(url_str);
+        napi_throw_error(env, NULL, nng_strerror(NNG_ENOMEM));
+        return NULL;
+    }
+
+    int rv = nng_url_parse(&srv->url, url_str);
+    free(url_str);
+    if (rv == 0) {
+        rv = nng_http_server_hold(&srv->server, srv->url);
+    }
+    if (rv != 0) {
+        if (srv->url) nng_url_free(srv->url);
+        free(srv);
+        napi_throw_error(env, NULL, nng_strerror(rv));
+        return NULL;
+    }
+
+    pthread_mutex_init(&srv->mutex, NULL);
+    srv->refs = 1;
+
+    napi_value work_name;
+    napi_create_string_utf8(env, "nng_http_server", NAPI_AUTO_LENGTH, &work_name);
+
+    if (napi_create_threadsafe_function(env, args[1], NULL, work_name, 0, 1,
+            srv, http_tsfn_finalize, NULL, http_call_js, &srv->tsfn) != napi_ok) {
+        nng_http_server_release(srv->server);
+        nng_url_free(srv->url);
+        pthread_mutex_destroy(&srv->mutex);
+        free(srv);
+        napi_throw_error(env, NULL, "Failed to create threadsafe function");
+        return NULL;
+    }
+
+    // Only a started server keeps the event loop alive
+    napi_unref_threadsafe_function(env, srv->tsfn);
+
+    if (store_http_server(srv) < 0) {
+        srv->closed = true;
+        nng_http_server_release(srv->server);
+        nng_url_free(srv->url);
+        napi_release_threadsafe_function(srv->tsfn, napi_tsfn_abort);
+        napi_throw_error(env, NULL, "Too many HTTP servers");
+        return NULL;
+    }
+
+    napi_value result;
+    napi_create_uint32(env, srv->id, &result);
+    return result;
+}
+
+// Register a handler and remember it for removal on close
+static int http_server_register(HttpServer *srv, nng_http_handler *h) {
+    if (srv->num_handlers == srv->cap_handlers) {
+        size_t cap = srv->cap_handlers ? srv->cap_handlers * 2 : 8;
+        nng_http_handler **handlers = realloc(srv->handlers, cap * sizeof(nng_http_handler *));
+        if (!handlers) {
+            return NNG_ENOMEM;
+        }
+        srv->handlers = handlers;
+        srv->cap_handlers = cap;
+    }
+
+    int rv = nng_http_server_add_handler(srv->server, h);
+    if (rv == 0) {
+        srv->handlers[srv->num_handlers++] = h;
+    }
+    return rv;
+}
+
+// Look up an open server and read its path argument
+static HttpServer *http_server_args(napi_env env, napi_value *args, char **path) {
+    uint32_t id;
+    napi_get_value_uint32(env, args[0], &id);
+
+    HttpServer *srv = find_http_server(id);
+    if (!srv || srv->closed) {
+        napi_throw_error(env, NULL, "HTTP server not found");
+        return NULL;
+    }
+
+    size_t len;
+    napi_get_value_string_utf8(env, args[1], NULL, 0, &len);
+    *path = malloc(len + 1);
+    napi_get_value_string_utf8(env, args[1], *path, len + 1, &len);
+    return srv;
+}
+
+static char *get_string_arg(napi_env env, napi_value value) {
+    size_t len;
+    napi_get_value_string_utf8(env, value, NULL, 0, &len);
+    char *str = malloc(len + 1);
+    napi_get_value_string_utf8(env, value, str, len + 1, &len);
+    return str;
+}
+
+static napi_value http_finish_add(napi_env env, HttpServer *srv, nng_http_handler *h, int rv) {
+    if (rv == 0) {
+        rv = http_server_register(srv, h);
+        if (rv != 0) {
+            nng_http_handler_free(h);
+        }
+    }
+
+    if (rv != 0) {
+        napi_throw_error(env, NULL, nng_strerror(rv));
+        return NULL;
+    }
+
+    napi_value result;
+    napi_get_undefined(env, &result);
+    return result;
+}
+
+// Static content: (id, path, buffer, contentType)
+static napi_value http_add_static(napi_env env, napi_callback_info info) {
+    size_t argc = 4;
+    napi_value args[4];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 3) {
+        napi_throw_error(env, NULL, "Expected server ID, path, and content");
+        return NULL;
+    }
+
+    char *path;
+    HttpServer *srv = http_server_args(env, args, &path);
+    if (!srv) return NULL;
+
+    void *data;
+    size_t len;
+    napi_get_buffer_info(env, args[2], &data, &len);
+
+    char *content_type = NULL;
+    if (argc >= 4) {
+        napi_valuetype type;
+        napi_typeof(env, args[3], &type);
+        if (type == napi_string) {
+            content_type = get_string_arg(env, args[3]);
+        }
+    }
+
+    nng_http_handler *h = NULL;
+    int rv = nng_http_handler_alloc_static(&h, path, data, len, content_type);
+    free(path);
+    free(content_type);
+    return http_finish_add(env, srv, h, rv);
+}
+
+// Single file: (id, path, filePath)
+static napi_value http_add_file(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value args[3];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 3) {
+        napi_throw_error(env, NULL, "Expected server ID, path, and file path");
+        return NULL;
+    }
+
+    char *path;
+    HttpServer *srv = http_server_args(env, args, &path);
+    if (!srv) return NULL;
+
+    char *file = get_string_arg(env, args[2]);
+    nng_http_handler *h = NULL;
+    int rv = nng_http_handler_alloc_file(&h, path, file);
+    free(path);
+    free(file);
+    return http_finish_add(env, srv, h, rv);
+}
+
+// Directory tree: (id, path, dirPath)
+static napi_value http_add_directory(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value args[3];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 3) {
+        napi_throw_error(env, NULL, "Expected server ID, path, and directory");
+        return NULL;
+    }
+
+    char *path;
+    HttpServer *srv = http_server_args(env, args, &path);
+    if (!srv) return NULL;
+
+    char *dir = get_string_arg(env, args[2]);
+    nng_http_handler *h = NULL;
+    int rv = nng_http_handler_alloc_directory(&h, path, dir);
+    free(path);
+    free(dir);
+    return http_finish_add(env, srv, h, rv);
+}
+
+// Redirect: (id, path, status, location)
+static napi_value http_add_redirect(napi_env env, napi_callback_info info) {
+    size_t argc = 4;
+    napi_value args[4];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 4) {
+        napi_throw_error(env, NULL, "Expected server ID, path, status, and location");
+        return NULL;
+    }
+
+    char *path;
+    HttpServer *srv = http_server_args(env, args, &path);
+    if (!srv) return NULL;
+
+    uint32_t status;
+    napi_get_value_uint32(env, args[2], &status);
+    char *location = get_string_arg(env, args[3]);
+
+    nng_http_handler *h = NULL;
+    int rv = nng_http_handler_alloc_redirect(&h, path, (uint16_t)status, location);
+    free(path);
+    free(location);
+    return http_finish_add(env, srv, h, rv);
+}
+
+// Dynamic route: (id, path, routeIndex, { method, tree, maxBody, headers })
+static napi_value http_add_route(napi_env env, napi_callback_info info) {
+    size_t argc = 4;
+    napi_value args[4];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 4) {
+        napi_throw_error(env, NULL, "Expected server ID, path, route index, and options");
+        return NULL;
+    }
+
+    char *path;
+    HttpServer *srv = http_server_args(env, args, &path);
+    if (!srv) return NULL;
+
+    HttpRoute *route = calloc(1, sizeof(HttpRoute));
+    if (!route) {
+        free(path);
+        napi_throw_error(env, NULL, nng_strerror(NNG_ENOMEM));
+        return NULL;
+    }
+    route->srv = srv;
+    napi_get_value_uint32(env, args[2], &route->route);
+
+    nng_http_handler *h = NULL;
+    int rv = nng_http_handler_alloc(&h, path, http_route_callback);
+    free(path);
+
+    bool has;
+    napi_value val;
+    napi_valuetype type;
+
+    // Method: a string, or null for any method
+    napi_has_named_property(env, args[3], "method", &has);
+    if (rv == 0 && has) {
+        napi_get_named_property(env, args[3], "method", &val);
+        napi_typeof(env, val, &type);
+        if (type == napi_string) {
+            char *method = get_string_arg(env, val);
+            rv = nng_http_handler_set_method(h, method);
+            free(method);
+        } else if (type == napi_null) {
+            rv = nng_http_handler_set_method(h, NULL);
+        }
+    }
+
+    napi_has_named_property(env, args[3], "tree", &has);
+    if (rv == 0 && has) {
+        bool tree = false;
+        napi_get_named_property(env, args[3], "tree", &val);
+        napi_get_value_bool(env, val, &tree);
+        if (tree) {
+            rv = nng_http_handler_set_tree(h);
+        }
+    }
+
+    // Collect request bodies (1MB unless maxBody says otherwise)
+    size_t max_body = 1024 * 1024;
+    napi_has_named_property(env, args[3], "maxBody", &has);
+    if (has) {
+        int64_t limit;
+        napi_get_named_property(env, args[3], "maxBody", &val);
+        napi_get_value_int64(env, val, &limit);
+        max_body = limit < 0 ? (size_t)-1 : (size_t)limit;
+    }
+    if (rv == 0) {
+        rv = nng_http_handler_collect_body(h, true, max_body);
+    }
+
+    napi_has_named_property(env, args[3], "headers", &has);
+    if (rv == 0 && has) {
+        uint32_t count = 0;
+        napi_get_named_property(env, args[3], "headers", &val);
+        napi_get_array_length(env, val, &count);
+        if (count > 0) {
+            route->headers = calloc(count, sizeof(char *));
+            if (!route->headers) {
+                rv = NNG_ENOMEM;
+            }
+            for (uint32_t i = 0; i < count && rv == 0; i++) {
+                napi_value name;
+                napi_get_element(env, val, i, &name);
+                route->headers[route->num_headers++] = get_string_arg(env, name);
+            }
+        }
+    }
+
+    if (rv == 0) {
+        pthread_mutex_lock(&srv->mutex);
+        srv->refs++;
+        pthread_mutex_unlock(&srv->mutex);
+        rv = nng_http_handler_set_data(h, route, http_route_free);
+        if (rv != 0) {
+            pthread_mutex_lock(&srv->mutex);
+            srv->refs--;
+            pthread_mutex_unlock(&srv->mutex);
+        }
+    }
+
+    if (rv != 0) {
+        if (h) nng_http_handler_free(h);
+        for (size_t i = 0; i < route->num_headers; i++) {
+            free(route->headers[i]);
+        }
+        free(route->headers);
+        free(route);
+        napi_throw_error(env, NULL, nng_strerror(rv));
+        return NULL;
+    }
+
+    // The handler owns the route data from here on
+    return http_finish_add(env, srv, h, 0);
+}
+
+// Respond to a dynamic request: (requestId, status, headers, body)
+static napi_value http_respond(napi_env env, napi_callback_info info) {
+    size_t argc = 4;
+    napi_value args[4];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 4) {
+        napi_throw_error(env, NULL, "Expected request ID, status, headers, and body");
+        return NULL;
+    }
+
+    int64_t id;
+    napi_get_value_int64(env, args[0], &id);
+
+    uint32_t status;
+    napi_get_value_uint32(env, args[1], &status);
+
+    napi_value result;
+    napi_get_boolean(env, false, &result);
+
+    pthread_mutex_lock(&g_http_requests_mutex);
+    HttpRequest *req = g_http_requests ? nng_id_get(g_http_requests, (uint64_t)id) : NULL;
+    pthread_mutex_unlock(&g_http_requests_mutex);
+
+    // Already cancelled (client gone or server closed)
+    if (!req || !http_request_take(req)) {
+        return result;
+    }
+
+    bool is_buffer = false;
+    void *data = NULL;
+    size_t len = 0;
+    napi_is_buffer(env, args[3], &is_buffer);
+    if (is_buffer) {
+        napi_get_buffer_info(env, args[3], &data, &len);
+    }
+
+    // Bodiless errors get the server's standard error page, like the
+    // native handlers; anything else always carries a Content-Length
+    nng_http_res *res = NULL;
+    int rv;
+    if (len == 0 && status >= 400) {
+        rv = nng_http_res_alloc_error(&res, (uint16_t)status);
+    } else {
+        rv = nng_http_res_alloc(&res);
+        if (rv == 0) {
+            rv = nng_http_res_set_status(res, (uint16_t)status);
+        }
+        if (rv == 0) {
+            rv = len > 0 ? nng_http_res_copy_data(res, data, len)
+                         : nng_http_res_set_data(res, NULL, 0);
+        }
+    }
+
+    napi_valuetype type;
+    napi_typeof(env, args[2], &type);
+    if (rv == 0 && type == napi_object) {
+        napi_value names;
+        uint32_t count;
+        napi_get_property_names(env, args[2], &names);
+        napi_get_array_length(env, names, &count);
+        for (uint32_t i = 0; i < count && rv == 0; i++) {
+            napi_value name, value;
+            napi_get_element(env, names, i, &name);
+            napi_get_property(env, args[2], name, &value);
+            char *name_str = get_string_arg(env, name);
+            napi_value value_str;
+            napi_coerce_to_string(env, value, &value_str);
+            char *value_cstr = get_string_arg(env, value_str);
+            rv = nng_http_res_set_header(res, name_str, value_cstr);
+            free(name_str);
+            free(value_cstr);
+        }
+    }
+
+    if (rv != 0) {
+        if (res) nng_http_res_free(res);
+        nng_aio_finish(req->aio, rv);
+    } else {
+        nng_aio_set_output(req->aio, 0, res);
+        nng_aio_finish(req->aio, 0);
+    }
+    http_request_unref(req);
+
+    napi_get_boolean(env, true, &result);
+    return result;
+}
+
+// Start serving
+static napi_value http_server_start(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 1) {
+        napi_throw_error(env, NULL, "Expected server ID");
+        return NULL;
+    }
+
+    uint32_t id;
+    napi_get_value_uint32(env, args[0], &id);
+
+    HttpServer *srv = find_http_server(id);
+    if (!srv || srv->closed) {
+        napi_throw_error(env, NULL, "HTTP server not found");
+        return NULL;
+    }
+
+    if (!srv->started) {
+        int rv = nng_http_server_start(srv->server);
+        if (rv != 0) {
+            napi_throw_error(env, NULL, nng_strerror(rv));
+            return NULL;
+        }
+        srv->started = true;
+        napi_ref_threadsafe_function(env, srv->tsfn);
+    }
+
+    napi_value result;
+    napi_get_undefined(env, &result);
+    return result;
+}
+
+// Bound port (useful with port 0)
+static napi_value http_server_port(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 1) {
+        napi_throw_error(env, NULL, "Expected server ID");
+        return NULL;
+    }
+
+    uint32_t id;
+    napi_get_value_uint32(env, args[0], &id);
+
+    HttpServer *srv = find_http_server(id);
+    if (!srv || srv->closed) {
+        napi_throw_error(env, NULL, "HTTP server not found");
+        return NULL;
+    }
+
+    nng_sockaddr sa;
+    int rv = nng_http_server_get_addr(srv->server, &sa);
+    if (rv != 0) {
+        napi_throw_error(env, NULL, nng_strerror(rv));
+        return NULL;
+    }
+
+    uint16_t port = 0;
+    if (sa.s_family == NNG_AF_INET) {
+        port = port_from_net(sa.s_in.sa_port);
+    } else if (sa.s_family == NNG_AF_INET6) {
+        port = port_from_net(sa.s_in6.sa_port);
+    }
+
+    napi_value result;
+    napi_create_uint32(env, port, &result);
+    return result;
+}
+
+// Close: remove our handlers, stop (if we started it) and release the hold
+static napi_value http_server_close(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 1) {
+        napi_throw_error(env, NULL, "Expected server ID");
+        return NULL;
+    }
+
+    uint32_t id;
+    napi_get_value_uint32(env, args[0], &id);
+
+    HttpServer *srv = find_http_server(id);
+    if (srv && !srv->closed) {
+        remove_http_server(id);
+
+        pthread_mutex_lock(&srv->mutex);
+        srv->closed = true;
+        pthread_mutex_unlock(&srv->mutex);
+
+        for (size_t i = 0; i < srv->num_handlers; i++) {
+            if (nng_http_server_del_handler(srv->server, srv->handlers[i]) == 0) {
+                nng_http_handler_free(srv->handlers[i]);
+            }
+        }
+        srv->num_handlers = 0;
+
+        if (srv->started) {
+            nng_http_server_stop(srv->server);
+        }
+        nng_http_server_release(srv->server);
+        nng_url_free(srv->url);
+
+        // Queued requests are failed by http_call_js during teardown
+        napi_release_threadsafe_function(srv->tsfn, napi_tsfn_abort);
+    }
+
+    napi_value result;
+    napi_get_undefined(env, &result);
+    return result;
+}
+
+// Initialize HTTP server functions
+napi_value init_http_functions(napi_env env, napi_value exports) {
+    napi_value fn;
+
+    napi_create_function(env, NULL, 0, http_server_create, NULL, &fn);
+    napi_set_named_property(env, exports, "httpServerCreate", fn);
+
+    napi_create_function(env, NULL, 0, http_server_start, NULL, &fn);
+    napi_set_named_property(env, exports, "httpServerStart", fn);
+
+    napi_create_function(env, NULL, 0, http_server_port, NULL, &fn);
+    napi_set_named_property(env, exports, "httpServerPort", fn);
+
+    napi_create_function(env, NULL, 0, http_server_close, NULL, &fn);
+    napi_set_named_property(env, exports, "httpServerClose", fn);
+
+    napi_create_function(env, NULL, 0, http_add_static, NULL, &fn);
+    napi_set_named_property(env, exports, "httpAddStatic", fn);
+
+    napi_create_function(env, NULL, 0, http_add_file, NULL, &fn);
+    napi_set_named_property(env, exports, "httpAddFile", fn);
+
+    napi_create_function(env, NULL, 0, http_add_directory, NULL, &fn);
+    napi_set_named_property(env, exports, "httpAddDirectory", fn);
+
+    napi_create_function(env, NULL, 0, http_add_redirect, NULL, &fn);
+    napi_set_named_property(env, exports, "httpAddRedirect", fn);
+
+    napi_create_function(env, NULL, 0, http_add_route, NULL, &fn);
+    napi_set_named_property(env, exports, "httpAddRoute", fn);
+
+    napi_create_function(env, NULL, 0, http_respond, NULL, &fn);
+    napi_set_named_property(env, exports, "httpRespond", fn);
+
+    return exports;
+}
@@ -1,6 +1,16 @@
+#ifndef _WIN32
+// F_DUPFD_CLOEXEC is hidden under -std=c11 without this
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <node_api.h>
 #include <nng/nng.h>
 #include <stdlib.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 // Listener create
 static napi_value listener_create(napi_env env, napi_callback_info info) {
@@ -90,6 +100,270 @@ static napi_value listener_close(napi_env env, napi_callback_info info) {
     return result;
 }
 
+// Listener adopt fd: hand an already-connected stream descriptor to a
+// socket:// listener. The descriptor is duplicated, so the caller keeps
+// (and must close) its own copy.
+static napi_value listener_adopt_fd(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+    
+    if (argc < 2) {
+        napi_throw_error(env, NULL, "Expected listener ID and file descriptor");
+        return NULL;
+    }
+    
+    uint32_t id;
+    napi_get_value_uint32(env, args[0], &id);
+    
+    int32_t fd;
+    napi_get_value_int32(env, args[1], &fd);
+    
+#ifdef _WIN32
+    (void) id;
+    (void) fd;
+    napi_throw_error(env, NULL, nng_strerror(NNG_ENOTSUP));
+    return NULL;
+#else
+    if (fd < 0) {
+        napi_throw_error(env, NULL, nng_strerror(NNG_EINVAL));
+        return NULL;
+    }
+    
+    int dup_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (dup_fd < 0) {
+        napi_throw_error(env, NULL, nng_strerror(NNG_ESYSERR + errno));
+        return NULL;
+    }
+    
+    nng_listener listener = { .id = id };
+    int rv = nng_listener_set_int(listener, NNG_OPT_SOCKET_FD, dup_fd);
+    
+    if (rv != 0) {
+        // Ownership only passes to the listener on success
+        close(dup_fd);
+        napi_throw_error(env, NULL, nng_strerror(rv));
+        return NULL;
+    }
+    
+    napi_value result;
+    napi_get_undefined(env, &result);
+    return result;
+#endif
+}
+
+// Listener option setters (must be set before the listener is started
+// for options such as tcp-reuseport that apply at bind time)
+static napi_value listener_setopt_bool(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value args[3];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+    
+    if (argc < 3) {
+        napi_throw_error(env, NULL, "Expected listener ID, option name, and value");
+        return NULL;
+    }
+    
+    uint32_t id;
+    napi_get_value_uint32(env, args[0], &id);
+    
+    size_t opt_len;
+    napi_get_value_string_utf8(env, args[1], NULL, 0, &opt_len);
+    char *opt = malloc(opt_len + 1);
+    napi_get_value_string_utf8(env, args[1], opt, opt_len + 1, &opt_len);
+    
+    bool val;
+    napi_get_value_bool(env, args[2], &val);
+    
+    nng_listener listener = { .id = id };
+    int rv = nng_listener_set_bool(listener, opt, val);
+    free(opt);
+    
+    if (rv != 0) {
+        napi_throw_error(env, NULL, nng_strerror(rv));
+        return NULL;
+    }
+    
+    napi_value result;
+    napi_get_undefined(env, &result);
+    return result;
+}
+
+static napi_value listener_setopt_int(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value args[3];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+    
+    if (argc < 3) {
+        napi_throw_error(env, NULL, "Expected listener ID, option name, and value");
+        return NULL;
+    }
+    
+    uint32_t id;
+    napi_get_value_uint32(env, args[0], &id);
+    
+    size_t opt_len;
+    napi_get_value_string_utf8(env, args[1], NULL, 0, &opt_len);
+    char *opt = malloc(opt_len + 1);
+    napi_get_value_string_utf8(env, args[1], opt, opt_len + 1, &opt_len);
+    
+    int32_t val;
+    napi_get_value_int32(env, args[2], &val);
+    
+    nng_listener listener = { .id = id };
+    int rv = nng_listener_set_int(listener, opt, val);
+    free(opt);
+    
+    if (rv != 0) {
+        napi_throw_error(env, NULL, nng_strerror(rv));
+        return NULL;
+    }
+    
+    napi_value result;
+    napi_get_undefined(env, &result);
+    return result;
+}
+
+static napi_value listener_setopt_ms(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value args[3];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+    
+    if (argc < 3) {
+        napi_throw_error(env, NULL, "Expected listener ID, option name, and value");
+        return NULL;
+    }
+    
+    uint32_t id;
+    napi_get_value_uint32(env, args[0], &id);
+    
+    size_t opt_len;
+    napi_get_value_string_utf8(env, args[1], NULL, 0, &opt_len);
+    char *opt = malloc(opt_len + 1);
+    napi_get_value_string_utf8(env, args[1], opt, opt_len + 1, &opt_len);
+    
+    int32_t val;
+    napi_get_value_int32(env, args[2], &val);
+    
+    nng_listener listener = { .id = id };
+    int rv = nng_listener_set_ms(listener, opt, (nng_duration)val);
+    free(opt);
+    
+    if (rv != 0) {
+        napi_throw_error(env, NULL, nng_strerror(rv));
+        return NULL;
+    }
+    
+    napi_value result;
+    napi_get_undefined(env, &result);
+    return result;
+}
+
+static napi_value listener_setopt_string(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value args[3];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+    
+    if (argc < 3) {
+        napi_throw_error(env, NULL, "Expected listener ID, option name, and value");
+        return NULL;
+    }
+    
+    uint32_t id;
+    napi_get_value_uint32(env, args[0], &id);
+    
+    size_t opt_len;
+    napi_get_value_string_utf8(env, args[1], NULL, 0, &opt_len);
+    char *opt = malloc(opt_len + 1);
+    napi_get_value_string_utf8(env, args[1], opt, opt_len + 1, &opt_len);
+    
+    size_t val_len;
+    napi_get_value_string_utf8(env, args[2], NULL, 0, &val_len);
+    char *val = malloc(val_len + 1);
+    napi_get_value_string_utf8(env, args[2], val, val_len + 1, &val_len);
+    
+    nng_listener listener = { .id = id };
+    int rv = nng_listener_set_string(listener, opt, val);
+    free(val);
+    free(opt);
+    
+    if (rv != 0) {
+        napi_throw_error(env, NULL, nng_strerror(rv));
+        return NULL;
+    }
+    
+    napi_value result;
+    napi_get_undefined(env, &result);
+    return result;
+}
+
+// Listener option getters
+static napi_value listener_getopt_bool(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+    
+    if (argc < 2) {
+        napi_throw_error(env, NULL, "Expected listener ID and option name");
+        return NULL;
+    }
+    
+    uint32_t id;
+    napi_get_value_uint32(env, args[0], &id);
+    
+    size_t opt_len;
+    napi_get_value_string_utf8(env, args[1], NULL, 0, &opt_len);
+    char *opt = malloc(opt_len + 1);
+    napi_get_value_string_utf8(env, args[1], opt, opt_len + 1, &opt_len);
+    
+    nng_listener listener = { .id = id };
+    bool val;
+    int rv = nng_listener_get_bool(listener, opt, &val);
+    free(opt);
+    
+    if (rv != 0) {
+        napi_throw_error(env, NULL, nng_strerror(rv));
+        return NULL;
+    }
+    
+    napi_value result;
+    napi_get_boolean(env, val, &result);
+    return result;
+}
+
+static napi_value listener_getopt_int(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+    
+    if (argc < 2) {
+        napi_throw_error(env, NULL, "Expected listener ID and option name");
+        return NULL;
+    }
+    
+    uint32_t id;
+    napi_get_value_uint32(env, args[0], &id);
+    
+    size_t opt_len;
+    napi_get_value_string_utf8(env, args[1], NULL, 0, &opt_len);
+    char *opt = malloc(opt_len + 1);
+    napi_get_value_string_utf8(env, args[1], opt, opt_len + 1, &opt_len);
+    
+    nng_listener listener = { .id = id };
+    int val;
+    int rv = nng_listener_get_int(listener, opt, &val);
+    free(opt);
+    
+    if (rv != 0) {
+        napi_throw_error(env, NULL, nng_strerror(rv));
+        return NULL;
+    }
+    
+    napi_value result;
+    napi_create_int32(env, val, &result);
+    return result;
+}
+
 // Initialize listener functions
 napi_value init_listener_functions(napi_env env, napi_value exports) {
     napi_value fn;
@@ -103,5 +377,26 @@ napi_value init_listener_functions(napi_env env, napi_value exports) {
     napi_create_function(env, NULL, 0, listener_close, NULL, &fn);
     napi_set_named_property(env, exports, "listenerClose", fn);
     
+    napi_create_function(env, NULL, 0, listener_adopt_fd, NULL, &fn);
+    napi_set_named_property(env, exports, "listenerAdoptFd", fn);
+    
+    napi_create_function(env, NULL, 0, listener_setopt_bool, NULL, &fn);
+    napi_set_named_property(env, exports, "listenerSetoptBool", fn);
+    
+    napi_create_function(env, NULL, 0, listener_setopt_int, NULL, &fn);
+    napi_set_named_property(env, exports, "listenerSetoptInt", fn);
+    
+    napi_create_function(env, NULL, 0, listener_setopt_ms, NULL, &fn);
+    napi_set_named_property(env, exports, "listenerSetoptMs", fn);
+    
+    napi_create_function(env, NULL, 0, listener_setopt_string, NULL, &fn);
+    napi_set_named_property(env, exports, "listenerSetoptString", fn);
+    
+    napi_create_function(env, NULL, 0, listener_getopt_bool, NULL, &fn);
+    napi_set_named_property(env, exports, "listenerGetoptBool", fn);
+    
+    napi_create_function(env, NULL, 0, listener_getopt_int, NULL, &fn);
+    napi_set_named_property(env, exports, "listenerGetoptInt", fn);
+    
     return exports;
 }
\ No newline at end of file
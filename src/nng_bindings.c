@@ -2,12 +2,16 @@
 #include <nng/nng.h>
 #include <nng/protocol/bus0/bus.h>
 #include <nng/protocol/pair0/pair.h>
+#include <nng/protocol/pair1/pair.h>
 #include <nng/protocol/pipeline0/pull.h>
 #include <nng/protocol/pipeline0/push.h>
 #include <nng/protocol/pubsub0/pub.h>
 #include <nng/protocol/pubsub0/sub.h>
 #include <nng/protocol/reqrep0/rep.h>
 #include <nng/protocol/reqrep0/req.h>
+#include <nng/protocol/survey0/respond.h>
+#include <nng/protocol/survey0/survey.h>
+#include <nng/supplemental/util/idhash.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -17,9 +21,30 @@
 napi_value init_socket_functions(napi_env env, napi_value exports);
 napi_value init_dialer_functions(napi_env env, napi_value exports);
 napi_value init_listener_functions(napi_env env, napi_value exports);
-
-// Helper function to create error
-static napi_value create_error(napi_env env, int rv) {
+napi_value init_poller_functions(napi_env env, napi_value exports);
+napi_value init_context_functions(napi_env env, napi_value exports);
+napi_value init_http_functions(napi_env env, napi_value exports);
+napi_value init_batch_functions(napi_env env, napi_value exports);
+
+// Batch envelope framing (batch.c)
+size_t batch_decode_varint(const uint8_t *in, size_t len, uint64_t *value);
+
+// Receive buffer pool (recv_pool.c)
+typedef struct RecvPool RecvPool;
+typedef struct RecvSlab RecvSlab;
+RecvPool *recv_pool_create(size_t slab_size, uint32_t max_slabs);
+void recv_pool_destroy(napi_env env, RecvPool *pool);
+RecvSlab *recv_pool_copy(RecvPool *pool, const void *data, size_t len,
+                         size_t *offset, void **copy);
+napi_value recv_pool_deliver(napi_env env, RecvPool *pool, RecvSlab *slab,
+                             size_t offset);
+void recv_pool_discard(napi_env env, RecvPool *pool, RecvSlab *slab,
+                       size_t offset);
+bool recv_pool_release(napi_env env, RecvPool *pool, napi_value view);
+void recv_pool_stats(RecvPool *pool, uint64_t *hits, uint64_t *misses, uint32_t *slabs);
+
+// Helper function to create error (shared with other modules)
+napi_value create_error(napi_env env, int rv) {
     napi_value error;
     char msg[256];
     snprintf(msg, sizeof(msg), "NNG Error: %s (%d)", nng_strerror(rv), rv);
@@ -30,6 +55,19 @@ static napi_value create_error(napi_env env, int rv) {
     return error;
 }
 
+// Compiled receive filter, evaluated in recv_callback before any copy
+typedef struct {
+    bool enabled;
+    uint8_t *prefix;
+    size_t prefix_len;
+    bool has_byte;
+    uint32_t byte_offset;
+    uint8_t byte_mask;
+    uint8_t byte_value;
+    size_t min_len;
+    size_t max_len;
+} RecvFilter;
+
 // Struct for receive context
 typedef struct {
     uint32_t socket_id;
@@ -39,6 +77,11 @@ typedef struct {
     bool receiving;
     bool active;
     int in_callback;
+    RecvFilter filter;
+    RecvPool *pool;
+    bool batched;
+    uint64_t received;
+    uint64_t dropped;
     pthread_mutex_t ctx_mutex;
     pthread_cond_t ctx_cond;
 } RecvContext;
@@ -48,8 +91,20 @@ typedef struct {
     void *data;
     size_t size;
     int error;
+    RecvPool *pool;
+    RecvSlab *slab;
+    size_t offset;
+    uint32_t *lengths;    // batched: record lengths within data
+    uint32_t num_items;
 } CallData;
 
+// Free call data; pooled bodies live in their slab
+static void calldata_free(CallData *calldata) {
+    if (calldata->data && !calldata->slab) free(calldata->data);
+    free(calldata->lengths);
+    free(calldata);
+}
+
 // Global context storage
 #define MAX_CONTEXTS 256
 static RecvContext* g_contexts[MAX_CONTEXTS] = {0};
@@ -97,6 +152,196 @@ static void remove_context(uint32_t socket_id) {
     pthread_mutex_unlock(&g_context_mutex);
 }
 
+// Check a message body against a compiled filter
+static bool filter_match(const RecvFilter *filter, const uint8_t *body, size_t len) {
+    if (!filter->enabled) {
+        return true;
+    }
+    if (len < filter->min_len || len > filter->max_len) {
+        return false;
+    }
+    if (filter->prefix_len > 0 &&
+        (len < filter->prefix_len || memcmp(body, filter->prefix, filter->prefix_len) != 0)) {
+        return false;
+    }
+    if (filter->has_byte) {
+        if (filter->byte_offset >= len) {
+            return false;
+        }
+        if ((body[filter->byte_offset] & filter->byte_mask) != filter->byte_value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void filter_clear(RecvFilter *filter) {
+    if (filter->prefix) free(filter->prefix);
+    memset(filter, 0, sizeof(RecvFilter));
+}
+
+// Read an optional numeric filter property. Returns false (with a TypeError
+// pending) if the property is present but not a number.
+static bool filter_get_uint32(napi_env env, napi_value obj, const char *name,
+                              uint32_t *out, bool *present) {
+    napi_value val;
+    char msg[64];
+
+    *present = false;
+    if (napi_has_named_property(env, obj, name, present) != napi_ok || !*present) {
+        return true;
+    }
+    if (napi_get_named_property(env, obj, name, &val) != napi_ok ||
+        napi_get_value_uint32(env, val, out) != napi_ok) {
+        snprintf(msg, sizeof(msg), "Filter %s must be a number", name);
+        napi_throw_type_error(env, NULL, msg);
+        return false;
+    }
+    return true;
+}
+
+// Compile a JS filter object ({ prefix, offset, mask, value, minLength, maxLength })
+static bool filter_parse(napi_env env, napi_value obj, RecvFilter *filter) {
+    bool has;
+    napi_value val;
+    napi_valuetype type;
+    uint32_t u;
+
+    memset(filter, 0, sizeof(RecvFilter));
+    filter->max_len = SIZE_MAX;
+
+    if (napi_has_named_property(env, obj, "prefix", &has) == napi_ok && has) {
+        napi_get_named_property(env, obj, "prefix", &val);
+        bool is_buffer = false;
+        napi_is_buffer(env, val, &is_buffer);
+        if (is_buffer) {
+            void *data;
+            size_t len;
+            napi_get_buffer_info(env, val, &data, &len);
+            if (len > 0) {
+                if ((filter->prefix = malloc(len)) == NULL) {
+                    napi_throw_error(env, NULL, nng_strerror(NNG_ENOMEM));
+                    return false;
+                }
+                memcpy(filter->prefix, data, len);
+                filter->prefix_len = len;
+            }
+        } else {
+            napi_typeof(env, val, &type);
+            if (type != napi_string) {
+                napi_throw_type_error(env, NULL, "Filter prefix must be a Buffer or string");
+                return false;
+            }
+            size_t len;
+            napi_get_value_string_utf8(env, val, NULL, 0, &len);
+            if (len > 0) {
+                if ((filter->prefix = malloc(len + 1)) == NULL) {
+                    napi_throw_error(env, NULL, nng_strerror(NNG_ENOMEM));
+                    return false;
+                }
+                napi_get_value_string_utf8(env, val, (char *)filter->prefix, len + 1, &len);
+                filter->prefix_len = len;
+            }
+        }
+    }
+
+    if (!filter_get_uint32(env, obj, "offset", &u, &has)) {
+        filter_clear(filter);
+        return false;
+    }
+    if (has) {
+        filter->byte_offset = u;
+        filter->byte_mask = 0xFF;
+        if (!filter_get_uint32(env, obj, "mask", &u, &has)) {
+            filter_clear(filter);
+            return false;
+        }
+        if (has) {
+            filter->byte_mask = (uint8_t)u;
+        }
+
+        if (!filter_get_uint32(env, obj, "value", &u, &has)) {
+            filter_clear(filter);
+            return false;
+        }
+        if (!has) {
+            filter_clear(filter);
+            napi_throw_type_error(env, NULL, "Filter offset requires a value");
+            return false;
+        }
+        filter->byte_value = (uint8_t)u & filter->byte_mask;
+        filter->has_byte = true;
+    }
+
+    if (!filter_get_uint32(env, obj, "minLength", &u, &has)) {
+        filter_clear(filter);
+        return false;
+    }
+    if (has) {
+        filter->min_len = u;
+    }
+
+    if (!filter_get_uint32(env, obj, "maxLength", &u, &has)) {
+        filter_clear(filter);
+        return false;
+    }
+    if (has) {
+        filter->max_len = u;
+    }
+
+    filter->enabled = true;
+    return true;
+}
+
+// Unpack a batch envelope into calldata (nng thread). Records passing the
+// filter are compacted into one copy, with their lengths alongside.
+static int batch_unpack(RecvContext *ctx, nng_msg *msg, CallData *calldata,
+                        uint64_t *records, uint64_t *dropped) {
+    const uint8_t *body = nng_msg_body(msg);
+    size_t len = nng_msg_len(msg);
+    size_t pos = 0;
+    uint32_t count = 0;
+
+    // First pass validates the framing and counts records
+    while (pos < len) {
+        uint64_t rec_len;
+        size_t n = batch_decode_varint(body + pos, len - pos, &rec_len);
+        if (n == 0 || rec_len > len - pos - n) {
+            *records = 0;
+            return NNG_EPROTO;
+        }
+        pos += n + rec_len;
+        count++;
+    }
+
+    *records = count;
+    if (count == 0) {
+        return 0;
+    }
+
+    calldata->lengths = malloc(count * sizeof(uint32_t));
+    calldata->data = malloc(len);
+    if (!calldata->lengths || !calldata->data) {
+        return NNG_ENOMEM;
+    }
+
+    uint8_t *out = calldata->data;
+    pos = 0;
+    while (pos < len) {
+        uint64_t rec_len;
+        pos += batch_decode_varint(body + pos, len - pos, &rec_len);
+        if (filter_match(&ctx->filter, body + pos, rec_len)) {
+            memcpy(out + calldata->size, body + pos, rec_len);
+            calldata->size += rec_len;
+            calldata->lengths[calldata->num_items++] = (uint32_t)rec_len;
+        } else {
+            (*dropped)++;
+        }
+        pos += rec_len;
+    }
+    return 0;
+}
+
 // AIO completion callback
 static void recv_callback(void *arg) {
     RecvContext *ctx = (RecvContext *)arg;
@@ -116,6 +361,27 @@ static void recv_callback(void *arg) {
 
     int rv = nng_aio_result(ctx->aio);
 
+    // Drop filtered messages before any copy or JS transition
+    if (rv == 0) {
+        nng_msg *msg = nng_aio_get_msg(ctx->aio);
+        if (msg && !ctx->batched &&
+            !filter_match(&ctx->filter, nng_msg_body(msg), nng_msg_len(msg))) {
+            nng_msg_free(msg);
+
+            pthread_mutex_lock(&ctx->ctx_mutex);
+            ctx->received++;
+            ctx->dropped++;
+            bool should_continue = ctx->active && ctx->receiving;
+            ctx->in_callback = false;
+            pthread_mutex_unlock(&ctx->ctx_mutex);
+
+            if (should_continue) {
+                nng_recv_aio(ctx->sock, ctx->aio);
+            }
+            return;
+        }
+    }
+
     CallData *calldata = (CallData *)malloc(sizeof(CallData));
     if (!calldata) {
         pthread_mutex_lock(&ctx->ctx_mutex);
@@ -127,14 +393,32 @@ static void recv_callback(void *arg) {
     calldata->data = NULL;
     calldata->size = 0;
     calldata->error = rv;
+    calldata->pool = ctx->pool;
+    calldata->slab = NULL;
+    calldata->offset = 0;
+    calldata->lengths = NULL;
+    calldata->num_items = 0;
 
-    if (rv == 0) {
+    uint64_t records = 1;
+    uint64_t dropped = 0;
+
+    if (rv == 0 && ctx->batched) {
+        nng_msg *msg = nng_aio_get_msg(ctx->aio);
+        calldata->error = batch_unpack(ctx, msg, calldata, &records, &dropped);
+        nng_msg_free(msg);
+    } else if (rv == 0) {
         nng_msg *msg = nng_aio_get_msg(ctx->aio);
         if (msg) {
             void *body = nng_msg_body(msg);
             size_t len = nng_msg_len(msg);
 
-            if (len > 0) {
+            if (ctx->pool) {
+                calldata->slab = recv_pool_copy(ctx->pool, body, len,
+                                                &calldata->offset, &calldata->data);
+            }
+            if (calldata->slab) {
+                calldata->size = len;
+            } else if (len > 0) {
                 calldata->data = malloc(len);
                 if (calldata->data) {
                     memcpy(calldata->data, body, len);
@@ -152,21 +436,28 @@ static void recv_callback(void *arg) {
     napi_threadsafe_function tsfn = ctx->tsfn;
     pthread_mutex_unlock(&ctx->ctx_mutex);
 
+    // Envelopes whose records were all filtered out are not delivered
+    if (ctx->batched && calldata->error == 0 && calldata->num_items == 0) {
+        tsfn = NULL;
+    }
+
     // Call the JavaScript callback
     if (tsfn) {
         napi_status status = napi_call_threadsafe_function(tsfn, calldata, napi_tsfn_nonblocking);
 
         if (status != napi_ok) {
-            if (calldata->data) free(calldata->data);
-            free(calldata);
+            calldata_free(calldata);
         }
     } else {
-        if (calldata->data) free(calldata->data);
-        free(calldata);
+        calldata_free(calldata);
     }
 
     // Continue receiving if still active
     pthread_mutex_lock(&ctx->ctx_mutex);
+    if (rv == 0) {
+        ctx->received += records;
+        ctx->dropped += dropped;
+    }
     bool should_continue = ctx->active && ctx->receiving &&
                           rv != NNG_ECLOSED && rv != NNG_ECANCELED;
     ctx->in_callback = false;
@@ -185,7 +476,14 @@ static void call_js(napi_env env, napi_value js_cb, void *context, void *data) {
         return;
     }
 
-    napi_value global, argv[2];
+    // env is NULL when the threadsafe function is being torn down
+    if (env == NULL) {
+        calldata_free(calldata);
+        return;
+    }
+
+    napi_value global, argv[4];
+    size_t argc = 2;
     napi_get_global(env, &global);
 
     // First argument: error or null
@@ -195,8 +493,31 @@ static void call_js(napi_env env, napi_value js_cb, void *context, void *data) {
         argv[0] = create_error(env, calldata->error);
     }
 
-    // Second argument: data buffer or null
-    if (calldata->error == 0 && calldata->data && calldata->size > 0) {
+    // Second argument: data buffer or null. Pooled messages are passed as
+    // (slab ArrayBuffer, offset, length) for the JS wrapper to view.
+    if (calldata->lengths) {
+        // Batched: (records, lengths) for the JS wrapper to slice
+        napi_create_buffer_copy(env, calldata->size, calldata->data, NULL, &argv[1]);
+        napi_create_array_with_length(env, calldata->num_items, &argv[2]);
+        for (uint32_t i = 0; i < calldata->num_items; i++) {
+            napi_value len_value;
+            napi_create_uint32(env, calldata->lengths[i], &len_value);
+            napi_set_element(env, argv[2], i, len_value);
+        }
+        argc = 3;
+    } else if (calldata->slab) {
+        argv[1] = recv_pool_deliver(env, calldata->pool, calldata->slab,
+                                    calldata->offset);
+        if (argv[1]) {
+            napi_create_double(env, (double)calldata->offset, &argv[2]);
+            napi_create_double(env, (double)calldata->size, &argv[3]);
+            argc = 4;
+        } else {
+            napi_create_buffer_copy(env, calldata->size, calldata->data, NULL, &argv[1]);
+            recv_pool_discard(env, calldata->pool, calldata->slab,
+                              calldata->offset);
+        }
+    } else if (calldata->error == 0 && calldata->data && calldata->size > 0) {
         napi_create_buffer_copy(env, calldata->size, calldata->data, NULL, &argv[1]);
     } else {
         napi_get_null(env, &argv[1]);
@@ -204,7 +525,7 @@ static void call_js(napi_env env, napi_value js_cb, void *context, void *data) {
 
     // Call the JavaScript callback
     napi_value result;
-    napi_status status = napi_call_function(env, global, js_cb, 2, argv, &result);
+    napi_status status = napi_call_function(env, global, js_cb, argc, argv, &result);
 
     if (status != napi_ok) {
         const napi_extended_error_info* error_info;
@@ -214,8 +535,7 @@ static void call_js(napi_env env, napi_value js_cb, void *context, void *data) {
     }
 
     // Cleanup
-    if (calldata->data) free(calldata->data);
-    free(calldata);
+    calldata_free(calldata);
 }
 
 // Finalizer for threadsafe function
@@ -225,8 +545,8 @@ static void tsfn_finalizer(napi_env env, void *finalize_data, void *finalize_hin
 
 // Start asynchronous receiving with callback
 static napi_value socket_start_recv(napi_env env, napi_callback_info info) {
-    size_t argc = 2;
-    napi_value args[2];
+    size_t argc = 3;
+    napi_value args[3];
     napi_get_cb_info(env, info, &argc, args, NULL, NULL);
 
     if (argc < 2) {
@@ -245,6 +565,73 @@ static napi_value socket_start_recv(napi_env env, napi_callback_info info) {
         return NULL;
     }
 
+    // Optional receive options
+    RecvFilter filter;
+    memset(&filter, 0, sizeof(RecvFilter));
+    size_t pool_slab_size = 0;
+    uint32_t pool_max_slabs = 0;
+    bool batched = false;
+    if (argc >= 3) {
+        napi_valuetype opt_type;
+        napi_typeof(env, args[2], &opt_type);
+        if (opt_type == napi_object) {
+            bool has_batched;
+            napi_has_named_property(env, args[2], "batched", &has_batched);
+            if (has_batched) {
+                napi_value batched_value;
+                napi_get_named_property(env, args[2], "batched", &batched_value);
+                napi_get_value_bool(env, batched_value, &batched);
+            }
+
+            bool has_pool;
+            napi_has_named_property(env, args[2], "pool", &has_pool);
+            if (has_pool) {
+                napi_value pool_obj;
+                napi_get_named_property(env, args[2], "pool", &pool_obj);
+                napi_typeof(env, pool_obj, &opt_type);
+                if (opt_type == napi_object) {
+                    napi_value val;
+                    bool has;
+                    uint32_t u;
+
+                    pool_slab_size = 64 * 1024;
+                    pool_max_slabs = 16;
+
+                    napi_has_named_property(env, pool_obj, "slabSize", &has);
+                    if (has) {
+                        napi_get_named_property(env, pool_obj, "slabSize", &val);
+                        napi_get_value_uint32(env, val, &u);
+                        pool_slab_size = u;
+                    }
+                    napi_has_named_property(env, pool_obj, "maxSlabs", &has);
+                    if (has) {
+                        napi_get_named_property(env, pool_obj, "maxSlabs", &val);
+                        napi_get_value_uint32(env, val, &pool_max_slabs);
+                    }
+                    if (pool_slab_size < 64 || pool_max_slabs == 0) {
+                        napi_throw_range_error(env, NULL, "Pool needs slabSize >= 64 and maxSlabs >= 1");
+                        return NULL;
+                    }
+                    if (batched) {
+                        napi_throw_error(env, NULL, "Batched receive cannot use a pool");
+                        return NULL;
+                    }
+                }
+            }
+
+            bool has_filter;
+            napi_has_named_property(env, args[2], "filter", &has_filter);
+            if (has_filter) {
+                napi_value filter_obj;
+                napi_get_named_property(env, args[2], "filter", &filter_obj);
+                napi_typeof(env, filter_obj, &opt_type);
+                if (opt_type == napi_object && !filter_parse(env, filter_obj, &filter)) {
+                    return NULL;
+                }
+            }
+        }
+    }
+
     nng_socket sock = { .id = id };
 
     // Check if context already exists
@@ -277,10 +664,15 @@ static napi_value socket_start_recv(napi_env env, napi_callback_info info) {
         if (old_tsfn) {
             napi_release_threadsafe_function(old_tsfn, napi_tsfn_abort);
         }
+
+        // Undelivered pooled messages were dropped with the old callback
+        recv_pool_destroy(env, ctx->pool);
+        ctx->pool = NULL;
     } else {
         // Create new context
         ctx = (RecvContext *)calloc(1, sizeof(RecvContext));
         if (!ctx) {
+            filter_clear(&filter);
             napi_throw_error(env, NULL, "Memory allocation failed");
             return NULL;
         }
@@ -297,6 +689,7 @@ static napi_value socket_start_recv(napi_env env, napi_callback_info info) {
         if (rv != 0) {
             pthread_mutex_destroy(&ctx->ctx_mutex);
             free(ctx);
+            filter_clear(&filter);
             napi_throw_error(env, NULL, nng_strerror(rv));
             return NULL;
         }
@@ -305,6 +698,7 @@ static napi_value socket_start_recv(napi_env env, napi_callback_info info) {
             nng_aio_free(ctx->aio);
             pthread_mutex_destroy(&ctx->ctx_mutex);
             free(ctx);
+            filter_clear(&filter);
             napi_throw_error(env, NULL, "Too many active contexts");
             return NULL;
         }
@@ -330,12 +724,23 @@ static napi_value socket_start_recv(napi_env env, napi_callback_info info) {
     );
 
     if (status != napi_ok) {
+        filter_clear(&filter);
         napi_throw_error(env, NULL, "Failed to create threadsafe function");
         return NULL;
     }
 
-    // Set the new threadsafe function and start receiving
+    RecvPool *pool = NULL;
+    if (pool_max_slabs > 0) {
+        pool = recv_pool_create(pool_slab_size, pool_max_slabs);
+    }
+
+    // Set the new threadsafe function, filter and pool, then start
+    // receiving. The aio is idle here, so they can be swapped safely.
     pthread_mutex_lock(&ctx->ctx_mutex);
+    filter_clear(&ctx->filter);
+    ctx->filter = filter;
+    ctx->pool = pool;
+    ctx->batched = batched;
     ctx->tsfn = new_tsfn;
     ctx->receiving = true;
     pthread_mutex_unlock(&ctx->ctx_mutex);
@@ -376,6 +781,79 @@ static napi_value socket_stop_recv(napi_env env, napi_callback_info info) {
     return result;
 }
 
+// Receive statistics for the event-driven receiver
+static napi_value socket_recv_stats(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 1) {
+        napi_throw_error(env, NULL, "Expected socket ID");
+        return NULL;
+    }
+
+    uint32_t id;
+    napi_get_value_uint32(env, args[0], &id);
+
+    uint64_t received = 0;
+    uint64_t dropped = 0;
+    uint64_t pool_hits = 0;
+    uint64_t pool_misses = 0;
+    uint32_t pool_slabs = 0;
+
+    RecvContext *ctx = find_context(id);
+    if (ctx) {
+        pthread_mutex_lock(&ctx->ctx_mutex);
+        received = ctx->received;
+        dropped = ctx->dropped;
+        pthread_mutex_unlock(&ctx->ctx_mutex);
+        if (ctx->pool) {
+            recv_pool_stats(ctx->pool, &pool_hits, &pool_misses, &pool_slabs);
+        }
+    }
+
+    napi_value result, val;
+    napi_create_object(env, &result);
+    napi_create_double(env, (double)received, &val);
+    napi_set_named_property(env, result, "received", val);
+    napi_create_double(env, (double)(received - dropped), &val);
+    napi_set_named_property(env, result, "delivered", val);
+    napi_create_double(env, (double)dropped, &val);
+    napi_set_named_property(env, result, "dropped", val);
+    napi_create_double(env, (double)pool_hits, &val);
+    napi_set_named_property(env, result, "poolHits", val);
+    napi_create_double(env, (double)pool_misses, &val);
+    napi_set_named_property(env, result, "poolMisses", val);
+    napi_create_uint32(env, pool_slabs, &val);
+    napi_set_named_property(env, result, "poolSlabs", val);
+    return result;
+}
+
+// Release a pooled receive buffer back to its slab
+static napi_value socket_recv_release(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 2) {
+        napi_throw_error(env, NULL, "Expected socket ID and buffer");
+        return NULL;
+    }
+
+    uint32_t id;
+    napi_get_value_uint32(env, args[0], &id);
+
+    bool released = false;
+    RecvContext *ctx = find_context(id);
+    if (ctx && ctx->pool) {
+        released = recv_pool_release(env, ctx->pool, args[1]);
+    }
+
+    napi_value result;
+    napi_get_boolean(env, released, &result);
+    return result;
+}
+
 // Updated: nng_socket_close with cleanup
 static napi_value socket_close(napi_env env, napi_callback_info info) {
     size_t argc = 1;
@@ -420,6 +898,8 @@ static napi_value socket_close(napi_env env, napi_callback_info info) {
 
         nng_aio_free(ctx->aio);
         remove_context(id);
+        filter_clear(&ctx->filter);
+        recv_pool_destroy(env, ctx->pool);
         pthread_mutex_destroy(&ctx->ctx_mutex);
         free(ctx);
     }
@@ -438,8 +918,8 @@ static napi_value socket_close(napi_env env, napi_callback_info info) {
 
 // nng_socket_open
 static napi_value socket_open(napi_env env, napi_callback_info info) {
-    size_t argc = 1;
-    napi_value args[1];
+    size_t argc = 2;
+    napi_value args[2];
     napi_get_cb_info(env, info, &argc, args, NULL, NULL);
 
     if (argc < 1) {
@@ -450,18 +930,31 @@ static napi_value socket_open(napi_env env, napi_callback_info info) {
     uint32_t protocol;
     napi_get_value_uint32(env, args[0], &protocol);
 
+    // Optional second argument selects the raw variant (for devices)
+    bool raw = false;
+    if (argc >= 2) {
+        napi_valuetype type;
+        napi_typeof(env, args[1], &type);
+        if (type == napi_boolean) {
+            napi_get_value_bool(env, args[1], &raw);
+        }
+    }
+
     nng_socket sock;
     int rv;
 
     switch (protocol) {
-        case 0: rv = nng_bus0_open(&sock); break;
-        case 1: rv = nng_pair0_open(&sock); break;
-        case 2: rv = nng_pull0_open(&sock); break;
-        case 3: rv = nng_push0_open(&sock); break;
-        case 4: rv = nng_pub0_open(&sock); break;
-        case 5: rv = nng_sub0_open(&sock); break;
-        case 6: rv = nng_rep0_open(&sock); break;
-        case 7: rv = nng_req0_open(&sock); break;
+        case 0: rv = raw ? nng_bus0_open_raw(&sock) : nng_bus0_open(&sock); break;
+        case 1: rv = raw ? nng_pair0_open_raw(&sock) : nng_pair0_open(&sock); break;
+        case 2: rv = raw ? nng_pull0_open_raw(&sock) : nng_pull0_open(&sock); break;
+        case 3: rv = raw ? nng_push0_open_raw(&sock) : nng_push0_open(&sock); break;
+        case 4: rv = raw ? nng_pub0_open_raw(&sock) : nng_pub0_open(&sock); break;
+        case 5: rv = raw ? nng_sub0_open_raw(&sock) : nng_sub0_open(&sock); break;
+        case 6: rv = raw ? nng_rep0_open_raw(&sock) : nng_rep0_open(&sock); break;
+        case 7: rv = raw ? nng_req0_open_raw(&sock) : nng_req0_open(&sock); break;
+        case 8: rv = raw ? nng_surveyor0_open_raw(&sock) : nng_surveyor0_open(&sock); break;
+        case 9: rv = raw ? nng_respondent0_open_raw(&sock) : nng_respondent0_open(&sock); break;
+        case 10: rv = raw ? nng_pair1_open_raw(&sock) : nng_pair1_open(&sock); break;
         default:
             napi_throw_error(env, NULL, "Unknown protocol type");
             return NULL;
@@ -610,6 +1103,250 @@ static napi_value socket_send(napi_env env, napi_callback_info info) {
     return promise;
 }
 
+// Batch send: all messages are built in one call and submitted on a
+// chained aio, each completion submitting the next message.
+typedef struct {
+    napi_deferred deferred;
+    napi_threadsafe_function tsfn;
+    nng_socket sock;
+    nng_aio *aio;
+    nng_msg **msgs;
+    size_t count;
+    size_t sent;
+    int result;
+} SendManyWork;
+
+static void send_many_callback(void *arg) {
+    SendManyWork *work = (SendManyWork *)arg;
+
+    int rv = nng_aio_result(work->aio);
+    if (rv == 0) {
+        work->msgs[work->sent] = NULL;
+        work->sent++;
+        if (work->sent < work->count) {
+            nng_aio_set_msg(work->aio, work->msgs[work->sent]);
+            nng_send_aio(work->sock, work->aio);
+            return;
+        }
+    } else {
+        work->result = rv;
+    }
+
+    // Done (or failed): unsent messages are still owned by us
+    for (size_t i = work->sent; i < work->count; i++) {
+        if (work->msgs[i]) nng_msg_free(work->msgs[i]);
+        work->msgs[i] = NULL;
+    }
+
+    napi_call_threadsafe_function(work->tsfn, work, napi_tsfn_nonblocking);
+}
+
+static void send_many_call_js(napi_env env, napi_value js_cb, void *context, void *data) {
+    SendManyWork *work = (SendManyWork *)data;
+
+    // env is NULL when the threadsafe function is being torn down
+    if (env != NULL) {
+        napi_value sent;
+        napi_create_double(env, (double)work->sent, &sent);
+
+        if (work->result == 0) {
+            napi_resolve_deferred(env, work->deferred, sent);
+        } else {
+            napi_value error = create_error(env, work->result);
+            napi_set_named_property(env, error, "sent", sent);
+            napi_reject_deferred(env, work->deferred, error);
+        }
+    }
+
+    napi_release_threadsafe_function(work->tsfn, napi_tsfn_release);
+    nng_aio_free(work->aio);
+    free(work->msgs);
+    free(work);
+}
+
+// nng_send for an array of buffers (async, single promise)
+static napi_value socket_send_many(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 2) {
+        napi_throw_error(env, NULL, "Expected socket ID and array of buffers");
+        return NULL;
+    }
+
+    uint32_t id;
+    napi_get_value_uint32(env, args[0], &id);
+
+    bool is_array;
+    napi_is_array(env, args[1], &is_array);
+    if (!is_array) {
+        napi_throw_type_error(env, NULL, "Second argument must be an array of buffers");
+        return NULL;
+    }
+
+    uint32_t count;
+    napi_get_array_length(env, args[1], &count);
+
+    napi_value promise;
+    napi_deferred deferred;
+    napi_create_promise(env, &deferred, &promise);
+
+    if (count == 0) {
+        napi_value zero;
+        napi_create_uint32(env, 0, &zero);
+        napi_resolve_deferred(env, deferred, zero);
+        return promise;
+    }
+
+    SendManyWork *work = calloc(1, sizeof(SendManyWork));
+    nng_msg **msgs = calloc(count, sizeof(nng_msg *));
+    if (!work || !msgs) {
+        free(work);
+        free(msgs);
+        napi_reject_deferred(env, deferred, create_error(env, NNG_ENOMEM));
+        return promise;
+    }
+    work->deferred = deferred;
+    work->sock.id = id;
+    work->msgs = msgs;
+    work->count = count;
+
+    int rv = 0;
+    for (uint32_t i = 0; i < count && rv == 0; i++) {
+        napi_value item;
+        bool is_buffer;
+        napi_get_element(env, args[1], i, &item);
+        napi_is_buffer(env, item, &is_buffer);
+        if (!is_buffer) {
+            rv = NNG_EINVAL;
+            break;
+        }
+
+        void *buffer_data;
+        size_t buffer_len;
+        napi_get_buffer_info(env, item, &buffer_data, &buffer_len);
+
+        rv = nng_msg_alloc(&msgs[i], 0);
+        if (rv == 0 && buffer_len > 0) {
+            rv = nng_msg_append(msgs[i], buffer_data, buffer_len);
+        }
+    }
+
+    if (rv == 0) {
+        rv = nng_aio_alloc(&work->aio, send_many_callback, work);
+    }
+
+    napi_value work_name;
+    napi_create_string_utf8(env, "nng_send_many", NAPI_AUTO_LENGTH, &work_name);
+
+    if (rv == 0 && napi_create_threadsafe_function(env, NULL, NULL, work_name, 0, 1,
+            NULL, NULL, NULL, send_many_call_js, &work->tsfn) != napi_ok) {
+        rv = NNG_ENOMEM;
+    }
+
+    if (rv != 0) {
+        for (uint32_t i = 0; i < count; i++) {
+            if (msgs[i]) nng_msg_free(msgs[i]);
+        }
+        if (work->aio) nng_aio_free(work->aio);
+        free(msgs);
+        free(work);
+        napi_reject_deferred(env, deferred, create_error(env, rv));
+        return promise;
+    }
+
+    nng_aio_set_msg(work->aio, msgs[0]);
+    nng_send_aio(work->sock, work->aio);
+
+    return promise;
+}
+
+// Native forwarding device between two (raw) sockets. Messages never
+// cross into JS; the promise settles once either socket is closed.
+typedef struct {
+    napi_deferred deferred;
+    napi_threadsafe_function tsfn;
+    nng_aio *aio;
+    int result;
+} DeviceWork;
+
+static void device_callback(void *arg) {
+    DeviceWork *work = (DeviceWork *)arg;
+    work->result = nng_aio_result(work->aio);
+    napi_call_threadsafe_function(work->tsfn, work, napi_tsfn_nonblocking);
+}
+
+static void device_call_js(napi_env env, napi_value js_cb, void *context, void *data) {
+    DeviceWork *work = (DeviceWork *)data;
+
+    // env is NULL when the threadsafe function is being torn down
+    if (env != NULL) {
+        // Closing a socket is the normal way to stop a device
+        if (work->result == 0 || work->result == NNG_ECLOSED) {
+            napi_value undefined;
+            napi_get_undefined(env, &undefined);
+            napi_resolve_deferred(env, work->deferred, undefined);
+        } else {
+            napi_reject_deferred(env, work->deferred, create_error(env, work->result));
+        }
+    }
+
+    napi_release_threadsafe_function(work->tsfn, napi_tsfn_release);
+    nng_aio_free(work->aio);
+    free(work);
+}
+
+// nng_device_aio (async)
+static napi_value socket_device(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 2) {
+        napi_throw_error(env, NULL, "Expected two socket IDs");
+        return NULL;
+    }
+
+    uint32_t id1, id2;
+    napi_get_value_uint32(env, args[0], &id1);
+    napi_get_value_uint32(env, args[1], &id2);
+
+    napi_value promise;
+    napi_deferred deferred;
+    napi_create_promise(env, &deferred, &promise);
+
+    DeviceWork *work = calloc(1, sizeof(DeviceWork));
+    if (!work) {
+        napi_reject_deferred(env, deferred, create_error(env, NNG_ENOMEM));
+        return promise;
+    }
+    work->deferred = deferred;
+
+    int rv = nng_aio_alloc(&work->aio, device_callback, work);
+
+    napi_value work_name;
+    napi_create_string_utf8(env, "nng_device", NAPI_AUTO_LENGTH, &work_name);
+
+    if (rv == 0 && napi_create_threadsafe_function(env, NULL, NULL, work_name, 0, 1,
+            NULL, NULL, NULL, device_call_js, &work->tsfn) != napi_ok) {
+        rv = NNG_ENOMEM;
+    }
+
+    if (rv != 0) {
+        if (work->aio) nng_aio_free(work->aio);
+        free(work);
+        napi_reject_deferred(env, deferred, create_error(env, rv));
+        return promise;
+    }
+
+    nng_socket s1 = { .id = id1 };
+    nng_socket s2 = { .id = id2 };
+    nng_device_aio(work->aio, s1, s2);
+
+    return promise;
+}
+
 // Async recv worker
 typedef struct {
     napi_async_work work;
@@ -671,6 +1408,220 @@ static napi_value socket_recv(napi_env env, napi_callback_info info) {
     return promise;
 }
 
+// Cancellable send/recv on an nng_aio, with a per-call timeout.
+// Pending operations are kept in an ID map so JS can cancel them.
+typedef struct {
+    napi_deferred deferred;
+    napi_threadsafe_function tsfn;
+    nng_aio *aio;
+    nng_socket sock;
+    uint32_t op_id;
+    bool is_recv;
+    int result;
+} AioOp;
+
+static nng_id_map *g_aio_ops = NULL;
+static pthread_mutex_t g_aio_ops_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void aio_op_callback(void *arg) {
+    AioOp *op = (AioOp *)arg;
+
+    op->result = nng_aio_result(op->aio);
+    if (op->result != 0 && !op->is_recv) {
+        // Failed sends leave the message with us
+        nng_msg *msg = nng_aio_get_msg(op->aio);
+        if (msg) nng_msg_free(msg);
+        nng_aio_set_msg(op->aio, NULL);
+    }
+
+    napi_call_threadsafe_function(op->tsfn, op, napi_tsfn_nonblocking);
+}
+
+static void aio_op_call_js(napi_env env, napi_value js_cb, void *context, void *data) {
+    AioOp *op = (AioOp *)data;
+
+    pthread_mutex_lock(&g_aio_ops_mutex);
+    nng_id_remove(g_aio_ops, op->op_id);
+    pthread_mutex_unlock(&g_aio_ops_mutex);
+
+    nng_msg *msg = (op->is_recv && op->result == 0) ? nng_aio_get_msg(op->aio) : NULL;
+
+    // env is NULL when the threadsafe function is being torn down
+    if (env != NULL) {
+        if (op->result != 0) {
+            napi_reject_deferred(env, op->deferred, create_error(env, op->result));
+        } else if (msg) {
+            napi_value buffer;
+            napi_create_buffer_copy(env, nng_msg_len(msg), nng_msg_body(msg), NULL, &buffer);
+            napi_resolve_deferred(env, op->deferred, buffer);
+        } else {
+            napi_value undefined;
+            napi_get_undefined(env, &undefined);
+            napi_resolve_deferred(env, op->deferred, undefined);
+        }
+    }
+
+    if (msg) nng_msg_free(msg);
+    napi_release_threadsafe_function(op->tsfn, napi_tsfn_release);
+    nng_aio_free(op->aio);
+    free(op);
+}
+
+// Start a send or recv operation; returns { id, promise }
+static napi_value aio_op_start(napi_env env, uint32_t socket_id, napi_value buffer,
+                               int32_t timeout_ms) {
+    napi_value promise;
+    napi_deferred deferred;
+    napi_create_promise(env, &deferred, &promise);
+
+    AioOp *op = calloc(1, sizeof(AioOp));
+    if (!op) {
+        napi_reject_deferred(env, deferred, create_error(env, NNG_ENOMEM));
+        return promise;
+    }
+    op->deferred = deferred;
+    op->sock.id = socket_id;
+    op->is_recv = (buffer == NULL);
+
+    nng_msg *msg = NULL;
+    int rv = nng_aio_alloc(&op->aio, aio_op_callback, op);
+
+    if (rv == 0 && !op->is_recv) {
+        void *buffer_data;
+        size_t buffer_len;
+        napi_get_buffer_info(env, buffer, &buffer_data, &buffer_len);
+        rv = nng_msg_alloc(&msg, 0);
+        if (rv == 0 && buffer_len > 0) {
+            rv = nng_msg_append(msg, buffer_data, buffer_len);
+        }
+    }
+
+    uint64_t op_id = 0;
+    if (rv == 0) {
+        pthread_mutex_lock(&g_aio_ops_mutex);
+        if (g_aio_ops == NULL) {
+            rv = nng_id_map_alloc(&g_aio_ops, 1, 0xffffffffu, 0);
+        }
+        if (rv == 0) {
+            rv = nng_id_alloc(g_aio_ops, &op_id, op);
+        }
+        pthread_mutex_unlock(&g_aio_ops_mutex);
+        op->op_id = (uint32_t)op_id;
+    }
+
+    napi_value work_name;
+    napi_create_string_utf8(env, op->is_recv ? "nng_recv_aio" : "nng_send_aio",
+                            NAPI_AUTO_LENGTH, &work_name);
+
+    if (rv == 0 && napi_create_threadsafe_function(env, NULL, NULL, work_name, 0, 1,
+            NULL, NULL, NULL, aio_op_call_js, &op->tsfn) != napi_ok) {
+        pthread_mutex_lock(&g_aio_ops_mutex);
+        nng_id_remove(g_aio_ops, op->op_id);
+        pthread_mutex_unlock(&g_aio_ops_mutex);
+        rv = NNG_ENOMEM;
+    }
+
+    if (rv != 0) {
+        if (msg) nng_msg_free(msg);
+        if (op->aio) nng_aio_free(op->aio);
+        free(op);
+        napi_reject_deferred(env, deferred, create_error(env, rv));
+        return promise;
+    }
+
+    nng_aio_set_timeout(op->aio, (nng_duration)timeout_ms);
+
+    napi_value result, id_value;
+    napi_create_object(env, &result);
+    napi_create_uint32(env, op->op_id, &id_value);
+    napi_set_named_property(env, result, "id", id_value);
+    napi_set_named_property(env, result, "promise", promise);
+
+    if (op->is_recv) {
+        nng_recv_aio(op->sock, op->aio);
+    } else {
+        nng_aio_set_msg(op->aio, msg);
+        nng_send_aio(op->sock, op->aio);
+    }
+
+    return result;
+}
+
+// nng_send_aio with timeout (async, cancellable)
+static napi_value socket_send_aio(napi_env env, napi_callback_info info) {
+    size_t argc = 3;
+    napi_value args[3];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 3) {
+        napi_throw_error(env, NULL, "Expected socket ID, data, and timeout");
+        return NULL;
+    }
+
+    uint32_t id;
+    napi_get_value_uint32(env, args[0], &id);
+
+    bool is_buffer;
+    napi_is_buffer(env, args[1], &is_buffer);
+    if (!is_buffer) {
+        napi_throw_type_error(env, NULL, "Data must be a Buffer");
+        return NULL;
+    }
+
+    int32_t timeout_ms;
+    napi_get_value_int32(env, args[2], &timeout_ms);
+
+    return aio_op_start(env, id, args[1], timeout_ms);
+}
+
+// nng_recv_aio with timeout (async, cancellable)
+static napi_value socket_recv_aio(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 2) {
+        napi_throw_error(env, NULL, "Expected socket ID and timeout");
+        return NULL;
+    }
+
+    uint32_t id;
+    napi_get_value_uint32(env, args[0], &id);
+
+    int32_t timeout_ms;
+    napi_get_value_int32(env, args[1], &timeout_ms);
+
+    return aio_op_start(env, id, NULL, timeout_ms);
+}
+
+// Cancel a pending send/recv; its promise rejects with NNG_ECANCELED
+static napi_value aio_cancel(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 1) {
+        napi_throw_error(env, NULL, "Expected operation ID");
+        return NULL;
+    }
+
+    uint32_t op_id;
+    napi_get_value_uint32(env, args[0], &op_id);
+
+    // Completion only frees the op on this thread, so it is still valid here
+    pthread_mutex_lock(&g_aio_ops_mutex);
+    AioOp *op = g_aio_ops ? nng_id_get(g_aio_ops, op_id) : NULL;
+    pthread_mutex_unlock(&g_aio_ops_mutex);
+
+    if (op) {
+        nng_aio_cancel(op->aio);
+    }
+
+    napi_value result;
+    napi_get_undefined(env, &result);
+    return result;
+}
+
 // nng_setopt_string
 static napi_value socket_setopt_string(napi_env env, napi_callback_info info) {
     size_t argc = 3;
@@ -716,6 +1667,7 @@ static napi_value Init(napi_env env, napi_value exports) {
     // Protocol constants
     napi_value protocol_bus, protocol_pair, protocol_pull, protocol_push;
     napi_value protocol_pub, protocol_sub, protocol_rep, protocol_req;
+    napi_value protocol_surveyor, protocol_respondent, protocol_pair1;
 
     napi_create_uint32(env, 0, &protocol_bus);
     napi_create_uint32(env, 1, &protocol_pair);
@@ -725,6 +1677,9 @@ static napi_value Init(napi_env env, napi_value exports) {
     napi_create_uint32(env, 5, &protocol_sub);
     napi_create_uint32(env, 6, &protocol_rep);
     napi_create_uint32(env, 7, &protocol_req);
+    napi_create_uint32(env, 8, &protocol_surveyor);
+    napi_create_uint32(env, 9, &protocol_respondent);
+    napi_create_uint32(env, 10, &protocol_pair1);
 
     napi_value protocols;
     napi_create_object(env, &protocols);
@@ -736,6 +1691,9 @@ static napi_value Init(napi_env env, napi_value exports) {
     napi_set_named_property(env, protocols, "SUB", protocol_sub);
     napi_set_named_property(env, protocols, "REP", protocol_rep);
     napi_set_named_property(env, protocols, "REQ", protocol_req);
+    napi_set_named_property(env, protocols, "SURVEYOR", protocol_surveyor);
+    napi_set_named_property(env, protocols, "RESPONDENT", protocol_respondent);
+    napi_set_named_property(env, protocols, "PAIR1", protocol_pair1);
 
     napi_set_named_property(env, exports, "Protocol", protocols);
 
@@ -757,9 +1715,24 @@ static napi_value Init(napi_env env, napi_value exports) {
     napi_create_function(env, NULL, 0, socket_send, NULL, &fn);
     napi_set_named_property(env, exports, "socketSend", fn);
 
+    napi_create_function(env, NULL, 0, socket_send_many, NULL, &fn);
+    napi_set_named_property(env, exports, "socketSendMany", fn);
+
+    napi_create_function(env, NULL, 0, socket_device, NULL, &fn);
+    napi_set_named_property(env, exports, "socketDevice", fn);
+
     napi_create_function(env, NULL, 0, socket_recv, NULL, &fn);
     napi_set_named_property(env, exports, "socketRecv", fn);
 
+    napi_create_function(env, NULL, 0, socket_send_aio, NULL, &fn);
+    napi_set_named_property(env, exports, "socketSendAio", fn);
+
+    napi_create_function(env, NULL, 0, socket_recv_aio, NULL, &fn);
+    napi_set_named_property(env, exports, "socketRecvAio", fn);
+
+    napi_create_function(env, NULL, 0, aio_cancel, NULL, &fn);
+    napi_set_named_property(env, exports, "aioCancel", fn);
+
     napi_create_function(env, NULL, 0, socket_setopt_string, NULL, &fn);
     napi_set_named_property(env, exports, "socketSetoptString", fn);
 
@@ -769,10 +1742,20 @@ static napi_value Init(napi_env env, napi_value exports) {
     napi_create_function(env, NULL, 0, socket_stop_recv, NULL, &fn);
     napi_set_named_property(env, exports, "socketStopRecv", fn);
 
+    napi_create_function(env, NULL, 0, socket_recv_stats, NULL, &fn);
+    napi_set_named_property(env, exports, "socketRecvStats", fn);
+
+    napi_create_function(env, NULL, 0, socket_recv_release, NULL, &fn);
+    napi_set_named_property(env, exports, "socketRecvRelease", fn);
+
     // Initialize other modules
     init_socket_functions(env, exports);
     init_dialer_functions(env, exports);
     init_listener_functions(env, exports);
+    init_poller_functions(env, exports);
+    init_context_functions(env, exports);
+    init_http_functions(env, exports);
+    init_batch_functions(env, exports);
     
     return exports;
 }
@@ -0,0 +1,468 @@
+#include <node_api.h>
+#include <nng/nng.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+
+// Shared helpers from nng_bindings.c
+napi_value create_error(napi_env env, int rv);
+
+struct Poller;
+
+// One socket joined to a poller, with its own receive aio
+typedef struct {
+    struct Poller *poller;
+    uint32_t socket_id;
+    nng_socket sock;
+    nng_aio *aio;
+} PollerMember;
+
+// A received message waiting to be delivered to JS
+typedef struct PollerItem {
+    uint32_t socket_id;
+    int error;
+    void *data;
+    size_t size;
+    struct PollerItem *next;
+} PollerItem;
+
+// Poller: many sockets, one threadsafe function
+typedef struct Poller {
+    uint32_t id;
+    napi_threadsafe_function tsfn;
+    pthread_mutex_t mutex;
+    PollerItem *head;
+    PollerItem *tail;
+    bool scheduled;
+    bool closed;
+    PollerMember **members;
+    size_t num_members;
+    size_t cap_members;
+} Poller;
+
+// Global poller storage
+#define MAX_POLLERS 64
+static Poller* g_pollers[MAX_POLLERS] = {0};
+static uint32_t g_next_poller_id = 1;
+static pthread_mutex_t g_poller_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Find poller by ID
+static Poller* find_poller(uint32_t poller_id) {
+    pthread_mutex_lock(&g_poller_mutex);
+    Poller *poller = NULL;
+    for (int i = 0; i < MAX_POLLERS; i++) {
+        if (g_pollers[i] && g_pollers[i]->id == poller_id) {
+            poller = g_pollers[i];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_poller_mutex);
+    return poller;
+}
+
+// Store poller and assign its ID
+static int store_poller(Poller *poller) {
+    pthread_mutex_lock(&g_poller_mutex);
+    int slot = -1;
+    for (int i = 0; i < MAX_POLLERS; i++) {
+        if (g_pollers[i] == NULL) {
+            poller->id = g_next_poller_id++;
+            g_pollers[i] = poller;
+            slot = i;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_poller_mutex);
+    return slot;
+}
+
+// Remove poller
+static void remove_poller(uint32_t poller_id) {
+    pthread_mutex_lock(&g_poller_mutex);
+    for (int i = 0; i < MAX_POLLERS; i++) {
+        if (g_pollers[i] && g_pollers[i]->id == poller_id) {
+            g_pollers[i] = NULL;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_poller_mutex);
+}
+
+static void free_items(PollerItem *item) {
+    while (item) {
+        PollerItem *next = item->next;
+        if (item->data) free(item->data);
+        free(item);
+        item = next;
+    }
+}
+
+// AIO completion callback, shared by all members of a poller
+static void poller_recv_callback(void *arg) {
+    PollerMember *member = (PollerMember *)arg;
+    Poller *poller = member->poller;
+
+    int rv = nng_aio_result(member->aio);
+
+    // Removal and socket close end the member's receive loop quietly
+    if (rv == NNG_ECANCELED || rv == NNG_ECLOSED) {
+        return;
+    }
+
+    PollerItem *item = (PollerItem *)malloc(sizeof(PollerItem));
+    if (item) {
+        item->socket_id = member->socket_id;
+        item->error = rv;
+        item->data = NULL;
+        item->size = 0;
+        item->next = NULL;
+    }
+
+    if (rv == 0) {
+        nng_msg *msg = nng_aio_get_msg(member->aio);
+        if (msg) {
+            size_t len = nng_msg_len(msg);
+            if (item && len > 0) {
+                item->data = malloc(len);
+                if (item->data) {
+                    memcpy(item->data, nng_msg_body(msg), len);
+                    item->size = len;
+                } else {
+                    item->error = NNG_ENOMEM;
+                }
+            }
+            nng_msg_free(msg);
+        }
+    }
+
+    // Queue in arrival order; only the first item of a batch wakes JS
+    if (item) {
+        pthread_mutex_lock(&poller->mutex);
+        bool wake = false;
+        if (poller->closed) {
+            free_items(item);
+        } else {
+            if (poller->tail) {
+                poller->tail->next = item;
+            } else {
+                poller->head = item;
+            }
+            poller->tail = item;
+            if (!poller->scheduled) {
+                poller->scheduled = true;
+                wake = true;
+            }
+        }
+        napi_threadsafe_function tsfn = poller->tsfn;
+        pthread_mutex_unlock(&poller->mutex);
+
+        if (wake && napi_call_threadsafe_function(tsfn, NULL, napi_tsfn_nonblocking) != napi_ok) {
+            pthread_mutex_lock(&poller->mutex);
+            poller->scheduled = false;
+            pthread_mutex_unlock(&poller->mutex);
+        }
+    }
+
+    // Errors end the loop too: a protocol that cannot receive (PUB, PUSH)
+    // or a REQ with nothing outstanding would fail again at once, forever
+    if (rv != 0) {
+        return;
+    }
+    nng_recv_aio(member->sock, member->aio);
+}
+
+// Threadsafe function to deliver a batch to the JS callback
+static void poller_call_js(napi_env env, napi_value js_cb, void *context, void *data) {
+    Poller *poller = (Poller *)context;
+
+    // env is NULL when the threadsafe function is being torn down
+    if (env == NULL || poller == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&poller->mutex);
+    PollerItem *items = poller->head;
+    poller->head = NULL;
+    poller->tail = NULL;
+    poller->scheduled = false;
+    pthread_mutex_unlock(&poller->mutex);
+
+    if (!items) {
+        return;
+    }
+
+    napi_value batch;
+    napi_create_array(env, &batch);
+
+    uint32_t index = 0;
+    for (PollerItem *item = items; item; item = item->next) {
+        napi_value entry, val;
+        napi_create_object(env, &entry);
+
+        napi_create_uint32(env, item->socket_id, &val);
+        napi_set_named_property(env, entry, "socket", val);
+
+        if (item->error == 0) {
+            if (item->data && item->size > 0) {
+                napi_create_buffer_copy(env, item->size, item->data, NULL, &val);
+            } else {
+                napi_create_buffer(env, 0, NULL, &val);
+            }
+            napi_set_named_property(env, entry, "data", val);
+        } else {
+            napi_set_named_property(env, entry, "error", create_error(env, item->error));
+        }
+
+        napi_set_element(env, batch, index++, entry);
+    }
+    free_items(items);
+
+    napi_value global, argv[2], result;
+    napi_get_global(env, &global);
+    napi_get_null(env, &argv[0]);
+    argv[1] = batch;
+
+    napi_status status = napi_call_function(env, global, js_cb, 2, argv, &result);
+
+    if (status != napi_ok) {
+        const napi_extended_error_info* error_info;
+        napi_get_last_error_info(env, &error_info);
+        fprintf(stderr, "Error calling JS poller callback: %s\n",
+                error_info->error_message ? error_info->error_message : "Unknown error");
+    }
+}
+
+// Finalizer for threadsafe function, releases the poller itself
+static void poller_tsfn_finalizer(napi_env env, void *finalize_data, void *finalize_hint) {
+    Poller *poller = (Poller *)finalize_data;
+
+    free_items(poller->head);
+    free(poller->members);
+    pthread_mutex_destroy(&poller->mutex);
+    free(poller);
+}
+
+// Stop a member's receive loop and release it
+static void member_free(PollerMember *member) {
+    // Waits for a running callback, which always consumes its message
+    nng_aio_stop(member->aio);
+    nng_aio_free(member->aio);
+    free(member);
+}
+
+// Create a poller delivering batches to a callback
+static napi_value poller_create(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 1) {
+        napi_throw_error(env, NULL, "Expected callback function");
+        return NULL;
+    }
+
+    napi_valuetype type;
+    napi_typeof(env, args[0], &type);
+    if (type != napi_function) {
+        napi_throw_type_error(env, NULL, "First argument must be a function");
+        return NULL;
+    }
+
+    Poller *poller = (Poller *)calloc(1, sizeof(Poller));
+    if (!poller) {
+        napi_throw_error(env, NULL, "Memory allocation failed");
+        return NULL;
+    }
+    pthread_mutex_init(&poller->mutex, NULL);
+
+    if (store_poller(poller) < 0) {
+        pthread_mutex_destroy(&poller->mutex);
+        free(poller);
+        napi_throw_error(env, NULL, "Too many active pollers");
+        return NULL;
+    }
+
+    napi_value resource_name;
+    napi_create_string_utf8(env, "nng_poller_callback", NAPI_AUTO_LENGTH, &resource_name);
+
+    napi_status status = napi_create_threadsafe_function(
+        env,
+        args[0],
+        NULL,
+        resource_name,
+        0,
+        1,
+        poller,
+        poller_tsfn_finalizer,
+        poller,
+        poller_call_js,
+        &poller->tsfn
+    );
+
+    if (status != napi_ok) {
+        remove_poller(poller->id);
+        pthread_mutex_destroy(&poller->mutex);
+        free(poller);
+        napi_throw_error(env, NULL, "Failed to create threadsafe function");
+        return NULL;
+    }
+
+    napi_value result;
+    napi_create_uint32(env, poller->id, &result);
+    return result;
+}
+
+// Join a socket to a poller
+static napi_value poller_add(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 2) {
+        napi_throw_error(env, NULL, "Expected poller ID and socket ID");
+        return NULL;
+    }
+
+    uint32_t poller_id, socket_id;
+    napi_get_value_uint32(env, args[0], &poller_id);
+    napi_get_value_uint32(env, args[1], &socket_id);
+
+    Poller *poller = find_poller(poller_id);
+    if (!poller) {
+        napi_throw_error(env, NULL, "Unknown poller");
+        return NULL;
+    }
+
+    for (size_t i = 0; i < poller->num_members; i++) {
+        if (poller->members[i]->socket_id == socket_id) {
+            napi_throw_error(env, NULL, "Socket already added to poller");
+            return NULL;
+        }
+    }
+
+    if (poller->num_members == poller->cap_members) {
+        size_t cap = poller->cap_members ? poller->cap_members * 2 : 16;
+        PollerMember **members = realloc(poller->members, cap * sizeof(PollerMember *));
+        if (!members) {
+            napi_throw_error(env, NULL, "Memory allocation failed");
+            return NULL;
+        }
+        poller->members = members;
+        poller->cap_members = cap;
+    }
+
+    PollerMember *member = (PollerMember *)calloc(1, sizeof(PollerMember));
+    if (!member) {
+        napi_throw_error(env, NULL, "Memory allocation failed");
+        return NULL;
+    }
+    member->poller = poller;
+    member->socket_id = socket_id;
+    member->sock.id = socket_id;
+
+    int rv = nng_aio_alloc(&member->aio, poller_recv_callback, member);
+    if (rv != 0) {
+        free(member);
+        napi_throw_error(env, NULL, nng_strerror(rv));
+        return NULL;
+    }
+    // A member waits for its next message indefinitely; honoring the
+    // socket's recv-timeout would post an ETIMEDOUT item every period
+    nng_aio_set_timeout(member->aio, NNG_DURATION_INFINITE);
+
+    poller->members[poller->num_members++] = member;
+    nng_recv_aio(member->sock, member->aio);
+
+    napi_value result;
+    napi_get_undefined(env, &result);
+    return result;
+}
+
+// Remove a socket from a poller
+static napi_value poller_remove(napi_env env, napi_callback_info info) {
+    size_t argc = 2;
+    napi_value args[2];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 2) {
+        napi_throw_error(env, NULL, "Expected poller ID and socket ID");
+        return NULL;
+    }
+
+    uint32_t poller_id, socket_id;
+    napi_get_value_uint32(env, args[0], &poller_id);
+    napi_get_value_uint32(env, args[1], &socket_id);
+
+    Poller *poller = find_poller(poller_id);
+    if (poller) {
+        for (size_t i = 0; i < poller->num_members; i++) {
+            if (poller->members[i]->socket_id == socket_id) {
+                PollerMember *member = poller->members[i];
+                poller->members[i] = poller->members[--poller->num_members];
+                member_free(member);
+                break;
+            }
+        }
+    }
+
+    napi_value result;
+    napi_get_undefined(env, &result);
+    return result;
+}
+
+// Close a poller, stopping all member receives
+static napi_value poller_close(napi_env env, napi_callback_info info) {
+    size_t argc = 1;
+    napi_value args[1];
+    napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+    if (argc < 1) {
+        napi_throw_error(env, NULL, "Expected poller ID");
+        return NULL;
+    }
+
+    uint32_t poller_id;
+    napi_get_value_uint32(env, args[0], &poller_id);
+
+    Poller *poller = find_poller(poller_id);
+    if (poller) {
+        remove_poller(poller_id);
+
+        for (size_t i = 0; i < poller->num_members; i++) {
+            member_free(poller->members[i]);
+        }
+        poller->num_members = 0;
+
+        pthread_mutex_lock(&poller->mutex);
+        poller->closed = true;
+        napi_threadsafe_function tsfn = poller->tsfn;
+        pthread_mutex_unlock(&poller->mutex);
+
+        // The finalizer frees the poller once pending calls have drained
+        napi_release_threadsafe_function(tsfn, napi_tsfn_abort);
+    }
+
+    napi_value result;
+    napi_get_undefined(env, &result);
+    return result;
+}
+
+// Initialize poller functions
+napi_value init_poller_functions(napi_env env, napi_value exports) {
+    napi_value fn;
+
+    napi_create_function(env, NULL, 0, poller_create, NULL, &fn);
+    napi_set_named_property(env, exports, "pollerCreate", fn);
+
+    napi_create_function(env, NULL, 0, poller_add, NULL, &fn);
+    napi_set_named_property(env, exports, "pollerAdd", fn);
+
+    napi_create_function(env, NULL, 0, poller_remove, NULL, &fn);
+    napi_set_named_property(env, exports, "pollerRemove", fn);
+
+    napi_create_function(env, NULL, 0, poller_close, NULL, &fn);
+    napi_set_named_property(env, exports, "pollerClose", fn);
+
+    return exports;
+}
\ No newline at end of file
@@ -0,0 +1,406 @@
+#include <node_api.h>
+#include <nng/nng.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+// Pooled receive buffers.
+//
+// Small messages are copied on the nng thread into the current slab of a
+// per-receiver pool. On the JS thread every fill cycle of a slab is
+// exposed as one external ArrayBuffer, and messages are delivered as
+// views into it, so no per-message backing store is allocated.
+//
+// A slab goes back to the free list once it is full and every message
+// delivered from it has been delivered, and then either all of them were
+// released from JS, or the cycle's ArrayBuffer was garbage collected.
+// Recycling a slab whose ArrayBuffer is still alive detaches it, so stale
+// views read as empty rather than seeing newer messages.
+//
+// Each message of a cycle is recorded by its place in the slab, and a
+// release must name exactly one delivered message that was not released
+// yet. A repeated release, or one of a slice, would otherwise count
+// against messages still held and recycle the slab under them.
+
+typedef struct RecvPool RecvPool;
+
+// One message of a slab's current fill cycle
+typedef struct {
+    size_t offset;
+    size_t length;
+    bool delivered;
+    bool released;
+} SlabRecord;
+
+typedef struct RecvSlab {
+    RecvPool *pool;
+    uint8_t *mem;
+    size_t used;
+    uint32_t pending;     // copied, not yet delivered to JS
+    uint32_t unreleased;  // delivered or pending, not yet released
+    uint32_t generation;
+    uint32_t ab_count;    // live ArrayBuffers over this slab
+    bool in_use;
+    bool retired;
+    napi_ref ab_ref;      // current cycle's ArrayBuffer
+    bool ab_strong;
+    SlabRecord *records;  // this cycle's messages, by offset
+    uint32_t num_records;
+    uint32_t cap_records;
+} RecvSlab;
+
+struct RecvPool {
+    pthread_mutex_t mutex;
+    size_t slab_size;
+    size_t max_message;
+    uint32_t max_slabs;
+    uint32_t num_slabs;
+    RecvSlab **slabs;
+    RecvSlab *current;
+    bool needs_sweep;
+    uint64_t hits;
+    uint64_t misses;
+};
+
+// Finalizer hint identifying which fill cycle an ArrayBuffer belongs to
+typedef struct {
+    RecvSlab *slab;
+    uint32_t generation;
+} SlabCycle;
+
+#define POOL_ALIGN 8
+
+RecvPool *recv_pool_create(size_t slab_size, uint32_t max_slabs) {
+    RecvPool *pool = (RecvPool *)calloc(1, sizeof(RecvPool));
+    if (!pool) {
+        return NULL;
+    }
+    pool->slabs = (RecvSlab **)calloc(max_slabs, sizeof(RecvSlab *));
+    if (!pool->slabs) {
+        free(pool);
+        return NULL;
+    }
+    pool->slab_size = slab_size;
+    pool->max_message = slab_size / 4;
+    pool->max_slabs = max_slabs;
+    pthread_mutex_init(&pool->mutex, NULL);
+    return pool;
+}
+
+// Return a slab to the free list (JS thread, pool mutex held)
+static void slab_recycle(napi_env env, RecvSlab *slab) {
+    if (slab->ab_ref) {
+        napi_value ab = NULL;
+        napi_get_reference_value(env, slab->ab_ref, &ab);
+        if (ab) {
+            napi_detach_arraybuffer(env, ab);
+        }
+        napi_delete_reference(env, slab->ab_ref);
+        slab->ab_ref = NULL;
+    }
+    slab->ab_strong = false;
+    slab->used = 0;
+    slab->unreleased = 0;
+    slab->num_records = 0;
+    slab->retired = false;
+    slab->in_use = false;
+    slab->generation++;
+}
+
+// Drop the strong reference on drained slabs and recycle fully released
+// ones (JS thread, pool mutex held)
+static void slab_drained(napi_env env, RecvSlab *slab) {
+    if (!slab->retired || slab->pending > 0) {
+        return;
+    }
+    if (slab->unreleased == 0) {
+        slab_recycle(env, slab);
+    } else if (slab->ab_strong) {
+        uint32_t refcount;
+        napi_reference_unref(env, slab->ab_ref, &refcount);
+        slab->ab_strong = false;
+    }
+}
+
+static void slab_finalizer(napi_env env, void *finalize_data, void *finalize_hint) {
+    SlabCycle *cycle = (SlabCycle *)finalize_hint;
+    RecvSlab *slab = cycle->slab;
+    uint32_t generation = cycle->generation;
+    RecvPool *pool = slab->pool;
+
+    free(cycle);
+
+    // Orphaned by recv_pool_destroy: the last ArrayBuffer frees the slab
+    if (pool == NULL) {
+        if (--slab->ab_count == 0) {
+            free(slab);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    slab->ab_count--;
+    if (slab->generation == generation && slab->in_use &&
+        slab->retired && slab->pending == 0) {
+        slab_recycle(env, slab);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void recv_pool_destroy(napi_env env, RecvPool *pool) {
+    if (!pool) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < pool->num_slabs; i++) {
+        RecvSlab *slab = pool->slabs[i];
+        if (slab->ab_ref) {
+            napi_value ab = NULL;
+            napi_get_reference_value(env, slab->ab_ref, &ab);
+            if (ab) {
+                napi_detach_arraybuffer(env, ab);
+            }
+            napi_delete_reference(env, slab->ab_ref);
+        }
+        // Every ArrayBuffer is detached now, so the memory can go
+        free(slab->mem);
+        free(slab->records);
+        slab->mem = NULL;
+        slab->records = NULL;
+        slab->pool = NULL;
+        if (slab->ab_count == 0) {
+            free(slab);
+        }
+    }
+
+    free(pool->slabs);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+}
+
+// Copy a message into the pool (nng thread). Returns NULL when the message
+// is too large or no slab is free, in which case the caller copies to heap.
+RecvSlab *recv_pool_copy(RecvPool *pool, const void *data, size_t len,
+                         size_t *offset, void **copy) {
+    if (len == 0 || len > pool->max_message) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+
+    RecvSlab *slab = pool->current;
+    if (slab && slab->used + len > pool->slab_size) {
+        slab->retired = true;
+        pool->needs_sweep = true;
+        pool->current = NULL;
+        slab = NULL;
+    }
+
+    if (!slab) {
+        for (uint32_t i = 0; i < pool->num_slabs; i++) {
+            if (!pool->slabs[i]->in_use) {
+                slab = pool->slabs[i];
+                break;
+            }
+        }
+        if (!slab && pool->num_slabs < pool->max_slabs) {
+            slab = (RecvSlab *)calloc(1, sizeof(RecvSlab));
+            if (slab) {
+                slab->mem = (uint8_t *)malloc(pool->slab_size);
+                if (slab->mem) {
+                    slab->pool = pool;
+                    pool->slabs[pool->num_slabs++] = slab;
+                } else {
+                    free(slab);
+                    slab = NULL;
+                }
+            }
+        }
+        if (slab) {
+            slab->in_use = true;
+            pool->current = slab;
+        }
+    }
+
+    if (slab && slab->num_records == slab->cap_records) {
+        uint32_t cap = slab->cap_records ? slab->cap_records * 2 : 64;
+        SlabRecord *records = realloc(slab->records, cap * sizeof(SlabRecord));
+        if (records) {
+            slab->records = records;
+            slab->cap_records = cap;
+        } else {
+            slab = NULL;
+        }
+    }
+
+    if (!slab) {
+        pool->misses++;
+        pthread_mutex_unlock(&pool->mutex);
+        return NULL;
+    }
+
+    SlabRecord *record = &slab->records[slab->num_records++];
+    record->offset = slab->used;
+    record->length = len;
+    record->delivered = false;
+    record->released = false;
+
+    *offset = slab->used;
+    *copy = slab->mem + slab->used;
+    memcpy(*copy, data, len);
+    slab->used += (len + POOL_ALIGN - 1) & ~(size_t)(POOL_ALIGN - 1);
+    slab->pending++;
+    slab->unreleased++;
+    pool->hits++;
+
+    pthread_mutex_unlock(&pool->mutex);
+    return slab;
+}
+
+// Find the record of the message at offset (pool mutex held)
+static SlabRecord *slab_record(RecvSlab *slab, size_t offset) {
+    uint32_t lo = 0;
+    uint32_t hi = slab->num_records;
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (slab->records[mid].offset < offset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < slab->num_records && slab->records[lo].offset == offset) {
+        return &slab->records[lo];
+    }
+    return NULL;
+}
+
+// Get the ArrayBuffer for a pooled message being delivered (JS thread).
+// Returns NULL if it cannot be created; the caller then copies the message
+// and calls recv_pool_discard.
+napi_value recv_pool_deliver(napi_env env, RecvPool *pool, RecvSlab *slab,
+                             size_t offset) {
+    napi_value ab = NULL;
+
+    pthread_mutex_lock(&pool->mutex);
+
+    if (slab->ab_ref) {
+        napi_get_reference_value(env, slab->ab_ref, &ab);
+    }
+    if (ab == NULL) {
+        SlabCycle *cycle = (SlabCycle *)malloc(sizeof(SlabCycle));
+        napi_status status = napi_generic_failure;
+        if (cycle) {
+            cycle->slab = slab;
+            cycle->generation = slab->generation;
+            status = napi_create_external_arraybuffer(
+                env, slab->mem, pool->slab_size, slab_finalizer, cycle, &ab);
+            if (status != napi_ok) {
+                free(cycle);
+            }
+        }
+        if (status == napi_ok) {
+            slab->ab_count++;
+            if (slab->ab_ref) {
+                napi_delete_reference(env, slab->ab_ref);
+            }
+            napi_create_reference(env, ab, 1, &slab->ab_ref);
+            slab->ab_strong = true;
+        } else {
+            pthread_mutex_unlock(&pool->mutex);
+            return NULL;
+        }
+    }
+
+    SlabRecord *record = slab_record(slab, offset);
+    if (record) {
+        record->delivered = true;
+    }
+    slab->pending--;
+    slab_drained(env, slab);
+
+    // Slabs retired on the nng thread may have drained earlier
+    if (pool->needs_sweep) {
+        pool->needs_sweep = false;
+        for (uint32_t i = 0; i < pool->num_slabs; i++) {
+            if (pool->slabs[i]->in_use) {
+                slab_drained(env, pool->slabs[i]);
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&pool->mutex);
+    return ab;
+}
+
+// Drop a pooled message without delivering it (JS thread)
+void recv_pool_discard(napi_env env, RecvPool *pool, RecvSlab *slab,
+                       size_t offset) {
+    pthread_mutex_lock(&pool->mutex);
+    SlabRecord *record = slab_record(slab, offset);
+    if (record) {
+        record->released = true;
+    }
+    slab->pending--;
+    slab->unreleased--;
+    slab_drained(env, slab);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+// Release a delivered message back to its slab (JS thread)
+bool recv_pool_release(napi_env env, RecvPool *pool, napi_value view) {
+    bool is_typedarray;
+    napi_is_typedarray(env, view, &is_typedarray);
+    if (!is_typedarray) {
+        return false;
+    }
+
+    napi_typedarray_type type;
+    size_t length, byte_offset;
+    void *data;
+    napi_value ab;
+    napi_get_typedarray_info(env, view, &type, &length, &data, &ab, &byte_offset);
+    if (type != napi_uint8_array || length == 0) {
+        // Detached: the slab was already recycled
+        return false;
+    }
+
+    bool released = false;
+    pthread_mutex_lock(&pool->mutex);
+    for (uint32_t i = 0; i < pool->num_slabs; i++) {
+        RecvSlab *slab = pool->slabs[i];
+        if (!slab->in_use || !slab->ab_ref) {
+            continue;
+        }
+        if ((uint8_t *)data < slab->mem || (uint8_t *)data >= slab->mem + pool->slab_size) {
+            continue;
+        }
+        napi_value current = NULL;
+        bool same = false;
+        napi_get_reference_value(env, slab->ab_ref, &current);
+        if (current) {
+            napi_strict_equals(env, current, ab, &same);
+        }
+        SlabRecord *record = same ? slab_record(slab, byte_offset) : NULL;
+        if (record && record->length == length && record->delivered &&
+            !record->released) {
+            record->released = true;
+            slab->unreleased--;
+            slab_drained(env, slab);
+            released = true;
+        }
+        break;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return released;
+}
+
+void recv_pool_stats(RecvPool *pool, uint64_t *hits, uint64_t *misses, uint32_t *slabs) {
+    pthread_mutex_lock(&pool->mutex);
+    *hits = pool->hits;
+    *misses = pool->misses;
+    *slabs = pool->num_slabs;
+    pthread_mutex_unlock(&pool->mutex);
+}
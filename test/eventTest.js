@@ -441,6 +441,394 @@ async function testEventBasedHandlerReplacement() {
     }
 }
 
+// Test 7: Event-based PUSH/PULL - Native receive filter
+async function testEventBasedFilter() {
+    console.log('\n=== Testing Event-Based PUSH/PULL - Native Filter ===');
+
+    const push = nng.push();
+    const pull = nng.pull();
+
+    try {
+        pull.listen('tcp://127.0.0.1:5576');
+        push.dial('tcp://127.0.0.1:5576');
+
+        await delay(100);
+
+        const receivedMessages = [];
+
+        // Keep messages starting with "keep:" whose byte 5 has the low bit set
+        pull.startRecv((err, data) => {
+            if (err) return;
+            receivedMessages.push(data.toString());
+            console.log('Filtered event received:', data.toString());
+        }, {
+            filter: { prefix: 'keep:', offset: 5, mask: 0x01, value: 0x01, maxLength: 16 }
+        });
+
+        await push.send('keep:1');
+        await push.send('drop:1');
+        await push.send('keep:2');
+        await push.send('keep:3');
+        await push.send('keep:1 but far too long');
+        await delay(200);
+
+        if (receivedMessages.length !== 2 ||
+            receivedMessages[0] !== 'keep:1' ||
+            receivedMessages[1] !== 'keep:3') {
+            throw new Error(`Unexpected filtered messages: ${receivedMessages.join(', ')}`);
+        }
+
+        const stats = pull.recvStats();
+        console.log('Receive stats:', stats);
+        if (stats.received !== 5 || stats.dropped !== 3 || stats.delivered !== 2) {
+            throw new Error('Receive stats mismatch');
+        }
+
+        pull.stopRecv();
+
+        // Non-numeric filter fields are rejected rather than read as garbage
+        for (const bad of [{ offset: 'x', value: 1 }, { offset: 0, value: 1, mask: 'y' },
+                           { minLength: {} }, { prefix: 'keep:', maxLength: 'z' }]) {
+            let threw = false;
+            try {
+                pull.startRecv(() => {}, { filter: bad });
+            } catch (e) {
+                threw = e instanceof TypeError;
+            }
+            if (!threw) {
+                throw new Error(`Filter ${JSON.stringify(bad)} was not rejected`);
+            }
+        }
+
+        console.log('✓ Event-based native filter test passed');
+    } catch (err) {
+        console.error('✗ Event-based native filter test failed:', err.message);
+        throw err;
+    } finally {
+        push.close();
+        pull.close();
+    }
+}
+
+// Test 8: Poller - One callback for many PAIR sockets
+async function testPollerManySockets() {
+    console.log('\n=== Testing Poller - Many PAIR Sockets ===');
+
+    const servers = [];
+    const clients = [];
+    const received = [];
+    let batches = 0;
+    const errors = [];
+
+    const poller = new nng.Poller((err, batch) => {
+        if (err) return;
+        batches++;
+        for (const entry of batch) {
+            if (entry.error) {
+                errors.push(entry.socket);
+                continue;
+            }
+            received.push({ socket: entry.socket, msg: entry.data.toString() });
+        }
+    });
+
+    try {
+        for (let i = 0; i < 4; i++) {
+            const server = nng.pair();
+            const client = nng.pair();
+            server.listen(`tcp://127.0.0.1:${5577 + i}`);
+            client.dial(`tcp://127.0.0.1:${5577 + i}`);
+            // A socket receive timeout does not turn into poller errors
+            server.setOpt('recv-timeout', 20);
+            poller.add(server);
+            servers.push(server);
+            clients.push(client);
+        }
+
+        await delay(200);
+
+        for (let i = 0; i < clients.length; i++) {
+            await clients[i].send(`from ${i} #1`);
+            await clients[i].send(`from ${i} #2`);
+        }
+        await delay(300);
+
+        console.log(`Poller received ${received.length} messages in ${batches} batches`);
+        if (received.length !== 8) {
+            throw new Error(`Expected 8 messages, received ${received.length}`);
+        }
+        for (let i = 0; i < servers.length; i++) {
+            const mine = received.filter(r => r.socket === servers[i].id).map(r => r.msg);
+            if (mine.length !== 2 || mine[0] !== `from ${i} #1` || mine[1] !== `from ${i} #2`) {
+                throw new Error(`Socket ${i} messages out of order: ${mine.join(', ')}`);
+            }
+        }
+
+        // Removed sockets stop delivering through the poller
+        poller.remove(servers[0]);
+        await clients[0].send('after remove');
+        await clients[1].send('still polled');
+        await delay(200);
+
+        if (received.some(r => r.msg === 'after remove')) {
+            throw new Error('Received message from removed socket');
+        }
+        if (!received.some(r => r.msg === 'still polled')) {
+            throw new Error('Missing message from polled socket');
+        }
+        if (errors.length !== 0) {
+            throw new Error(`Unexpected poller errors: ${errors.length}`);
+        }
+
+        // A socket that can never receive reports so once, not in a loop
+        const push = nng.push();
+        try {
+            poller.add(push);
+            await delay(100);
+        } finally {
+            poller.remove(push);
+            push.close();
+        }
+        if (errors.length !== 1 || errors[0] !== push.id) {
+            throw new Error(`Expected one error from PUSH, got ${errors.length}`);
+        }
+
+        console.log('✓ Poller test passed');
+    } catch (err) {
+        console.error('✗ Poller test failed:', err.message);
+        throw err;
+    } finally {
+        for (const sock of clients) sock.close();
+        for (const sock of servers) sock.close();
+        poller.close();
+    }
+}
+
+// Test 9: Event-based PUSH/PULL - Pooled receive buffers
+async function testEventBasedPool() {
+    console.log('\n=== Testing Event-Based PUSH/PULL - Pooled Buffers ===');
+
+    const push = nng.push();
+    const pull = nng.pull();
+
+    try {
+        pull.listen('tcp://127.0.0.1:5581');
+        push.dial('tcp://127.0.0.1:5581');
+
+        await delay(100);
+
+        const count = 200;
+        const received = [];
+        let pooledViews = 0;
+        let largeReceived = null;
+        let held = null;
+        let doneResolve;
+        const donePromise = new Promise((resolve, reject) => {
+            doneResolve = resolve;
+            setTimeout(() => reject(new Error('Timeout waiting for pooled messages')), 5000);
+        });
+
+        pull.startRecv((err, data) => {
+            if (err) return;
+            if (held) {
+                held.push(data);
+                return;
+            }
+            if (data.length > 256) {
+                largeReceived = data;
+            } else {
+                if (data.buffer.byteLength === 1024) pooledViews++;
+                received.push(data.toString());
+                pull.release(data);
+            }
+            if (received.length === count && largeReceived) doneResolve();
+        }, { pool: { slabSize: 1024, maxSlabs: 2 } });
+
+        const messages = [];
+        for (let i = 0; i < count; i++) {
+            messages.push(`pooled message ${String(i).padStart(4, '0')}`.padEnd(60, '.'));
+        }
+        await push.sendMany(messages);
+        await push.send(Buffer.alloc(1000, 'L'));
+        await donePromise;
+
+        for (let i = 0; i < count; i++) {
+            if (received[i] !== messages[i]) {
+                throw new Error(`Pooled message mismatch at ${i}`);
+            }
+        }
+        if (largeReceived.length !== 1000 || largeReceived[999] !== 0x4C) {
+            throw new Error('Large message mismatch');
+        }
+
+        const stats = pull.recvStats();
+        console.log(`Pooled views: ${pooledViews}, stats:`, stats);
+        if (pooledViews === 0 || stats.poolHits !== pooledViews || stats.poolSlabs > 2) {
+            throw new Error('Pool was not used as expected');
+        }
+
+        // Releasing one buffer again and again, or slices of it, must not
+        // release the messages still held in the same slab
+        held = [];
+        const heldMessages = messages.slice(0, 20);
+        await push.sendMany(heldMessages);
+        await delay(200);
+        if (held.length !== heldMessages.length) {
+            throw new Error(`Expected ${heldMessages.length} held messages, got ${held.length}`);
+        }
+        if (held.slice(0, 16).some(b => b.buffer.byteLength !== 1024)) {
+            throw new Error('Held messages were not pooled');
+        }
+        const releases = [pull.release(held[0])];
+        for (let i = 0; i < 20; i++) {
+            releases.push(pull.release(held[0]));
+            releases.push(pull.release(held[1].subarray(1)));
+        }
+        if (!releases[0] || releases.slice(1).some(r => r)) {
+            throw new Error('Repeated or partial release was accepted');
+        }
+        for (let i = 1; i < held.length; i++) {
+            if (held[i].toString() !== heldMessages[i]) {
+                throw new Error(`Held message ${i} was recycled`);
+            }
+        }
+        for (let i = 1; i < held.length; i++) {
+            if (!pull.release(held[i])) {
+                throw new Error(`Release of held message ${i} failed`);
+            }
+        }
+
+        pull.stopRecv();
+
+        console.log('✓ Event-based pooled buffers test passed');
+    } catch (err) {
+        console.error('✗ Event-based pooled buffers test failed:', err.message);
+        throw err;
+    } finally {
+        push.close();
+        pull.close();
+    }
+}
+
+// Test 10: Event-based PUSH/PULL - Micro-batched sends
+async function testEventBasedBatching() {
+    console.log('\n=== Testing Event-Based PUSH/PULL - Micro-Batching ===');
+
+    const push = nng.push();
+    const pull = nng.pull();
+
+    try {
+        pull.listen('tcp://127.0.0.1:5582');
+        push.dial('tcp://127.0.0.1:5582');
+
+        await delay(100);
+
+        const received = [];
+        let envelopes = 0;
+        let doneResolve;
+        let expected = 0;
+        const donePromise = new Promise((resolve, reject) => {
+            doneResolve = resolve;
+            setTimeout(() => reject(new Error('Timeout waiting for batched messages')), 5000);
+        });
+
+        pull.startRecv((err, messages) => {
+            if (err) return;
+            envelopes++;
+            for (const msg of messages) {
+                received.push(msg.toString());
+            }
+            if (received.length === expected) doneResolve();
+        }, { batched: true, filter: { minLength: 1 } });
+
+        // Budgets cut envelopes by count and by size; an empty message
+        // is framed like any other and dropped here by the filter
+        push.setBatching({ maxDelayMs: 50, maxBytes: 4096, maxMessages: 64 });
+
+        const messages = [];
+        for (let i = 0; i < 300; i++) {
+            messages.push(`batched message ${i}`.padEnd(i % 7 === 0 ? 300 : 20, '.'));
+        }
+        expected = messages.length;
+        await push.sendMany(messages);
+        await push.send(Buffer.alloc(0));
+        await push.flush();
+        await donePromise;
+
+        for (let i = 0; i < messages.length; i++) {
+            if (received[i] !== messages[i]) {
+                throw new Error(`Batched message mismatch at ${i}`);
+            }
+        }
+
+        const stats = push.batchStats();
+        console.log(`Envelopes received: ${envelopes}, stats:`, stats);
+        if (stats.messages !== 301 || stats.pending !== 0 || stats.failed !== 0) {
+            throw new Error('Unexpected batch stats');
+        }
+        if (stats.batches < 5 || stats.batches > 20 || envelopes > stats.batches) {
+            throw new Error('Messages were not coalesced as expected');
+        }
+        if (pull.recvStats().dropped !== 1) {
+            throw new Error('Filter was not applied per record');
+        }
+
+        // A lone message goes out when the delay timer fires
+        const lone = new Promise((resolve, reject) => {
+            const timer = setTimeout(() => reject(new Error('Delay flush did not fire')), 2000);
+            pull.startRecv((err, msgs) => {
+                clearTimeout(timer);
+                if (err) reject(err); else resolve(msgs);
+            }, { batched: true });
+        });
+        await push.send('lonely');
+        const msgs = await lone;
+        if (msgs.length !== 1 || msgs[0].toString() !== 'lonely') {
+            throw new Error('Delayed envelope mismatch');
+        }
+
+        push.setBatching(null);
+        if (push.batchStats() !== null) {
+            throw new Error('Batching was not disabled');
+        }
+
+        pull.stopRecv();
+
+        // With no peer, envelopes queue up to maxQueued and sends then fail
+        const lonePush = nng.push();
+        try {
+            lonePush.setBatching({ maxMessages: 1, maxQueued: 4 });
+            let accepted = 0;
+            let error = null;
+            for (let i = 0; i < 100 && !error; i++) {
+                try {
+                    await lonePush.send(`queued ${i}`);
+                    accepted++;
+                } catch (err) {
+                    error = err;
+                }
+            }
+            // One envelope waits on the send aio, maxQueued more behind it
+            if (!error || !/Try again/.test(error.message) || accepted !== 5) {
+                throw new Error(`Expected NNG_EAGAIN after 5 sends, got ${accepted}: ${error}`);
+            }
+            if (lonePush.batchStats().pending !== 5) {
+                throw new Error('Rejected send was queued');
+            }
+        } finally {
+            lonePush.close();
+        }
+
+        console.log('✓ Event-based micro-batching test passed');
+    } catch (err) {
+        console.error('✗ Event-based micro-batching test failed:', err.message);
+        throw err;
+    } finally {
+        push.close();
+        pull.close();
+    }
+}
+
 // Run all event-based tests
 async function runEventTests() {
     console.log('Starting Event-Based PUSH/PULL Tests');
@@ -453,6 +841,10 @@ async function runEventTests() {
         await testEventBasedBinaryData();
         await testEventBasedStopRestart();
         await testEventBasedHandlerReplacement();
+        await testEventBasedFilter();
+        await testPollerManySockets();
+        await testEventBasedPool();
+        await testEventBasedBatching();
 
         console.log('\n=====================================');
         console.log('All event-based tests completed successfully!');
@@ -1,4 +1,6 @@
 const nng = require('../lib/index');
+const http = require('http');
+const net = require('net');
 
 // Utility function to wait for a short time
 function delay(ms) {
@@ -652,6 +654,495 @@ async function testEventDrivenRecv() {
     }
 }
 
+// Test 15: Batch send
+async function testSendMany() {
+    console.log('\n=== Testing Batch Send (sendMany) ===');
+
+    const push = nng.push();
+    const pull = nng.pull();
+    const lonely = nng.push();
+
+    try {
+        pull.listen('tcp://127.0.0.1:5567');
+        push.dial('tcp://127.0.0.1:5567');
+
+        await delay(100);
+
+        const count = 1000;
+        const received = [];
+        let allResolve;
+        const allPromise = new Promise((resolve, reject) => {
+            allResolve = resolve;
+            setTimeout(() => reject(new Error('Timeout waiting for batch')), 5000);
+        });
+
+        pull.startRecv((err, data) => {
+            if (err) return;
+            received.push(data.toString());
+            if (received.length === count) allResolve();
+        });
+
+        const messages = [];
+        for (let i = 0; i < count; i++) {
+            messages.push(i % 2 ? `msg ${i}` : Buffer.from(`msg ${i}`));
+        }
+
+        const sent = await push.sendMany(messages);
+        if (sent !== count) {
+            throw new Error(`Expected ${count} sent, got ${sent}`);
+        }
+        await allPromise;
+
+        for (let i = 0; i < count; i++) {
+            if (received[i] !== `msg ${i}`) {
+                throw new Error(`Order mismatch at ${i}: ${received[i]}`);
+            }
+        }
+        console.log(`✓ ${count} messages sent in one call, in order`);
+
+        // No peer: the batch times out and reports how many went out
+        lonely.setOpt('send-timeout', 100);
+        try {
+            await lonely.sendMany(['a', 'b', 'c']);
+            throw new Error('sendMany without peer should fail');
+        } catch (err) {
+            if (!err.message.includes('Timed out') || err.sent !== 0) {
+                throw err;
+            }
+            console.log('✓ Partial batch reports sent count:', err.sent);
+        }
+
+        pull.stopRecv();
+
+        console.log('✓ Batch send test passed');
+    } catch (err) {
+        console.error('✗ Batch send test failed:', err.message);
+        throw err;
+    } finally {
+        push.close();
+        pull.close();
+        lonely.close();
+    }
+}
+
+// Test 16: Per-call deadlines and AbortSignal
+async function testDeadlineAndAbort() {
+    console.log('\n=== Testing Per-Call Deadlines and AbortSignal ===');
+
+    const push = nng.push();
+    const pull = nng.pull();
+
+    try {
+        pull.listen('tcp://127.0.0.1:5568');
+
+        // recv deadline without touching the socket-wide recv-timeout
+        let start = Date.now();
+        try {
+            await pull.recv({ timeoutMs: 100 });
+            throw new Error('Recv should time out');
+        } catch (err) {
+            if (!err.message.includes('Timed out')) throw err;
+        }
+        if (Date.now() - start > 1000) {
+            throw new Error('Recv deadline took too long');
+        }
+        console.log('✓ Recv deadline expired');
+
+        // Aborting releases a pending recv at once
+        const controller = new AbortController();
+        start = Date.now();
+        setTimeout(() => controller.abort(), 50);
+        try {
+            await pull.recv({ signal: controller.signal });
+            throw new Error('Recv should be aborted');
+        } catch (err) {
+            if (err.name !== 'AbortError') throw err;
+        }
+        if (Date.now() - start > 1000) {
+            throw new Error('Abort took too long');
+        }
+        console.log('✓ Recv aborted');
+
+        // Already-aborted signal fails fast
+        try {
+            await pull.recv({ signal: controller.signal });
+            throw new Error('Recv with aborted signal should fail');
+        } catch (err) {
+            if (err.name !== 'AbortError') throw err;
+        }
+        console.log('✓ Pre-aborted signal rejected');
+
+        // Send deadline with no peer
+        try {
+            await push.send('nobody listening', { timeoutMs: 100 });
+            throw new Error('Send should time out');
+        } catch (err) {
+            if (!err.message.includes('Timed out')) throw err;
+        }
+        console.log('✓ Send deadline expired');
+
+        // Normal delivery through the aio path
+        push.dial('tcp://127.0.0.1:5568');
+        await delay(100);
+
+        const signal = new AbortController().signal;
+        const receivePromise = pull.recv({ signal, timeoutMs: 2000 });
+        await push.send('with deadline', { signal, timeoutMs: 2000 });
+        const msg = await receivePromise;
+        if (msg.toString() !== 'with deadline') {
+            throw new Error('Message mismatch');
+        }
+        console.log('✓ Message delivered with deadline and signal');
+
+        console.log('✓ Deadline and abort test passed');
+    } catch (err) {
+        console.error('✗ Deadline and abort test failed:', err.message);
+        throw err;
+    } finally {
+        push.close();
+        pull.close();
+    }
+}
+
+// Test 17: Surveyor contexts gathering responses
+async function testSurvey() {
+    console.log('\n=== Testing Surveyor/Respondent ===');
+
+    const surveyor = nng.surveyor();
+    const respondents = [nng.respondent(), nng.respondent(), nng.respondent()];
+
+    try {
+        surveyor.listen('tcp://127.0.0.1:5569');
+        for (const r of respondents) {
+            r.dial('tcp://127.0.0.1:5569');
+        }
+        await delay(100);
+
+        // Each respondent answers every survey with its index
+        const answer = (r, i) => r.recv().then(msg => r.send(`${msg.toString()}:${i}`));
+
+        surveyor.setOpt('surveyor:survey-time', 300);
+        let pending = respondents.map(answer);
+        const responses = await surveyor.survey('health');
+        await Promise.all(pending);
+
+        const got = responses.map(b => b.toString()).sort();
+        if (got.join(',') !== 'health:0,health:1,health:2') {
+            throw new Error(`Unexpected responses: ${got.join(',')}`);
+        }
+        console.log(`✓ Survey gathered ${responses.length} responses`);
+
+        // Two surveys in flight on separate contexts of one socket
+        const ctx1 = surveyor.openContext();
+        const ctx2 = surveyor.openContext();
+        ctx1.setOpt('surveyor:survey-time', 300);
+        ctx2.setOpt('surveyor:survey-time', 300);
+        pending = respondents.map(r => answer(r, 'a').then(() => answer(r, 'b')));
+        const [first, second] = await Promise.all([ctx1.survey('one'), ctx2.survey('two')]);
+        await Promise.all(pending);
+        ctx1.close();
+        ctx2.close();
+
+        if (first.length !== 3 || !first.every(b => b.toString().startsWith('one:'))) {
+            throw new Error('First context got wrong responses');
+        }
+        if (second.length !== 3 || !second.every(b => b.toString().startsWith('two:'))) {
+            throw new Error('Second context got wrong responses');
+        }
+        console.log('✓ Concurrent surveys on separate contexts');
+
+        // No respondents answer: survey resolves empty once time expires
+        const silent = await surveyor.survey('anyone?', { timeoutMs: 100 });
+        if (silent.length !== 0) {
+            throw new Error('Expected no responses');
+        }
+        console.log('✓ Unanswered survey resolves empty');
+
+        console.log('✓ Surveyor/Respondent test passed');
+    } catch (err) {
+        console.error('✗ Surveyor/Respondent test failed:', err.message);
+        throw err;
+    } finally {
+        surveyor.close();
+        for (const r of respondents) r.close();
+    }
+}
+
+// Test 18: Raw sockets forwarded by a native device
+async function testRawDevice() {
+    console.log('\n=== Testing Raw Sockets and Device ===');
+
+    const front = nng.rep({ raw: true });
+    const back = nng.req({ raw: true });
+    const client = nng.req();
+    const server = nng.rep();
+
+    try {
+        front.listen('tcp://127.0.0.1:5570');
+        back.listen('tcp://127.0.0.1:5571');
+        const running = nng.device(front, back);
+
+        client.dial('tcp://127.0.0.1:5570');
+        server.dial('tcp://127.0.0.1:5571');
+        await delay(100);
+
+        for (let i = 0; i < 3; i++) {
+            const served = server.recv().then(msg => server.send(`pong ${msg.toString()}`));
+            await client.send(`${i}`);
+            const reply = await client.recv();
+            await served;
+            if (reply.toString() !== `pong ${i}`) {
+                throw new Error(`Unexpected reply: ${reply.toString()}`);
+            }
+        }
+        console.log('✓ Requests forwarded through raw device');
+
+        // Closing a side stops the device
+        front.close();
+        await running;
+        console.log('✓ Device stopped on close');
+
+        // Raw sockets refuse contexts
+        try {
+            back.openContext();
+            throw new Error('Raw socket should not open a context');
+        } catch (err) {
+            if (err.message.includes('should not')) throw err;
+        }
+        console.log('✓ Raw socket rejects contexts');
+
+        console.log('✓ Raw device test passed');
+    } catch (err) {
+        console.error('✗ Raw device test failed:', err.message);
+        throw err;
+    } finally {
+        front.close();
+        back.close();
+        client.close();
+        server.close();
+    }
+}
+
+// Test 19: Shared TCP port via tcp-reuseport
+async function testReusePort() {
+    console.log('\n=== Testing tcp-reuseport Listeners ===');
+
+    const pulls = [nng.pull(), nng.pull()];
+    const intruder = nng.pull();
+    const push = nng.push();
+
+    try {
+        const listeners = pulls.map(pull => {
+            const listener = new nng.Listener(pull, 'tcp://127.0.0.1:5572');
+            if (listener.getOpt('tcp-reuseport') !== false) {
+                throw new Error('tcp-reuseport should default to false');
+            }
+            listener.setOpt('tcp-reuseport', true);
+            listener.start();
+            return listener;
+        });
+        console.log('✓ Two listeners bound to the same port');
+
+        // Changing it once bound is refused
+        try {
+            listeners[0].setOpt('tcp-reuseport', false);
+            throw new Error('Setting tcp-reuseport after start should fail');
+        } catch (err) {
+            if (err.message.includes('should fail')) throw err;
+        }
+
+        // A listener without the option cannot join
+        try {
+            new nng.Listener(intruder, 'tcp://127.0.0.1:5572').start();
+            throw new Error('Listener without tcp-reuseport should fail');
+        } catch (err) {
+            if (err.message.includes('should fail')) throw err;
+        }
+        console.log('✓ Listener without tcp-reuseport refused');
+
+        // Whichever listener the kernel picks delivers the message
+        push.dial('tcp://127.0.0.1:5572');
+        await delay(100);
+        await push.send('shared port');
+        const got = await Promise.all(
+            pulls.map(pull => pull.recv({ timeoutMs: 500 }).catch(() => null)));
+        const delivered = got.filter(msg => msg !== null);
+        if (delivered.length !== 1 || delivered[0].toString() !== 'shared port') {
+            throw new Error('Message mismatch');
+        }
+        console.log('✓ Message delivered through shared port');
+
+        console.log('✓ tcp-reuseport test passed');
+    } catch (err) {
+        console.error('✗ tcp-reuseport test failed:', err.message);
+        throw err;
+    } finally {
+        for (const pull of pulls) pull.close();
+        intruder.close();
+        push.close();
+    }
+}
+
+// Test 20: Adopting connections made by Node
+async function testAdoptFd() {
+    console.log('\n=== Testing listener.adoptFd ===');
+
+    const rep = nng.rep();
+    const req = nng.req();
+    const listener = new nng.Listener(req, 'socket://');
+    listener.start();
+
+    try {
+        rep.listen('tcp://127.0.0.1:5573');
+
+        // Node owns the TCP connection; NNG speaks SP over it once adopted.
+        // Pausing before connect keeps Node from reading any of it.
+        const conn = new net.Socket();
+        conn.pause();
+        await new Promise((resolve, reject) => {
+            conn.once('error', reject);
+            conn.connect(5573, '127.0.0.1', resolve);
+        });
+        listener.adoptFd(conn);
+        await delay(100);
+
+        for (let i = 0; i < 3; i++) {
+            const served = rep.recv().then(msg => rep.send(`echo ${msg.toString()}`));
+            await req.send(`adopted ${i}`);
+            const reply = await req.recv();
+            await served;
+            if (reply.toString() !== `echo adopted ${i}`) {
+                throw new Error(`Unexpected reply: ${reply.toString()}`);
+            }
+        }
+        console.log('✓ Request/reply over an adopted connection');
+
+        try {
+            listener.adoptFd('not a socket');
+            throw new Error('adoptFd should reject bad arguments');
+        } catch (err) {
+            if (err.message.includes('should reject')) throw err;
+        }
+        console.log('✓ Bad arguments rejected');
+
+        console.log('✓ adoptFd test passed');
+    } catch (err) {
+        console.error('✗ adoptFd test failed:', err.message);
+        throw err;
+    } finally {
+        listener.close();
+        rep.close();
+        req.close();
+    }
+}
+
+// Minimal HTTP client for the HTTP server test
+function httpRequest(port, path, options = {}) {
+    return new Promise((resolve, reject) => {
+        const headers = Object.assign({}, options.headers);
+        if (options.body) {
+            headers['content-length'] = Buffer.byteLength(options.body);
+        }
+        const req = http.request({ host: '127.0.0.1', port, path, method: options.method || 'GET', headers }, res => {
+            const chunks = [];
+            res.on('data', chunk => chunks.push(chunk));
+            res.on('end', () => resolve({
+                status: res.statusCode,
+                headers: res.headers,
+                body: Buffer.concat(chunks).toString()
+            }));
+        });
+        req.on('error', reject);
+        if (options.body) req.write(options.body);
+        req.end();
+    });
+}
+
+// Test 21: Native HTTP server
+async function testHttpServer() {
+    console.log('\n=== Testing HTTP Server ===');
+
+    const server = new nng.HttpServer('http://127.0.0.1:5574');
+    const rep = nng.rep();
+    const req = nng.req();
+
+    try {
+        server.static('/health', 'ok', 'text/plain');
+        server.redirect('/status', '/health');
+        server.directory('/files', __dirname);
+        server.route('/echo', request => ({
+            status: 201,
+            headers: { 'x-echo': request.headers['x-token'] },
+            body: `${request.method} ${request.uri} ${request.body.toString()}`
+        }), { method: 'POST', headers: ['x-token'] });
+        server.route('/broken', () => {
+            throw new Error('handler failed');
+        });
+        server.start();
+
+        if (server.port !== 5574) {
+            throw new Error(`Unexpected port ${server.port}`);
+        }
+
+        let res = await httpRequest(5574, '/health');
+        if (res.status !== 200 || res.body !== 'ok' || res.headers['content-type'] !== 'text/plain') {
+            throw new Error('Static route mismatch');
+        }
+        res = await httpRequest(5574, '/status');
+        if (res.status !== 301 || res.headers.location !== '/health') {
+            throw new Error('Redirect mismatch');
+        }
+        res = await httpRequest(5574, '/files/test.js');
+        if (res.status !== 200 || !res.body.includes('testHttpServer')) {
+            throw new Error('Directory route mismatch');
+        }
+        console.log('✓ Static, redirect and directory routes served natively');
+
+        res = await httpRequest(5574, '/echo?x=1', {
+            method: 'POST',
+            headers: { 'x-token': 'abc' },
+            body: 'payload'
+        });
+        if (res.status !== 201 || res.body !== 'POST /echo?x=1 payload' || res.headers['x-echo'] !== 'abc') {
+            throw new Error(`Dynamic route mismatch: ${res.status} ${res.body}`);
+        }
+        res = await httpRequest(5574, '/broken');
+        if (res.status !== 500) {
+            throw new Error('Throwing handler should give 500');
+        }
+        res = await httpRequest(5574, '/missing');
+        if (res.status !== 404) {
+            throw new Error('Unknown path should give 404');
+        }
+        console.log('✓ Dynamic routes call back into JS');
+
+        // ws:// SP listeners share the same HTTP server
+        rep.listen('ws://127.0.0.1:5574/sp');
+        req.dial('ws://127.0.0.1:5574/sp');
+        const served = rep.recv().then(msg => rep.send(`ws ${msg.toString()}`));
+        await req.send('hello');
+        const reply = await req.recv();
+        await served;
+        if (reply.toString() !== 'ws hello') {
+            throw new Error('WebSocket reply mismatch');
+        }
+        res = await httpRequest(5574, '/health');
+        if (res.body !== 'ok') {
+            throw new Error('HTTP route lost after WebSocket listener');
+        }
+        console.log('✓ WebSocket SP shares the HTTP server');
+
+        console.log('✓ HTTP server test passed');
+    } catch (err) {
+        console.error('✗ HTTP server test failed:', err.message);
+        throw err;
+    } finally {
+        rep.close();
+        req.close();
+        server.close();
+    }
+}
+
 // Run all tests
 async function runTests() {
     console.log('Starting Expanded NNG Node.js Bindings Tests');
@@ -673,6 +1164,13 @@ async function runTests() {
         await testBus();
 
         await testEventDrivenRecv();
+        await testSendMany();
+        await testDeadlineAndAbort();
+        await testSurvey();
+        await testRawDevice();
+        await testReusePort();
+        await testAdoptFd();
+        await testHttpServer();
 
         console.log('\n================================================');
         console.log('All tests completed successfully!');